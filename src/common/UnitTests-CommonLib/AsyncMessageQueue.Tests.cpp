@@ -0,0 +1,193 @@
+#include "pch.h"
+#include <async_message_queue.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTestsCommonLib
+{
+    namespace
+    {
+        // The queue as it was before messages were shared: strings copied in and out, and an empty
+        // string for an interrupted queue.
+        class CopyingMessageQueue
+        {
+        public:
+            void queue_message(std::wstring message)
+            {
+                std::unique_lock lock(mutex);
+                queue.push(message);
+                lock.unlock();
+                ready.notify_one();
+            }
+
+            std::wstring pop_message()
+            {
+                std::unique_lock lock(mutex);
+                ready.wait(lock, [this] { return !queue.empty(); });
+                std::wstring message = queue.front();
+                queue.pop();
+                return message;
+            }
+
+        private:
+            std::mutex mutex;
+            std::queue<std::wstring> queue;
+            std::condition_variable ready;
+        };
+    }
+
+    TEST_CLASS(AsyncMessageQueueUnitTests)
+    {
+    public:
+        TEST_METHOD(SharedTextIsNotCopied)
+        {
+            SharedMessage message(std::wstring(1000, L'x'));
+            const auto shared = message.share();
+            Assert::IsTrue(&message.str() == &shared.str());
+
+            AsyncMessageQueue queue;
+            const wchar_t* text = message.str().c_str();
+            Assert::IsTrue(queue.queue_message(std::move(message)));
+            const auto popped = queue.pop_message();
+            Assert::IsTrue(popped.has_value());
+            Assert::IsTrue(popped->str().c_str() == text);
+        }
+
+        TEST_METHOD(EmptyMessagesAreDelivered)
+        {
+            AsyncMessageQueue queue;
+            queue.queue_message(std::wstring());
+            queue.queue_message(L"after");
+            const auto empty = queue.pop_message();
+            Assert::IsTrue(empty.has_value());
+            Assert::IsTrue(empty->empty());
+            Assert::AreEqual(std::wstring(L"after"), queue.pop_message()->str());
+        }
+
+        TEST_METHOD(InterruptIsSignaled)
+        {
+            AsyncMessageQueue queue;
+            queue.queue_message(L"left over");
+            queue.interrupt();
+            Assert::IsFalse(queue.pop_message().has_value());
+            std::vector<SharedMessage> messages;
+            Assert::AreEqual(size_t{ 0 }, queue.pop_messages(messages));
+            Assert::IsFalse(queue.queue_message(L"too late"));
+        }
+
+        TEST_METHOD(PopsBatches)
+        {
+            AsyncMessageQueue queue;
+            for (int i = 0; i < 5; i++)
+            {
+                queue.queue_message(std::to_wstring(i));
+            }
+            std::vector<SharedMessage> messages;
+            Assert::AreEqual(size_t{ 3 }, queue.pop_messages(messages, 3));
+            Assert::AreEqual(size_t{ 2 }, queue.pop_messages(messages));
+            Assert::AreEqual(size_t{ 5 }, messages.size());
+            for (int i = 0; i < 5; i++)
+            {
+                Assert::AreEqual(std::to_wstring(i), messages[i].str());
+            }
+        }
+
+        // A producer of a full bounded queue waits until the consumer makes room, or until the
+        // queue is interrupted.
+        TEST_METHOD(BoundedQueueHoldsProducersBack)
+        {
+            AsyncMessageQueue queue(2);
+            queue.queue_message(L"1");
+            queue.queue_message(L"2");
+
+            std::atomic<bool> queued = false;
+            std::thread producer([&] {
+                queue.queue_message(L"3");
+                queued = true;
+            });
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            Assert::IsFalse(queued.load());
+
+            Assert::AreEqual(std::wstring(L"1"), queue.pop_message()->str());
+            producer.join();
+            Assert::IsTrue(queued.load());
+
+            std::atomic<bool> accepted = true;
+            std::thread blocked([&] { accepted = queue.queue_message(L"4"); });
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            queue.interrupt();
+            blocked.join();
+            Assert::IsFalse(accepted.load());
+        }
+
+        // Passes settings sized messages from one thread to another through the queue as it was,
+        // and through the queue sharing the text, popping in batches. Logs the time per message.
+        TEST_METHOD(ThroughputComparedToCopyingQueue)
+        {
+            constexpr size_t messages = 2000;
+            const std::wstring settings(32 * 1024, L's');
+
+            size_t copied_length = 0;
+            const auto copying_start = std::chrono::steady_clock::now();
+            {
+                CopyingMessageQueue queue;
+                std::thread consumer([&] {
+                    for (size_t i = 0; i < messages; i++)
+                    {
+                        copied_length += queue.pop_message().length();
+                    }
+                });
+                for (size_t i = 0; i < messages; i++)
+                {
+                    std::wstring message = settings;
+                    queue.queue_message(message);
+                }
+                consumer.join();
+            }
+            const auto copying_elapsed = std::chrono::steady_clock::now() - copying_start;
+
+            size_t shared_length = 0;
+            const auto shared_start = std::chrono::steady_clock::now();
+            {
+                AsyncMessageQueue queue(64);
+                std::thread consumer([&] {
+                    size_t received = 0;
+                    std::vector<SharedMessage> batch;
+                    while (received < messages)
+                    {
+                        batch.clear();
+                        received += queue.pop_messages(batch);
+                        for (const auto& message : batch)
+                        {
+                            shared_length += message.str().length();
+                        }
+                    }
+                });
+                for (size_t i = 0; i < messages; i++)
+                {
+                    std::wstring message = settings;
+                    queue.queue_message(std::move(message));
+                }
+                consumer.join();
+            }
+            const auto shared_elapsed = std::chrono::steady_clock::now() - shared_start;
+
+            Assert::AreEqual(messages * settings.length(), copied_length);
+            Assert::AreEqual(messages * settings.length(), shared_length);
+
+            const auto per_message = [](auto elapsed) { return std::to_wstring(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / messages); };
+            const std::wstring report = L"Copying queue: " + per_message(copying_elapsed) + L" ns per message, shared message queue: " +
+                                        per_message(shared_elapsed) + L" ns per message";
+            Logger::WriteMessage(report.c_str());
+        }
+    };
+}
@@ -0,0 +1,105 @@
+#include "pch.h"
+#include <dispatch_sequence.h>
+#include <keyboard_dispatch.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTestsCommonLib
+{
+    TEST_CLASS(DispatchSequenceUnitTests)
+    {
+        struct Receiver
+        {
+            std::atomic<bool> destroyed = false;
+            std::atomic<uint64_t> calls = 0;
+        };
+
+    public:
+        TEST_METHOD(IdlePositionHasPassed)
+        {
+            DispatchSequence sequence;
+            Assert::IsTrue(sequence.passed(sequence.position()));
+
+            {
+                DispatchSequence::Scope dispatching(sequence);
+            }
+            Assert::IsTrue(sequence.passed(sequence.position()));
+        }
+
+        TEST_METHOD(RunningDispatchPassesWhenItEnds)
+        {
+            DispatchSequence sequence;
+            uint64_t position;
+            {
+                DispatchSequence::Scope dispatching(sequence);
+                position = sequence.position();
+                Assert::IsFalse(sequence.passed(position));
+            }
+            Assert::IsTrue(sequence.passed(position));
+
+            // Later dispatches don't hold it back.
+            DispatchSequence::Scope dispatching(sequence);
+            Assert::IsTrue(sequence.passed(position));
+        }
+
+        // A hook thread dispatches keystrokes without locking while another thread removes a
+        // receiver, waits for the sequence and then marks the receiver destroyed. The receiver
+        // must never be called after that.
+        TEST_METHOD(RemovedReceiverNotCalledAfterWait)
+        {
+            constexpr uint32_t vk = 0x41;
+            for (int round = 0; round < 200; round++)
+            {
+                KeyboardDispatcher<Receiver> dispatcher;
+                DispatchSequence sequence;
+                auto removed = std::make_unique<Receiver>();
+                Receiver kept;
+                dispatcher.add_receiver(removed.get(), KeyInterest{}.add_keys(vk, vk));
+                dispatcher.add_receiver(&kept, KeyInterest{}.add_keys(vk, vk));
+
+                std::atomic<bool> running = true;
+                std::atomic<uint64_t> after_destroyed = 0;
+                std::thread hook([&] {
+                    while (running)
+                    {
+                        DispatchSequence::Scope dispatching(sequence);
+                        dispatcher.dispatch(vk, true, [&](Receiver* receiver) {
+                            if (receiver->destroyed)
+                            {
+                                after_destroyed++;
+                            }
+                            receiver->calls++;
+                            return intptr_t{ 0 };
+                        });
+                    }
+                });
+
+                while (kept.calls < 10)
+                {
+                    std::this_thread::yield();
+                }
+                dispatcher.remove_receiver(removed.get());
+                const auto position = sequence.position();
+                while (!sequence.passed(position))
+                {
+                    std::this_thread::yield();
+                }
+                removed->destroyed = true;
+
+                const auto calls = kept.calls.load();
+                while (kept.calls < calls + 10)
+                {
+                    std::this_thread::yield();
+                }
+                running = false;
+                hook.join();
+
+                Assert::AreEqual(uint64_t{ 0 }, after_destroyed.load());
+            }
+        }
+    };
+}
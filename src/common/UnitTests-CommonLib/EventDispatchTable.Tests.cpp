@@ -0,0 +1,211 @@
+#include "pch.h"
+#include <event_dispatch_table.h>
+
+#include <chrono>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTestsCommonLib
+{
+    // Stands in for a module: counts the events it gets and swallows keys when asked to.
+    struct TestReceiver
+    {
+        intptr_t signal_event(const wchar_t* name, intptr_t data)
+        {
+            last_name = name;
+            received += data;
+            return swallow ? 1 : 0;
+        }
+
+        const wchar_t* last_name = nullptr;
+        intptr_t received = 0;
+        bool swallow = false;
+    };
+
+    template<typename Receiver>
+    intptr_t dispatch(const EventDispatchTable<Receiver>& table, size_t event, intptr_t data)
+    {
+        intptr_t rvalue = 0;
+        for (auto receiver : table.receivers(event))
+        {
+            rvalue |= receiver->signal_event(table.name(event), data);
+        }
+        return rvalue;
+    }
+
+    TEST_CLASS(EventDispatchTableUnitTests)
+    {
+    public:
+        TEST_METHOD(InternAssignsStableIds)
+        {
+            EventDispatchTable<TestReceiver> table;
+            Assert::AreEqual(size_t{ 0 }, table.intern(L"ll_keyboard"));
+            Assert::AreEqual(size_t{ 1 }, table.intern(L"win_hook_event"));
+            Assert::AreEqual(size_t{ 0 }, table.intern(L"ll_keyboard"));
+            Assert::AreEqual(size_t{ 1 }, table.find(L"win_hook_event"));
+            Assert::AreEqual(EventDispatchTable<TestReceiver>::invalid_event, table.find(L"unknown"));
+            Assert::AreEqual(std::wstring(L"win_hook_event"), std::wstring(table.name(1)));
+        }
+
+        TEST_METHOD(InternLimit)
+        {
+            EventDispatchTable<TestReceiver> table;
+            for (size_t i = 0; i < EventDispatchTable<TestReceiver>::max_events; i++)
+            {
+                table.intern(std::to_wstring(i));
+            }
+            Assert::ExpectException<std::length_error>([&] { table.intern(L"one too many"); });
+        }
+
+        TEST_METHOD(AddAndRemoveReceivers)
+        {
+            EventDispatchTable<TestReceiver> table;
+            const auto keyboard = table.intern(L"ll_keyboard");
+            const auto winEvent = table.intern(L"win_hook_event");
+            TestReceiver first, second;
+
+            Assert::IsTrue(table.add_receiver(L"ll_keyboard", &first));
+            Assert::IsFalse(table.add_receiver(L"ll_keyboard", &second));
+            Assert::IsTrue(table.add_receiver(L"win_hook_event", &second));
+            Assert::AreEqual(size_t{ 2 }, table.receivers(keyboard).size());
+
+            // Only events the receiver was the last one of are reported.
+            auto emptied = table.remove_receiver(&second);
+            Assert::AreEqual(size_t{ 1 }, emptied.size());
+            Assert::AreEqual(winEvent, emptied[0]);
+            Assert::AreEqual(size_t{ 1 }, table.receivers(keyboard).size());
+            Assert::IsTrue(table.receivers(winEvent).empty());
+
+            Assert::IsTrue(table.remove_receiver(&second).empty());
+            emptied = table.remove_receiver(&first);
+            Assert::AreEqual(size_t{ 1 }, emptied.size());
+            Assert::AreEqual(keyboard, emptied[0]);
+        }
+
+        TEST_METHOD(DispatchReachesEveryReceiver)
+        {
+            EventDispatchTable<TestReceiver> table;
+            TestReceiver first, second, other;
+            table.add_receiver(L"ll_keyboard", &first);
+            table.add_receiver(L"ll_keyboard", &second);
+            table.add_receiver(L"win_hook_event", &other);
+
+            second.swallow = true;
+            Assert::AreEqual(intptr_t{ 1 }, dispatch(table, table.find(L"ll_keyboard"), 5));
+            Assert::AreEqual(intptr_t{ 5 }, first.received);
+            Assert::AreEqual(intptr_t{ 5 }, second.received);
+            Assert::AreEqual(intptr_t{ 0 }, other.received);
+            Assert::AreEqual(std::wstring(L"ll_keyboard"), std::wstring(first.last_name));
+        }
+
+        TEST_METHOD(ListsLoadedBeforeAnUpdateStayValid)
+        {
+            EventDispatchTable<TestReceiver> table;
+            TestReceiver first, second;
+            table.add_receiver(L"ll_keyboard", &first);
+            const auto& before = table.receivers(0);
+
+            table.add_receiver(L"ll_keyboard", &second);
+            table.remove_receiver(&first);
+
+            Assert::AreEqual(size_t{ 1 }, before.size());
+            Assert::IsTrue(before[0] == &first);
+            Assert::IsTrue(table.receivers(0)[0] == &second);
+        }
+
+        TEST_METHOD(DispatchWhileRegistering)
+        {
+            EventDispatchTable<TestReceiver> table;
+            TestReceiver resident;
+            table.add_receiver(L"ll_keyboard", &resident);
+
+            std::atomic_bool running{ true };
+            std::thread registrations([&] {
+                std::vector<TestReceiver> transient(8);
+                while (running)
+                {
+                    for (auto& receiver : transient)
+                    {
+                        table.add_receiver(L"ll_keyboard", &receiver);
+                    }
+                    for (auto& receiver : transient)
+                    {
+                        table.remove_receiver(&receiver);
+                    }
+                }
+            });
+
+            constexpr intptr_t keystrokes = 20000;
+            for (intptr_t i = 0; i < keystrokes; i++)
+            {
+                dispatch(table, 0, 1);
+            }
+            running = false;
+            registrations.join();
+
+            // The resident receiver is in every list that was ever published.
+            Assert::AreEqual(keystrokes, resident.received);
+            Assert::AreEqual(size_t{ 1 }, table.receivers(0).size());
+        }
+
+        // Per-keystroke cost with ten modules subscribed to the keyboard hook, against looking the
+        // receivers up by name under a shared lock the way the runner used to.
+        TEST_METHOD(KeystrokeDispatchBenchmark)
+        {
+            constexpr size_t modules = 10;
+            constexpr int keystrokes = 200000;
+            const wchar_t* keyboard = L"ll_keyboard";
+
+            std::vector<TestReceiver> receivers(modules);
+            EventDispatchTable<TestReceiver> table;
+            table.intern(L"win_hook_event");
+            std::shared_mutex mutex;
+            std::unordered_map<std::wstring, std::vector<TestReceiver*>> byName;
+            for (auto& receiver : receivers)
+            {
+                table.add_receiver(keyboard, &receiver);
+                table.add_receiver(L"win_hook_event", &receiver);
+                byName[keyboard].push_back(&receiver);
+                byName[L"win_hook_event"].push_back(&receiver);
+            }
+            const auto event = table.find(keyboard);
+
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < keystrokes; i++)
+            {
+                const std::wstring name(keyboard);
+                std::shared_lock lock(mutex);
+                if (auto it = byName.find(name); it != byName.end())
+                {
+                    for (auto receiver : it->second)
+                    {
+                        receiver->signal_event(name.c_str(), 1);
+                    }
+                }
+            }
+            const auto byNameTime = std::chrono::steady_clock::now() - start;
+
+            start = std::chrono::steady_clock::now();
+            for (int i = 0; i < keystrokes; i++)
+            {
+                dispatch(table, event, 1);
+            }
+            const auto tableTime = std::chrono::steady_clock::now() - start;
+
+            for (auto const& receiver : receivers)
+            {
+                Assert::AreEqual(intptr_t{ 2 * keystrokes }, receiver.received);
+            }
+
+            const auto nanoseconds = [](auto duration) {
+                return std::to_wstring(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count() / keystrokes);
+            };
+            const std::wstring message = L"Keystroke dispatch to " + std::to_wstring(modules) + L" modules: " +
+                                         nanoseconds(tableTime) + L" ns by id, " + nanoseconds(byNameTime) + L" ns by name";
+            Logger::WriteMessage(message.c_str());
+        }
+    };
+}
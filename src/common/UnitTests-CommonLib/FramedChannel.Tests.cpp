@@ -0,0 +1,339 @@
+#include "pch.h"
+#include <framed_channel.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTestsCommonLib
+{
+    namespace
+    {
+        std::vector<uint8_t> payload_of(size_t size, uint8_t seed)
+        {
+            std::vector<uint8_t> payload(size);
+            for (size_t i = 0; i < size; i++)
+            {
+                payload[i] = static_cast<uint8_t>(seed + i);
+            }
+            return payload;
+        }
+
+        struct Recording
+        {
+            std::mutex mutex;
+            std::condition_variable changed;
+            std::vector<std::vector<uint8_t>> writes;
+            bool hold = false;
+            bool fail = false;
+            bool writing = false;
+        };
+
+        // Records what it's asked to write; a write can be held until released.
+        struct RecordingStream
+        {
+            std::shared_ptr<Recording> recording = std::make_shared<Recording>();
+
+            bool write(const uint8_t* data, size_t size)
+            {
+                std::unique_lock lock(recording->mutex);
+                recording->writing = true;
+                recording->changed.notify_all();
+                recording->changed.wait(lock, [this] { return !recording->hold; });
+                recording->writing = false;
+                recording->writes.emplace_back(data, data + size);
+                return !recording->fail;
+            }
+
+            size_t read(uint8_t*, size_t)
+            {
+                return 0;
+            }
+        };
+
+        // A connected duplex byte stream of the system: a Unix domain socket pair, or a pair of
+        // anonymous pipes on Windows.
+        class SystemStream
+        {
+        public:
+            static std::pair<SystemStream, SystemStream> connected_pair()
+            {
+#ifdef _WIN32
+                HANDLE read_a, write_a, read_b, write_b;
+                CreatePipe(&read_b, &write_a, nullptr, 64 * 1024);
+                CreatePipe(&read_a, &write_b, nullptr, 64 * 1024);
+                return { SystemStream(read_a, write_a), SystemStream(read_b, write_b) };
+#else
+                int sockets[2];
+                socketpair(AF_UNIX, SOCK_STREAM, 0, sockets);
+                return { SystemStream(sockets[0], sockets[0]), SystemStream(sockets[1], sockets[1]) };
+#endif
+            }
+
+            SystemStream(SystemStream&& other) noexcept :
+                reading(std::exchange(other.reading, invalid)), writing(std::exchange(other.writing, invalid))
+            {
+            }
+
+            ~SystemStream()
+            {
+                close_writing();
+                if (reading != invalid)
+                {
+                    close(reading);
+                }
+            }
+
+            bool write(const uint8_t* data, size_t size)
+            {
+                while (size > 0)
+                {
+#ifdef _WIN32
+                    DWORD written = 0;
+                    if (!WriteFile(writing, data, static_cast<DWORD>(size), &written, nullptr))
+                    {
+                        return false;
+                    }
+#else
+                    const auto written = ::send(writing, data, size, MSG_NOSIGNAL);
+                    if (written <= 0)
+                    {
+                        return false;
+                    }
+#endif
+                    data += written;
+                    size -= written;
+                }
+                return true;
+            }
+
+            size_t read(uint8_t* data, size_t size)
+            {
+#ifdef _WIN32
+                DWORD read = 0;
+                return ReadFile(reading, data, static_cast<DWORD>(size), &read, nullptr) ? read : 0;
+#else
+                const auto read = ::recv(reading, data, size, 0);
+                return read > 0 ? static_cast<size_t>(read) : 0;
+#endif
+            }
+
+            // The other end reads to the end of the stream after what was written.
+            void close_writing()
+            {
+                if (writing == invalid)
+                {
+                    return;
+                }
+#ifdef _WIN32
+                CloseHandle(writing);
+#else
+                shutdown(writing, SHUT_WR);
+#endif
+                writing = invalid;
+            }
+
+        private:
+#ifdef _WIN32
+            using Handle = HANDLE;
+            static inline const Handle invalid = INVALID_HANDLE_VALUE;
+            static void close(Handle handle)
+            {
+                CloseHandle(handle);
+            }
+#else
+            using Handle = int;
+            static constexpr Handle invalid = -1;
+            static void close(Handle handle)
+            {
+                ::close(handle);
+            }
+#endif
+
+            SystemStream(Handle reading, Handle writing) :
+                reading(reading), writing(writing)
+            {
+            }
+
+            Handle reading;
+            Handle writing;
+        };
+    }
+
+    TEST_CLASS(FramedChannelUnitTests)
+    {
+    public:
+        // However the bytes of a stream are split when they're read, the same frames come out,
+        // empty ones included.
+        TEST_METHOD(FramesSurviveAnyChunking)
+        {
+            const std::vector<std::vector<uint8_t>> sent = { payload_of(5, 1), {}, payload_of(300, 2), payload_of(1, 3), payload_of(70000, 4) };
+            std::vector<uint8_t> stream;
+            for (const auto& payload : sent)
+            {
+                framing::append_frame(stream, payload.data(), payload.size());
+            }
+
+            for (size_t chunk : { size_t{ 1 }, size_t{ 3 }, size_t{ 4 }, size_t{ 7 }, size_t{ 4096 }, stream.size() })
+            {
+                framing::FrameReader reader;
+                std::vector<std::vector<uint8_t>> received;
+                for (size_t offset = 0; offset < stream.size(); offset += chunk)
+                {
+                    const size_t size = (std::min)(chunk, stream.size() - offset);
+                    Assert::IsTrue(reader.feed(stream.data() + offset, size, [&](const uint8_t* payload, size_t payload_size) {
+                        received.emplace_back(payload, payload + payload_size);
+                    }));
+                }
+                Assert::IsTrue(received == sent);
+                Assert::AreEqual(size_t{ 0 }, reader.buffered());
+            }
+        }
+
+        TEST_METHOD(OversizedFrameIsCorrupt)
+        {
+            const uint8_t header[] = { 0xFF, 0xFF, 0xFF, 0xFF };
+            framing::FrameReader reader;
+            bool called = false;
+            Assert::IsFalse(reader.feed(header, sizeof(header), [&](const uint8_t*, size_t) { called = true; }));
+            Assert::IsFalse(called);
+        }
+
+        TEST_METHOD(ReconnectBacksOffAndGivesUp)
+        {
+            using std::chrono::milliseconds;
+            framing::ReconnectPolicy policy(milliseconds(10), milliseconds(50), 5);
+            const milliseconds expected[] = { milliseconds(10), milliseconds(20), milliseconds(40), milliseconds(50), milliseconds(50) };
+            for (auto delay : expected)
+            {
+                const auto next = policy.next_delay();
+                Assert::IsTrue(next.has_value());
+                Assert::AreEqual(delay.count(), next->count());
+            }
+            Assert::IsFalse(policy.next_delay().has_value());
+
+            policy.reset();
+            Assert::AreEqual(milliseconds(10).count(), policy.next_delay()->count());
+        }
+
+        // Frames sent while a write is in progress don't wait for it, they go out together in the
+        // next write.
+        TEST_METHOD(SendsArePipelined)
+        {
+            FramedChannel<RecordingStream> channel{ RecordingStream{} };
+            auto& stream = *channel.transport().recording;
+            stream.hold = true;
+
+            const auto first = payload_of(10, 1);
+            std::thread writer([&] { channel.send(first.data(), first.size()); });
+            {
+                std::unique_lock lock(stream.mutex);
+                stream.changed.wait(lock, [&] { return stream.writing; });
+            }
+
+            const auto second = payload_of(20, 2);
+            const auto third = payload_of(30, 3);
+            Assert::IsTrue(channel.send(second.data(), second.size()));
+            Assert::IsTrue(channel.send(third.data(), third.size()));
+            {
+                std::lock_guard lock(stream.mutex);
+                stream.hold = false;
+            }
+            stream.changed.notify_all();
+            writer.join();
+
+            Assert::AreEqual(size_t{ 2 }, stream.writes.size());
+            Assert::AreEqual(framing::header_size + 10, stream.writes[0].size());
+            Assert::AreEqual(2 * framing::header_size + 50, stream.writes[1].size());
+        }
+
+        TEST_METHOD(SendFailsOnceBroken)
+        {
+            FramedChannel<RecordingStream> channel{ RecordingStream{} };
+            auto& stream = *channel.transport().recording;
+            stream.fail = true;
+            const auto payload = payload_of(10, 1);
+            Assert::IsFalse(channel.send(payload.data(), payload.size()));
+            Assert::IsFalse(channel.send(payload.data(), payload.size()));
+            Assert::AreEqual(size_t{ 1 }, stream.writes.size());
+        }
+
+        // Sends a burst of settings sized messages one way and then bounces messages back and
+        // forth over a connection of the system, logging the messages per second and the round
+        // trip latency percentiles.
+        TEST_METHOD(ThroughputAndLatencyBenchmark)
+        {
+            constexpr size_t burst = 20000;
+            constexpr size_t round_trips = 2000;
+            const auto message = payload_of(512, 7);
+
+            auto [client_stream, server_stream] = SystemStream::connected_pair();
+            FramedChannel<SystemStream> client{ std::move(client_stream) };
+            FramedChannel<SystemStream> server{ std::move(server_stream) };
+
+            // The server echoes every round trip message, the burst ones are only counted.
+            std::atomic<size_t> received = 0;
+            std::thread echo([&] {
+                server.receive([&](const uint8_t* payload, size_t size) {
+                    if (received.fetch_add(1) >= burst)
+                    {
+                        server.send(payload, size);
+                    }
+                });
+            });
+
+            const auto burst_start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < burst; i++)
+            {
+                Assert::IsTrue(client.send(message.data(), message.size()));
+            }
+            while (received < burst)
+            {
+                std::this_thread::yield();
+            }
+            const auto burst_elapsed = std::chrono::steady_clock::now() - burst_start;
+
+            // Round trips are read back one at a time on this thread.
+            framing::FrameReader reader;
+            uint8_t buffer[4096];
+            std::vector<int64_t> latencies;
+            for (size_t i = 0; i < round_trips; i++)
+            {
+                const auto start = std::chrono::steady_clock::now();
+                Assert::IsTrue(client.send(message.data(), message.size()));
+                bool echoed = false;
+                while (!echoed)
+                {
+                    const size_t size = client.transport().read(buffer, sizeof(buffer));
+                    Assert::IsTrue(size > 0);
+                    reader.feed(buffer, size, [&](const uint8_t*, size_t payload_size) { echoed = payload_size == message.size(); });
+                }
+                latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+            }
+
+            client.transport().close_writing();
+            echo.join();
+            Assert::AreEqual(burst + round_trips, received.load());
+
+            std::sort(latencies.begin(), latencies.end());
+            const auto per_second = burst * 1000000000ull / std::chrono::duration_cast<std::chrono::nanoseconds>(burst_elapsed).count();
+            const std::wstring report = L"Framed channel: " + std::to_wstring(per_second) + L" messages per second, round trip p50 " +
+                                        std::to_wstring(latencies[latencies.size() / 2]) + L" us, p99 " +
+                                        std::to_wstring(latencies[latencies.size() * 99 / 100]) + L" us";
+            Logger::WriteMessage(report.c_str());
+        }
+    };
+}
@@ -0,0 +1,428 @@
+#include "pch.h"
+#include <json.h>
+#include <json_sax.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <winrt/Windows.Data.Json.h>
+#endif
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTestsCommonLib
+{
+    namespace
+    {
+        // Records the events of a parse as text.
+        struct EventRecorder
+        {
+            std::wstring events;
+
+            bool null() { events += L"n "; return true; }
+            bool boolean(bool value) { events += value ? L"t " : L"f "; return true; }
+            bool number(double value) { events += std::to_wstring(static_cast<int>(value)) + L" "; return true; }
+            bool string(std::wstring_view value) { events += L"s:" + std::wstring{ value } + L" "; return true; }
+            bool key(std::wstring_view name) { events += L"k:" + std::wstring{ name } + L" "; return true; }
+            bool start_object() { events += L"{ "; return true; }
+            bool end_object() { events += L"} "; return true; }
+            bool start_array() { events += L"[ "; return true; }
+            bool end_array() { events += L"] "; return true; }
+        };
+
+        // Counts the values of a parse and does nothing else.
+        struct EventCounter
+        {
+            size_t values = 0;
+
+            bool null() { ++values; return true; }
+            bool boolean(bool) { ++values; return true; }
+            bool number(double) { ++values; return true; }
+            bool string(std::wstring_view) { ++values; return true; }
+            bool key(std::wstring_view) { return true; }
+            bool start_object() { ++values; return true; }
+            bool end_object() { return true; }
+            bool start_array() { ++values; return true; }
+            bool end_array() { return true; }
+        };
+
+        std::filesystem::path temp_file(const std::wstring& name)
+        {
+            return std::filesystem::temp_directory_path() / (L"UnitTestsCommonLib_" + name);
+        }
+
+        void write_bytes(const std::filesystem::path& path, const std::string& bytes)
+        {
+            std::ofstream{ path, std::ios::binary }.write(bytes.data(), bytes.size());
+        }
+
+        // A settings file with a few hundred modules, like the one of the runner but bigger.
+        json::JsonObject large_settings()
+        {
+            json::JsonObject powertoys;
+            for (int module = 0; module < 400; module++)
+            {
+                json::JsonObject properties;
+                for (int i = 0; i < 20; i++)
+                {
+                    json::JsonObject property;
+                    property.SetNamedValue(L"display_name", json::value(L"Property number " + std::to_wstring(i) + L" of the module, with a \"quoted\" word"));
+                    property.SetNamedValue(L"editor_type", json::value(i % 2 ? L"bool_toggle" : L"int_spinner"));
+                    property.SetNamedValue(L"value", i % 2 ? json::value(i % 4 == 1) : json::value(i * 1.5));
+                    property.SetNamedValue(L"order", json::value(i));
+                    properties.SetNamedValue(L"property_" + std::to_wstring(i), property);
+                }
+                json::JsonObject config;
+                config.SetNamedValue(L"name", json::value(L"Module " + std::to_wstring(module)));
+                config.SetNamedValue(L"description", json::value(L"What module " + std::to_wstring(module) + L" does.\nIn a sentence or two."));
+                config.SetNamedValue(L"properties", properties);
+                powertoys.SetNamedValue(L"Module " + std::to_wstring(module), config);
+            }
+            json::JsonObject settings;
+            settings.SetNamedValue(L"powertoys", powertoys);
+            return settings;
+        }
+    }
+
+    TEST_CLASS(JsonUnitTests)
+    {
+    public:
+        TEST_METHOD(StringifyOfParsedIsTheSame)
+        {
+            const std::wstring text = L"{\"a\":[1,-2.5,1e+100,true,false,null],\"b\":{\"c\":\"text\",\"d\":{}},\"e\":[]}";
+            Assert::AreEqual(text, json::JsonValue::Parse(text).Stringify());
+            Assert::AreEqual(std::wstring{ L"[]" }, json::JsonValue::Parse(L" \r\n\t[ ] ").Stringify());
+        }
+
+        TEST_METHOD(ReadsValuesOfEveryType)
+        {
+            const auto object = json::JsonObject::Parse(L"{\"n\":null,\"b\":true,\"x\":0.25,\"s\":\"text\",\"a\":[1,\"2\"],\"o\":{\"p\":3}}");
+            Assert::AreEqual(6u, object.Size());
+            Assert::IsTrue(object.GetNamedValue(L"n").ValueType() == json::JsonValueType::Null);
+            Assert::IsTrue(object.GetNamedBoolean(L"b"));
+            Assert::AreEqual(0.25, object.GetNamedNumber(L"x"));
+            Assert::AreEqual(std::wstring{ L"text" }, object.GetNamedString(L"s"));
+            Assert::AreEqual(2u, object.GetNamedArray(L"a").Size());
+            Assert::AreEqual(1.0, object.GetNamedArray(L"a").GetNumberAt(0));
+            Assert::AreEqual(std::wstring{ L"2" }, object.GetNamedArray(L"a").GetStringAt(1));
+            Assert::AreEqual(3.0, object.GetNamedObject(L"o").GetNamedNumber(L"p"));
+
+            Assert::AreEqual(std::wstring{ L"default" }, object.GetNamedString(L"missing", L"default"));
+            Assert::IsFalse(static_cast<bool>(object.TryLookup(L"missing")));
+            Assert::ExpectException<std::out_of_range>([&] { object.GetNamedString(L"missing"); });
+            Assert::ExpectException<std::invalid_argument>([&] { object.GetNamedString(L"x"); });
+            Assert::ExpectException<std::out_of_range>([&] { object.GetNamedArray(L"a").GetAt(2); });
+        }
+
+        TEST_METHOD(UnescapesStrings)
+        {
+            const auto text = json::JsonValue::Parse(L"\"q\\\" b\\\\ s\\/ \\b\\f\\n\\r\\t \\u00e9 \\ud83d\\ude00\"").GetString();
+            Assert::AreEqual(std::wstring{ L"q\" b\\ s/ \b\f\n\r\t \u00e9 \U0001F600" }, text);
+            // Stringify escapes what it has to and nothing else.
+            Assert::AreEqual(std::wstring{ L"\"q\\\" b\\\\ s/ \\b\\f\\n\\r\\t \u00e9 \U0001F600 \\u0001\"" },
+                             json::JsonValue::CreateStringValue(text + L" \x01").Stringify());
+        }
+
+        TEST_METHOD(ReadsNumbers)
+        {
+            const auto numbers = json::JsonArray::Parse(L"[0,-0,12,-3.5,1e3,2E-2,1.5e+2,123456789012]");
+            const double expected[] = { 0, 0, 12, -3.5, 1000, 0.02, 150, 123456789012.0 };
+            for (uint32_t i = 0; i < numbers.Size(); i++)
+            {
+                Assert::AreEqual(expected[i], numbers.GetNumberAt(i));
+            }
+            Assert::AreEqual(std::wstring{ L"[0.1,-2,1e+300]" }, json::JsonValue::Parse(L"[0.1,-2.0,1e300]").Stringify());
+        }
+
+        TEST_METHOD(RefusesInvalidText)
+        {
+            const wchar_t* invalid[] = {
+                L"", L" ", L"{", L"}", L"[1,]", L"{\"a\":1,}", L"{\"a\" 1}", L"{a:1}", L"[01]", L"[1.]", L"[.5]", L"[-]",
+                L"[1e]", L"[+1]", L"tru", L"nul", L"\"open", L"\"\\x\"", L"\"\\u12\"", L"\"a\nb\"", L"[1] 2", L"{}}",
+            };
+            for (const auto text : invalid)
+            {
+                json::JsonValue value = nullptr;
+                Assert::IsFalse(json::JsonValue::TryParse(text, value), text);
+                Assert::ExpectException<std::invalid_argument>([&] { json::JsonValue::Parse(text); });
+            }
+            json::JsonObject object = nullptr;
+            Assert::IsFalse(json::JsonObject::TryParse(L"[]", object));
+            Assert::ExpectException<std::invalid_argument>([] { json::JsonObject::Parse(L"[]"); });
+
+            std::wstring deep(100000, L'[');
+            Assert::ExpectException<std::invalid_argument>([&] { json::JsonValue::Parse(deep + std::wstring(deep.size(), L']')); });
+        }
+
+        // Values are handles, the way they are in Windows.Data.Json.
+        TEST_METHOD(ChangesAreSeenThroughEveryHandle)
+        {
+            const auto settings = json::JsonObject::Parse(L"{\"properties\":{\"a\":1},\"list\":[1]}");
+            settings.GetNamedObject(L"properties").SetNamedValue(L"b", json::value(2));
+            settings.GetNamedArray(L"list").Append(json::value(L"two"));
+            Assert::AreEqual(std::wstring{ L"{\"properties\":{\"a\":1,\"b\":2},\"list\":[1,\"two\"]}" }, settings.Stringify());
+
+            const auto copy = settings;
+            copy.Remove(L"list");
+            Assert::IsFalse(settings.HasKey(L"list"));
+            Assert::IsTrue(settings.Insert(L"properties", json::value(true)));
+            Assert::IsFalse(settings.Insert(L"other", json::value(false)));
+            Assert::AreEqual(std::wstring{ L"{\"properties\":true,\"other\":false}" }, copy.Stringify());
+
+            const json::JsonArray array;
+            for (int i = 0; i < 10; i++)
+            {
+                array.InsertAt(0, json::value(i));
+            }
+            array.RemoveAt(9);
+            array.SetAt(0, json::value(L"nine"));
+            Assert::AreEqual(std::wstring{ L"[\"nine\",8,7,6,5,4,3,2,1]" }, array.Stringify());
+        }
+
+        // A value taken from a document keeps it alive, and a container keeps alive the values of
+        // other documents put into it.
+        TEST_METHOD(ValuesOutliveTheirDocument)
+        {
+            json::JsonObject nested = nullptr;
+            json::JsonValue name = nullptr;
+            json::JsonObject parent;
+            {
+                const auto document = json::JsonObject::Parse(L"{\"module\":{\"name\":\"FancyZones\",\"properties\":{\"a\":1}}}");
+                nested = document.GetNamedObject(L"module");
+                name = nested.GetNamedValue(L"name");
+                parent.SetNamedValue(L"properties", nested.GetNamedObject(L"properties"));
+            }
+            Assert::AreEqual(std::wstring{ L"FancyZones" }, name.GetString());
+            nested.Clear();
+            Assert::AreEqual(0u, nested.Size());
+            Assert::AreEqual(std::wstring{ L"{\"properties\":{\"a\":1}}" }, parent.Stringify());
+
+            // A value can be held by its own document more than once.
+            const auto array = json::JsonArray::Parse(L"[{\"a\":1}]");
+            array.Append(array.GetAt(0));
+            array.GetObjectAt(1).SetNamedValue(L"b", json::value(2));
+            Assert::AreEqual(std::wstring{ L"[{\"a\":1,\"b\":2},{\"a\":1,\"b\":2}]" }, array.Stringify());
+        }
+
+        // Like Windows.Data.Json, and like Insert: the key keeps its first place.
+        TEST_METHOD(DuplicateKeysKeepTheLastValue)
+        {
+            const auto object = json::JsonObject::Parse(L"{\"a\":1,\"b\":{\"c\":1,\"c\":[2]},\"a\":3}");
+            Assert::AreEqual(2u, object.Size());
+            Assert::AreEqual(3.0, object.GetNamedNumber(L"a"));
+            Assert::AreEqual(1u, object.GetNamedObject(L"b").Size());
+            Assert::AreEqual(std::wstring{ L"{\"a\":3,\"b\":{\"c\":[2]}}" }, object.Stringify());
+            Assert::AreEqual(std::wstring{ L"{\"a\":3,\"b\":{\"c\":[2]}}" }, json::parse_utf8("{\"a\":1,\"b\":{\"c\":1,\"c\":[2]},\"a\":3}").Stringify());
+        }
+
+        TEST_METHOD(RefusesContainersInsideThemselves)
+        {
+            const auto settings = json::JsonObject::Parse(L"{\"module\":{\"properties\":{\"list\":[1]}}}");
+            const auto module = settings.GetNamedObject(L"module");
+            const auto properties = module.GetNamedObject(L"properties");
+            const auto list = properties.GetNamedArray(L"list");
+
+            Assert::ExpectException<std::invalid_argument>([&] { settings.SetNamedValue(L"self", settings); });
+            Assert::ExpectException<std::invalid_argument>([&] { properties.Insert(L"parent", module); });
+            Assert::ExpectException<std::invalid_argument>([&] { list.Append(list); });
+            Assert::ExpectException<std::invalid_argument>([&] { list.InsertAt(0, settings); });
+            Assert::ExpectException<std::invalid_argument>([&] { list.SetAt(0, properties); });
+            Assert::AreEqual(std::wstring{ L"{\"module\":{\"properties\":{\"list\":[1]}}}" }, settings.Stringify());
+
+            // Through another document as well.
+            json::JsonArray other;
+            other.Append(settings);
+            Assert::ExpectException<std::invalid_argument>([&] { list.Append(other); });
+
+            // The same value in two places, or a copy of the container, is fine.
+            module.SetNamedValue(L"list", list);
+            list.Append(json::JsonArray::Parse(list.Stringify()));
+            Assert::AreEqual(std::wstring{ L"{\"module\":{\"properties\":{\"list\":[1,[1]]},\"list\":[1,[1]]}}" }, settings.Stringify());
+        }
+
+        // A surrogate escaped on its own is replaced, and one put into a string by hand is replaced
+        // when written as UTF-8, which has no encoding for it.
+        TEST_METHOD(LoneSurrogatesAreReplaced)
+        {
+            const auto text = json::JsonValue::Parse(L"\"a\\ud83d b\\ude00 c\\ud83d\\u0041 \\ud83d\\ude00\"").GetString();
+            Assert::AreEqual(std::wstring{ L"a\uFFFD b\uFFFD c\uFFFDA \U0001F600" }, text);
+            Assert::AreEqual(std::wstring{ L"\uFFFD" }, json::parse_utf8("\"\\udc00\"").GetString());
+
+            const auto lone = json::JsonValue::CreateStringValue(std::wstring{ L"a" } + static_cast<wchar_t>(0xD83D) + L"b");
+            Assert::AreEqual(std::string{ "\"a\xEF\xBF\xBD" "b\"" }, json::stringify_utf8(lone));
+        }
+
+        TEST_METHOD(IteratesInOrder)
+        {
+            const auto object = json::JsonObject::Parse(L"{\"c\":1,\"a\":2,\"b\":3}");
+            std::wstring keys;
+            for (const auto& member : object)
+            {
+                keys += member.Key() + std::to_wstring(static_cast<int>(member.Value().GetNumber()));
+            }
+            Assert::AreEqual(std::wstring{ L"c1a2b3" }, keys);
+
+            auto iterator = object.First();
+            Assert::IsTrue(iterator.HasCurrent());
+            Assert::IsTrue(iterator.MoveNext());
+            Assert::AreEqual(std::wstring{ L"a" }, iterator.Current().Key());
+            Assert::IsTrue(iterator.MoveNext());
+            Assert::IsFalse(iterator.MoveNext());
+            Assert::IsFalse(iterator.HasCurrent());
+
+            double sum = 0;
+            for (const auto& value : json::JsonArray::Parse(L"[1,2,3]"))
+            {
+                sum += value.GetNumber();
+            }
+            Assert::AreEqual(6.0, sum);
+        }
+
+        TEST_METHOD(SaxEventsFollowTheText)
+        {
+            EventRecorder recorder;
+            Assert::IsTrue(static_cast<bool>(json::sax_parse(L"{\"a\":[1,true,null],\"b\":{\"c\":\"d\"}}", recorder)));
+            Assert::AreEqual(std::wstring{ L"{ k:a [ 1 t n ] k:b { k:c s:d } } " }, recorder.events);
+
+            EventRecorder utf8_recorder;
+            Assert::IsTrue(static_cast<bool>(json::sax_parse_utf8("\xEF\xBB\xBF[\"\xC3\xA9\",false]", utf8_recorder)));
+            Assert::AreEqual(std::wstring{ L"[ s:\u00e9 f ] " }, utf8_recorder.events);
+
+            EventRecorder failed;
+            const auto result = json::sax_parse(L"[1, x]", failed);
+            Assert::IsFalse(static_cast<bool>(result));
+            Assert::AreEqual(size_t{ 4 }, result.offset);
+        }
+
+        // The vector scans find the same units as looking at one unit at a time, wherever they
+        // start and end.
+        template<typename Char>
+        void check_scans()
+        {
+            std::mt19937 random(42);
+            const Char units[] = { 'a', ' ', '\t', '\n', '\r', '"', '\\', 0x1F, 0x20, 0x7F, static_cast<Char>(0xE9) };
+            std::vector<Char> text(200);
+            for (int round = 0; round < 50; round++)
+            {
+                for (auto& unit : text)
+                {
+                    // Runs of the same unit, so that whole vectors of them are seen.
+                    unit = random() % 4 ? units[round % 2] : units[random() % std::size(units)];
+                }
+                for (size_t begin = 0; begin < 40; begin++)
+                {
+                    for (size_t end = begin; end <= text.size(); end += 7)
+                    {
+                        const Char* first = text.data() + begin;
+                        const Char* last = text.data() + end;
+                        const Char* special = first;
+                        while (special != last && !json::details::is_string_special(*special))
+                        {
+                            ++special;
+                        }
+                        Assert::IsTrue(special == json::details::find_string_special(first, last));
+                        const Char* token = first;
+                        while (token != last && json::details::is_whitespace(*token))
+                        {
+                            ++token;
+                        }
+                        Assert::IsTrue(token == json::details::skip_whitespace(first, last));
+                    }
+                }
+            }
+        }
+
+        TEST_METHOD(VectorScansMatchScalarScans)
+        {
+            check_scans<char>();
+            check_scans<wchar_t>();
+        }
+
+        TEST_METHOD(FilesAreUtf8)
+        {
+            const auto path = temp_file(L"FilesAreUtf8.json");
+            const auto written = json::JsonObject::Parse(L"{\"name\":\"\u00e9t\u00e9 \u4e2d \U0001F600\",\"n\":1}");
+            json::to_file(path.wstring(), written);
+            std::ifstream file{ path, std::ios::binary };
+            const std::string bytes{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+            Assert::AreEqual(std::string{ "{\"name\":\"\xC3\xA9t\xC3\xA9 \xE4\xB8\xAD \xF0\x9F\x98\x80\",\"n\":1}" }, bytes);
+
+            const auto read = json::from_file(path.wstring());
+            Assert::IsTrue(read.has_value());
+            Assert::AreEqual(written.Stringify(), read->Stringify());
+
+            // Older versions wrote every character as a single byte, and files may start with a BOM.
+            write_bytes(path, "{\"name\":\"\xE9t\xE9\"}");
+            Assert::AreEqual(std::wstring{ L"\u00e9t\u00e9" }, json::from_file(path.wstring())->GetNamedString(L"name"));
+            write_bytes(path, "\xEF\xBB\xBF{\"name\":\"\xC3\xA9t\xC3\xA9\"}");
+            Assert::AreEqual(std::wstring{ L"\u00e9t\u00e9" }, json::from_file(path.wstring())->GetNamedString(L"name"));
+
+            write_bytes(path, "");
+            Assert::IsFalse(json::from_file(path.wstring()).has_value());
+            write_bytes(path, "[1]");
+            Assert::IsFalse(json::from_file(path.wstring()).has_value());
+            std::filesystem::remove(path);
+            Assert::IsFalse(json::from_file(path.wstring()).has_value());
+        }
+
+        // Reads a settings file of about a megabyte the way from_file used to, through a wide
+        // stream, and mapped as UTF-8, then parses and writes it. Logs the throughput of each.
+        TEST_METHOD(LargeSettingsFileThroughput)
+        {
+            const auto path = temp_file(L"LargeSettingsFileThroughput.json");
+            const auto settings = large_settings();
+            json::to_file(path.wstring(), settings);
+            const double megabytes = std::filesystem::file_size(path) / (1024.0 * 1024.0);
+            constexpr int rounds = 5;
+
+            const auto measure = [&](auto&& read) {
+                const auto start = std::chrono::steady_clock::now();
+                for (int round = 0; round < rounds; round++)
+                {
+                    read();
+                }
+                const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                return std::to_wstring(static_cast<int>(megabytes * rounds / elapsed.count()));
+            };
+
+            const std::wstring text = settings.Stringify();
+            std::wstring stream_read;
+            const auto stream_throughput = measure([&] {
+                std::wifstream file(path, std::ios::binary);
+                using isbi = std::istreambuf_iterator<wchar_t>;
+                stream_read = json::JsonValue::Parse(std::wstring{ isbi{ file }, isbi{} }).Stringify();
+            });
+            Assert::AreEqual(text, stream_read);
+
+            std::wstring mapped_read;
+            const auto mapped_throughput = measure([&] { mapped_read = json::from_file(path.wstring())->Stringify(); });
+            Assert::AreEqual(text, mapped_read);
+
+            const auto parse_throughput = measure([&] { json::JsonValue::Parse(text); });
+            const auto stringify_throughput = measure([&] { settings.Stringify(); });
+            size_t values = 0;
+            const auto sax_throughput = measure([&] {
+                EventCounter counter;
+                json::sax_parse(text, counter);
+                values = counter.values;
+            });
+            Assert::IsTrue(values > 400 * 20 * 5);
+
+            std::wstring message = std::to_wstring(static_cast<int>(megabytes)) + L" MB of settings, in MB/s: wide stream read, parse and stringify " +
+                                   stream_throughput + L", mapped read, parse and stringify " + mapped_throughput + L", parse " + parse_throughput +
+                                   L", stringify " + stringify_throughput + L", SAX parse " + sax_throughput;
+#ifdef _WIN32
+            const auto winrt_throughput = measure([&] { winrt::Windows::Data::Json::JsonValue::Parse(text); });
+            message += L", Windows.Data.Json parse " + winrt_throughput;
+#endif
+            Logger::WriteMessage(message.c_str());
+            std::filesystem::remove(path);
+        }
+    };
+}
@@ -0,0 +1,183 @@
+#include "pch.h"
+#include <json_merge_patch.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTestsCommonLib
+{
+    namespace
+    {
+        json::JsonObject parse(const std::wstring& text)
+        {
+            return json::JsonObject::Parse(text);
+        }
+
+        bool same(const json::JsonObject& a, const json::JsonObject& b)
+        {
+            return json::merge_diff(a, b).Size() == 0 && json::merge_diff(b, a).Size() == 0;
+        }
+
+        // A module config the way the settings window gets it, with a handful of properties.
+        json::JsonObject module_config(int module, int value)
+        {
+            json::JsonObject properties;
+            for (int i = 0; i < 12; i++)
+            {
+                json::JsonObject property;
+                property.SetNamedValue(L"display_name", json::value(L"Property number " + std::to_wstring(i) + L" of the module"));
+                property.SetNamedValue(L"editor_type", json::value(i % 2 ? L"bool_toggle" : L"int_spinner"));
+                property.SetNamedValue(L"value", json::value(i == 0 ? value : i));
+                properties.SetNamedValue(L"property_" + std::to_wstring(i), property);
+            }
+            json::JsonObject config;
+            config.SetNamedValue(L"name", json::value(L"Module " + std::to_wstring(module)));
+            config.SetNamedValue(L"version", json::value(L"1.0"));
+            config.SetNamedValue(L"description", json::value(L"What module " + std::to_wstring(module) + L" does, in a sentence or two."));
+            config.SetNamedValue(L"properties", properties);
+            return config;
+        }
+    }
+
+    TEST_CLASS(JsonMergePatchUnitTests)
+    {
+    public:
+        TEST_METHOD(DiffOfSameObjectsIsEmpty)
+        {
+            const auto settings = parse(L"{\"a\":1,\"b\":{\"c\":[1,2],\"d\":\"text\"}}");
+            Assert::AreEqual(0u, json::merge_diff(settings, parse(L"{\"b\":{\"d\":\"text\",\"c\":[1,2]},\"a\":1}")).Size());
+        }
+
+        // Only what changed is in the patch, however deep it is; removed members are null.
+        TEST_METHOD(DiffHoldsOnlyChanges)
+        {
+            const auto from = parse(L"{\"a\":1,\"b\":{\"c\":true,\"d\":\"text\"},\"e\":[1,2],\"f\":0}");
+            const auto to = parse(L"{\"a\":1,\"b\":{\"c\":false,\"d\":\"text\"},\"e\":[1,2,3],\"g\":{\"h\":1}}");
+            const auto patch = json::merge_diff(from, to);
+            Assert::IsTrue(same(parse(L"{\"b\":{\"c\":false},\"e\":[1,2,3],\"f\":null,\"g\":{\"h\":1}}"), patch));
+            Assert::IsTrue(patch.GetNamedValue(L"f").ValueType() == json::JsonValueType::Null);
+        }
+
+        TEST_METHOD(ValueOfAnotherTypeIsReplaced)
+        {
+            const auto patch = json::merge_diff(parse(L"{\"a\":{\"b\":1},\"c\":\"1\"}"), parse(L"{\"a\":2,\"c\":1}"));
+            Assert::IsTrue(same(parse(L"{\"a\":2,\"c\":1}"), patch));
+        }
+
+        // The examples of RFC 7396 without null values in the result.
+        TEST_METHOD(AppliesPatches)
+        {
+            const wchar_t* examples[][3] = {
+                { L"{\"a\":\"b\"}", L"{\"a\":\"c\"}", L"{\"a\":\"c\"}" },
+                { L"{\"a\":\"b\"}", L"{\"b\":\"c\"}", L"{\"a\":\"b\",\"b\":\"c\"}" },
+                { L"{\"a\":\"b\"}", L"{\"a\":null}", L"{}" },
+                { L"{\"a\":\"b\",\"b\":\"c\"}", L"{\"a\":null}", L"{\"b\":\"c\"}" },
+                { L"{\"a\":[\"b\"]}", L"{\"a\":\"c\"}", L"{\"a\":\"c\"}" },
+                { L"{\"a\":\"c\"}", L"{\"a\":[\"b\"]}", L"{\"a\":[\"b\"]}" },
+                { L"{\"a\":{\"b\":\"c\"}}", L"{\"a\":{\"b\":\"d\",\"c\":null}}", L"{\"a\":{\"b\":\"d\"}}" },
+                { L"{\"a\":[{\"b\":\"c\"}]}", L"{\"a\":[1]}", L"{\"a\":[1]}" },
+                { L"{\"e\":null}", L"{\"a\":1}", L"{\"e\":null,\"a\":1}" },
+                { L"{}", L"{\"a\":{\"bb\":{\"ccc\":null}}}", L"{\"a\":{\"bb\":{}}}" },
+            };
+            for (const auto& [original, patch, result] : examples)
+            {
+                auto target = parse(original);
+                json::apply_merge_patch(target, parse(patch));
+                Assert::IsTrue(same(parse(result), target));
+            }
+        }
+
+        TEST_METHOD(DiffAppliedGivesTarget)
+        {
+            const auto from = module_config(1, 5);
+            auto to = module_config(1, 6);
+            to.SetNamedValue(L"version", json::value(L"1.1"));
+            to.GetNamedObject(L"properties").Remove(L"property_3");
+
+            auto patched = module_config(1, 5);
+            json::apply_merge_patch(patched, json::merge_diff(from, to));
+            Assert::IsTrue(same(to, patched));
+        }
+
+        // Changes one property of one of 20 modules and gets it to the other side the way the
+        // runner used to, by sending all the settings, and as a patch of the one module whose
+        // revision changed. Logs the bytes sent and the time from the change until the other side
+        // has the settings.
+        TEST_METHOD(RoundTripComparedToFullSettings)
+        {
+            constexpr int module_count = 20;
+            constexpr int rounds = 200;
+
+            json::JsonObject general;
+            general.SetNamedValue(L"startup", json::value(true));
+            general.SetNamedValue(L"theme", json::value(L"system"));
+            std::vector<json::JsonObject> configs;
+            for (int module = 0; module < module_count; module++)
+            {
+                configs.push_back(module_config(module, 0));
+            }
+
+            size_t full_bytes = 0;
+            json::JsonObject full_received;
+            const auto full_start = std::chrono::steady_clock::now();
+            for (int round = 1; round <= rounds; round++)
+            {
+                configs[round % module_count] = module_config(round % module_count, round);
+                json::JsonObject powertoys;
+                for (int module = 0; module < module_count; module++)
+                {
+                    powertoys.SetNamedValue(L"Module " + std::to_wstring(module), configs[module]);
+                }
+                json::JsonObject settings;
+                settings.SetNamedValue(L"general", general);
+                settings.SetNamedValue(L"powertoys", powertoys);
+                const std::wstring message = settings.Stringify().c_str();
+                full_bytes += message.size() * sizeof(wchar_t);
+                full_received = parse(message);
+            }
+            const auto full_elapsed = std::chrono::steady_clock::now() - full_start;
+
+            std::vector<json::JsonObject> sent;
+            json::JsonObject received_powertoys;
+            for (int module = 0; module < module_count; module++)
+            {
+                sent.push_back(module_config(module, 0));
+                received_powertoys.SetNamedValue(L"Module " + std::to_wstring(module), module_config(module, 0));
+            }
+            json::JsonObject delta_received;
+            delta_received.SetNamedValue(L"general", general);
+            delta_received.SetNamedValue(L"powertoys", received_powertoys);
+
+            size_t delta_bytes = 0;
+            const auto delta_start = std::chrono::steady_clock::now();
+            for (int round = 1; round <= rounds; round++)
+            {
+                const int changed = round % module_count;
+                const auto config = module_config(changed, round);
+                json::JsonObject powertoys;
+                powertoys.SetNamedValue(L"Module " + std::to_wstring(changed), json::merge_diff(sent[changed], config));
+                sent[changed] = config;
+                json::JsonObject patch;
+                patch.SetNamedValue(L"powertoys", powertoys);
+                json::JsonObject update;
+                update.SetNamedValue(L"version", json::value(round));
+                update.SetNamedValue(L"patch", patch);
+                const std::wstring message = update.Stringify().c_str();
+                delta_bytes += message.size() * sizeof(wchar_t);
+                json::apply_merge_patch(delta_received, parse(message).GetNamedObject(L"patch"));
+            }
+            const auto delta_elapsed = std::chrono::steady_clock::now() - delta_start;
+
+            Assert::IsTrue(same(full_received, delta_received));
+
+            const auto per_round = [](auto elapsed) { return std::to_wstring(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() / rounds); };
+            const std::wstring report = L"Full settings: " + std::to_wstring(full_bytes / rounds) + L" bytes, " + per_round(full_elapsed) +
+                                        L" us per update, merge patch: " + std::to_wstring(delta_bytes / rounds) + L" bytes, " +
+                                        per_round(delta_elapsed) + L" us per update";
+            Logger::WriteMessage(report.c_str());
+        }
+    };
+}
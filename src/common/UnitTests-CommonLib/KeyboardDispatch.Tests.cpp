@@ -0,0 +1,352 @@
+#include "pch.h"
+#include <keyboard_dispatch.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTestsCommonLib
+{
+    namespace
+    {
+        constexpr uint32_t VK_SHIFT_KEY = 0x10;
+        constexpr uint32_t VK_LEFT_SHIFT = 0xA0;
+        constexpr uint32_t VK_RIGHT_SHIFT = 0xA1;
+        constexpr uint32_t VK_LEFT_CTRL = 0xA2;
+        constexpr uint32_t VK_LEFT_WIN = 0x5B;
+        constexpr uint32_t VK_RIGHT_WIN = 0x5C;
+        constexpr uint32_t VK_LEFT_ARROW = 0x25;
+        constexpr uint32_t VK_DOWN_ARROW = 0x28;
+
+        // Stands in for a module behind the virtual signal_event of the interface.
+        class KeyboardModule
+        {
+        public:
+            explicit KeyboardModule(KeyInterest interest) :
+                interest(interest) {}
+            virtual ~KeyboardModule() = default;
+
+            virtual intptr_t signal_event(uint32_t vk, bool key_down)
+            {
+                signaled++;
+                // Modules check the key themselves, whether they were filtered or not.
+                if (key_down && interest.has_key(vk))
+                {
+                    handled++;
+                }
+                return 0;
+            }
+
+            KeyInterest interest;
+            size_t signaled = 0;
+            size_t handled = 0;
+        };
+
+        struct KeyEvent
+        {
+            uint32_t vk;
+            bool key_down;
+        };
+
+        // Someone typing text, with the occasional capital, arrow key and Win+Ctrl+Number.
+        std::vector<KeyEvent> typing_trace(size_t keystrokes)
+        {
+            std::mt19937 random(42);
+            std::vector<KeyEvent> trace;
+            const auto press = [&trace](uint32_t vk) {
+                trace.push_back({ vk, true });
+                trace.push_back({ vk, false });
+            };
+            for (size_t i = 0; i < keystrokes; i++)
+            {
+                const auto roll = random() % 100;
+                if (roll < 80)
+                {
+                    press('A' + random() % 26);
+                }
+                else if (roll < 90)
+                {
+                    press(0x20); // Space
+                }
+                else if (roll < 95)
+                {
+                    trace.push_back({ VK_LEFT_SHIFT, true });
+                    press('A' + random() % 26);
+                    trace.push_back({ VK_LEFT_SHIFT, false });
+                }
+                else if (roll < 99)
+                {
+                    press(VK_LEFT_ARROW + random() % 4);
+                }
+                else
+                {
+                    trace.push_back({ VK_LEFT_WIN, true });
+                    trace.push_back({ VK_LEFT_CTRL, true });
+                    press('0' + random() % 10);
+                    trace.push_back({ VK_LEFT_CTRL, false });
+                    trace.push_back({ VK_LEFT_WIN, false });
+                }
+            }
+            return trace;
+        }
+
+        std::wstring percentiles(std::vector<std::chrono::nanoseconds::rep> samples)
+        {
+            std::sort(begin(samples), end(samples));
+            const auto at = [&samples](double percentile) {
+                return std::to_wstring(samples[static_cast<size_t>(percentile * (samples.size() - 1))]);
+            };
+            return L"p50 " + at(0.5) + L" ns, p99 " + at(0.99) + L" ns, p99.9 " + at(0.999) + L" ns";
+        }
+    }
+
+    TEST_CLASS(KeyboardDispatchUnitTests)
+    {
+    public:
+        TEST_METHOD(InterestMatchesKeys)
+        {
+            KeyInterest interest;
+            interest.add_keys('0', '9');
+            Assert::IsTrue(interest.matches('5', true, 0));
+            Assert::IsFalse(interest.matches('A', true, 0));
+            Assert::IsFalse(interest.matches('5', false, 0));
+            Assert::IsFalse(interest.matches(300, true, 0));
+
+            interest.key_up = true;
+            Assert::IsTrue(interest.matches('5', false, 0));
+            Assert::IsTrue(KeyInterest::all_keys().matches(0xFF, false, 0));
+        }
+
+        TEST_METHOD(InterestRequiresOneOfTheModifiers)
+        {
+            KeyInterest interest;
+            interest.add_keys('L', 'L');
+            interest.modifiers = keyboard_modifiers::win | keyboard_modifiers::ctrl;
+            Assert::IsFalse(interest.matches('L', true, 0));
+            Assert::IsFalse(interest.matches('L', true, keyboard_modifiers::shift));
+            Assert::IsTrue(interest.matches('L', true, keyboard_modifiers::win));
+            Assert::IsTrue(interest.matches('L', true, keyboard_modifiers::ctrl | keyboard_modifiers::shift));
+        }
+
+        TEST_METHOD(ModifiersTrackBothKeysOfAPair)
+        {
+            ModifierState state;
+            state.update(VK_LEFT_SHIFT, true);
+            state.update(VK_RIGHT_SHIFT, true);
+            state.update(VK_LEFT_SHIFT, false);
+            Assert::AreEqual(keyboard_modifiers::shift, state.held());
+
+            state.update(VK_RIGHT_SHIFT, false);
+            state.update(VK_RIGHT_WIN, true);
+            Assert::AreEqual(keyboard_modifiers::win, state.held());
+
+            state.update(VK_SHIFT_KEY, true);
+            state.update('A', true);
+            Assert::AreEqual(keyboard_modifiers::win | keyboard_modifiers::shift, state.held());
+        }
+
+        TEST_METHOD(DispatchSignalsInterestedReceivers)
+        {
+            KeyInterest numbers;
+            numbers.add_keys('0', '9');
+            KeyInterest winL;
+            winL.add_keys('L', 'L');
+            winL.modifiers = keyboard_modifiers::win;
+
+            KeyboardModule zones(numbers), lock(winL), everything(KeyInterest::all_keys());
+            KeyboardDispatcher<KeyboardModule> dispatcher;
+            dispatcher.add_receiver(&zones, zones.interest);
+            dispatcher.add_receiver(&lock, lock.interest);
+            dispatcher.add_receiver(&everything, everything.interest);
+
+            const auto dispatch = [&dispatcher](uint32_t vk, bool key_down) {
+                return dispatcher.dispatch(vk, key_down, [vk, key_down](KeyboardModule* module) { return module->signal_event(vk, key_down); });
+            };
+            dispatch('L', true);
+            dispatch('L', false);
+            dispatch('1', true);
+            dispatch(VK_LEFT_WIN, true);
+            dispatch('L', true);
+            dispatch(VK_LEFT_WIN, false);
+
+            Assert::AreEqual(size_t{ 1 }, zones.signaled);
+            Assert::AreEqual(size_t{ 1 }, lock.signaled);
+            Assert::AreEqual(size_t{ 6 }, everything.signaled);
+
+            // Once the catch-all receiver is gone, keys nobody wants don't reach anyone.
+            dispatcher.remove_receiver(&everything);
+            dispatch('Q', true);
+            dispatch('2', true);
+            Assert::AreEqual(size_t{ 6 }, everything.signaled);
+            Assert::AreEqual(size_t{ 2 }, zones.signaled);
+            Assert::AreEqual(size_t{ 1 }, lock.signaled);
+        }
+
+        TEST_METHOD(DispatchOrsTheResults)
+        {
+            KeyboardModule first(KeyInterest::all_keys()), second(KeyInterest::all_keys());
+            KeyboardDispatcher<KeyboardModule> dispatcher;
+            dispatcher.add_receiver(&first, first.interest);
+            dispatcher.add_receiver(&second, second.interest);
+
+            const auto swallowed = dispatcher.dispatch('A', true, [&second](KeyboardModule* module) { return (module == &second) ? 1 : 0; });
+            Assert::AreEqual(intptr_t{ 1 }, swallowed);
+        }
+
+        // Replays synthetic typing through ten modules that each handle a few hotkeys, signaling
+        // every module for every key the way the runner used to, and then through the filter.
+        TEST_METHOD(TypingReplayBenchmark)
+        {
+            std::vector<KeyInterest> interests(10);
+            interests[0].add_keys('0', '9').add_keys(VK_LEFT_ARROW, VK_DOWN_ARROW); // Zones and snapping
+            for (size_t i = 1; i < interests.size(); i++)
+            {
+                // Win+<letter> hotkeys
+                interests[i].add_keys('F' + static_cast<uint32_t>(i), 'F' + static_cast<uint32_t>(i));
+                interests[i].modifiers = keyboard_modifiers::win;
+            }
+
+            std::vector<std::unique_ptr<KeyboardModule>> unfilteredModules, filteredModules;
+            KeyboardDispatcher<KeyboardModule> dispatcher;
+            for (const auto& interest : interests)
+            {
+                unfilteredModules.push_back(std::make_unique<KeyboardModule>(interest));
+                filteredModules.push_back(std::make_unique<KeyboardModule>(interest));
+                dispatcher.add_receiver(filteredModules.back().get(), interest);
+            }
+
+            const auto trace = typing_trace(100000);
+            std::vector<std::chrono::nanoseconds::rep> unfiltered, filtered;
+            unfiltered.reserve(trace.size());
+            filtered.reserve(trace.size());
+
+            for (const auto& event : trace)
+            {
+                const auto start = std::chrono::steady_clock::now();
+                for (const auto& module : unfilteredModules)
+                {
+                    module->signal_event(event.vk, event.key_down);
+                }
+                unfiltered.push_back((std::chrono::steady_clock::now() - start).count());
+            }
+
+            for (const auto& event : trace)
+            {
+                const auto start = std::chrono::steady_clock::now();
+                dispatcher.dispatch(event.vk, event.key_down, [&event](KeyboardModule* module) { return module->signal_event(event.vk, event.key_down); });
+                filtered.push_back((std::chrono::steady_clock::now() - start).count());
+            }
+
+            // Filtering may only drop the events modules ignore anyway.
+            size_t skipped = 0;
+            for (size_t i = 0; i < interests.size(); i++)
+            {
+                Assert::IsTrue(filteredModules[i]->signaled < unfilteredModules[i]->signaled);
+                skipped += unfilteredModules[i]->signaled - filteredModules[i]->signaled;
+            }
+            Assert::AreEqual(unfilteredModules[0]->handled, filteredModules[0]->handled);
+            Assert::IsTrue(skipped > 0);
+
+            const std::wstring message = L"Keystroke through 10 modules, unfiltered: " + percentiles(unfiltered) +
+                                         L"; filtered: " + percentiles(filtered) + L"; " + std::to_wstring(skipped) +
+                                         L" of " + std::to_wstring(trace.size() * interests.size()) + L" calls skipped";
+            Logger::WriteMessage(message.c_str());
+        }
+    };
+
+    TEST_CLASS(HotkeyTableUnitTests)
+    {
+        struct Pressed
+        {
+            KeyboardModule* receiver;
+            Hotkey hotkey;
+        };
+
+        static std::vector<Pressed> press(const HotkeyTable<KeyboardModule>& table, uint32_t vk, uint32_t modifiers, bool& swallowed)
+        {
+            std::vector<Pressed> pressed;
+            swallowed = table.dispatch(vk, modifiers, [&pressed](KeyboardModule* receiver, const Hotkey& hotkey) { pressed.push_back({ receiver, hotkey }); });
+            return pressed;
+        }
+
+    public:
+        TEST_METHOD(ModifiersMustMatchExactly)
+        {
+            KeyboardModule module(KeyInterest{});
+            HotkeyTable<KeyboardModule> table;
+            table.set_hotkeys(&module, { { '1', keyboard_modifiers::win | keyboard_modifiers::ctrl, true } });
+
+            bool swallowed = false;
+            auto pressed = press(table, '1', keyboard_modifiers::win | keyboard_modifiers::ctrl, swallowed);
+            Assert::IsTrue(swallowed);
+            Assert::AreEqual(size_t{ 1 }, pressed.size());
+            Assert::IsTrue(pressed[0].receiver == &module);
+            Assert::AreEqual(uint32_t{ '1' }, pressed[0].hotkey.vk);
+
+            Assert::IsTrue(press(table, '1', keyboard_modifiers::win, swallowed).empty());
+            Assert::IsFalse(swallowed);
+            Assert::IsTrue(press(table, '1', keyboard_modifiers::win | keyboard_modifiers::ctrl | keyboard_modifiers::shift, swallowed).empty());
+            Assert::IsTrue(press(table, '2', keyboard_modifiers::win | keyboard_modifiers::ctrl, swallowed).empty());
+            Assert::IsTrue(press(table, 300, 0, swallowed).empty());
+        }
+
+        TEST_METHOD(SharedHotkeyReachesEveryReceiver)
+        {
+            KeyboardModule zones(KeyInterest{}), other(KeyInterest{});
+            HotkeyTable<KeyboardModule> table;
+            table.set_hotkeys(&zones, { { '1', 0, false }, { VK_LEFT_ARROW, keyboard_modifiers::win, true } });
+            table.set_hotkeys(&other, { { '1', 0, true } });
+
+            // One receiver swallowing the key press swallows it for everyone.
+            bool swallowed = false;
+            auto pressed = press(table, '1', 0, swallowed);
+            Assert::IsTrue(swallowed);
+            Assert::AreEqual(size_t{ 2 }, pressed.size());
+            Assert::IsTrue(pressed[0].hotkey.swallow);
+
+            pressed = press(table, VK_LEFT_ARROW, keyboard_modifiers::win, swallowed);
+            Assert::AreEqual(size_t{ 1 }, pressed.size());
+            Assert::IsTrue(pressed[0].receiver == &zones);
+        }
+
+        TEST_METHOD(SetHotkeysReplacesTheList)
+        {
+            KeyboardModule zones(KeyInterest{});
+            HotkeyTable<KeyboardModule> table;
+            table.set_hotkeys(&zones, { { VK_LEFT_ARROW, keyboard_modifiers::win, true } });
+
+            // Like FancyZones dropping Win+Arrow when overriding the snap hotkeys is turned off.
+            table.set_hotkeys(&zones, { { '1', 0, false } });
+            bool swallowed = false;
+            Assert::IsTrue(press(table, VK_LEFT_ARROW, keyboard_modifiers::win, swallowed).empty());
+            Assert::AreEqual(size_t{ 1 }, press(table, '1', 0, swallowed).size());
+
+            table.remove_receiver(&zones);
+            Assert::IsTrue(press(table, '1', 0, swallowed).empty());
+        }
+
+        TEST_METHOD(TooManyDistinctMatches)
+        {
+            // Every receiver gets its own key, so each key is a match of its own.
+            std::vector<std::unique_ptr<KeyboardModule>> modules;
+            HotkeyTable<KeyboardModule> table;
+            for (uint32_t vk = 0; vk < 255; vk++)
+            {
+                modules.push_back(std::make_unique<KeyboardModule>(KeyInterest{}));
+                table.set_hotkeys(modules.back().get(), { { vk, 0, false } });
+            }
+            modules.push_back(std::make_unique<KeyboardModule>(KeyInterest{}));
+            Assert::ExpectException<std::length_error>([&] { table.set_hotkeys(modules.back().get(), { { 255, 0, false } }); });
+
+            // The table is left as it was.
+            bool swallowed = false;
+            Assert::IsTrue(press(table, 255, 0, swallowed).empty());
+            Assert::AreEqual(size_t{ 1 }, press(table, 254, 0, swallowed).size());
+            table.remove_receiver(modules.front().get());
+            table.set_hotkeys(modules.back().get(), { { 255, 0, false } });
+            Assert::AreEqual(size_t{ 1 }, press(table, 255, 0, swallowed).size());
+        }
+    };
+}
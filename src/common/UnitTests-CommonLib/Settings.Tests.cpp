@@ -100,13 +100,13 @@ namespace UnitTestsCommonLib
         TEST_METHOD(LoadFromEmptyString)
         {
             auto func = [] { PowerToyValues values = PowerToyValues::from_json_string(L""); };
-            Assert::ExpectException<winrt::hresult_error>(func);
+            Assert::ExpectException<std::invalid_argument>(func);
         }
 
         TEST_METHOD(LoadFromInvalidString_NameMissed)
         {
             auto func = [] { PowerToyValues values = PowerToyValues::from_json_string(L"{\"properties\" : {\"bool_toggle_true\":{\"value\":true},\"bool_toggle_false\":{\"value\":false},\"color_picker\" : {\"value\":\"#ff8d12\"},\"int_spinner\" : {\"value\":10},\"string_text\" : {\"value\":\"a quick fox\"}},\"version\" : \"1.0\" }"); };
-            Assert::ExpectException<winrt::hresult_error>(func);
+            Assert::ExpectException<std::out_of_range>(func);
         }
 
         TEST_METHOD(LoadFromInvalidString_VersionMissed)
@@ -0,0 +1,110 @@
+#include "pch.h"
+#include <spsc_ring.h>
+
+#include <chrono>
+#include <thread>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTestsCommonLib
+{
+    TEST_CLASS(SpscRingUnitTests)
+    {
+    public:
+        TEST_METHOD(PopsInPushOrder)
+        {
+            SpscRing<int, 4> ring;
+            int item = 0;
+            Assert::IsFalse(ring.try_pop(item));
+
+            Assert::IsTrue(ring.try_push(1));
+            Assert::IsTrue(ring.try_push(2));
+            Assert::AreEqual(size_t{ 2 }, ring.size());
+            Assert::IsTrue(ring.try_pop(item));
+            Assert::AreEqual(1, item);
+            Assert::IsTrue(ring.try_pop(item));
+            Assert::AreEqual(2, item);
+            Assert::IsFalse(ring.try_pop(item));
+        }
+
+        TEST_METHOD(PushFailsWhenFull)
+        {
+            SpscRing<int, 4> ring;
+            for (int i = 0; i < 4; i++)
+            {
+                Assert::IsTrue(ring.try_push(i));
+            }
+            Assert::IsFalse(ring.try_push(4));
+
+            int item = 0;
+            Assert::IsTrue(ring.try_pop(item));
+            Assert::IsTrue(ring.try_push(4));
+            Assert::AreEqual(size_t{ 4 }, ring.size());
+        }
+
+        TEST_METHOD(WrapsAround)
+        {
+            SpscRing<int, 4> ring;
+            int item = 0;
+            for (int i = 0; i < 100; i++)
+            {
+                Assert::IsTrue(ring.try_push(i));
+                Assert::IsTrue(ring.try_push(-i));
+                Assert::IsTrue(ring.try_pop(item));
+                Assert::AreEqual(i, item);
+                Assert::IsTrue(ring.try_pop(item));
+                Assert::AreEqual(-i, item);
+            }
+            Assert::AreEqual(size_t{ 0 }, ring.size());
+        }
+
+        // One thread pushes a sequence while another pops it, the way the keyboard hook hands
+        // hotkeys to its worker. Nothing may be lost, duplicated or reordered; pushes that find
+        // the ring full are retried and counted, and the throughput is logged.
+        TEST_METHOD(ProducerConsumerTransfer)
+        {
+            SpscRing<uint64_t, 64> ring;
+            constexpr uint64_t items = 200000;
+
+            uint64_t received = 0;
+            bool ordered = true;
+            std::thread consumer([&] {
+                uint64_t item = 0;
+                while (received < items)
+                {
+                    if (ring.try_pop(item))
+                    {
+                        ordered = ordered && (item == received);
+                        received++;
+                    }
+                    else
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+
+            const auto start = std::chrono::steady_clock::now();
+            uint64_t full = 0;
+            for (uint64_t i = 0; i < items; i++)
+            {
+                while (!ring.try_push(i))
+                {
+                    full++;
+                    std::this_thread::yield();
+                }
+            }
+            consumer.join();
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+
+            Assert::AreEqual(items, received);
+            Assert::IsTrue(ordered);
+            Assert::AreEqual(size_t{ 0 }, ring.size());
+
+            const auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+            const std::wstring message = L"SPSC ring transfer: " + std::to_wstring(nanoseconds / items) + L" ns per item, " +
+                                         std::to_wstring(full) + L" pushes found the ring full";
+            Logger::WriteMessage(message.c_str());
+        }
+    };
+}
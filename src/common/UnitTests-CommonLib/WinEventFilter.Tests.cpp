@@ -0,0 +1,211 @@
+#include "pch.h"
+#include <win_event_filter.h>
+#include <dispatch_sequence.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTestsCommonLib
+{
+    namespace
+    {
+        constexpr uint32_t MENU_START = 0x0004;
+        constexpr uint32_t MOVESIZE_START = 0x000A;
+        constexpr uint32_t MOVESIZE_END = 0x000B;
+        constexpr uint32_t OBJECT_CREATE = 0x8000;
+        constexpr uint32_t OBJECT_SHOW = 0x8002;
+        constexpr uint32_t OBJECT_FOCUS = 0x8005;
+        constexpr uint32_t OBJECT_LOCATIONCHANGE = 0x800B;
+        constexpr uint32_t OBJECT_NAMECHANGE = 0x800C;
+        constexpr uint32_t OBJECT_VALUECHANGE = 0x800E;
+        constexpr uint32_t OBJECT_UNCLOAKED = 0x8018;
+        constexpr int32_t WINDOW = 0;
+        constexpr int32_t CARET = -8;
+        constexpr int32_t CURSOR = -9;
+
+        struct Subscriber
+        {
+            size_t received = 0;
+        };
+
+        // The ranges FancyZones declares.
+        std::vector<WinEventRange> zones_ranges()
+        {
+            return { { MOVESIZE_START, MOVESIZE_END },
+                     { OBJECT_CREATE, OBJECT_SHOW, false, WINDOW },
+                     { OBJECT_LOCATIONCHANGE, OBJECT_LOCATIONCHANGE, false, WINDOW },
+                     { OBJECT_NAMECHANGE, OBJECT_NAMECHANGE },
+                     { OBJECT_UNCLOAKED, OBJECT_UNCLOAKED, false, WINDOW } };
+        }
+    }
+
+    TEST_CLASS(WinEventFilterUnitTests)
+    {
+    public:
+        TEST_METHOD(HookRangesAreMerged)
+        {
+            Subscriber zones;
+            WinEventFilter<Subscriber> filter;
+            Assert::IsTrue(filter.hook_ranges().empty());
+
+            filter.add_receiver(&zones, zones_ranges());
+            const auto ranges = filter.hook_ranges();
+            // Location and name changes are adjacent, so they share a hook.
+            const std::vector<std::pair<uint32_t, uint32_t>> expected{ { MOVESIZE_START, MOVESIZE_END },
+                                                                       { OBJECT_CREATE, OBJECT_SHOW },
+                                                                       { OBJECT_LOCATIONCHANGE, OBJECT_NAMECHANGE },
+                                                                       { OBJECT_UNCLOAKED, OBJECT_UNCLOAKED } };
+            Assert::IsTrue(expected == ranges);
+        }
+
+        TEST_METHOD(ReceiverWithoutRangesGetsEverything)
+        {
+            Subscriber zones, everything;
+            WinEventFilter<Subscriber> filter;
+            filter.add_receiver(&zones, zones_ranges());
+            filter.add_receiver(&everything, {});
+
+            const auto ranges = filter.hook_ranges();
+            Assert::AreEqual(size_t{ 1 }, ranges.size());
+            Assert::AreEqual(WinEventFilter<Subscriber>::all_events.event_min, ranges[0].first);
+            Assert::AreEqual(WinEventFilter<Subscriber>::all_events.event_max, ranges[0].second);
+            Assert::IsTrue(filter.wanted(OBJECT_FOCUS, WINDOW));
+
+            filter.remove_receiver(&everything);
+            Assert::AreEqual(size_t{ 4 }, filter.hook_ranges().size());
+            Assert::IsFalse(filter.wanted(OBJECT_FOCUS, WINDOW));
+        }
+
+        TEST_METHOD(ObjectIdsAreFiltered)
+        {
+            Subscriber zones;
+            WinEventFilter<Subscriber> filter;
+            filter.add_receiver(&zones, zones_ranges());
+
+            Assert::IsTrue(filter.wanted(OBJECT_LOCATIONCHANGE, WINDOW));
+            Assert::IsFalse(filter.wanted(OBJECT_LOCATIONCHANGE, CARET));
+            Assert::IsFalse(filter.wanted(OBJECT_LOCATIONCHANGE, CURSOR));
+            Assert::IsTrue(filter.wanted(OBJECT_NAMECHANGE, CARET));
+            Assert::IsTrue(filter.wanted(MOVESIZE_END, CURSOR));
+            Assert::IsFalse(filter.wanted(OBJECT_VALUECHANGE, WINDOW));
+        }
+
+        TEST_METHOD(DispatchSignalsInterestedReceivers)
+        {
+            Subscriber zones, menus;
+            WinEventFilter<Subscriber> filter;
+            filter.add_receiver(&zones, zones_ranges());
+            filter.add_receiver(&menus, { { MENU_START, MENU_START } });
+
+            const auto signal = [](Subscriber* subscriber) { subscriber->received++; };
+            Assert::AreEqual(size_t{ 1 }, filter.dispatch(MOVESIZE_START, WINDOW, signal));
+            Assert::AreEqual(size_t{ 1 }, filter.dispatch(MENU_START, WINDOW, signal));
+            Assert::AreEqual(size_t{ 0 }, filter.dispatch(OBJECT_LOCATIONCHANGE, CURSOR, signal));
+            Assert::AreEqual(size_t{ 1 }, zones.received);
+            Assert::AreEqual(size_t{ 1 }, menus.received);
+        }
+
+        // Replays a storm of system-wide events, mostly cursor and caret location changes, focus
+        // and value changes, and logs how many of them reach the queue per second with the filter.
+        TEST_METHOD(EventStormFiltering)
+        {
+            Subscriber zones;
+            WinEventFilter<Subscriber> filter;
+            filter.add_receiver(&zones, zones_ranges());
+
+            const std::vector<std::pair<uint32_t, int32_t>> storm{
+                { OBJECT_LOCATIONCHANGE, CURSOR }, { OBJECT_LOCATIONCHANGE, CURSOR }, { OBJECT_LOCATIONCHANGE, CARET },
+                { OBJECT_VALUECHANGE, 1 }, { OBJECT_FOCUS, 2 }, { OBJECT_LOCATIONCHANGE, WINDOW },
+                { OBJECT_SHOW, 3 }, { OBJECT_NAMECHANGE, 4 },
+            };
+            constexpr size_t rounds = 100000;
+
+            size_t queued = 0;
+            const auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < rounds; i++)
+            {
+                for (const auto& [event, object] : storm)
+                {
+                    if (filter.wanted(event, object))
+                    {
+                        queued++;
+                    }
+                }
+            }
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+
+            Assert::AreEqual(2 * rounds, queued);
+
+            const auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / (rounds * storm.size());
+            const std::wstring message = L"WinEvent storm: " + std::to_wstring(queued) + L" of " + std::to_wstring(rounds * storm.size()) +
+                                         L" events queued, " + std::to_wstring(nanoseconds) + L" ns per filter check";
+            Logger::WriteMessage(message.c_str());
+        }
+
+        // The dispatch thread signals events while a module unsubscribes: the filter is swapped
+        // for one without the module, and the hooks narrowed to the remaining ranges. Once the
+        // dispatch sequence has passed, the module is destroyed and must not be signaled again.
+        TEST_METHOD(RemovedReceiverNotSignaledAfterWait)
+        {
+            struct Module
+            {
+                std::atomic<bool> destroyed = false;
+                std::atomic<size_t> received = 0;
+            };
+
+            for (int round = 0; round < 200; round++)
+            {
+                WinEventFilter<Module> filter;
+                DispatchSequence sequence;
+                auto zones = std::make_unique<Module>();
+                Module menus;
+                filter.add_receiver(zones.get(), zones_ranges());
+                filter.add_receiver(&menus, { { MENU_START, MENU_START }, { MOVESIZE_START, MOVESIZE_START } });
+
+                std::atomic<bool> running = true;
+                std::atomic<size_t> after_destroyed = 0;
+                std::thread dispatch([&] {
+                    while (running)
+                    {
+                        DispatchSequence::Scope dispatching(sequence);
+                        filter.dispatch(MOVESIZE_START, WINDOW, [&](Module* module) {
+                            if (module->destroyed)
+                            {
+                                after_destroyed++;
+                            }
+                            module->received++;
+                        });
+                    }
+                });
+
+                while (menus.received < 10)
+                {
+                    std::this_thread::yield();
+                }
+                filter.remove_receiver(zones.get());
+                const std::vector<std::pair<uint32_t, uint32_t>> narrowed{ { MENU_START, MENU_START }, { MOVESIZE_START, MOVESIZE_START } };
+                Assert::IsTrue(narrowed == filter.hook_ranges());
+                const auto position = sequence.position();
+                while (!sequence.passed(position))
+                {
+                    std::this_thread::yield();
+                }
+                zones->destroyed = true;
+
+                const auto received = menus.received.load();
+                while (menus.received < received + 10)
+                {
+                    std::this_thread::yield();
+                }
+                running = false;
+                dispatch.join();
+
+                Assert::AreEqual(size_t{ 0 }, after_destroyed.load());
+            }
+        }
+    };
+}
@@ -3,13 +3,57 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+// A message whose text is shared rather than copied, however many queues it goes through. The
+// text can't be changed once it's in a message. Messages are move-only, so every extra reference
+// to the text is taken on purpose with share().
+class SharedMessage {
+public:
+  SharedMessage() = default;
+  explicit SharedMessage(std::wstring text) : text(std::make_shared<const std::wstring>(std::move(text))) {
+  }
+
+  SharedMessage(SharedMessage&&) noexcept = default;
+  SharedMessage& operator=(SharedMessage&&) noexcept = default;
+  SharedMessage(const SharedMessage&) = delete;
+  SharedMessage& operator=(const SharedMessage&) = delete;
+
+  SharedMessage share() const {
+    SharedMessage shared;
+    shared.text = text;
+    return shared;
+  }
+
+  const std::wstring& str() const noexcept {
+    static const std::wstring empty;
+    return text ? *text : empty;
+  }
+
+  std::wstring_view view() const noexcept {
+    return str();
+  }
+
+  bool empty() const noexcept {
+    return str().empty();
+  }
+
+private:
+  std::shared_ptr<const std::wstring> text;
+};
 
 class AsyncMessageQueue {
 private:
   std::mutex queue_mutex;
-  std::queue<std::wstring> message_queue;
+  std::queue<SharedMessage> message_queue;
   std::condition_variable message_ready;
+  std::condition_variable space_ready;
+  size_t capacity;
   bool interrupted = false;
 
   //Disable copy
@@ -17,31 +61,72 @@ private:
   AsyncMessageQueue& operator=(const AsyncMessageQueue&);
 
 public:
-  AsyncMessageQueue() {
+  // With a capacity, queue_message waits while the queue is full, so producers can't get ahead
+  // of the consumer by more than that. 0 leaves the queue unbounded.
+  explicit AsyncMessageQueue(size_t capacity = 0) : capacity(capacity) {
   }
-  void queue_message(std::wstring message) {
-    this->queue_mutex.lock();
-    this->message_queue.push(message);
-    this->queue_mutex.unlock();
+
+  // Returns false if the queue was interrupted, the message is dropped then.
+  bool queue_message(SharedMessage message) {
+    std::unique_lock<std::mutex> lock(this->queue_mutex);
+    while (this->capacity && this->message_queue.size() >= this->capacity && !this->interrupted) {
+      this->space_ready.wait(lock);
+    }
+    if (this->interrupted) {
+      return false;
+    }
+    this->message_queue.push(std::move(message));
+    lock.unlock();
     this->message_ready.notify_one();
+    return true;
   }
-  std::wstring pop_message() {
+
+  bool queue_message(std::wstring message) {
+    return queue_message(SharedMessage(std::move(message)));
+  }
+
+  // Waits for a message. Returns nothing once the queue is interrupted, even if messages are left.
+  std::optional<SharedMessage> pop_message() {
     std::unique_lock<std::mutex> lock(this->queue_mutex);
-    while (message_queue.empty() && !this->interrupted) {
+    while (this->message_queue.empty() && !this->interrupted) {
       this->message_ready.wait(lock);
     }
     if (this->interrupted) {
-      //Just returns a empty string if the queue was interrupted.
-      return std::wstring(L"");
+      return std::nullopt;
     }
-    std::wstring message = this->message_queue.front();
+    SharedMessage message = std::move(this->message_queue.front());
     this->message_queue.pop();
+    lock.unlock();
+    this->space_ready.notify_one();
     return message;
   }
+
+  // Waits for a message and appends it to messages, along with every other message queued
+  // meanwhile up to max in all. Returns how many were appended, 0 once the queue is interrupted.
+  size_t pop_messages(std::vector<SharedMessage>& messages, size_t max = SIZE_MAX) {
+    std::unique_lock<std::mutex> lock(this->queue_mutex);
+    while (this->message_queue.empty() && !this->interrupted) {
+      this->message_ready.wait(lock);
+    }
+    if (this->interrupted) {
+      return 0;
+    }
+    size_t popped = 0;
+    while (!this->message_queue.empty() && popped < max) {
+      messages.push_back(std::move(this->message_queue.front()));
+      this->message_queue.pop();
+      ++popped;
+    }
+    lock.unlock();
+    this->space_ready.notify_all();
+    return popped;
+  }
+
   void interrupt() {
     this->queue_mutex.lock();
     this->interrupted = true;
     this->queue_mutex.unlock();
     this->message_ready.notify_all();
+    this->space_ready.notify_all();
   }
 };
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// DispatchSequence tells a thread that unpublished a receiver from a lock-free dispatch table
+// (EventDispatchTable, KeyboardDispatcher, WinEventFilter, HotkeyTable) when the thread that
+// dispatches from that table can no longer be calling the receiver, so it can be destroyed.
+//
+// The dispatching thread wraps every dispatch in a Scope, which makes the count odd while the
+// dispatch runs. A dispatch that starts after the receiver was unpublished reads the new list,
+// so only the one running when position() is read can still call it: once passed() returns
+// true for that position, the receiver is no longer used.
+class DispatchSequence {
+public:
+  DispatchSequence() = default;
+  DispatchSequence(const DispatchSequence&) = delete;
+  DispatchSequence& operator=(const DispatchSequence&) = delete;
+
+  // Only used on the dispatching thread, around the load of the receiver list and every call.
+  class Scope {
+  public:
+    explicit Scope(DispatchSequence& sequence) noexcept :
+        sequence(sequence) {
+      sequence.count.fetch_add(1, std::memory_order_relaxed);
+      // Pairs with the fence in position(): either that thread sees this dispatch running, or
+      // this dispatch sees the list published before position() was called.
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    ~Scope() {
+      sequence.count.fetch_add(1, std::memory_order_release);
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+  private:
+    DispatchSequence& sequence;
+  };
+
+  // Called after unpublishing a receiver.
+  uint64_t position() const noexcept {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return count.load(std::memory_order_relaxed);
+  }
+
+  // Whether the dispatch running at position, if there was one, has finished.
+  bool passed(uint64_t position) const noexcept {
+    return (position % 2 == 0) || (count.load(std::memory_order_acquire) != position);
+  }
+
+private:
+  std::atomic<uint64_t> count = 0;
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// EventDispatchTable maps event names to small integer ids when receivers register, and keeps
+// the receivers of each event in an immutable list that is republished whenever it changes.
+// Dispatching an event is one indexed atomic load with no locking and no allocation, which
+// keeps it cheap enough to run inside hooks that Windows removes when they are slow.
+//
+// Lists that get replaced are kept until the table is destroyed, since a dispatch running on
+// another thread may still be walking them. Receivers only (un)register when modules load and
+// unload, so that stays a handful of small vectors.
+
+template<typename Receiver>
+class EventDispatchTable {
+public:
+  using event_id = size_t;
+  static constexpr size_t max_events = 16;
+  static constexpr event_id invalid_event = static_cast<event_id>(-1);
+
+  EventDispatchTable() {
+    for (auto& slot : slots) {
+      slot.store(&empty_list, std::memory_order_relaxed);
+    }
+  }
+
+  EventDispatchTable(const EventDispatchTable&) = delete;
+  EventDispatchTable& operator=(const EventDispatchTable&) = delete;
+
+  // Returns the id of the event, assigning the next one the first time the name is seen.
+  // Throws once max_events different names have been interned.
+  event_id intern(const std::wstring& name) {
+    std::unique_lock lock(mutex);
+    return intern_locked(name);
+  }
+
+  // Returns invalid_event for names that were never interned.
+  event_id find(const std::wstring& name) const {
+    std::unique_lock lock(mutex);
+    for (event_id id = 0; id < event_count; ++id) {
+      if (names[id] == name) {
+        return id;
+      }
+    }
+    return invalid_event;
+  }
+
+  // Names never change once interned, so this is safe to call while dispatching.
+  const wchar_t* name(event_id id) const {
+    return names[id].c_str();
+  }
+
+  // Returns true if the receiver is the first one of the event.
+  bool add_receiver(const std::wstring& name, Receiver* receiver) {
+    std::unique_lock lock(mutex);
+    const event_id id = intern_locked(name);
+    const auto& current = *slots[id].load(std::memory_order_relaxed);
+    auto updated = std::make_unique<std::vector<Receiver*>>(current);
+    updated->push_back(receiver);
+    publish(id, std::move(updated));
+    return current.empty();
+  }
+
+  // Removes the receiver from every event and returns the events it was the last receiver of.
+  std::vector<event_id> remove_receiver(Receiver* receiver) {
+    std::unique_lock lock(mutex);
+    std::vector<event_id> emptied;
+    for (event_id id = 0; id < event_count; ++id) {
+      const auto& current = *slots[id].load(std::memory_order_relaxed);
+      if (std::find(begin(current), end(current), receiver) == end(current)) {
+        continue;
+      }
+      auto updated = std::make_unique<std::vector<Receiver*>>(current);
+      updated->erase(std::remove(begin(*updated), end(*updated), receiver), end(*updated));
+      if (updated->empty()) {
+        emptied.push_back(id);
+      }
+      publish(id, std::move(updated));
+    }
+    return emptied;
+  }
+
+  // The receivers of the event at the time of the call. The list stays valid while the table lives.
+  const std::vector<Receiver*>& receivers(event_id id) const noexcept {
+    return *slots[id].load(std::memory_order_acquire);
+  }
+
+private:
+  event_id intern_locked(const std::wstring& name) {
+    for (event_id id = 0; id < event_count; ++id) {
+      if (names[id] == name) {
+        return id;
+      }
+    }
+    if (event_count == max_events) {
+      throw std::length_error("Too many events");
+    }
+    names[event_count] = name;
+    return event_count++;
+  }
+
+  void publish(event_id id, std::unique_ptr<std::vector<Receiver*>> list) {
+    const auto* current = list.get();
+    published.push_back(std::move(list));
+    slots[id].store(current, std::memory_order_release);
+  }
+
+  mutable std::mutex mutex;
+  std::array<std::wstring, max_events> names;
+  size_t event_count = 0;
+  const std::vector<Receiver*> empty_list;
+  std::array<std::atomic<const std::vector<Receiver*>*>, max_events> slots;
+  // Every list ever published, including the current ones.
+  std::vector<std::unique_ptr<std::vector<Receiver*>>> published;
+};
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// Length-prefixed framing, so one connection of a byte stream transport like a named pipe or a
+// socket carries any number of messages. Every frame is the payload length in 4 bytes, least
+// significant first, followed by the payload.
+//
+// FramedChannel is templated on the transport, which has to provide
+//   bool write(const uint8_t* data, size_t size);  // Writes all of it, false once the connection is gone
+//   size_t read(uint8_t* data, size_t size);       // Waits for some bytes, 0 once the connection is gone
+// Everything else only uses the standard library, so the framing can be tested and measured over
+// any transport.
+
+namespace framing {
+  constexpr size_t header_size = 4;
+  // Longer frames are taken for a corrupt stream.
+  constexpr size_t max_payload_size = 64 * 1024 * 1024;
+
+  inline void append_frame(std::vector<uint8_t>& buffer, const void* payload, size_t size) {
+    const auto length = static_cast<uint32_t>(size);
+    for (size_t i = 0; i < header_size; ++i) {
+      buffer.push_back(static_cast<uint8_t>(length >> (8 * i)));
+    }
+    const auto bytes = static_cast<const uint8_t*>(payload);
+    buffer.insert(buffer.end(), bytes, bytes + size);
+  }
+
+  // Puts frames back together from the chunks a stream is read in.
+  class FrameReader {
+  public:
+    // Calls on_frame(payload, size) for every frame the chunk completes. Returns false if the
+    // stream is corrupt, nothing more can be read from it then.
+    template<typename OnFrame>
+    bool feed(const uint8_t* data, size_t size, OnFrame&& on_frame) {
+      // Frames that arrive whole are handed out from the chunk, only the rest is copied.
+      if (pending.empty()) {
+        const size_t consumed = parse(data, size, on_frame);
+        if (consumed == npos) {
+          return false;
+        }
+        pending.assign(data + consumed, data + size);
+        return true;
+      }
+      pending.insert(pending.end(), data, data + size);
+      const size_t consumed = parse(pending.data(), pending.size(), on_frame);
+      if (consumed == npos) {
+        return false;
+      }
+      pending.erase(pending.begin(), pending.begin() + consumed);
+      return true;
+    }
+
+    // Bytes of a frame not complete yet.
+    size_t buffered() const noexcept {
+      return pending.size();
+    }
+
+  private:
+    static constexpr size_t npos = ~size_t{ 0 };
+
+    template<typename OnFrame>
+    static size_t parse(const uint8_t* data, size_t size, OnFrame& on_frame) {
+      size_t offset = 0;
+      while (size - offset >= header_size) {
+        uint32_t length = 0;
+        for (size_t i = 0; i < header_size; ++i) {
+          length |= uint32_t{ data[offset + i] } << (8 * i);
+        }
+        if (length > max_payload_size) {
+          return npos;
+        }
+        if (size - offset - header_size < length) {
+          break;
+        }
+        on_frame(data + offset + header_size, size_t{ length });
+        offset += header_size + length;
+      }
+      return offset;
+    }
+
+    std::vector<uint8_t> pending;
+  };
+
+  // Exponential backoff between connection attempts: the delay doubles after every failed attempt
+  // up to max_delay, until the caller gives up after max_attempts.
+  class ReconnectPolicy {
+  public:
+    ReconnectPolicy(std::chrono::milliseconds initial_delay = std::chrono::milliseconds(10),
+                    std::chrono::milliseconds max_delay = std::chrono::milliseconds(1000),
+                    int max_attempts = 8) :
+      initial_delay(initial_delay), max_delay(max_delay), max_attempts(max_attempts) {
+    }
+
+    // How long to wait before the next attempt, nothing once it's time to give up.
+    std::optional<std::chrono::milliseconds> next_delay() {
+      if (attempts >= max_attempts) {
+        return std::nullopt;
+      }
+      auto delay = initial_delay;
+      for (int i = 0; (i < attempts) && (delay < max_delay); ++i) {
+        delay *= 2;
+      }
+      ++attempts;
+      return delay < max_delay ? delay : max_delay;
+    }
+
+    // Called once connected, or after giving up.
+    void reset() noexcept {
+      attempts = 0;
+    }
+
+  private:
+    std::chrono::milliseconds initial_delay;
+    std::chrono::milliseconds max_delay;
+    int max_attempts;
+    int attempts = 0;
+  };
+}
+
+// FramedChannel sends and receives frames over one connection of the transport for as long as
+// it lasts. Any number of threads can send, one thread receives.
+template<typename Stream>
+class FramedChannel {
+public:
+  explicit FramedChannel(Stream stream) :
+    stream(std::move(stream)) {
+  }
+
+  FramedChannel(const FramedChannel&) = delete;
+  FramedChannel& operator=(const FramedChannel&) = delete;
+
+  // Writes are pipelined: a frame sent while another thread is writing is queued for the write
+  // after it, along with every other frame queued meanwhile, instead of waiting for its turn.
+  // Returns false once the connection is gone; frames queued for a write that then fails are lost.
+  bool send(const void* payload, size_t size) {
+    std::unique_lock lock(mutex);
+    if (broken) {
+      return false;
+    }
+    framing::append_frame(pending, payload, size);
+    if (writing) {
+      return true;
+    }
+
+    writing = true;
+    while (!pending.empty() && !broken) {
+      std::swap(pending, in_flight);
+      lock.unlock();
+      const bool written = stream.write(in_flight.data(), in_flight.size());
+      in_flight.clear();
+      lock.lock();
+      broken = !written;
+    }
+    writing = false;
+    return !broken;
+  }
+
+  // Calls on_frame(payload, size) for every frame received, until the connection is gone or the
+  // stream turns out corrupt.
+  template<typename OnFrame>
+  void receive(OnFrame&& on_frame) {
+    framing::FrameReader reader;
+    uint8_t buffer[4096];
+    while (const size_t size = stream.read(buffer, sizeof(buffer))) {
+      if (!reader.feed(buffer, size, on_frame)) {
+        break;
+      }
+    }
+  }
+
+  Stream& transport() noexcept {
+    return stream;
+  }
+
+private:
+  Stream stream;
+  std::mutex mutex;
+  std::vector<uint8_t> pending;   // Frames queued while another send is writing
+  std::vector<uint8_t> in_flight; // Only touched by the writing send
+  bool writing = false;
+  bool broken = false;
+};
@@ -1,17 +1,1215 @@
 #include "pch.h"
 #include "json.h"
+#include "json_sax.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
+#include <stdexcept>
+#include <unordered_set>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace json
 {
+  namespace details
+  {
+    // Hands out memory from chunks that are only freed all at once. Growing a container leaves
+    // its old storage behind, which a settings document doesn't do often enough to matter.
+    class Arena
+    {
+    public:
+      explicit Arena(size_t first_chunk_size) :
+        next_chunk_size(first_chunk_size)
+      {
+      }
+
+      Arena(const Arena&) = delete;
+      Arena& operator=(const Arena&) = delete;
+
+      void* allocate(size_t size, size_t alignment)
+      {
+        void* allocated = cursor;
+        if (!std::align(alignment, size, allocated, remaining))
+        {
+          const size_t chunk_size = (std::max)(size + alignment, next_chunk_size);
+          chunks.push_back(std::make_unique<std::byte[]>(chunk_size));
+          next_chunk_size *= 2;
+          allocated = chunks.back().get();
+          remaining = chunk_size;
+          std::align(alignment, size, allocated, remaining);
+        }
+        cursor = static_cast<std::byte*>(allocated) + size;
+        remaining -= size;
+        return allocated;
+      }
+
+    private:
+      // Enough for a small value created on its own, which is a document of its own.
+      alignas(std::max_align_t) std::byte initial_chunk[256];
+      std::byte* cursor = initial_chunk;
+      size_t remaining = sizeof(initial_chunk);
+      size_t next_chunk_size;
+      std::vector<std::unique_ptr<std::byte[]>> chunks;
+    };
+
+    class Document;
+
+    // Containers hold the values of their own document by pointer only, in a shared_ptr that
+    // doesn't own anything, since the document keeps them alive anyway. Values of any other
+    // document are held by a reference to it.
+    using Held = std::shared_ptr<Node>;
+
+    struct Member
+    {
+      std::wstring_view key;
+      Held value;
+    };
+
+    struct Node
+    {
+      Node(Document* document, JsonValueType type) noexcept :
+        document(document), type(type)
+      {
+      }
+
+      ~Node()
+      {
+        if (type == JsonValueType::Object)
+        {
+          std::destroy_n(members, size);
+        }
+        else if (type == JsonValueType::Array)
+        {
+          std::destroy_n(items, size);
+        }
+      }
+
+      Document* document;
+      Node* next_in_document = nullptr;
+      JsonValueType type;
+      bool boolean = false;
+      uint32_t size = 0;
+      uint32_t capacity = 0;
+      double number = 0;
+      std::wstring_view string;
+      Member* members = nullptr;
+      Held* items = nullptr;
+    };
+
+    class Document
+    {
+    public:
+      explicit Document(size_t first_chunk_size = 1024) :
+        arena(first_chunk_size)
+      {
+      }
+
+      // Nodes don't free anything, but they have to let go of the values of other documents.
+      ~Document()
+      {
+        for (Node* node = nodes; node;)
+        {
+          Node* next = node->next_in_document;
+          node->~Node();
+          node = next;
+        }
+      }
+
+      Node* create(JsonValueType type)
+      {
+        Node* node = new (arena.allocate(sizeof(Node), alignof(Node))) Node(this, type);
+        node->next_in_document = nodes;
+        nodes = node;
+        return node;
+      }
+
+      std::wstring_view copy(std::wstring_view text)
+      {
+        if (text.empty())
+        {
+          return {};
+        }
+        auto chars = static_cast<wchar_t*>(arena.allocate(text.size() * sizeof(wchar_t), alignof(wchar_t)));
+        std::memcpy(chars, text.data(), text.size() * sizeof(wchar_t));
+        return { chars, text.size() };
+      }
+
+      template<typename T>
+      T* allocate_array(uint32_t count)
+      {
+        return static_cast<T*>(arena.allocate(sizeof(T) * count, alignof(T)));
+      }
+
+    private:
+      Arena arena;
+      Node* nodes = nullptr;
+    };
+
+    struct Access
+    {
+      static const std::shared_ptr<Node>& node(const JsonValue& value) noexcept
+      {
+        return value.node;
+      }
+
+      static JsonValue value(std::shared_ptr<Node> node) noexcept
+      {
+        return JsonValue(std::move(node));
+      }
+
+      static JsonObject object(std::shared_ptr<Node> node) noexcept
+      {
+        return JsonObject(std::move(node));
+      }
+
+      static JsonArray array(std::shared_ptr<Node> node) noexcept
+      {
+        return JsonArray(std::move(node));
+      }
+    };
+
+    namespace
+    {
+      Held held_by_pointer(Node* node) noexcept
+      {
+        return Held(Held(), node);
+      }
+
+      bool is_container(const Node& node) noexcept
+      {
+        return node.type == JsonValueType::Object || node.type == JsonValueType::Array;
+      }
+
+      // Whether node is value or a value inside it, at any depth. Values held more than once
+      // are only looked into once.
+      bool contains(const Node& value, const Node& node)
+      {
+        std::vector<const Node*> unvisited{ &value };
+        std::unordered_set<const Node*> visited;
+        while (!unvisited.empty())
+        {
+          const Node* container = unvisited.back();
+          unvisited.pop_back();
+          if (container == &node)
+          {
+            return true;
+          }
+          if (!visited.insert(container).second)
+          {
+            continue;
+          }
+          for (uint32_t i = 0; i < container->size; ++i)
+          {
+            const Node* held = container->type == JsonValueType::Object ? container->members[i].value.get() : container->items[i].get();
+            if (is_container(*held))
+            {
+              unvisited.push_back(held);
+            }
+          }
+        }
+        return false;
+      }
+
+      Held held_by(const Node& container, const std::shared_ptr<Node>& value)
+      {
+        if (!value)
+        {
+          throw std::invalid_argument("JSON value is a null handle");
+        }
+        // A container holding itself would never be freed, nor be written out.
+        if (is_container(*value) && contains(*value, container))
+        {
+          throw std::invalid_argument("JSON value would contain itself");
+        }
+        return value->document == container.document ? held_by_pointer(value.get()) : value;
+      }
+
+      // A handle to a value held by a container: it keeps the value's document alive, through
+      // the handle of the container if that's the same document.
+      std::shared_ptr<Node> handle_of(const std::shared_ptr<Node>& container, const Held& held) noexcept
+      {
+        return held.use_count() ? held : std::shared_ptr<Node>(container, held.get());
+      }
+
+      std::shared_ptr<Node> create_value(JsonValueType type)
+      {
+        auto document = std::make_shared<Document>();
+        Node* node = document->create(type);
+        return std::shared_ptr<Node>(std::move(document), node);
+      }
+
+      const Node& checked(const std::shared_ptr<Node>& node, JsonValueType type)
+      {
+        if (!node)
+        {
+          throw std::invalid_argument("JSON value is a null handle");
+        }
+        if (node->type != type)
+        {
+          throw std::invalid_argument("JSON value is of another type");
+        }
+        return *node;
+      }
+
+      Node& checked_mutable(const std::shared_ptr<Node>& node, JsonValueType type)
+      {
+        return const_cast<Node&>(checked(node, type));
+      }
+
+      template<typename T>
+      void reserve(Node& node, T*& data, uint32_t needed)
+      {
+        if (needed <= node.capacity)
+        {
+          return;
+        }
+        const uint32_t capacity = (std::max)(needed, (std::max)(4u, node.capacity * 2));
+        T* grown = node.document->allocate_array<T>(capacity);
+        std::uninitialized_move_n(data, node.size, grown);
+        std::destroy_n(data, node.size);
+        data = grown;
+        node.capacity = capacity;
+      }
+
+      template<typename T>
+      void erase(Node& node, T* data, uint32_t index)
+      {
+        std::move(data + index + 1, data + node.size, data + index);
+        std::destroy_at(data + node.size - 1);
+        --node.size;
+      }
+
+      Member* find(const Node& object, std::wstring_view name) noexcept
+      {
+        for (uint32_t i = 0; i < object.size; ++i)
+        {
+          if (object.members[i].key == name)
+          {
+            return object.members + i;
+          }
+        }
+        return nullptr;
+      }
+
+      // Builds the nodes of a document from the events of a parse.
+      class DomBuilder
+      {
+      public:
+        // Deeper documents are refused, so that nothing working on them recursively runs out
+        // of stack.
+        static constexpr size_t max_depth = 512;
+
+        explicit DomBuilder(Document& document) :
+          document(document)
+        {
+        }
+
+        bool null()
+        {
+          return add(document.create(JsonValueType::Null));
+        }
+
+        bool boolean(bool value)
+        {
+          Node* node = document.create(JsonValueType::Boolean);
+          node->boolean = value;
+          return add(node);
+        }
+
+        bool number(double value)
+        {
+          Node* node = document.create(JsonValueType::Number);
+          node->number = value;
+          return add(node);
+        }
+
+        bool string(std::wstring_view value)
+        {
+          Node* node = document.create(JsonValueType::String);
+          node->string = document.copy(value);
+          return add(node);
+        }
+
+        bool key(std::wstring_view name)
+        {
+          pending_key = document.copy(name);
+          return true;
+        }
+
+        bool start_object()
+        {
+          return start(JsonValueType::Object);
+        }
+
+        // A key given more than once keeps its first place and its last value, like Insert.
+        bool end_object()
+        {
+          Frame frame = frames.back();
+          frames.pop_back();
+          const auto count = static_cast<uint32_t>(pending.size() - frame.first);
+          Node& object = *frame.container;
+          object.members = document.allocate_array<Member>(count);
+          object.capacity = count;
+          for (uint32_t i = 0; i < count; ++i)
+          {
+            const auto& [key, value] = pending[frame.first + i];
+            if (Member* member = find(object, key))
+            {
+              member->value = held_by_pointer(value);
+              continue;
+            }
+            new (object.members + object.size) Member{ key, held_by_pointer(value) };
+            ++object.size;
+          }
+          pending.resize(frame.first);
+          return true;
+        }
+
+        bool start_array()
+        {
+          return start(JsonValueType::Array);
+        }
+
+        bool end_array()
+        {
+          Frame frame = frames.back();
+          frames.pop_back();
+          const auto count = static_cast<uint32_t>(pending.size() - frame.first);
+          frame.container->items = document.allocate_array<Held>(count);
+          for (uint32_t i = 0; i < count; ++i)
+          {
+            new (frame.container->items + i) Held(held_by_pointer(pending[frame.first + i].second));
+          }
+          frame.container->size = frame.container->capacity = count;
+          pending.resize(frame.first);
+          return true;
+        }
+
+        Node* root = nullptr;
+
+      private:
+        struct Frame
+        {
+          Node* container;
+          size_t first; // Where the values of the container start in pending
+        };
+
+        bool start(JsonValueType type)
+        {
+          Node* node = document.create(type);
+          if (!add(node))
+          {
+            return false;
+          }
+          frames.push_back({ node, pending.size() });
+          return frames.size() <= max_depth;
+        }
+
+        // Values are only put into their container once it's complete, so it can be given
+        // exactly the room they need.
+        bool add(Node* node)
+        {
+          if (frames.empty())
+          {
+            root = node;
+          }
+          else
+          {
+            pending.emplace_back(pending_key, node);
+          }
+          return true;
+        }
+
+        Document& document;
+        std::vector<Frame> frames;
+        std::vector<std::pair<std::wstring_view, Node*>> pending;
+        std::wstring_view pending_key;
+      };
+
+      template<typename Parse>
+      std::shared_ptr<Node> try_parse(size_t text_bytes, Parse&& parse, size_t* error_offset = nullptr)
+      {
+        // The strings and nodes of a document take about as much room as its text widened.
+        const size_t first_chunk_size = std::clamp(text_bytes * sizeof(wchar_t), size_t{ 1024 }, size_t{ 64 * 1024 * 1024 });
+        auto document = std::make_shared<Document>(first_chunk_size);
+        DomBuilder builder(*document);
+        const ParseResult result = parse(builder);
+        if (!result)
+        {
+          if (error_offset)
+          {
+            *error_offset = result.offset;
+          }
+          return nullptr;
+        }
+        return std::shared_ptr<Node>(std::move(document), builder.root);
+      }
+
+      std::shared_ptr<Node> try_parse_wide(std::wstring_view text, size_t* error_offset = nullptr)
+      {
+        return try_parse(
+          text.size() * sizeof(wchar_t), [text](DomBuilder& builder) { return sax_parse(text, builder); }, error_offset);
+      }
+
+      std::shared_ptr<Node> parse_wide(std::wstring_view text)
+      {
+        size_t error_offset = 0;
+        auto node = try_parse_wide(text, &error_offset);
+        if (!node)
+        {
+          throw std::invalid_argument("Invalid JSON at offset " + std::to_string(error_offset));
+        }
+        return node;
+      }
+
+      // Appends JSON text to a std::wstring, or to a std::string as UTF-8.
+      template<typename String>
+      class Writer
+      {
+      public:
+        explicit Writer(String& out) :
+          out(out)
+        {
+        }
+
+        void write(const Node& node)
+        {
+          switch (node.type)
+          {
+          case JsonValueType::Null:
+            append_ascii("null");
+            break;
+          case JsonValueType::Boolean:
+            append_ascii(node.boolean ? "true" : "false");
+            break;
+          case JsonValueType::Number:
+            write_number(node.number);
+            break;
+          case JsonValueType::String:
+            write_string(node.string);
+            break;
+          case JsonValueType::Array:
+            out.push_back('[');
+            for (uint32_t i = 0; i < node.size; ++i)
+            {
+              if (i)
+              {
+                out.push_back(',');
+              }
+              write(*node.items[i]);
+            }
+            out.push_back(']');
+            break;
+          case JsonValueType::Object:
+            out.push_back('{');
+            for (uint32_t i = 0; i < node.size; ++i)
+            {
+              if (i)
+              {
+                out.push_back(',');
+              }
+              write_string(node.members[i].key);
+              out.push_back(':');
+              write(*node.members[i].value);
+            }
+            out.push_back('}');
+            break;
+          }
+        }
+
+      private:
+        void append_ascii(std::string_view text)
+        {
+          out.append(text.begin(), text.end());
+        }
+
+        void write_number(double number)
+        {
+          // JSON has no infinities or NaNs.
+          if (!std::isfinite(number))
+          {
+            append_ascii("null");
+            return;
+          }
+          char buffer[32];
+          const auto written = std::to_chars(buffer, buffer + sizeof(buffer), number);
+          append_ascii({ buffer, static_cast<size_t>(written.ptr - buffer) });
+        }
+
+        void write_string(std::wstring_view text)
+        {
+          out.push_back('"');
+          const wchar_t* p = text.data();
+          const wchar_t* end = p + text.size();
+          while (p != end)
+          {
+            const wchar_t* special = find_string_special(p, end);
+            append_run(p, special);
+            p = special;
+            if (p == end)
+            {
+              break;
+            }
+            switch (*p)
+            {
+            case L'"':
+              append_ascii("\\\"");
+              break;
+            case L'\\':
+              append_ascii("\\\\");
+              break;
+            case L'\b':
+              append_ascii("\\b");
+              break;
+            case L'\f':
+              append_ascii("\\f");
+              break;
+            case L'\n':
+              append_ascii("\\n");
+              break;
+            case L'\r':
+              append_ascii("\\r");
+              break;
+            case L'\t':
+              append_ascii("\\t");
+              break;
+            default:
+              if (static_cast<uint32_t>(*p) < 0x20)
+              {
+                const char* digits = "0123456789abcdef";
+                const char escape[] = { '\\', 'u', '0', '0', digits[*p >> 4], digits[*p & 0xF] };
+                append_ascii({ escape, sizeof(escape) });
+              }
+              else
+              {
+                append_run(p, p + 1);
+              }
+              break;
+            }
+            ++p;
+          }
+          out.push_back('"');
+        }
+
+        // Characters that need no escaping. Surrogates aren't special, so a run holds both of a pair.
+        // A surrogate without its other half has no UTF-8 encoding and is written as U+FFFD.
+        void append_run(const wchar_t* begin, const wchar_t* end)
+        {
+          if constexpr (std::is_same_v<typename String::value_type, wchar_t>)
+          {
+            out.append(begin, end);
+          }
+          else
+          {
+            for (const wchar_t* p = begin; p != end; ++p)
+            {
+              auto code_point = static_cast<uint32_t>(*p);
+              if (sizeof(wchar_t) == 2 && code_point >= 0xD800 && code_point <= 0xDBFF && p + 1 != end &&
+                  static_cast<uint32_t>(p[1]) >= 0xDC00 && static_cast<uint32_t>(p[1]) <= 0xDFFF)
+              {
+                code_point = 0x10000 + ((code_point - 0xD800) << 10) + (static_cast<uint32_t>(p[1]) - 0xDC00);
+                ++p;
+              }
+              else if (code_point >= 0xD800 && code_point <= 0xDFFF)
+              {
+                code_point = 0xFFFD;
+              }
+              append_utf8(code_point);
+            }
+          }
+        }
+
+        void append_utf8(uint32_t code_point)
+        {
+          if (code_point < 0x80)
+          {
+            out.push_back(static_cast<char>(code_point));
+          }
+          else if (code_point < 0x800)
+          {
+            out.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+            out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+          }
+          else if (code_point < 0x10000)
+          {
+            out.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+            out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+          }
+          else
+          {
+            out.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+            out.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+          }
+        }
+
+        String& out;
+      };
+
+      // A whole file mapped into memory to read it.
+      class MappedFile
+      {
+      public:
+        explicit MappedFile(std::wstring_view file_name)
+        {
+#ifdef _WIN32
+          file = CreateFileW(std::wstring{ file_name }.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+          LARGE_INTEGER file_size;
+          if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+          {
+            return;
+          }
+          mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+          if (!mapping)
+          {
+            return;
+          }
+          data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+          size = data ? static_cast<size_t>(file_size.QuadPart) : 0;
+#else
+          const int file = open(std::filesystem::path{ file_name }.c_str(), O_RDONLY);
+          struct stat status;
+          if (file == -1)
+          {
+            return;
+          }
+          if (fstat(file, &status) == 0 && status.st_size > 0)
+          {
+            void* mapped = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+            if (mapped != MAP_FAILED)
+            {
+              data = static_cast<const char*>(mapped);
+              size = static_cast<size_t>(status.st_size);
+            }
+          }
+          close(file);
+#endif
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        ~MappedFile()
+        {
+#ifdef _WIN32
+          if (data)
+          {
+            UnmapViewOfFile(data);
+          }
+          if (mapping)
+          {
+            CloseHandle(mapping);
+          }
+          if (file != INVALID_HANDLE_VALUE)
+          {
+            CloseHandle(file);
+          }
+#else
+          if (data)
+          {
+            munmap(const_cast<char*>(data), size);
+          }
+#endif
+        }
+
+        std::string_view text() const noexcept
+        {
+          return { data, size };
+        }
+
+      private:
+#ifdef _WIN32
+        HANDLE file = INVALID_HANDLE_VALUE;
+        HANDLE mapping = nullptr;
+#endif
+        const char* data = nullptr;
+        size_t size = 0;
+      };
+    }
+  }
+
+  using details::Access;
+  using details::checked;
+  using details::checked_mutable;
+  using details::create_value;
+  using details::handle_of;
+  using details::Node;
+
+  JsonValueType JsonValue::ValueType() const
+  {
+    if (!node)
+    {
+      throw std::invalid_argument("JSON value is a null handle");
+    }
+    return node->type;
+  }
+
+  bool JsonValue::GetBoolean() const
+  {
+    return checked(node, JsonValueType::Boolean).boolean;
+  }
+
+  double JsonValue::GetNumber() const
+  {
+    return checked(node, JsonValueType::Number).number;
+  }
+
+  std::wstring JsonValue::GetString() const
+  {
+    return std::wstring{ checked(node, JsonValueType::String).string };
+  }
+
+  JsonObject JsonValue::GetObjectW() const
+  {
+    checked(node, JsonValueType::Object);
+    return JsonObject(node);
+  }
+
+  JsonArray JsonValue::GetArray() const
+  {
+    checked(node, JsonValueType::Array);
+    return JsonArray(node);
+  }
+
+  std::wstring JsonValue::Stringify() const
+  {
+    std::wstring text;
+    if (!node)
+    {
+      return L"null";
+    }
+    details::Writer<std::wstring>(text).write(*node);
+    return text;
+  }
+
+  JsonValue JsonValue::Parse(std::wstring_view text)
+  {
+    return JsonValue(details::parse_wide(text));
+  }
+
+  bool JsonValue::TryParse(std::wstring_view text, JsonValue& result)
+  {
+    auto parsed = details::try_parse_wide(text);
+    if (!parsed)
+    {
+      return false;
+    }
+    result = JsonValue(std::move(parsed));
+    return true;
+  }
+
+  JsonValue JsonValue::CreateNullValue()
+  {
+    return JsonValue(create_value(JsonValueType::Null));
+  }
+
+  JsonValue JsonValue::CreateBooleanValue(bool value)
+  {
+    auto created = create_value(JsonValueType::Boolean);
+    created->boolean = value;
+    return JsonValue(std::move(created));
+  }
+
+  JsonValue JsonValue::CreateNumberValue(double value)
+  {
+    auto created = create_value(JsonValueType::Number);
+    created->number = value;
+    return JsonValue(std::move(created));
+  }
+
+  JsonValue JsonValue::CreateStringValue(std::wstring_view value)
+  {
+    auto created = create_value(JsonValueType::String);
+    created->string = created->document->copy(value);
+    return JsonValue(std::move(created));
+  }
+
+  bool JsonObjectIterator::HasCurrent() const noexcept
+  {
+    return object && index < object->size;
+  }
+
+  JsonMember JsonObjectIterator::Current() const
+  {
+    if (!HasCurrent())
+    {
+      throw std::out_of_range("JSON object iterator past the end");
+    }
+    const auto& member = object->members[index];
+    return JsonMember(member.key, Access::value(handle_of(object, member.value)));
+  }
+
+  bool JsonObjectIterator::MoveNext() noexcept
+  {
+    if (HasCurrent())
+    {
+      ++index;
+    }
+    return HasCurrent();
+  }
+
+  JsonObject::JsonObject() :
+    JsonValue(create_value(JsonValueType::Object))
+  {
+  }
+
+  JsonObject JsonObject::Parse(std::wstring_view text)
+  {
+    return JsonValue::Parse(text).GetObjectW();
+  }
+
+  bool JsonObject::TryParse(std::wstring_view text, JsonObject& result)
+  {
+    auto parsed = details::try_parse_wide(text);
+    if (!parsed || parsed->type != JsonValueType::Object)
+    {
+      return false;
+    }
+    result = JsonObject(std::move(parsed));
+    return true;
+  }
+
+  uint32_t JsonObject::Size() const noexcept
+  {
+    return node ? node->size : 0;
+  }
+
+  bool JsonObject::HasKey(std::wstring_view name) const noexcept
+  {
+    return node && details::find(*node, name);
+  }
+
+  JsonValue JsonObject::Lookup(std::wstring_view name) const
+  {
+    return GetNamedValue(name);
+  }
+
+  JsonValue JsonObject::TryLookup(std::wstring_view name) const noexcept
+  {
+    const auto member = node ? details::find(*node, name) : nullptr;
+    return member ? JsonValue(handle_of(node, member->value)) : JsonValue(nullptr);
+  }
+
+  JsonValue JsonObject::GetNamedValue(std::wstring_view name) const
+  {
+    const auto member = details::find(checked(node, JsonValueType::Object), name);
+    if (!member)
+    {
+      throw std::out_of_range("JSON object has no such member");
+    }
+    return JsonValue(handle_of(node, member->value));
+  }
+
+  JsonObject JsonObject::GetNamedObject(std::wstring_view name) const
+  {
+    return GetNamedValue(name).GetObjectW();
+  }
+
+  JsonArray JsonObject::GetNamedArray(std::wstring_view name) const
+  {
+    return GetNamedValue(name).GetArray();
+  }
+
+  std::wstring JsonObject::GetNamedString(std::wstring_view name) const
+  {
+    return GetNamedValue(name).GetString();
+  }
+
+  double JsonObject::GetNamedNumber(std::wstring_view name) const
+  {
+    return GetNamedValue(name).GetNumber();
+  }
+
+  bool JsonObject::GetNamedBoolean(std::wstring_view name) const
+  {
+    return GetNamedValue(name).GetBoolean();
+  }
+
+  JsonValue JsonObject::GetNamedValue(std::wstring_view name, const JsonValue& default_value) const
+  {
+    const auto member = TryLookup(name);
+    return member ? member : default_value;
+  }
+
+  JsonObject JsonObject::GetNamedObject(std::wstring_view name, const JsonObject& default_value) const
+  {
+    const auto member = TryLookup(name);
+    return member ? member.GetObjectW() : default_value;
+  }
+
+  JsonArray JsonObject::GetNamedArray(std::wstring_view name, const JsonArray& default_value) const
+  {
+    const auto member = TryLookup(name);
+    return member ? member.GetArray() : default_value;
+  }
+
+  std::wstring JsonObject::GetNamedString(std::wstring_view name, std::wstring_view default_value) const
+  {
+    const auto member = TryLookup(name);
+    return member ? member.GetString() : std::wstring{ default_value };
+  }
+
+  double JsonObject::GetNamedNumber(std::wstring_view name, double default_value) const
+  {
+    const auto member = TryLookup(name);
+    return member ? member.GetNumber() : default_value;
+  }
+
+  bool JsonObject::GetNamedBoolean(std::wstring_view name, bool default_value) const
+  {
+    const auto member = TryLookup(name);
+    return member ? member.GetBoolean() : default_value;
+  }
+
+  void JsonObject::SetNamedValue(std::wstring_view name, const JsonValue& value) const
+  {
+    Insert(name, value);
+  }
+
+  bool JsonObject::Insert(std::wstring_view name, const JsonValue& value) const
+  {
+    auto& object = checked_mutable(node, JsonValueType::Object);
+    auto held = details::held_by(object, Access::node(value));
+    if (const auto member = details::find(object, name))
+    {
+      member->value = std::move(held);
+      return true;
+    }
+    details::reserve(object, object.members, object.size + 1);
+    new (object.members + object.size) details::Member{ object.document->copy(name), std::move(held) };
+    ++object.size;
+    return false;
+  }
+
+  void JsonObject::Remove(std::wstring_view name) const
+  {
+    auto& object = checked_mutable(node, JsonValueType::Object);
+    const auto member = details::find(object, name);
+    if (!member)
+    {
+      throw std::out_of_range("JSON object has no such member");
+    }
+    details::erase(object, object.members, static_cast<uint32_t>(member - object.members));
+  }
+
+  void JsonObject::Clear() const noexcept
+  {
+    if (node)
+    {
+      std::destroy_n(node->members, node->size);
+      node->size = 0;
+    }
+  }
+
+  JsonObjectIterator JsonObject::First() const noexcept
+  {
+    return begin();
+  }
+
+  JsonObjectIterator JsonObject::begin() const noexcept
+  {
+    return JsonObjectIterator(node, 0);
+  }
+
+  JsonObjectIterator JsonObject::end() const noexcept
+  {
+    return JsonObjectIterator(node, Size());
+  }
+
+  bool JsonArrayIterator::HasCurrent() const noexcept
+  {
+    return array && index < array->size;
+  }
+
+  JsonValue JsonArrayIterator::Current() const
+  {
+    if (!HasCurrent())
+    {
+      throw std::out_of_range("JSON array iterator past the end");
+    }
+    return Access::value(handle_of(array, array->items[index]));
+  }
+
+  bool JsonArrayIterator::MoveNext() noexcept
+  {
+    if (HasCurrent())
+    {
+      ++index;
+    }
+    return HasCurrent();
+  }
+
+  JsonArray::JsonArray() :
+    JsonValue(create_value(JsonValueType::Array))
+  {
+  }
+
+  JsonArray JsonArray::Parse(std::wstring_view text)
+  {
+    return JsonValue::Parse(text).GetArray();
+  }
+
+  bool JsonArray::TryParse(std::wstring_view text, JsonArray& result)
+  {
+    auto parsed = details::try_parse_wide(text);
+    if (!parsed || parsed->type != JsonValueType::Array)
+    {
+      return false;
+    }
+    result = JsonArray(std::move(parsed));
+    return true;
+  }
+
+  uint32_t JsonArray::Size() const noexcept
+  {
+    return node ? node->size : 0;
+  }
+
+  JsonValue JsonArray::GetAt(uint32_t index) const
+  {
+    const auto& array = checked(node, JsonValueType::Array);
+    if (index >= array.size)
+    {
+      throw std::out_of_range("JSON array index out of range");
+    }
+    return JsonValue(handle_of(node, array.items[index]));
+  }
+
+  JsonObject JsonArray::GetObjectAt(uint32_t index) const
+  {
+    return GetAt(index).GetObjectW();
+  }
+
+  JsonArray JsonArray::GetArrayAt(uint32_t index) const
+  {
+    return GetAt(index).GetArray();
+  }
+
+  std::wstring JsonArray::GetStringAt(uint32_t index) const
+  {
+    return GetAt(index).GetString();
+  }
+
+  double JsonArray::GetNumberAt(uint32_t index) const
+  {
+    return GetAt(index).GetNumber();
+  }
+
+  bool JsonArray::GetBooleanAt(uint32_t index) const
+  {
+    return GetAt(index).GetBoolean();
+  }
+
+  void JsonArray::Append(const JsonValue& value) const
+  {
+    InsertAt(Size(), value);
+  }
+
+  void JsonArray::InsertAt(uint32_t index, const JsonValue& value) const
+  {
+    auto& array = checked_mutable(node, JsonValueType::Array);
+    if (index > array.size)
+    {
+      throw std::out_of_range("JSON array index out of range");
+    }
+    auto held = details::held_by(array, Access::node(value));
+    details::reserve(array, array.items, array.size + 1);
+    new (array.items + array.size) details::Held();
+    std::move_backward(array.items + index, array.items + array.size, array.items + array.size + 1);
+    array.items[index] = std::move(held);
+    ++array.size;
+  }
+
+  void JsonArray::SetAt(uint32_t index, const JsonValue& value) const
+  {
+    auto& array = checked_mutable(node, JsonValueType::Array);
+    if (index >= array.size)
+    {
+      throw std::out_of_range("JSON array index out of range");
+    }
+    array.items[index] = details::held_by(array, Access::node(value));
+  }
+
+  void JsonArray::RemoveAt(uint32_t index) const
+  {
+    auto& array = checked_mutable(node, JsonValueType::Array);
+    if (index >= array.size)
+    {
+      throw std::out_of_range("JSON array index out of range");
+    }
+    details::erase(array, array.items, index);
+  }
+
+  void JsonArray::Clear() const noexcept
+  {
+    if (node)
+    {
+      std::destroy_n(node->items, node->size);
+      node->size = 0;
+    }
+  }
+
+  JsonArrayIterator JsonArray::First() const noexcept
+  {
+    return begin();
+  }
+
+  JsonArrayIterator JsonArray::begin() const noexcept
+  {
+    return JsonArrayIterator(node, 0);
+  }
+
+  JsonArrayIterator JsonArray::end() const noexcept
+  {
+    return JsonArrayIterator(node, Size());
+  }
+
+  JsonValue parse_utf8(std::string_view text)
+  {
+    size_t error_offset = 0;
+    auto parsed = details::try_parse(
+      text.size(), [text](details::DomBuilder& builder) { return sax_parse_utf8(text, builder); }, &error_offset);
+    if (!parsed)
+    {
+      throw std::invalid_argument("Invalid JSON at offset " + std::to_string(error_offset));
+    }
+    return Access::value(std::move(parsed));
+  }
+
+  std::string stringify_utf8(const JsonValue& value)
+  {
+    std::string text;
+    if (!Access::node(value))
+    {
+      return "null";
+    }
+    details::Writer<std::string>(text).write(*Access::node(value));
+    return text;
+  }
+
   std::optional<JsonObject> from_file(std::wstring_view file_name)
   {
     try
     {
-      std::wifstream file(file_name.data(), std::ios::binary);
-      using isbi = std::istreambuf_iterator<wchar_t>;
-      return JsonValue::Parse(std::wstring{isbi{file}, isbi{}}).GetObjectW();
+      const details::MappedFile file(file_name);
+      const auto parsed = parse_utf8(file.text());
+      if (parsed.ValueType() != JsonValueType::Object)
+      {
+        return std::nullopt;
+      }
+      return parsed.GetObjectW();
     }
     catch(...)
     {
@@ -21,6 +1219,7 @@ namespace json
 
   void to_file(std::wstring_view file_name, const JsonObject & obj)
   {
-    std::wofstream{file_name.data(), std::ios::binary} << obj.Stringify().c_str();
+    const auto text = stringify_utf8(obj);
+    std::ofstream{ std::filesystem::path{ file_name }, std::ios::binary }.write(text.data(), text.size());
   }
 }
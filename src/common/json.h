@@ -1,16 +1,325 @@
 #pragma once
 
-#include <winrt/Windows.Foundation.h>
-#include <winrt/Windows.Data.Json.h>
-
+#include <cstdint>
+#include <iterator>
+#include <memory>
 #include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
 
+// A JSON DOM with the API of Windows.Data.Json, which it replaces, without any COM activation
+// behind it. Values are handles: copies refer to the same value, so changing an object gotten
+// from another one changes it in place.
+//
+// Parsed values live in the arena of their document, which is freed all at once when the last
+// handle to any of them goes away. Values from different documents can be mixed freely, a
+// container keeps the documents of the values put into it alive. Nothing is locked: a document
+// can be read by many threads at once, but changed by one with no one else using it.
 namespace json
 {
-  using namespace winrt::Windows::Data::Json;
+  enum class JsonValueType
+  {
+    Null,
+    Boolean,
+    Number,
+    String,
+    Array,
+    Object
+  };
+
+  namespace details
+  {
+    struct Node;
+    struct Access;
+  }
+
+  class JsonObject;
+  class JsonArray;
+
+  // Parse throws std::invalid_argument for malformed text. Of a key given twice in an object, the
+  // last value is kept; a surrogate escaped without its other half is read as U+FFFD. The
+  // accessors throw std::out_of_range for missing members and std::invalid_argument for values
+  // of another type, and putting a container into itself or into a value inside it throws
+  // std::invalid_argument.
+  class JsonValue
+  {
+  public:
+    JsonValue(std::nullptr_t) noexcept
+    {
+    }
+
+    explicit operator bool() const noexcept
+    {
+      return node != nullptr;
+    }
+
+    JsonValueType ValueType() const;
+    bool GetBoolean() const;
+    double GetNumber() const;
+    std::wstring GetString() const;
+    JsonObject GetObjectW() const;
+    JsonArray GetArray() const;
+
+    std::wstring Stringify() const;
+
+    static JsonValue Parse(std::wstring_view text);
+    static bool TryParse(std::wstring_view text, JsonValue& result);
+
+    static JsonValue CreateNullValue();
+    static JsonValue CreateBooleanValue(bool value);
+    static JsonValue CreateNumberValue(double value);
+    static JsonValue CreateStringValue(std::wstring_view value);
+
+  protected:
+    explicit JsonValue(std::shared_ptr<details::Node> node) noexcept :
+      node(std::move(node))
+    {
+    }
+
+    std::shared_ptr<details::Node> node;
+
+    friend class JsonObject;
+    friend class JsonArray;
+    friend struct details::Access;
+  };
+
+  // A member of an object, as iterating over the object gives them.
+  class JsonMember
+  {
+  public:
+    std::wstring Key() const
+    {
+      return std::wstring{ key };
+    }
+
+    // The key without copying it, valid until the object is changed.
+    std::wstring_view KeyView() const noexcept
+    {
+      return key;
+    }
+
+    JsonValue Value() const
+    {
+      return value;
+    }
+
+  private:
+    JsonMember(std::wstring_view key, JsonValue value) :
+      key(key), value(std::move(value))
+    {
+    }
+
+    std::wstring_view key;
+    JsonValue value;
+
+    friend class JsonObjectIterator;
+  };
+
+  // Iterates over the members of an object in the order they were added, both the way of
+  // Windows.Data.Json (HasCurrent/Current/MoveNext) and as a standard input iterator.
+  class JsonObjectIterator
+  {
+  public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = JsonMember;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = JsonMember;
+
+    bool HasCurrent() const noexcept;
+    JsonMember Current() const;
+    bool MoveNext() noexcept;
+
+    JsonMember operator*() const
+    {
+      return Current();
+    }
+
+    JsonObjectIterator& operator++() noexcept
+    {
+      ++index;
+      return *this;
+    }
+
+    bool operator==(const JsonObjectIterator& other) const noexcept
+    {
+      return index == other.index;
+    }
+
+    bool operator!=(const JsonObjectIterator& other) const noexcept
+    {
+      return index != other.index;
+    }
+
+  private:
+    JsonObjectIterator(std::shared_ptr<details::Node> object, uint32_t index) noexcept :
+      object(std::move(object)), index(index)
+    {
+    }
+
+    std::shared_ptr<details::Node> object;
+    uint32_t index;
+
+    friend class JsonObject;
+  };
 
+  class JsonObject : public JsonValue
+  {
+  public:
+    // A new empty object.
+    JsonObject();
+    JsonObject(std::nullptr_t) noexcept :
+      JsonValue(nullptr)
+    {
+    }
+
+    static JsonObject Parse(std::wstring_view text);
+    static bool TryParse(std::wstring_view text, JsonObject& result);
+
+    uint32_t Size() const noexcept;
+    bool HasKey(std::wstring_view name) const noexcept;
+    JsonValue Lookup(std::wstring_view name) const;
+    // A null handle if there's no such member.
+    JsonValue TryLookup(std::wstring_view name) const noexcept;
+
+    JsonValue GetNamedValue(std::wstring_view name) const;
+    JsonObject GetNamedObject(std::wstring_view name) const;
+    JsonArray GetNamedArray(std::wstring_view name) const;
+    std::wstring GetNamedString(std::wstring_view name) const;
+    double GetNamedNumber(std::wstring_view name) const;
+    bool GetNamedBoolean(std::wstring_view name) const;
+
+    // These return the default value if there's no such member.
+    JsonValue GetNamedValue(std::wstring_view name, const JsonValue& default_value) const;
+    JsonObject GetNamedObject(std::wstring_view name, const JsonObject& default_value) const;
+    JsonArray GetNamedArray(std::wstring_view name, const JsonArray& default_value) const;
+    std::wstring GetNamedString(std::wstring_view name, std::wstring_view default_value) const;
+    double GetNamedNumber(std::wstring_view name, double default_value) const;
+    bool GetNamedBoolean(std::wstring_view name, bool default_value) const;
+
+    // Changing a value doesn't change the handle, so these are const the way they are for
+    // Windows.Data.Json.
+    void SetNamedValue(std::wstring_view name, const JsonValue& value) const;
+    // Returns whether a member was replaced.
+    bool Insert(std::wstring_view name, const JsonValue& value) const;
+    void Remove(std::wstring_view name) const;
+    void Clear() const noexcept;
+
+    JsonObjectIterator First() const noexcept;
+    JsonObjectIterator begin() const noexcept;
+    JsonObjectIterator end() const noexcept;
+
+  private:
+    explicit JsonObject(std::shared_ptr<details::Node> node) noexcept :
+      JsonValue(std::move(node))
+    {
+    }
+
+    friend class JsonValue;
+    friend class JsonArray;
+    friend struct details::Access;
+  };
+
+  class JsonArrayIterator
+  {
+  public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = JsonValue;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = JsonValue;
+
+    bool HasCurrent() const noexcept;
+    JsonValue Current() const;
+    bool MoveNext() noexcept;
+
+    JsonValue operator*() const
+    {
+      return Current();
+    }
+
+    JsonArrayIterator& operator++() noexcept
+    {
+      ++index;
+      return *this;
+    }
+
+    bool operator==(const JsonArrayIterator& other) const noexcept
+    {
+      return index == other.index;
+    }
+
+    bool operator!=(const JsonArrayIterator& other) const noexcept
+    {
+      return index != other.index;
+    }
+
+  private:
+    JsonArrayIterator(std::shared_ptr<details::Node> array, uint32_t index) noexcept :
+      array(std::move(array)), index(index)
+    {
+    }
+
+    std::shared_ptr<details::Node> array;
+    uint32_t index;
+
+    friend class JsonArray;
+  };
+
+  class JsonArray : public JsonValue
+  {
+  public:
+    // A new empty array.
+    JsonArray();
+    JsonArray(std::nullptr_t) noexcept :
+      JsonValue(nullptr)
+    {
+    }
+
+    static JsonArray Parse(std::wstring_view text);
+    static bool TryParse(std::wstring_view text, JsonArray& result);
+
+    uint32_t Size() const noexcept;
+    JsonValue GetAt(uint32_t index) const;
+    JsonObject GetObjectAt(uint32_t index) const;
+    JsonArray GetArrayAt(uint32_t index) const;
+    std::wstring GetStringAt(uint32_t index) const;
+    double GetNumberAt(uint32_t index) const;
+    bool GetBooleanAt(uint32_t index) const;
+
+    void Append(const JsonValue& value) const;
+    void InsertAt(uint32_t index, const JsonValue& value) const;
+    void SetAt(uint32_t index, const JsonValue& value) const;
+    void RemoveAt(uint32_t index) const;
+    void Clear() const noexcept;
+
+    JsonArrayIterator First() const noexcept;
+    JsonArrayIterator begin() const noexcept;
+    JsonArrayIterator end() const noexcept;
+
+  private:
+    explicit JsonArray(std::shared_ptr<details::Node> node) noexcept :
+      JsonValue(std::move(node))
+    {
+    }
+
+    friend class JsonValue;
+    friend class JsonObject;
+    friend struct details::Access;
+  };
+
+  // Parses UTF-8 text. Bytes that aren't valid UTF-8 are taken for Latin-1 characters, the way
+  // settings files written by older versions read.
+  JsonValue parse_utf8(std::string_view text);
+
+  // Stringify, as UTF-8.
+  std::string stringify_utf8(const JsonValue& value);
+
+  // The file is mapped into memory rather than read, and parsed as UTF-8 (see parse_utf8).
   std::optional<JsonObject> from_file(std::wstring_view file_name);
 
+  // Writes the object as UTF-8.
   void to_file(std::wstring_view file_name, const JsonObject& obj);
 
   inline bool has(
@@ -18,13 +327,14 @@ namespace json
     std::wstring_view name,
     const json::JsonValueType type = JsonValueType::Object)
   {
-    return o.HasKey(name) && o.GetNamedValue(name).ValueType() == type;
+    const auto member = o.TryLookup(name);
+    return member && member.ValueType() == type;
   }
 
   template<typename T>
   inline std::enable_if_t<std::is_arithmetic_v<T>, JsonValue> value(const T arithmetic)
   {
-    return json::JsonValue::CreateNumberValue(arithmetic);
+    return json::JsonValue::CreateNumberValue(static_cast<double>(arithmetic));
   }
 
   template<typename T>
@@ -40,7 +350,12 @@ namespace json
 
   inline JsonValue value(JsonObject value)
   {
-    return value.as<JsonValue>();
+    return value;
+  }
+
+  inline JsonValue value(JsonArray value)
+  {
+    return value;
   }
 
   inline JsonValue value(JsonValue value)
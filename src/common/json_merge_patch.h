@@ -0,0 +1,74 @@
+#pragma once
+
+#include "json.h"
+
+// JSON merge patches (RFC 7396): a patch is an object holding only the members that changed, a
+// null member removes the member, and anything that isn't an object replaces the value as a whole.
+// Settings never hold null values, which a merge patch couldn't tell from a removed member.
+namespace json
+{
+  // Applies patch to target in place, objects nested in target included.
+  inline void apply_merge_patch(JsonObject& target, const JsonObject& patch)
+  {
+    for (const auto& member : patch)
+    {
+      const auto key = member.Key();
+      const auto value = member.Value();
+      if (value.ValueType() == JsonValueType::Null)
+      {
+        if (target.HasKey(key))
+        {
+          target.Remove(key);
+        }
+      }
+      else if (value.ValueType() == JsonValueType::Object)
+      {
+        JsonObject merged = has(target, key) ? target.GetNamedObject(key) : JsonObject{};
+        apply_merge_patch(merged, value.GetObjectW());
+        target.SetNamedValue(key, merged);
+      }
+      else
+      {
+        target.SetNamedValue(key, value);
+      }
+    }
+  }
+
+  // The merge patch that turns from into to, an empty object if they are the same. Neither is
+  // changed, the patch may share values with to.
+  inline JsonObject merge_diff(const JsonObject& from, const JsonObject& to)
+  {
+    JsonObject patch;
+    for (const auto& member : from)
+    {
+      if (!to.HasKey(member.Key()))
+      {
+        patch.SetNamedValue(member.Key(), JsonValue::CreateNullValue());
+      }
+    }
+    for (const auto& member : to)
+    {
+      const auto key = member.Key();
+      const auto value = member.Value();
+      if (!from.HasKey(key))
+      {
+        patch.SetNamedValue(key, value);
+        continue;
+      }
+      const auto old_value = from.GetNamedValue(key);
+      if (old_value.ValueType() == JsonValueType::Object && value.ValueType() == JsonValueType::Object)
+      {
+        const auto nested = merge_diff(old_value.GetObjectW(), value.GetObjectW());
+        if (nested.Size() > 0)
+        {
+          patch.SetNamedValue(key, nested);
+        }
+      }
+      else if (old_value.ValueType() != value.ValueType() || old_value.Stringify() != value.Stringify())
+      {
+        patch.SetNamedValue(key, value);
+      }
+    }
+    return patch;
+  }
+}
@@ -0,0 +1,681 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define JSON_SCAN_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// A SAX parser for JSON text, wide or UTF-8, which the DOM of json.h is built with. The handler
+// is called for every value as it is read:
+//   bool null();
+//   bool boolean(bool value);
+//   bool number(double value);
+//   bool string(std::wstring_view value); // The view is only valid during the call
+//   bool key(std::wstring_view name);     // Same
+//   bool start_object();
+//   bool end_object();
+//   bool start_array();
+//   bool end_array();
+// Returning false from any of them stops the parse. Nothing is allocated for the values, strings
+// are only copied to unescape them or to widen UTF-8.
+//
+// Where SSE2 is available the text is scanned 16 bytes at a time for the end of runs of
+// whitespace and of string contents with nothing to unescape, which is most of a settings file.
+
+namespace json
+{
+  // Where a parse stopped, and whether that was at the end of valid JSON text.
+  struct ParseResult
+  {
+    bool ok = false;
+    size_t offset = 0;
+
+    explicit operator bool() const noexcept
+    {
+      return ok;
+    }
+  };
+
+  namespace details
+  {
+    inline unsigned first_set_bit(uint32_t mask) noexcept
+    {
+#ifdef _MSC_VER
+      unsigned long index;
+      _BitScanForward(&index, mask);
+      return index;
+#else
+      return __builtin_ctz(mask);
+#endif
+    }
+
+    template<typename Char>
+    inline bool is_whitespace(Char c) noexcept
+    {
+      return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+    }
+
+    // What can't be copied as it is from the contents of a string: the closing quote, escapes,
+    // control characters, which have to be escaped, and for UTF-8 the bytes of anything but ASCII.
+    template<typename Char>
+    inline bool is_string_special(Char c) noexcept
+    {
+      const auto unit = static_cast<std::make_unsigned_t<Char>>(c);
+      if constexpr (sizeof(Char) == 1)
+      {
+        return unit == '"' || unit == '\\' || unit < 0x20 || unit >= 0x80;
+      }
+      else
+      {
+        return unit == '"' || unit == '\\' || unit < 0x20;
+      }
+    }
+
+#ifdef JSON_SCAN_SSE2
+    // One bit per byte of the vector, set for the bytes of the code units that are special to a
+    // string. It may be set for units that aren't, the caller looks at the unit anyway.
+    template<size_t UnitSize>
+    inline uint32_t string_special_mask(__m128i units) noexcept
+    {
+      if constexpr (UnitSize == 1)
+      {
+        const __m128i quote = _mm_cmpeq_epi8(units, _mm_set1_epi8('"'));
+        const __m128i escape = _mm_cmpeq_epi8(units, _mm_set1_epi8('\\'));
+        // A signed comparison, so non ASCII bytes are less than a space too.
+        const __m128i control = _mm_cmplt_epi8(units, _mm_set1_epi8(0x20));
+        return _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(quote, escape), control));
+      }
+      else if constexpr (UnitSize == 2)
+      {
+        const __m128i quote = _mm_cmpeq_epi16(units, _mm_set1_epi16('"'));
+        const __m128i escape = _mm_cmpeq_epi16(units, _mm_set1_epi16('\\'));
+        const __m128i control = _mm_cmpeq_epi16(_mm_subs_epu16(units, _mm_set1_epi16(0x1F)), _mm_setzero_si128());
+        return _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(quote, escape), control));
+      }
+      else
+      {
+        const __m128i quote = _mm_cmpeq_epi32(units, _mm_set1_epi32('"'));
+        const __m128i escape = _mm_cmpeq_epi32(units, _mm_set1_epi32('\\'));
+        const __m128i control = _mm_cmplt_epi32(units, _mm_set1_epi32(0x20));
+        return _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(quote, escape), control));
+      }
+    }
+
+    // One bit per byte of the vector, set for the bytes of the code units that aren't whitespace.
+    template<size_t UnitSize>
+    inline uint32_t non_whitespace_mask(__m128i units) noexcept
+    {
+      __m128i whitespace;
+      if constexpr (UnitSize == 1)
+      {
+        whitespace = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(units, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(units, _mm_set1_epi8('\n'))),
+                                  _mm_or_si128(_mm_cmpeq_epi8(units, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(units, _mm_set1_epi8('\t'))));
+      }
+      else if constexpr (UnitSize == 2)
+      {
+        whitespace = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi16(units, _mm_set1_epi16(' ')), _mm_cmpeq_epi16(units, _mm_set1_epi16('\n'))),
+                                  _mm_or_si128(_mm_cmpeq_epi16(units, _mm_set1_epi16('\r')), _mm_cmpeq_epi16(units, _mm_set1_epi16('\t'))));
+      }
+      else
+      {
+        whitespace = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi32(units, _mm_set1_epi32(' ')), _mm_cmpeq_epi32(units, _mm_set1_epi32('\n'))),
+                                  _mm_or_si128(_mm_cmpeq_epi32(units, _mm_set1_epi32('\r')), _mm_cmpeq_epi32(units, _mm_set1_epi32('\t'))));
+      }
+      return ~static_cast<uint32_t>(_mm_movemask_epi8(whitespace)) & 0xFFFF;
+    }
+#endif
+
+    // The first unit from p on that is special to a string, or end.
+    template<typename Char>
+    inline const Char* find_string_special(const Char* p, const Char* end) noexcept
+    {
+#ifdef JSON_SCAN_SSE2
+      constexpr size_t units_per_vector = 16 / sizeof(Char);
+      while (static_cast<size_t>(end - p) >= units_per_vector)
+      {
+        const auto mask = string_special_mask<sizeof(Char)>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+        if (mask)
+        {
+          return p + first_set_bit(mask) / sizeof(Char);
+        }
+        p += units_per_vector;
+      }
+#endif
+      while (p != end && !is_string_special(*p))
+      {
+        ++p;
+      }
+      return p;
+    }
+
+    // The first unit from p on that isn't whitespace, or end.
+    template<typename Char>
+    inline const Char* skip_whitespace(const Char* p, const Char* end) noexcept
+    {
+      // Tokens are mostly separated by nothing or a single character, vectors only pay off for
+      // the indentation of pretty printed text.
+      for (int i = 0; i < 2; ++i)
+      {
+        if (p == end || !is_whitespace(*p))
+        {
+          return p;
+        }
+        ++p;
+      }
+#ifdef JSON_SCAN_SSE2
+      constexpr size_t units_per_vector = 16 / sizeof(Char);
+      while (static_cast<size_t>(end - p) >= units_per_vector)
+      {
+        const auto mask = non_whitespace_mask<sizeof(Char)>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+        if (mask)
+        {
+          return p + first_set_bit(mask) / sizeof(Char);
+        }
+        p += units_per_vector;
+      }
+#endif
+      while (p != end && is_whitespace(*p))
+      {
+        ++p;
+      }
+      return p;
+    }
+
+    template<typename Char>
+    inline bool is_digit(Char c) noexcept
+    {
+      return c >= '0' && c <= '9';
+    }
+
+    template<typename Char, typename Handler>
+    class SaxParser
+    {
+    public:
+      SaxParser(const Char* begin, const Char* end, Handler& handler) :
+        begin(begin), p(begin), end(end), handler(handler)
+      {
+      }
+
+      ParseResult parse()
+      {
+        for (;;)
+        {
+          // A value is expected.
+          p = skip_whitespace(p, end);
+          if (p == end)
+          {
+            return failed();
+          }
+          switch (*p)
+          {
+          case '{':
+            ++p;
+            if (!handler.start_object())
+            {
+              return failed();
+            }
+            p = skip_whitespace(p, end);
+            if (p != end && *p == '}')
+            {
+              ++p;
+              if (!handler.end_object())
+              {
+                return failed();
+              }
+              break;
+            }
+            containers.push_back('{');
+            if (!parse_key())
+            {
+              return failed();
+            }
+            continue;
+          case '[':
+            ++p;
+            if (!handler.start_array())
+            {
+              return failed();
+            }
+            p = skip_whitespace(p, end);
+            if (p != end && *p == ']')
+            {
+              ++p;
+              if (!handler.end_array())
+              {
+                return failed();
+              }
+              break;
+            }
+            containers.push_back('[');
+            continue;
+          case '"':
+          {
+            std::wstring_view value;
+            if (!parse_string(value) || !handler.string(value))
+            {
+              return failed();
+            }
+            break;
+          }
+          case 't':
+            if (!parse_literal("true") || !handler.boolean(true))
+            {
+              return failed();
+            }
+            break;
+          case 'f':
+            if (!parse_literal("false") || !handler.boolean(false))
+            {
+              return failed();
+            }
+            break;
+          case 'n':
+            if (!parse_literal("null") || !handler.null())
+            {
+              return failed();
+            }
+            break;
+          default:
+            if (!parse_number())
+            {
+              return failed();
+            }
+            break;
+          }
+
+          // A value was read, it can close any number of containers.
+          for (;;)
+          {
+            p = skip_whitespace(p, end);
+            if (containers.empty())
+            {
+              return p == end ? ParseResult{ true, static_cast<size_t>(p - begin) } : failed();
+            }
+            if (p == end)
+            {
+              return failed();
+            }
+            const bool in_object = containers.back() == '{';
+            if (*p == ',')
+            {
+              ++p;
+              if (in_object && !parse_key())
+              {
+                return failed();
+              }
+              break;
+            }
+            if (*p != (in_object ? '}' : ']'))
+            {
+              return failed();
+            }
+            ++p;
+            containers.pop_back();
+            if (!(in_object ? handler.end_object() : handler.end_array()))
+            {
+              return failed();
+            }
+          }
+        }
+      }
+
+    private:
+      ParseResult failed() const noexcept
+      {
+        return { false, static_cast<size_t>(p - begin) };
+      }
+
+      // Reads a member name up to the colon after it.
+      bool parse_key()
+      {
+        p = skip_whitespace(p, end);
+        std::wstring_view name;
+        if (p == end || *p != '"' || !parse_string(name) || !handler.key(name))
+        {
+          return false;
+        }
+        p = skip_whitespace(p, end);
+        if (p == end || *p != ':')
+        {
+          return false;
+        }
+        ++p;
+        return true;
+      }
+
+      bool parse_string(std::wstring_view& value)
+      {
+        ++p;
+        const Char* run = p;
+        const Char* special = find_string_special(p, end);
+        // Wide strings with nothing to unescape are used where they are.
+        if constexpr (std::is_same_v<Char, wchar_t>)
+        {
+          if (special != end && *special == '"')
+          {
+            value = { run, static_cast<size_t>(special - run) };
+            p = special + 1;
+            return true;
+          }
+        }
+
+        unescaped.clear();
+        for (;;)
+        {
+          if (special == end)
+          {
+            p = end;
+            return false;
+          }
+          unescaped.append(run, special);
+          p = special;
+          const auto unit = static_cast<std::make_unsigned_t<Char>>(*p);
+          if (unit == '"')
+          {
+            ++p;
+            value = unescaped;
+            return true;
+          }
+          if (unit == '\\')
+          {
+            if (!parse_escape())
+            {
+              return false;
+            }
+          }
+          else if (unit < 0x20)
+          {
+            return false;
+          }
+          else if constexpr (sizeof(Char) == 1)
+          {
+            decode_utf8();
+          }
+          else
+          {
+            unescaped.push_back(*p++);
+          }
+          run = p;
+          special = find_string_special(p, end);
+        }
+      }
+
+      bool parse_escape()
+      {
+        ++p;
+        if (p == end)
+        {
+          return false;
+        }
+        switch (*p++)
+        {
+        case '"':
+          unescaped.push_back(L'"');
+          return true;
+        case '\\':
+          unescaped.push_back(L'\\');
+          return true;
+        case '/':
+          unescaped.push_back(L'/');
+          return true;
+        case 'b':
+          unescaped.push_back(L'\b');
+          return true;
+        case 'f':
+          unescaped.push_back(L'\f');
+          return true;
+        case 'n':
+          unescaped.push_back(L'\n');
+          return true;
+        case 'r':
+          unescaped.push_back(L'\r');
+          return true;
+        case 't':
+          unescaped.push_back(L'\t');
+          return true;
+        case 'u':
+        {
+          uint32_t unit;
+          if (!parse_hex(unit))
+          {
+            return false;
+          }
+          // A surrogate pair is written as two escapes. A surrogate escaped on its own can't be
+          // represented in UTF-8 or be shown, it is read as U+FFFD like invalid UTF-16 is.
+          uint32_t low;
+          if (unit >= 0xD800 && unit <= 0xDBFF && end - p >= 6 && p[0] == '\\' && p[1] == 'u')
+          {
+            const Char* escape = p;
+            p += 2;
+            if (parse_hex(low) && low >= 0xDC00 && low <= 0xDFFF)
+            {
+              append_code_point(0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00));
+              return true;
+            }
+            p = escape;
+          }
+          if (unit >= 0xD800 && unit <= 0xDFFF)
+          {
+            unit = 0xFFFD;
+          }
+          unescaped.push_back(static_cast<wchar_t>(unit));
+          return true;
+        }
+        default:
+          return false;
+        }
+      }
+
+      bool parse_hex(uint32_t& unit)
+      {
+        if (end - p < 4)
+        {
+          return false;
+        }
+        unit = 0;
+        for (int i = 0; i < 4; ++i, ++p)
+        {
+          const auto digit = static_cast<uint32_t>(*p);
+          unit <<= 4;
+          if (digit >= '0' && digit <= '9')
+          {
+            unit |= digit - '0';
+          }
+          else if (digit >= 'a' && digit <= 'f')
+          {
+            unit |= digit - 'a' + 10;
+          }
+          else if (digit >= 'A' && digit <= 'F')
+          {
+            unit |= digit - 'A' + 10;
+          }
+          else
+          {
+            return false;
+          }
+        }
+        return true;
+      }
+
+      void append_code_point(uint32_t code_point)
+      {
+        if (sizeof(wchar_t) == 2 && code_point > 0xFFFF)
+        {
+          code_point -= 0x10000;
+          unescaped.push_back(static_cast<wchar_t>(0xD800 + (code_point >> 10)));
+          unescaped.push_back(static_cast<wchar_t>(0xDC00 + (code_point & 0x3FF)));
+        }
+        else
+        {
+          unescaped.push_back(static_cast<wchar_t>(code_point));
+        }
+      }
+
+      // Reads the character starting at a byte of 0x80 or more. A byte that doesn't start a
+      // valid sequence is taken for a Latin-1 character.
+      void decode_utf8()
+      {
+        const auto lead = static_cast<uint8_t>(*p);
+        size_t length = 0;
+        uint32_t code_point = 0;
+        uint32_t smallest = 0;
+        if ((lead & 0xE0) == 0xC0)
+        {
+          length = 2;
+          code_point = lead & 0x1F;
+          smallest = 0x80;
+        }
+        else if ((lead & 0xF0) == 0xE0)
+        {
+          length = 3;
+          code_point = lead & 0x0F;
+          smallest = 0x800;
+        }
+        else if ((lead & 0xF8) == 0xF0)
+        {
+          length = 4;
+          code_point = lead & 0x07;
+          smallest = 0x10000;
+        }
+        if (length && static_cast<size_t>(end - p) >= length)
+        {
+          size_t i = 1;
+          for (; i < length && (static_cast<uint8_t>(p[i]) & 0xC0) == 0x80; ++i)
+          {
+            code_point = (code_point << 6) | (static_cast<uint8_t>(p[i]) & 0x3F);
+          }
+          if (i == length && code_point >= smallest && code_point <= 0x10FFFF && (code_point < 0xD800 || code_point > 0xDFFF))
+          {
+            append_code_point(code_point);
+            p += length;
+            return;
+          }
+        }
+        unescaped.push_back(static_cast<wchar_t>(lead));
+        ++p;
+      }
+
+      bool parse_literal(const char* literal)
+      {
+        for (; *literal; ++literal, ++p)
+        {
+          if (p == end || *p != *literal)
+          {
+            return false;
+          }
+        }
+        return true;
+      }
+
+      bool parse_number()
+      {
+        const Char* start = p;
+        if (p != end && *p == '-')
+        {
+          ++p;
+        }
+        if (p == end || !is_digit(*p))
+        {
+          return false;
+        }
+        if (*p == '0')
+        {
+          ++p;
+        }
+        else
+        {
+          while (p != end && is_digit(*p))
+          {
+            ++p;
+          }
+        }
+        if (p != end && *p == '.')
+        {
+          ++p;
+          if (p == end || !is_digit(*p))
+          {
+            return false;
+          }
+          while (p != end && is_digit(*p))
+          {
+            ++p;
+          }
+        }
+        if (p != end && (*p == 'e' || *p == 'E'))
+        {
+          ++p;
+          if (p != end && (*p == '+' || *p == '-'))
+          {
+            ++p;
+          }
+          if (p == end || !is_digit(*p))
+          {
+            return false;
+          }
+          while (p != end && is_digit(*p))
+          {
+            ++p;
+          }
+        }
+
+        double value;
+        std::from_chars_result converted;
+        if constexpr (sizeof(Char) == 1)
+        {
+          converted = std::from_chars(reinterpret_cast<const char*>(start), reinterpret_cast<const char*>(p), value);
+        }
+        else
+        {
+          // Only ASCII was read, so it narrows as it is.
+          narrowed.clear();
+          for (const Char* digit = start; digit != p; ++digit)
+          {
+            narrowed.push_back(static_cast<char>(*digit));
+          }
+          converted = std::from_chars(narrowed.data(), narrowed.data() + narrowed.size(), value);
+        }
+        return converted.ec == std::errc{} && handler.number(value);
+      }
+
+      const Char* begin;
+      const Char* p;
+      const Char* end;
+      Handler& handler;
+      std::vector<char> containers; // '{' or '[' for every container the parse is in
+      std::wstring unescaped;
+      std::string narrowed;
+    };
+  }
+
+  template<typename Handler>
+  inline ParseResult sax_parse(std::wstring_view text, Handler& handler)
+  {
+    return details::SaxParser<wchar_t, Handler>(text.data(), text.data() + text.size(), handler).parse();
+  }
+
+  // A byte order mark at the start is skipped.
+  template<typename Handler>
+  inline ParseResult sax_parse_utf8(std::string_view text, Handler& handler)
+  {
+    size_t skipped = 0;
+    if (text.size() >= 3 && text.substr(0, 3) == "\xEF\xBB\xBF")
+    {
+      skipped = 3;
+    }
+    auto result = details::SaxParser<char, Handler>(text.data() + skipped, text.data() + text.size(), handler).parse();
+    result.offset += skipped;
+    return result;
+  }
+}
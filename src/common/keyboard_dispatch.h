@@ -0,0 +1,286 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+// KeyboardDispatcher filters low-level keyboard events down to the receivers that declared an
+// interest in them, so the keyboard hook skips calling into modules for keys none of them handle.
+//
+// Receivers declare the virtual key codes they want, whether they also want key up events, and
+// modifiers of which at least one has to be held. The dispatcher keeps the modifier state itself
+// from the key events it sees instead of asking GetAsyncKeyState on every keystroke. Only the
+// standard library is used, so the filtering can be replayed and measured anywhere.
+
+namespace keyboard_modifiers {
+  constexpr uint32_t win = 1;
+  constexpr uint32_t ctrl = 2;
+  constexpr uint32_t shift = 4;
+  constexpr uint32_t alt = 8;
+}
+
+struct KeyInterest {
+  std::array<uint64_t, 4> keys{}; // Bit (vk % 64) of keys[vk / 64] for every virtual key code of interest
+  uint32_t modifiers = 0;         // keyboard_modifiers of which at least one must be held, 0 for none
+  bool key_up = false;            // Key up events are wanted too
+
+  static KeyInterest all_keys() {
+    KeyInterest interest;
+    interest.keys.fill(~uint64_t{ 0 });
+    interest.key_up = true;
+    return interest;
+  }
+
+  KeyInterest& add_keys(uint32_t first, uint32_t last) {
+    for (uint32_t vk = first; (vk <= last) && (vk < 256); ++vk) {
+      keys[vk / 64] |= uint64_t{ 1 } << (vk % 64);
+    }
+    return *this;
+  }
+
+  bool has_key(uint32_t vk) const noexcept {
+    return (vk < 256) && (keys[vk / 64] & (uint64_t{ 1 } << (vk % 64)));
+  }
+
+  bool matches(uint32_t vk, bool key_down, uint32_t held_modifiers) const noexcept {
+    return has_key(vk) && (key_down || key_up) && (!modifiers || (modifiers & held_modifiers));
+  }
+};
+
+class ModifierState {
+public:
+  // The keyboard_modifiers flag of the virtual key code, 0 if it isn't a modifier.
+  static uint32_t modifier_of(uint32_t vk) noexcept {
+    switch (vk) {
+    case 0x5B: case 0x5C: return keyboard_modifiers::win;               // VK_LWIN, VK_RWIN
+    case 0x11: case 0xA2: case 0xA3: return keyboard_modifiers::ctrl;   // VK_CONTROL, VK_LCONTROL, VK_RCONTROL
+    case 0x10: case 0xA0: case 0xA1: return keyboard_modifiers::shift;  // VK_SHIFT, VK_LSHIFT, VK_RSHIFT
+    case 0x12: case 0xA4: case 0xA5: return keyboard_modifiers::alt;    // VK_MENU, VK_LMENU, VK_RMENU
+    default: return 0;
+    }
+  }
+
+  void update(uint32_t vk, bool key_down) noexcept {
+    const uint32_t modifier = modifier_of(vk);
+    if (!modifier) {
+      return;
+    }
+    // Both keys of a pair are tracked, so letting go of one keeps the modifier held while the other is down.
+    const bool right = (vk == 0x5C) || (vk == 0xA1) || (vk == 0xA3) || (vk == 0xA5);
+    uint32_t& side = right ? right_held : left_held;
+    side = key_down ? (side | modifier) : (side & ~modifier);
+  }
+
+  uint32_t held() const noexcept {
+    return left_held | right_held;
+  }
+
+private:
+  uint32_t left_held = 0;
+  uint32_t right_held = 0;
+};
+
+// Receivers are published like in EventDispatchTable: an immutable list swapped atomically, with
+// replaced lists kept until the dispatcher is destroyed. dispatch() takes no lock and doesn't
+// allocate, and must always be called from the same thread, the one running the hook.
+template<typename Receiver>
+class KeyboardDispatcher {
+public:
+  struct Entry {
+    Receiver* receiver;
+    KeyInterest interest;
+  };
+
+  KeyboardDispatcher() {
+    current.store(&empty, std::memory_order_relaxed);
+  }
+
+  KeyboardDispatcher(const KeyboardDispatcher&) = delete;
+  KeyboardDispatcher& operator=(const KeyboardDispatcher&) = delete;
+
+  void add_receiver(Receiver* receiver, const KeyInterest& interest) {
+    std::unique_lock lock(mutex);
+    auto updated = std::make_unique<Receivers>(*current.load(std::memory_order_relaxed));
+    updated->entries.push_back({ receiver, interest });
+    publish(std::move(updated));
+  }
+
+  void remove_receiver(Receiver* receiver) {
+    std::unique_lock lock(mutex);
+    auto updated = std::make_unique<Receivers>(*current.load(std::memory_order_relaxed));
+    auto& entries = updated->entries;
+    entries.erase(std::remove_if(begin(entries), end(entries), [receiver](const Entry& entry) { return entry.receiver == receiver; }), end(entries));
+    publish(std::move(updated));
+  }
+
+  // Tracks the modifiers and calls signal(receiver) for every receiver interested in the key
+  // event, or-ing the results. Returns 0 without calling anyone if no receiver wants the key.
+  template<typename Signal>
+  intptr_t dispatch(uint32_t vk, bool key_down, Signal&& signal) {
+    modifiers.update(vk, key_down);
+    const Receivers& receivers = *current.load(std::memory_order_acquire);
+    if (!receivers.any.has_key(vk)) {
+      return 0;
+    }
+
+    intptr_t rvalue = 0;
+    const uint32_t held = modifiers.held();
+    for (const auto& entry : receivers.entries) {
+      if (entry.interest.matches(vk, key_down, held)) {
+        rvalue |= signal(entry.receiver);
+      }
+    }
+    return rvalue;
+  }
+
+  uint32_t held_modifiers() const noexcept {
+    return modifiers.held();
+  }
+
+private:
+  struct Receivers {
+    std::vector<Entry> entries;
+    KeyInterest any; // Union of the keys of every entry
+  };
+
+  void publish(std::unique_ptr<Receivers> receivers) {
+    receivers->any = {};
+    for (const auto& entry : receivers->entries) {
+      for (size_t i = 0; i < receivers->any.keys.size(); ++i) {
+        receivers->any.keys[i] |= entry.interest.keys[i];
+      }
+    }
+    const auto* published_receivers = receivers.get();
+    published.push_back(std::move(receivers));
+    current.store(published_receivers, std::memory_order_release);
+  }
+
+  std::mutex mutex;
+  const Receivers empty;
+  std::atomic<const Receivers*> current;
+  // Every list ever published, including the current one.
+  std::vector<std::unique_ptr<Receivers>> published;
+  ModifierState modifiers; // Only touched by dispatch()
+};
+
+// A key pressed with exactly the given keyboard_modifiers held.
+struct Hotkey {
+  uint32_t vk;
+  uint32_t modifiers;
+  bool swallow; // Whether the key press is kept from the rest of the system
+};
+
+// HotkeyTable compiles the hotkeys of every receiver into a table indexed by key and modifiers,
+// so deciding whether to swallow a key press is one lookup however many hotkeys are registered.
+// Tables are published and kept around like the receivers of KeyboardDispatcher; they only get
+// recompiled when a receiver changes its hotkeys.
+template<typename Receiver>
+class HotkeyTable {
+public:
+  HotkeyTable() {
+    current.store(&empty, std::memory_order_relaxed);
+  }
+
+  HotkeyTable(const HotkeyTable&) = delete;
+  HotkeyTable& operator=(const HotkeyTable&) = delete;
+
+  // Replaces the hotkeys of the receiver, an empty list removes the receiver.
+  void set_hotkeys(Receiver* receiver, std::vector<Hotkey> hotkeys) {
+    std::unique_lock lock(mutex);
+    auto updated = registered;
+    auto it = std::find_if(begin(updated), end(updated), [receiver](const auto& entry) { return entry.first == receiver; });
+    if (it != end(updated)) {
+      updated.erase(it);
+    }
+    if (!hotkeys.empty()) {
+      updated.emplace_back(receiver, std::move(hotkeys));
+    }
+
+    // Nothing changes if the hotkeys don't fit the table.
+    auto compiled = compile(updated);
+    const auto* published_table = compiled.get();
+    published.push_back(std::move(compiled));
+    current.store(published_table, std::memory_order_release);
+    registered = std::move(updated);
+  }
+
+  void remove_receiver(Receiver* receiver) {
+    set_hotkeys(receiver, {});
+  }
+
+  // Calls action(receiver, hotkey) for every receiver of the pressed hotkey and returns whether
+  // any of them swallows it. Takes no lock and doesn't allocate.
+  template<typename Action>
+  bool dispatch(uint32_t vk, uint32_t modifiers, Action&& action) const {
+    if (vk >= 256) {
+      return false;
+    }
+    const Compiled& table = *current.load(std::memory_order_acquire);
+    const Match& match = table.matches[table.index[vk * 16 + (modifiers & 15)]];
+    for (auto receiver : match.receivers) {
+      action(receiver, Hotkey{ vk, modifiers & 15, match.swallow });
+    }
+    return match.swallow;
+  }
+
+private:
+  struct Match {
+    std::vector<Receiver*> receivers;
+    bool swallow = false;
+
+    bool operator<(const Match& other) const {
+      return std::tie(receivers, swallow) < std::tie(other.receivers, other.swallow);
+    }
+  };
+
+  struct Compiled {
+    std::array<uint8_t, 256 * 16> index{}; // Into matches, by vk * 16 + modifiers
+    std::vector<Match> matches = std::vector<Match>(1); // Distinct matches, the first one has no receivers
+  };
+
+  using Registered = std::vector<std::pair<Receiver*, std::vector<Hotkey>>>;
+
+  static std::unique_ptr<Compiled> compile(const Registered& registered) {
+    std::vector<Match> slots(256 * 16);
+    for (const auto& [receiver, hotkeys] : registered) {
+      for (const auto& hotkey : hotkeys) {
+        if ((hotkey.vk >= 256) || (hotkey.modifiers > 15)) {
+          continue;
+        }
+        auto& slot = slots[hotkey.vk * 16 + hotkey.modifiers];
+        if (std::find(begin(slot.receivers), end(slot.receivers), receiver) == end(slot.receivers)) {
+          slot.receivers.push_back(receiver);
+        }
+        slot.swallow = slot.swallow || hotkey.swallow;
+      }
+    }
+
+    auto compiled = std::make_unique<Compiled>();
+    std::map<Match, uint8_t> distinct{ { Match{}, uint8_t{ 0 } } };
+    for (size_t i = 0; i < slots.size(); ++i) {
+      auto [it, inserted] = distinct.emplace(slots[i], static_cast<uint8_t>(compiled->matches.size()));
+      if (inserted) {
+        if (compiled->matches.size() > UINT8_MAX) {
+          throw std::length_error("Too many different hotkey receivers");
+        }
+        compiled->matches.push_back(slots[i]);
+      }
+      compiled->index[i] = it->second;
+    }
+    return compiled;
+  }
+
+  std::mutex mutex;
+  Registered registered;
+  const Compiled empty;
+  std::atomic<const Compiled*> current;
+  // Every table ever published, including the current one.
+  std::vector<std::unique_ptr<Compiled>> published;
+};
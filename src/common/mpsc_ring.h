@@ -0,0 +1,97 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// MpscRing is a bounded queue that any number of threads push to and a single thread drains.
+// Pushing never locks or allocates and fails when the ring is full, leaving it to the caller to
+// drop, merge or count what doesn't fit. The consumer drains whole batches at once.
+//
+// Every cell carries a sequence number telling whose turn it is: producers claim a position by
+// advancing the push index and publish the item by bumping the sequence of its cell; the consumer
+// hands the cell back to the producers one lap later by bumping it again.
+template<typename T, size_t Capacity>
+class MpscRing {
+  static_assert(Capacity && !(Capacity & (Capacity - 1)), "Capacity must be a power of two");
+  static_assert(std::is_nothrow_copy_assignable_v<T>, "Items are copied in and out of the ring");
+
+public:
+  static constexpr size_t capacity = Capacity;
+
+  MpscRing() {
+    for (size_t i = 0; i < Capacity; ++i) {
+      cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MpscRing(const MpscRing&) = delete;
+  MpscRing& operator=(const MpscRing&) = delete;
+
+  // Returns false if the ring is full. position, when given, receives the position of the item:
+  // it has been popped once popped() is past it.
+  bool try_push(const T& item, size_t* position = nullptr) noexcept {
+    size_t claimed = next_push.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell& cell = cells[claimed & (Capacity - 1)];
+      const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      const auto lag = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(claimed);
+      if (lag == 0) {
+        if (next_push.compare_exchange_weak(claimed, claimed + 1, std::memory_order_relaxed)) {
+          cell.item = item;
+          cell.sequence.store(claimed + 1, std::memory_order_release);
+          if (position) {
+            *position = claimed;
+          }
+          return true;
+        }
+      } else if (lag < 0) {
+        // The consumer hasn't taken the item of the previous lap yet.
+        return false;
+      } else {
+        claimed = next_push.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Only called from the consumer thread. Pops up to max items in push order and returns how many.
+  size_t pop_batch(T* items, size_t max) noexcept {
+    size_t count = 0;
+    size_t position = next_pop.load(std::memory_order_relaxed);
+    while (count < max) {
+      Cell& cell = cells[position & (Capacity - 1)];
+      if (cell.sequence.load(std::memory_order_acquire) != position + 1) {
+        break;
+      }
+      items[count++] = cell.item;
+      cell.sequence.store(position + Capacity, std::memory_order_release);
+      ++position;
+    }
+    next_pop.store(position, std::memory_order_release);
+    return count;
+  }
+
+  // Only called from the consumer thread. False if the next item is published, even if more
+  // items are still being written by their producers.
+  bool empty() const noexcept {
+    const size_t position = next_pop.load(std::memory_order_relaxed);
+    return cells[position & (Capacity - 1)].sequence.load(std::memory_order_acquire) != position + 1;
+  }
+
+  // How many items the consumer has popped so far.
+  size_t popped() const noexcept {
+    return next_pop.load(std::memory_order_acquire);
+  }
+
+private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T item{};
+  };
+
+  alignas(64) std::atomic<size_t> next_push{ 0 };
+  alignas(64) std::atomic<size_t> next_pop{ 0 };
+  alignas(64) std::array<Cell, Capacity> cells;
+};
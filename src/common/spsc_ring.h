@@ -0,0 +1,53 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+// SpscRing is a bounded queue between exactly one producer thread and one consumer thread.
+// Neither side locks or allocates: try_push fails when the ring is full and try_pop when it is
+// empty, so a hook that has to return quickly can hand work to another thread through it and
+// decide itself what to do when the other thread falls behind.
+template<typename T, size_t Capacity>
+class SpscRing {
+  static_assert(Capacity && !(Capacity & (Capacity - 1)), "Capacity must be a power of two");
+  static_assert(std::is_nothrow_copy_assignable_v<T>, "Items are copied in and out of the ring");
+
+public:
+  static constexpr size_t capacity = Capacity;
+
+  // Only called from the producer thread.
+  bool try_push(const T& item) noexcept {
+    const size_t tail = next_push.load(std::memory_order_relaxed);
+    if (tail - next_pop.load(std::memory_order_acquire) == Capacity) {
+      return false;
+    }
+    items[tail & (Capacity - 1)] = item;
+    next_push.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Only called from the consumer thread.
+  bool try_pop(T& item) noexcept {
+    const size_t head = next_pop.load(std::memory_order_relaxed);
+    if (head == next_push.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = items[head & (Capacity - 1)];
+    next_pop.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Exact on the producer and consumer threads when the other side is idle, a snapshot otherwise.
+  size_t size() const noexcept {
+    return next_push.load(std::memory_order_acquire) - next_pop.load(std::memory_order_acquire);
+  }
+
+private:
+  // The indices only ever grow and wrap around together; each one is written by a single side
+  // and kept on its own cache line so the two threads don't invalidate each other's writes.
+  alignas(64) std::atomic<size_t> next_push{ 0 };
+  alignas(64) std::atomic<size_t> next_pop{ 0 };
+  alignas(64) std::array<T, Capacity> items{};
+};
@@ -1,16 +1,63 @@
 #pragma once
 #include <Windows.h>
 #include "async_message_queue.h"
+#include "framed_channel.h"
 #include <WinSafer.h>
 #include <Sddl.h>
 #include <accctrl.h>
 #include <aclapi.h>
+#include <memory>
+#include <utility>
 
+// A connected named pipe instance in byte mode, the transport of FramedChannel.
+class NamedPipeStream {
+public:
+  explicit NamedPipeStream(HANDLE handle) : handle(handle) {
+  }
+  NamedPipeStream(NamedPipeStream&& other) noexcept : handle(std::exchange(other.handle, INVALID_HANDLE_VALUE)) {
+  }
+  NamedPipeStream(const NamedPipeStream&) = delete;
+  NamedPipeStream& operator=(const NamedPipeStream&) = delete;
+  ~NamedPipeStream() {
+    if (handle != INVALID_HANDLE_VALUE) {
+      CloseHandle(handle);
+    }
+  }
+
+  bool write(const uint8_t* data, size_t size) {
+    while (size > 0) {
+      DWORD written = 0;
+      const DWORD chunk = size > MAXDWORD ? MAXDWORD : static_cast<DWORD>(size);
+      if (!WriteFile(handle, data, chunk, &written, NULL)) {
+        return false;
+      }
+      data += written;
+      size -= written;
+    }
+    return true;
+  }
+
+  size_t read(uint8_t* data, size_t size) {
+    DWORD read = 0;
+    if (!ReadFile(handle, data, static_cast<DWORD>(size), &read, NULL)) {
+      return 0;
+    }
+    return read;
+  }
+
+private:
+  HANDLE handle;
+};
+
+// Each side runs a pipe server it reads messages from and connects to the pipe server of the
+// other side to write messages to. Both connections stay open for all the messages, which are
+// sent as frames of UTF-16 text.
 class TwoWayPipeMessageIPC {
 public:
-  typedef void(*callback_function)(const std::wstring&);
+  // Gets each message received, its text is shared with the queue it came from.
+  typedef void(*callback_function)(SharedMessage);
   void send(std::wstring msg) {
-    output_queue.queue_message(msg);
+    output_queue.queue_message(std::move(msg));
   }
   TwoWayPipeMessageIPC(std::wstring _input_pipe_name, std::wstring _output_pipe_name, callback_function p_func) {
     input_pipe_name = _input_pipe_name;
@@ -31,7 +78,7 @@ public:
     output_queue_thread.join();
     pipe_connect_handle_mutex.lock();
     if (current_connect_pipe_handle != NULL) {
-      //Cancels the Pipe currently waiting for a connection.
+      //Cancels the Pipe currently waiting for a connection or reading from one.
       CancelIoEx(current_connect_pipe_handle,NULL);
     }
     pipe_connect_handle_mutex.unlock();
@@ -39,7 +86,8 @@ public:
   }
 
 private:
-  AsyncMessageQueue input_queue;
+  // Bounded, so a peer sending faster than the messages are handled gets held up by the pipe.
+  AsyncMessageQueue input_queue{ 64 };
   AsyncMessageQueue output_queue;
   std::wstring output_pipe_name;
   std::wstring input_pipe_name;
@@ -48,85 +96,65 @@ private:
   std::thread input_pipe_thread;
   std::mutex pipe_connect_handle_mutex; // For manipulating the current_connect_pipe
 
+  // The input pipe while it waits for or is connected to the other side.
   HANDLE current_connect_pipe_handle = NULL;
+  // Only used by the output queue thread.
+  std::unique_ptr<FramedChannel<NamedPipeStream>> output_channel;
+  framing::ReconnectPolicy reconnect;
   bool closed = false;
   TwoWayPipeMessageIPC::callback_function dispatch_inc_message_function;
   const DWORD BUFSIZE = 1024;
 
-  void send_pipe_message(std::wstring message) {
-    // Adapted from https://docs.microsoft.com/en-us/windows/win32/ipc/named-pipe-client
-    HANDLE output_pipe_handle;
-    const wchar_t* message_send = message.c_str();
-    BOOL   fSuccess = FALSE;
-    DWORD  cbToWrite, cbWritten, dwMode;
-    const wchar_t* lpszPipename = output_pipe_name.c_str();
-
-    // Try to open a named pipe; wait for it, if necessary. 
-
-    while (1) {
-      output_pipe_handle = CreateFile(
-        lpszPipename,   // pipe name 
-        GENERIC_READ |  // read and write access 
-        GENERIC_WRITE,
-        0,              // no sharing 
-        NULL,           // default security attributes
-        OPEN_EXISTING,  // opens existing pipe 
-        0,              // default attributes 
-        NULL);          // no template file 
-
-      // Break if the pipe handle is valid. 
-
-      if (output_pipe_handle != INVALID_HANDLE_VALUE)
-        break;
-
-      // Exit if an error other than ERROR_PIPE_BUSY occurs. 
-      DWORD curr_error = 0;
-      if ((curr_error = GetLastError()) != ERROR_PIPE_BUSY) {
+  bool connect_output_pipe() {
+    HANDLE output_pipe_handle = CreateFile(
+      output_pipe_name.c_str(),
+      GENERIC_READ | GENERIC_WRITE,
+      0,
+      NULL,
+      OPEN_EXISTING,
+      0,
+      NULL);
+    if (output_pipe_handle == INVALID_HANDLE_VALUE) {
+      return false;
+    }
+    output_channel = std::make_unique<FramedChannel<NamedPipeStream>>(NamedPipeStream(output_pipe_handle));
+    return true;
+  }
 
-        return;
+  void send_pipe_message(const std::wstring& message) {
+    while (!closed) {
+      if (output_channel || connect_output_pipe()) {
+        // Only a delivered message shows the other side is back, a peer that accepts the
+        // connection and then drops it keeps backing off.
+        if (output_channel->send(message.data(), message.size() * sizeof(wchar_t))) {
+          reconnect.reset();
+          return;
+        }
+        // The connection broke, the message goes out again over a new one.
+        output_channel.reset();
       }
-
-      // All pipe instances are busy, so wait for 20 seconds. 
-
-      if (!WaitNamedPipe(lpszPipename, 20000)) {
+      // The other side isn't listening (yet), is between connections, or dropped this one.
+      const auto delay = reconnect.next_delay();
+      if (!delay) {
+        reconnect.reset();
         return;
       }
+      std::this_thread::sleep_for(*delay);
     }
-    dwMode = PIPE_READMODE_MESSAGE;
-    fSuccess = SetNamedPipeHandleState(
-      output_pipe_handle,    // pipe handle 
-      &dwMode,  // new pipe mode 
-      NULL,     // don't set maximum bytes 
-      NULL);    // don't set maximum time 
-    if (!fSuccess) {
-      return;
-    }
-
-    // Send a message to the pipe server. 
-
-    cbToWrite = (lstrlen(message_send)) * sizeof(WCHAR); // no need to send final '\0'. Pipe is in message mode.
-
-    fSuccess = WriteFile(
-      output_pipe_handle,                  // pipe handle 
-      message_send,           // message 
-      cbToWrite,              // message length 
-      &cbWritten,             // bytes written 
-      NULL);                  // not overlapped 
-    if (!fSuccess) {
-      return;
-    }
-    CloseHandle(output_pipe_handle);
-    return;
   }
 
   void consume_output_queue_thread() {
+    std::vector<SharedMessage> messages;
     while (!closed) {
-      std::wstring message = output_queue.pop_message();
-      if (message.length() == 0) {
+      messages.clear();
+      if (!output_queue.pop_messages(messages)) {
         break;
       }
-      send_pipe_message(message);
+      for (const auto& message : messages) {
+        send_pipe_message(message.str());
+      }
     }
+    output_channel.reset();
   }
 
   BOOL GetLogonSID(HANDLE hToken, PSID *ppsid) {
@@ -301,74 +329,13 @@ private:
     return restricted_token_handle;
   }
 
-  void handle_pipe_connection(HANDLE input_pipe_handle) {
-    //Adapted from https://docs.microsoft.com/en-us/windows/win32/ipc/multithreaded-pipe-server
-    HANDLE hHeap = GetProcessHeap();
-    uint8_t* pchRequest = (uint8_t*)HeapAlloc(hHeap, 0, BUFSIZE * sizeof(uint8_t));
-
-    DWORD cbBytesRead = 0, cbReplyBytes = 0, cbWritten = 0;
-    BOOL fSuccess = FALSE;
-    
-    // Do some extra error checking since the app will keep running even if this thread fails.
-    std::list<std::vector<uint8_t>> message_parts;
-
-    if (input_pipe_handle == NULL) {
-      if (pchRequest != NULL) HeapFree(hHeap, 0, pchRequest);
-      return;
-    }
-
-    if (pchRequest == NULL) {
-      return;
-    }
-
-    // Loop until done reading
-    do {
-      // Read client requests from the pipe. This simplistic code only allows messages
-      // up to BUFSIZE characters in length.
-      ZeroMemory(pchRequest, BUFSIZE * sizeof(uint8_t));
-      fSuccess = ReadFile(
-        input_pipe_handle,          // handle to pipe 
-        pchRequest,                 // buffer to receive data 
-        BUFSIZE * sizeof(uint8_t),  // size of buffer 
-        &cbBytesRead,               // number of bytes read 
-        NULL);                      // not overlapped I/O 
-
-      if (!fSuccess && GetLastError() != ERROR_MORE_DATA) {
-        break;
-      }
-      std::vector<uint8_t> part_vector;
-      part_vector.reserve(cbBytesRead);
-      std::copy(pchRequest, pchRequest + cbBytesRead, std::back_inserter(part_vector));
-      message_parts.push_back(part_vector);
-    } while (!fSuccess);
-
-    if (fSuccess) {
-      // Reconstruct the total_message.
-      std::vector<uint8_t> reconstructed_message;
-      size_t total_size = 0;
-      for (auto& part_vector : message_parts) {
-        total_size += part_vector.size();
-      }
-      reconstructed_message.reserve(total_size);
-      for (auto& part_vector : message_parts) {
-        std::move(part_vector.begin(), part_vector.end(), std::back_inserter(reconstructed_message));
-      }
+  void handle_pipe_connection(FramedChannel<NamedPipeStream>& channel) {
+    // The other side keeps the connection for all its messages, they're read until it goes away.
+    channel.receive([this](const uint8_t* payload, size_t size) {
       std::wstring unicode_msg;
-      unicode_msg.assign(reinterpret_cast<std::wstring::const_pointer>(reconstructed_message.data()), reconstructed_message.size() / sizeof(std::wstring::value_type));
-      input_queue.queue_message(unicode_msg);
-    }
-
-    // Flush the pipe to allow the client to read the pipe's contents 
-    // before disconnecting. Then disconnect the pipe, and close the 
-    // handle to this pipe instance. 
-
-    FlushFileBuffers(input_pipe_handle);
-    DisconnectNamedPipe(input_pipe_handle);
-    CloseHandle(input_pipe_handle);
-
-    HeapFree(hHeap, 0, pchRequest);
-
-    printf("InstanceThread exitting.\n");
+      unicode_msg.assign(reinterpret_cast<std::wstring::const_pointer>(payload), size / sizeof(std::wstring::value_type));
+      input_queue.queue_message(std::move(unicode_msg));
+    });
   }
 
   void start_named_pipe_server(HANDLE token) {
@@ -383,10 +350,10 @@ private:
           pipe_name,
           PIPE_ACCESS_DUPLEX |
           WRITE_DAC,
-          PIPE_TYPE_MESSAGE |
-          PIPE_READMODE_MESSAGE |
+          PIPE_TYPE_BYTE |
+          PIPE_READMODE_BYTE |
           PIPE_WAIT,
-          PIPE_UNLIMITED_INSTANCES,
+          1,
           BUFSIZE,
           BUFSIZE,
           0,
@@ -402,27 +369,28 @@ private:
         }
         current_connect_pipe_handle = connect_pipe_handle;
       }
+      FramedChannel<NamedPipeStream> channel{ NamedPipeStream(connect_pipe_handle) };
       connected = ConnectNamedPipe(connect_pipe_handle, NULL) ? TRUE : (GetLastError() == ERROR_PIPE_CONNECTED);
+      if (connected) {
+        handle_pipe_connection(channel);
+      }
       {
         std::unique_lock lock(pipe_connect_handle_mutex);
         current_connect_pipe_handle = NULL;
       }
-      if (connected) {
-        std::thread(&TwoWayPipeMessageIPC::handle_pipe_connection, this, connect_pipe_handle).detach();
-      } else {
-        // Client could not connect.
-        CloseHandle(connect_pipe_handle);
-      }
     }
   }
 
   void consume_input_queue_thread() {
+    std::vector<SharedMessage> messages;
     while (!closed) {
-      std::wstring message = input_queue.pop_message();
-      if (message.length() == 0) {
+      messages.clear();
+      if (!input_queue.pop_messages(messages)) {
         break;
       }
-      dispatch_inc_message_function(message);
+      for (auto& message : messages) {
+        dispatch_inc_message_function(std::move(message));
+      }
     }
   }
 
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// WinEventFilter keeps the WinEvent ranges every receiver declared, so the runner can install
+// hooks for just those events, drop the ones no receiver wants before queueing them, and only
+// signal each receiver for the events it asked for.
+//
+// Receivers are published like in EventDispatchTable: an immutable list swapped atomically, with
+// replaced lists kept until the filter is destroyed. wanted() and dispatch() take no lock, so a
+// dispatch() already running can still signal a receiver after remove_receiver() returns; wrap
+// dispatches in a DispatchSequence and wait for it before destroying the receiver.
+
+struct WinEventRange {
+  uint32_t event_min;
+  uint32_t event_max;
+  bool any_object = true;
+  int32_t object_id = 0; // Only events of this object id, unless any_object is set
+
+  bool matches(uint32_t event, int32_t object) const noexcept {
+    return (event >= event_min) && (event <= event_max) && (any_object || (object == object_id));
+  }
+};
+
+template<typename Receiver>
+class WinEventFilter {
+public:
+  using HookRange = std::pair<uint32_t, uint32_t>;
+
+  // What a receiver that declares no ranges gets.
+  static constexpr WinEventRange all_events{ 0x00000001, 0x7FFFFFFF }; // EVENT_MIN, EVENT_MAX
+
+  WinEventFilter() {
+    current.store(&empty, std::memory_order_relaxed);
+  }
+
+  WinEventFilter(const WinEventFilter&) = delete;
+  WinEventFilter& operator=(const WinEventFilter&) = delete;
+
+  // An empty list of ranges means every event.
+  void add_receiver(Receiver* receiver, std::vector<WinEventRange> ranges) {
+    if (ranges.empty()) {
+      ranges.push_back(all_events);
+    }
+    std::unique_lock lock(mutex);
+    auto updated = std::make_unique<Receivers>(*current.load(std::memory_order_relaxed));
+    updated->entries.push_back({ receiver, std::move(ranges) });
+    publish(std::move(updated));
+  }
+
+  void remove_receiver(Receiver* receiver) {
+    std::unique_lock lock(mutex);
+    auto updated = std::make_unique<Receivers>(*current.load(std::memory_order_relaxed));
+    auto& entries = updated->entries;
+    entries.erase(std::remove_if(begin(entries), end(entries), [receiver](const Entry& entry) { return entry.receiver == receiver; }), end(entries));
+    publish(std::move(updated));
+  }
+
+  // The fewest event ranges covering what the receivers want, sorted, one hook each.
+  std::vector<HookRange> hook_ranges() const {
+    return current.load(std::memory_order_acquire)->hooks;
+  }
+
+  // Whether any receiver wants the event, checked before it is queued.
+  bool wanted(uint32_t event, int32_t object) const noexcept {
+    const Receivers& receivers = *current.load(std::memory_order_acquire);
+    return std::any_of(begin(receivers.entries), end(receivers.entries), [event, object](const Entry& entry) { return entry.matches(event, object); });
+  }
+
+  // Calls signal(receiver) for every receiver that wants the event and returns how many there were.
+  template<typename Signal>
+  size_t dispatch(uint32_t event, int32_t object, Signal&& signal) const {
+    const Receivers& receivers = *current.load(std::memory_order_acquire);
+    size_t signaled = 0;
+    for (const auto& entry : receivers.entries) {
+      if (entry.matches(event, object)) {
+        signal(entry.receiver);
+        ++signaled;
+      }
+    }
+    return signaled;
+  }
+
+private:
+  struct Entry {
+    Receiver* receiver;
+    std::vector<WinEventRange> ranges;
+
+    bool matches(uint32_t event, int32_t object) const noexcept {
+      return std::any_of(begin(ranges), end(ranges), [event, object](const WinEventRange& range) { return range.matches(event, object); });
+    }
+  };
+
+  struct Receivers {
+    std::vector<Entry> entries;
+    std::vector<HookRange> hooks;
+  };
+
+  void publish(std::unique_ptr<Receivers> receivers) {
+    // Overlapping and adjacent ranges share a hook; the object ids are checked per event.
+    std::vector<HookRange> ranges;
+    for (const auto& entry : receivers->entries) {
+      for (const auto& range : entry.ranges) {
+        ranges.emplace_back(range.event_min, range.event_max);
+      }
+    }
+    std::sort(begin(ranges), end(ranges));
+    receivers->hooks.clear();
+    for (const auto& range : ranges) {
+      if (!receivers->hooks.empty() && (range.first <= receivers->hooks.back().second + 1)) {
+        receivers->hooks.back().second = (std::max)(receivers->hooks.back().second, range.second);
+      } else {
+        receivers->hooks.push_back(range);
+      }
+    }
+
+    const auto* published_receivers = receivers.get();
+    published.push_back(std::move(receivers));
+    current.store(published_receivers, std::memory_order_release);
+  }
+
+  std::mutex mutex;
+  const Receivers empty;
+  std::atomic<const Receivers*> current;
+  // Every list ever published, including the current one.
+  std::vector<std::unique_ptr<Receivers>> published;
+};
@@ -1,15 +1,18 @@
 #include "pch.h"
+#include <mutex>
 #include <common/settings_objects.h>
 #include <common/common.h>
 #include <interface/powertoy_module_interface.h>
 #include <interface/lowlevel_keyboard_event_data.h>
 #include <interface/win_hook_event_data.h>
 #include <lib/ZoneSet.h>
+#include <lib/ZoneSetStore.h>
 #include <lib/RegistryHelpers.h>
 
 #include <lib/resource.h>
 #include <lib/trace.h>
 #include <lib/Settings.h>
+#include <lib/WindowFilter.h>
 #include <lib/FancyZones.h>
 
 extern "C" IMAGE_DOS_HEADER __ImageBase;
@@ -44,27 +47,26 @@ STDAPI PersistZoneSet(
 {
     // See if we have already persisted this layout we can update.
     UUID id{GUID_NULL};
-    if (wil::unique_hkey key{ RegistryHelpers::OpenKey(resolutionKey) })
+    try
     {
-        ZoneSetPersistedData data{};
-        DWORD dataSize = sizeof(data);
-        wchar_t value[256]{};
-        DWORD valueLength = ARRAYSIZE(value);
-        DWORD i = 0;
-        while (RegEnumValueW(key.get(), i++, value, &valueLength, nullptr, nullptr, reinterpret_cast<BYTE*>(&data), &dataSize) == ERROR_SUCCESS)
+        std::wstring const path = ZoneSetStore::DefaultPath();
+        ZoneSetStore::EnsureMigrated(path.c_str());
+
+        ZoneSetStore::MappedView view(path.c_str());
+        ZoneSetStore::Image const& image = view.Get();
+        for (DWORD i = 0; i < image.RecordCount(); i++)
         {
-            if (data.LayoutId == layoutId)
+            ZoneSetStore::Record const& record = image.RecordAt(i);
+            if ((wcscmp(record.WorkAreaKey, resolutionKey) == 0) &&
+                (record.LayoutId == layoutId) &&
+                (record.ZoneCount == static_cast<DWORD>(zoneCount)))
             {
-                if (data.ZoneCount == zoneCount)
-                {
-                    CLSIDFromString(value, &id);
-                    break;
-                }
+                id = record.Id;
+                break;
             }
-            valueLength = ARRAYSIZE(value);
-            dataSize = sizeof(data);
         }
     }
+    CATCH_LOG();
 
     if (id == GUID_NULL)
     {
@@ -90,7 +92,12 @@ STDAPI PersistZoneSet(
             const int bottom = zones[baseIndex+3];
             zoneSet->AddZone(MakeZone({ left, top, right, bottom }));
         }
-        zoneSet->Save();
+
+        // Don't make a zone set active that isn't in the store, Save has logged why.
+        if (!zoneSet->Save())
+        {
+            return E_FAIL;
+        }
 
         wil::unique_cotaskmem_string zoneSetId;
         if (SUCCEEDED_LOG(StringFromCLSID(id, &zoneSetId)))
@@ -116,10 +123,70 @@ public:
     // nullptr as the last element of the array. Nullptr can also be retured for empty list.
     virtual PCWSTR* get_events() override
     {
-        static PCWSTR events[] = { ll_keyboard, win_hook_event, nullptr };
+        static PCWSTR events[] = { ll_keyboard_hotkey, win_hook_event, nullptr };
         return events;
     }
 
+    // Win+Ctrl+Number cycles the zone sets and is swallowed, and so is Win+Arrow when it snaps
+    // windows to zones. Numbers with other modifiers cycle the zone sets while dragging and are
+    // passed on. Shift turns the Win hotkeys off, like it does in OnHotkey.
+    virtual size_t get_hotkeys(LowlevelKeyboardHotkey* hotkeys, size_t buffer_size) override
+    {
+        if (!m_app)
+        {
+            return 0;
+        }
+
+        const bool snap = m_settings->GetSettings().overrideSnapHotkeys;
+        size_t count = 0;
+        const auto add = [&](unsigned vk, unsigned modifiers, bool swallow) {
+            if (count < buffer_size)
+            {
+                hotkeys[count] = { vk, modifiers, swallow };
+            }
+            count++;
+        };
+        for (unsigned modifiers = 0; modifiers < 16; modifiers++)
+        {
+            const bool win = modifiers & LL_KEYBOARD_MODIFIER_WIN;
+            const bool ctrl = modifiers & LL_KEYBOARD_MODIFIER_CTRL;
+            const bool shift = modifiers & LL_KEYBOARD_MODIFIER_SHIFT;
+            if (!win || shift || ctrl)
+            {
+                for (unsigned vk = '0'; vk <= '9'; vk++)
+                {
+                    add(vk, modifiers, win && !shift);
+                }
+            }
+            if (snap && win && !shift && !ctrl)
+            {
+                for (unsigned vk = VK_LEFT; vk <= VK_DOWN; vk++)
+                {
+                    add(vk, modifiers, true);
+                }
+            }
+        }
+        return count;
+    }
+
+    // The events HandleWinHookEvent handles. Location changes of carets and cursors, and objects
+    // inside windows being created, shown or destroyed, are left out.
+    virtual size_t get_win_hook_event_ranges(WinHookEventRange* ranges, size_t buffer_size) override
+    {
+        static const WinHookEventRange events[] = {
+            { EVENT_SYSTEM_MOVESIZESTART, EVENT_SYSTEM_MOVESIZEEND, true, 0 },
+            { EVENT_OBJECT_CREATE, EVENT_OBJECT_SHOW, false, OBJID_WINDOW },
+            { EVENT_OBJECT_LOCATIONCHANGE, EVENT_OBJECT_LOCATIONCHANGE, false, OBJID_WINDOW },
+            { EVENT_OBJECT_NAMECHANGE, EVENT_OBJECT_NAMECHANGE, true, 0 },
+            { EVENT_OBJECT_UNCLOAKED, EVENT_OBJECT_UNCLOAKED, false, OBJID_WINDOW },
+        };
+        if (buffer_size >= std::size(events))
+        {
+            std::copy(std::begin(events), std::end(events), ranges);
+        }
+        return std::size(events);
+    }
+
     // Return JSON with the configuration options.
     // These are the settings shown on the settings page along with their current values.
     virtual bool get_config(_Out_ PWSTR buffer, _Out_ int *buffer_size) override
@@ -132,6 +199,7 @@ public:
     virtual void set_config(PCWSTR config) override
     {
         m_settings->SetConfig(config);
+        UpdateExcludedApps();
     }
 
     // Signal from the Settings editor to call a custom action.
@@ -147,6 +215,11 @@ public:
         if (!m_app)
         {
             Trace::FancyZones::EnableFancyZones(true);
+            {
+                // Destroy notifications were not observed while disabled.
+                std::scoped_lock lock(m_windowFilterLock);
+                m_windowVerdicts.Clear();
+            }
             m_app = MakeFancyZones(reinterpret_cast<HINSTANCE>(&__ImageBase), m_settings.get());
             if (m_app)
             {
@@ -172,10 +245,10 @@ public:
     {
         if (m_app)
         {
-            if (wcscmp(name, ll_keyboard) == 0)
+            if (wcscmp(name, ll_keyboard_hotkey) == 0)
             {
-                // Return 1 if the keypress is to be suppressed (not forwarded to Windows), otherwise return 0.
-                return HandleKeyboardHookEvent(reinterpret_cast<LowlevelKeyboardEvent*>(data));
+                // Return value is ignored, whether the key is swallowed was decided by get_hotkeys
+                HandleHotkeyEvent(reinterpret_cast<LowlevelKeyboardHotkey*>(data));
             }
             else if (wcscmp(name, win_hook_event) == 0)
             {
@@ -200,6 +273,7 @@ public:
     {
         app_name = GET_RESOURCE_STRING(IDS_FANCYZONES);
         m_settings = MakeFancyZonesSettings(reinterpret_cast<HINSTANCE>(&__ImageBase), FancyZonesModule::get_name());
+        UpdateExcludedApps();
     }
 
 private:
@@ -217,25 +291,38 @@ private:
         {
             return false;
         }
+        // The checks below depend only on the owning process, so their verdict is
+        // cached until the window is destroyed or the excluded apps change.
+        DWORD pid{};
+        GetWindowThreadProcessId(window, &pid);
+        std::scoped_lock lock(m_windowFilterLock);
+        if (auto verdict = m_windowVerdicts.Get(window, pid))
+        {
+            return *verdict;
+        }
         // Filter some windows like the Start menu or Cortana
         auto windowAndPath = get_filtered_base_window_and_path(window);
         if (windowAndPath.hwnd == nullptr)
         {
+            // Not cached: this also fails for windows that are not visible yet.
             return false;
         }
         // Filter out user specified apps
         CharUpperBuffW(windowAndPath.process_path.data(), (DWORD)windowAndPath.process_path.length());
+        bool const interesting = !m_excludedApps.Matches(windowAndPath.process_path);
+        m_windowVerdicts.Set(window, pid, interesting);
+        return interesting;
+    }
+
+    void UpdateExcludedApps()
+    {
         if (m_settings)
         {
-            for (const auto& excluded : m_settings->GetSettings().excludedAppsArray)
-            {
-                if (windowAndPath.process_path.find(excluded) != std::wstring::npos)
-                {
-                    return false;
-                }
-            }
+            ExcludedAppsMatcher excludedApps(m_settings->GetSettings().excludedAppsArray);
+            std::scoped_lock lock(m_windowFilterLock);
+            m_excludedApps = std::move(excludedApps);
+            m_windowVerdicts.Clear();
         }
-        return true;
     }
 
     void Disable(bool const traceEvent)
@@ -250,7 +337,7 @@ private:
         }
     }
 
-    intptr_t HandleKeyboardHookEvent(LowlevelKeyboardEvent* data) noexcept;
+    void HandleHotkeyEvent(LowlevelKeyboardHotkey* data) noexcept;
     void HandleWinHookEvent(WinHookEvent* data) noexcept;
     void MoveSizeStart(HWND window, POINT const& ptScreen) noexcept;
     void MoveSizeEnd(HWND window, POINT const& ptScreen) noexcept;
@@ -260,15 +347,15 @@ private:
     winrt::com_ptr<IFancyZones> m_app;
     winrt::com_ptr<IFancyZonesSettings> m_settings;
     std::wstring app_name;
+
+    std::mutex m_windowFilterLock;
+    ExcludedAppsMatcher m_excludedApps;
+    WindowVerdictCache m_windowVerdicts;
 };
 
-intptr_t FancyZonesModule::HandleKeyboardHookEvent(LowlevelKeyboardEvent* data) noexcept
+void FancyZonesModule::HandleHotkeyEvent(LowlevelKeyboardHotkey* data) noexcept
 {
-    if (data->wParam == WM_KEYDOWN)
-    {
-        return m_app.as<IFancyZonesCallback>()->OnKeyDown(data->lParam) ? 1 : 0;
-    }
-    return 0;
+    m_app.as<IFancyZonesCallback>()->OnHotkey(data->vk, data->modifiers);
 }
 
 void FancyZonesModule::HandleWinHookEvent(WinHookEvent* data) noexcept
@@ -286,6 +373,8 @@ void FancyZonesModule::HandleWinHookEvent(WinHookEvent* data) noexcept
 
     case EVENT_SYSTEM_MOVESIZEEND:
     {
+        // The window may have been resized or dragged onto a monitor with another dpi.
+        WindowRelayout::DesktopGeometryCache().InvalidateWindow(data->hwnd);
         MoveSizeEnd(data->hwnd, ptScreen);
     }
     break;
@@ -311,6 +400,17 @@ void FancyZonesModule::HandleWinHookEvent(WinHookEvent* data) noexcept
     }
     break;
 
+    case EVENT_OBJECT_DESTROY:
+    {
+        if (data->idObject == OBJID_WINDOW)
+        {
+            WindowRelayout::DesktopGeometryCache().InvalidateWindow(data->hwnd);
+            std::scoped_lock lock(m_windowFilterLock);
+            m_windowVerdicts.Invalidate(data->hwnd);
+        }
+    }
+    break;
+
     case EVENT_OBJECT_UNCLOAKED:
     case EVENT_OBJECT_SHOW:
     case EVENT_OBJECT_CREATE:
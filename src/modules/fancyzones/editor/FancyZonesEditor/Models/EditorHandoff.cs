@@ -0,0 +1,193 @@
+﻿// Copyright (c) Microsoft Corporation
+// The Microsoft Corporation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.IO.MemoryMappedFiles;
+using System.Threading;
+using System.Windows;
+
+namespace FancyZonesEditor.Models
+{
+    // EditorHandoff
+    //  Reads the snapshot FancyZones shares with the editor when it launches it, and hands the applied layout back
+    //  The offsets below must match EditorHandoff.h in the FancyZones library
+    public static class EditorHandoff
+    {
+        private const uint _magic = 0x48455A46;
+        private const uint _version = 1;
+        private const int _maxResultZones = 256;
+        private const int _maxUniqueIdLength = 256;
+        private const int _maxWorkAreaKeyLength = 32;
+        private const int _rectSize = 16;
+
+        // SnapshotHeader
+        private const int _sizeOffset = 8;
+        private const int _layoutIdOffset = 12;
+        private const int _monitorOffset = 16;
+        private const int _editorRectOffset = 24;
+        private const int _dpiOffset = 40;
+        private const int _zoneCountOffset = 44;
+        private const int _spacingOffset = 48;
+        private const int _showSpacingOffset = 52;
+        private const int _uniqueIdOffset = 72;
+        private const int _workAreaKeyOffset = 584;
+        private const int _customLayoutCountOffset = 648;
+        private const int _customLayoutsOffset = 652;
+        private const int _dataOffset = 656;
+        private const int _dataSizeOffset = 660;
+        private const int _snapshotHeaderSize = 672;
+        private const int _customLayoutSize = 16;
+
+        // ResultHeader
+        private const int _appliedOffset = 8;
+        private const int _resultLayoutIdOffset = 12;
+        private const int _resultZoneCountOffset = 16;
+        private const int _resultHeaderSize = 24;
+        private const int _resultSize = _resultHeaderSize + (_maxResultZones * _rectSize);
+
+        private static string _resultName;
+
+        public static bool IsOpen { get; private set; }
+
+        public static ushort LayoutId { get; private set; }
+
+        public static uint Monitor { get; private set; }
+
+        public static Rect EditorRect { get; private set; }
+
+        public static float Dpi { get; private set; }
+
+        public static int ZoneCount { get; private set; }
+
+        public static int Spacing { get; private set; }
+
+        public static bool ShowSpacing { get; private set; }
+
+        public static string UniqueKey { get; private set; }
+
+        public static string WorkAreaKey { get; private set; }
+
+        public static IList<KeyValuePair<string, byte[]>> CustomLayouts { get; } = new List<KeyValuePair<string, byte[]>>();
+
+        // Maps the snapshot named on the command line, read-only, and copies out what the editor uses
+        public static bool Open(string name)
+        {
+            try
+            {
+                using (var section = MemoryMappedFile.OpenExisting(name, MemoryMappedFileRights.Read))
+                using (var view = section.CreateViewAccessor(0, 0, MemoryMappedFileAccess.Read))
+                {
+                    if (view.Capacity < _snapshotHeaderSize ||
+                        view.ReadUInt32(0) != _magic ||
+                        view.ReadUInt32(4) != _version ||
+                        view.ReadUInt32(_sizeOffset) > view.Capacity)
+                    {
+                        return false;
+                    }
+
+                    LayoutId = (ushort)view.ReadUInt32(_layoutIdOffset);
+                    Monitor = (uint)view.ReadUInt64(_monitorOffset);
+                    EditorRect = new Rect(
+                        view.ReadInt32(_editorRectOffset),
+                        view.ReadInt32(_editorRectOffset + 4),
+                        view.ReadInt32(_editorRectOffset + 8),
+                        view.ReadInt32(_editorRectOffset + 12));
+                    Dpi = view.ReadSingle(_dpiOffset);
+                    ZoneCount = view.ReadInt32(_zoneCountOffset);
+                    Spacing = view.ReadInt32(_spacingOffset);
+                    ShowSpacing = view.ReadInt32(_showSpacingOffset) != 0;
+                    UniqueKey = ReadString(view, _uniqueIdOffset, _maxUniqueIdLength);
+                    WorkAreaKey = ReadString(view, _workAreaKeyOffset, _maxWorkAreaKeyLength);
+
+                    uint count = view.ReadUInt32(_customLayoutCountOffset);
+                    long records = view.ReadUInt32(_customLayoutsOffset);
+                    long data = view.ReadUInt32(_dataOffset);
+                    long dataSize = view.ReadUInt32(_dataSizeOffset);
+                    if (records + ((long)count * _customLayoutSize) > view.Capacity || data + dataSize > view.Capacity)
+                    {
+                        return false;
+                    }
+
+                    CustomLayouts.Clear();
+                    for (long i = 0; i < count; i++)
+                    {
+                        long record = records + (i * _customLayoutSize);
+                        long nameOffset = view.ReadUInt32(record);
+                        long nameLength = view.ReadUInt32(record + 4);
+                        long layoutOffset = view.ReadUInt32(record + 8);
+                        long layoutSize = view.ReadUInt32(record + 12);
+                        if (nameOffset + (nameLength * 2) > dataSize || layoutOffset + layoutSize > dataSize)
+                        {
+                            return false;
+                        }
+
+                        var name = new char[nameLength];
+                        view.ReadArray(data + nameOffset, name, 0, name.Length);
+                        var bytes = new byte[layoutSize];
+                        view.ReadArray(data + layoutOffset, bytes, 0, bytes.Length);
+                        CustomLayouts.Add(new KeyValuePair<string, byte[]>(new string(name), bytes));
+                    }
+                }
+            }
+            catch (IOException)
+            {
+                return false;
+            }
+            catch (UnauthorizedAccessException)
+            {
+                return false;
+            }
+
+            _resultName = name + "-Result";
+            IsOpen = true;
+            return true;
+        }
+
+        // Hands the layout back to FancyZones, which applies it when the editor exits
+        // zones are in left/top/right/bottom chunks, already scaled to the DPI
+        public static bool WriteResult(ushort layoutId, int[] zones)
+        {
+            if (!IsOpen)
+            {
+                return false;
+            }
+
+            try
+            {
+                using (var section = MemoryMappedFile.OpenExisting(_resultName, MemoryMappedFileRights.ReadWrite))
+                using (var view = section.CreateViewAccessor(0, _resultSize, MemoryMappedFileAccess.ReadWrite))
+                {
+                    int zoneCount = Math.Min(zones.Length / 4, _maxResultZones);
+                    view.WriteArray(_resultHeaderSize, zones, 0, zoneCount * 4);
+                    view.Write(_resultLayoutIdOffset, (uint)layoutId);
+                    view.Write(_resultZoneCountOffset, (uint)zoneCount);
+
+                    // Applied goes last, FancyZones ignores the zones until it is set
+                    Thread.MemoryBarrier();
+                    view.Write(_appliedOffset, 1);
+                }
+            }
+            catch (IOException)
+            {
+                return false;
+            }
+            catch (UnauthorizedAccessException)
+            {
+                return false;
+            }
+
+            return true;
+        }
+
+        private static string ReadString(MemoryMappedViewAccessor view, long offset, int maxLength)
+        {
+            var chars = new char[maxLength];
+            view.ReadArray(offset, chars, 0, maxLength);
+            int length = Array.IndexOf(chars, '\0');
+            return new string(chars, 0, length < 0 ? maxLength : length);
+        }
+    }
+}
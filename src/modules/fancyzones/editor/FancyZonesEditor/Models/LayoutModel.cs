@@ -3,6 +3,7 @@
 // See the LICENSE file in the project root for more information.
 
 using System;
+using System.Collections.Generic;
 using System.Collections.ObjectModel;
 using System.ComponentModel;
 using System.Runtime.InteropServices;
@@ -116,38 +117,56 @@ namespace FancyZonesEditor.Models
             }
         }
 
-        // Loads all the Layouts persisted under the Layouts key in the registry
+        // Loads all the Layouts persisted under the Layouts key in the registry, or their copy in the snapshot FancyZones handed us
         public static ObservableCollection<LayoutModel> LoadCustomModels()
         {
             _customModels = new ObservableCollection<LayoutModel>();
 
-            RegistryKey key = Registry.CurrentUser.OpenSubKey(_registryPath);
-            if (key != null)
+            var layouts = new List<KeyValuePair<string, byte[]>>();
+            if (EditorHandoff.IsOpen)
+            {
+                layouts.AddRange(EditorHandoff.CustomLayouts);
+            }
+            else
             {
-                foreach (string name in key.GetValueNames())
+                RegistryKey key = Registry.CurrentUser.OpenSubKey(_registryPath);
+                if (key != null)
                 {
-                    LayoutModel model = null;
-                    byte[] data = (byte[])Registry.GetValue(_fullRegistryPath, name, null);
-
-                    ushort version = (ushort)((data[0] * 256) + data[1]);
-                    byte type = data[2];
-                    ushort id = (ushort)((data[3] * 256) + data[4]);
-
-                    switch (type)
+                    foreach (string name in key.GetValueNames())
                     {
-                        case 0: model = new GridLayoutModel(version, name, id, data); break;
-                        case 1: model = new CanvasLayoutModel(version, name, id, data); break;
+                        layouts.Add(new KeyValuePair<string, byte[]>(name, (byte[])Registry.GetValue(_fullRegistryPath, name, null)));
                     }
+                }
+            }
 
-                    if (model != null)
-                    {
-                        if (_maxId < id)
-                        {
-                            _maxId = id;
-                        }
+            foreach (var layout in layouts)
+            {
+                string name = layout.Key;
+                byte[] data = layout.Value;
+                if (data == null || data.Length < 5)
+                {
+                    continue;
+                }
+
+                LayoutModel model = null;
+                ushort version = (ushort)((data[0] * 256) + data[1]);
+                byte type = data[2];
+                ushort id = (ushort)((data[3] * 256) + data[4]);
 
-                        _customModels.Add(model);
+                switch (type)
+                {
+                    case 0: model = new GridLayoutModel(version, name, id, data); break;
+                    case 1: model = new CanvasLayoutModel(version, name, id, data); break;
+                }
+
+                if (model != null)
+                {
+                    if (_maxId < id)
+                    {
+                        _maxId = id;
                     }
+
+                    _customModels.Add(model);
                 }
             }
 
@@ -172,19 +191,6 @@ namespace FancyZonesEditor.Models
 
         public void Apply(System.Windows.Int32Rect[] zones)
         {
-            // Persist the zone data back into FZ
-            var module = Native.LoadLibrary("fancyzones.dll");
-            if (module == IntPtr.Zero)
-            {
-                return;
-            }
-
-            var pfn = Native.GetProcAddress(module, "PersistZoneSet");
-            if (pfn == IntPtr.Zero)
-            {
-                return;
-            }
-
             // Scale all the zones to the DPI and then pack them up to be marshalled.
             int zoneCount = zones.Length;
             var zoneArray = new int[zoneCount * 4];
@@ -202,6 +208,25 @@ namespace FancyZonesEditor.Models
                 zoneArray[index + 3] = bottom;
             }
 
+            // FancyZones applies the layout itself when we exit
+            if (EditorHandoff.WriteResult(Id, zoneArray))
+            {
+                return;
+            }
+
+            // Persist the zone data back into FZ
+            var module = Native.LoadLibrary("fancyzones.dll");
+            if (module == IntPtr.Zero)
+            {
+                return;
+            }
+
+            var pfn = Native.GetProcAddress(module, "PersistZoneSet");
+            if (pfn == IntPtr.Zero)
+            {
+                return;
+            }
+
             var persistZoneSet = Marshal.GetDelegateForFunctionPointer<Native.PersistZoneSet>(pfn);
             persistZoneSet(Settings.UniqueKey, Settings.WorkAreaKey, Settings.Monitor, _id, zoneCount, zoneArray);
         }
@@ -98,9 +98,18 @@ namespace FancyZonesEditor
 
             _blankCustomModel = new CanvasLayoutModel("Create new custom", _blankCustomModelId, (int)_workArea.Width, (int)_workArea.Height);
 
-            _zoneCount = ReadRegistryInt("ZoneCount", 3);
-            _spacing = ReadRegistryInt("Spacing", 16);
-            _showSpacing = ReadRegistryInt("ShowSpacing", 1) == 1;
+            if (EditorHandoff.IsOpen)
+            {
+                _zoneCount = EditorHandoff.ZoneCount;
+                _spacing = EditorHandoff.Spacing;
+                _showSpacing = EditorHandoff.ShowSpacing;
+            }
+            else
+            {
+                _zoneCount = ReadRegistryInt("ZoneCount", 3);
+                _spacing = ReadRegistryInt("Spacing", 16);
+                _showSpacing = ReadRegistryInt("ShowSpacing", 1) == 1;
+            }
 
             UpdateLayoutModels();
         }
@@ -336,7 +345,17 @@ namespace FancyZonesEditor
             Dpi = 1;
 
             string[] args = Environment.GetCommandLineArgs();
-            if (args.Length == 7)
+            if (args.Length == 8 && EditorHandoff.Open(args[7]))
+            {
+                // 7 = name of the shared memory snapshot FancyZones wrote for us, which supersedes the other arguments
+                UniqueKey = EditorHandoff.UniqueKey;
+                _uniqueRegistryPath += "\\" + UniqueKey;
+                WorkAreaKey = EditorHandoff.WorkAreaKey;
+                Dpi = EditorHandoff.Dpi;
+                Monitor = EditorHandoff.Monitor;
+                _workArea = EditorHandoff.EditorRect;
+            }
+            else if (args.Length == 7 || args.Length == 8)
             {
                 // 1 = unique key for per-monitor settings
                 // 2 = layoutid used to generate current layout (used to pick the default layout to show)
@@ -0,0 +1,122 @@
+#include "pch.h"
+
+#include "AnimationScheduler.h"
+
+#include <algorithm>
+
+void AnimationQueue::Start(uintptr_t key, Time now, Time duration, Frame frame)
+{
+    Animation animation{ key, now, (std::max)(duration, Time::zero()), now, std::make_shared<Frame const>(std::move(frame)) };
+
+    auto existing = std::find_if(m_animations.begin(), m_animations.end(), [key](Animation const& a) { return a.Key == key; });
+    if (existing != m_animations.end())
+    {
+        *existing = std::move(animation);
+    }
+    else
+    {
+        m_animations.push_back(std::move(animation));
+    }
+}
+
+bool AnimationQueue::Cancel(uintptr_t key) noexcept
+{
+    auto existing = std::find_if(m_animations.begin(), m_animations.end(), [key](Animation const& a) { return a.Key == key; });
+    if (existing == m_animations.end())
+    {
+        return false;
+    }
+    m_animations.erase(existing);
+    return true;
+}
+
+std::optional<AnimationQueue::Time> AnimationQueue::Advance(Time now, std::vector<Step>& steps)
+{
+    std::optional<Time> next;
+    for (auto iter = m_animations.begin(); iter != m_animations.end();)
+    {
+        if (iter->Due <= now)
+        {
+            Time const end = iter->Start + iter->Duration;
+            double const progress = (now >= end) ? 1.0 : static_cast<double>((now - iter->Start).count()) / iter->Duration.count();
+            steps.push_back({ iter->Callback, progress });
+
+            if (progress >= 1.0)
+            {
+                iter = m_animations.erase(iter);
+                continue;
+            }
+
+            // Land the last frame exactly on the end of the animation.
+            iter->Due = (std::min)(now + m_frameInterval, end);
+        }
+
+        next = next ? (std::min)(*next, iter->Due) : iter->Due;
+        ++iter;
+    }
+    return next;
+}
+
+AnimationScheduler::AnimationScheduler() :
+    m_thread([this] { Run(); })
+{
+}
+
+AnimationScheduler::~AnimationScheduler()
+{
+    {
+        std::scoped_lock lock(m_lock);
+        m_stop = true;
+    }
+    m_wake.notify_one();
+    m_thread.join();
+}
+
+void AnimationScheduler::Start(uintptr_t key, AnimationQueue::Time duration, AnimationQueue::Frame frame)
+{
+    {
+        std::scoped_lock lock(m_lock);
+        m_queue.Start(key, Now(), duration, std::move(frame));
+    }
+    m_wake.notify_one();
+}
+
+void AnimationScheduler::Cancel(uintptr_t key)
+{
+    std::scoped_lock lock(m_lock);
+    m_queue.Cancel(key);
+}
+
+AnimationQueue::Time AnimationScheduler::Now() noexcept
+{
+    return std::chrono::duration_cast<AnimationQueue::Time>(std::chrono::steady_clock::now().time_since_epoch());
+}
+
+void AnimationScheduler::Run() noexcept
+{
+    std::vector<AnimationQueue::Step> steps;
+    std::unique_lock lock(m_lock);
+    while (!m_stop)
+    {
+        steps.clear();
+        auto const next = m_queue.Advance(Now(), steps);
+        if (!steps.empty())
+        {
+            // Frames run unlocked so starting a new animation never waits on one.
+            lock.unlock();
+            for (auto const& step : steps)
+            {
+                (*step.Callback)(step.Progress);
+            }
+            lock.lock();
+        }
+        else if (next)
+        {
+            m_wake.wait_until(lock, std::chrono::steady_clock::time_point(*next));
+        }
+        else
+        {
+            m_wake.wait(lock);
+        }
+    }
+}
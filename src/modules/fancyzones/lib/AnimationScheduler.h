@@ -0,0 +1,85 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// Overlay animations, keyed by the window they run on. Starting an animation for a key
+// supersedes whatever was running for it, so a burst of layout changes leaves a single
+// animation behind. Time is passed in, which lets tests drive the queue with a fake clock.
+class AnimationQueue
+{
+public:
+    using Time = std::chrono::milliseconds;
+
+    // Called with the progress of the animation, from 0 to 1. The last call is always 1.
+    using Frame = std::function<void(double progress)>;
+
+    struct Step
+    {
+        std::shared_ptr<Frame const> Callback;
+        double Progress{};
+    };
+
+    static constexpr Time DefaultFrameInterval{ 16 };
+
+    explicit AnimationQueue(Time frameInterval = DefaultFrameInterval) noexcept :
+        m_frameInterval(frameInterval)
+    {
+    }
+
+    // The first frame is due at now.
+    void Start(uintptr_t key, Time now, Time duration, Frame frame);
+    bool Cancel(uintptr_t key) noexcept;
+
+    // Appends the frames due at now to steps. Frames missed because now is late are
+    // coalesced into one. Returns when the next frame is due, or nothing once idle.
+    std::optional<Time> Advance(Time now, std::vector<Step>& steps);
+
+    size_t Size() const noexcept { return m_animations.size(); }
+
+private:
+    struct Animation
+    {
+        uintptr_t Key{};
+        Time Start{};
+        Time Duration{};
+        Time Due{};
+        std::shared_ptr<Frame const> Callback;
+    };
+
+    Time m_frameInterval;
+    std::vector<Animation> m_animations; // Only a handful run at once
+};
+
+// Runs an AnimationQueue on a thread of its own. Frames are called on that thread, so they
+// should only post to the window that owns the animation; they must not call back into the
+// scheduler. A frame picked up just before Cancel may still run, so owners drop stale ones.
+class AnimationScheduler
+{
+public:
+    AnimationScheduler();
+    ~AnimationScheduler();
+
+    AnimationScheduler(AnimationScheduler const&) = delete;
+    AnimationScheduler& operator=(AnimationScheduler const&) = delete;
+
+    void Start(uintptr_t key, AnimationQueue::Time duration, AnimationQueue::Frame frame);
+    void Cancel(uintptr_t key);
+
+private:
+    static AnimationQueue::Time Now() noexcept;
+    void Run() noexcept;
+
+    std::mutex m_lock;
+    std::condition_variable m_wake;
+    AnimationQueue m_queue;
+    bool m_stop{};
+    std::thread m_thread;
+};
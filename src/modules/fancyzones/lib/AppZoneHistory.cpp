@@ -0,0 +1,221 @@
+#include "pch.h"
+
+#include "AppZoneHistory.h"
+#include "RegistryHelpers.h"
+
+AppZoneHistory::AppZoneHistory(size_t capacity) noexcept :
+    m_capacity(max(capacity, static_cast<size_t>(1)))
+{
+}
+
+void AppZoneHistory::Load(std::vector<Entry> const& entries)
+{
+    std::scoped_lock lock(m_lock);
+    m_lru.clear();
+    m_index.clear();
+    m_pending.clear();
+
+    for (auto const& entry : entries)
+    {
+        if (entry.ZoneIndex == -1)
+        {
+            continue;
+        }
+
+        auto key = MakeKey(entry.MonitorKey, entry.ProcessPath);
+        if (auto iter = m_index.find(key); iter != m_index.end())
+        {
+            m_lru.erase(iter->second);
+        }
+        m_lru.push_front(entry);
+        m_index[std::move(key)] = m_lru.begin();
+    }
+
+    // Anything over capacity was never going to be used; drop it from the store as well.
+    EvictIfNeeded();
+}
+
+std::optional<int> AppZoneHistory::Get(std::wstring const& monitorKey, std::wstring const& processPath)
+{
+    std::scoped_lock lock(m_lock);
+    auto iter = m_index.find(MakeKey(monitorKey, processPath));
+    if (iter == m_index.end())
+    {
+        return std::nullopt;
+    }
+
+    m_lru.splice(m_lru.begin(), m_lru, iter->second);
+    return iter->second->ZoneIndex;
+}
+
+void AppZoneHistory::Set(std::wstring const& monitorKey, std::wstring const& processPath, int zoneIndex)
+{
+    std::scoped_lock lock(m_lock);
+    auto key = MakeKey(monitorKey, processPath);
+    auto iter = m_index.find(key);
+
+    if (zoneIndex == -1)
+    {
+        if (iter != m_index.end())
+        {
+            m_lru.erase(iter->second);
+            m_index.erase(iter);
+        }
+        Journal({ monitorKey, processPath, -1 });
+        return;
+    }
+
+    if (iter != m_index.end())
+    {
+        m_lru.splice(m_lru.begin(), m_lru, iter->second);
+        if (iter->second->ZoneIndex == zoneIndex)
+        {
+            return;
+        }
+        iter->second->ZoneIndex = zoneIndex;
+    }
+    else
+    {
+        m_lru.push_front({ monitorKey, processPath, zoneIndex });
+        m_index.emplace(std::move(key), m_lru.begin());
+    }
+
+    Journal(m_lru.front());
+    EvictIfNeeded();
+}
+
+std::vector<AppZoneHistory::Entry> AppZoneHistory::TakePendingChanges()
+{
+    std::scoped_lock lock(m_lock);
+    std::vector<Entry> changes;
+    changes.reserve(m_pending.size());
+    for (auto& [key, entry] : m_pending)
+    {
+        changes.emplace_back(std::move(entry));
+    }
+    m_pending.clear();
+    return changes;
+}
+
+size_t AppZoneHistory::Size() const noexcept
+{
+    std::scoped_lock lock(m_lock);
+    return m_index.size();
+}
+
+bool AppZoneHistory::HasPendingChanges() const noexcept
+{
+    std::scoped_lock lock(m_lock);
+    return !m_pending.empty();
+}
+
+std::wstring AppZoneHistory::MonitorKey(HMONITOR monitor)
+{
+    wchar_t key[32]{};
+    StringCchPrintf(key, ARRAYSIZE(key), L"%x", monitor);
+    return key;
+}
+
+std::vector<AppZoneHistory::Entry> AppZoneHistory::ReadFromRegistry()
+{
+    std::vector<Entry> entries;
+
+    wchar_t historyKey[256]{};
+    StringCchPrintf(historyKey, ARRAYSIZE(historyKey), L"%s\\%s", RegistryHelpers::REG_SETTINGS, RegistryHelpers::APP_ZONE_HISTORY_SUBKEY);
+
+    wil::unique_hkey root;
+    if (RegOpenKeyExW(HKEY_CURRENT_USER, historyKey, 0, KEY_READ, &root) != ERROR_SUCCESS)
+    {
+        return entries;
+    }
+
+    wchar_t monitorKey[256]{};
+    DWORD keyIndex = 0;
+    while (RegEnumKeyW(root.get(), keyIndex++, monitorKey, ARRAYSIZE(monitorKey)) == ERROR_SUCCESS)
+    {
+        wil::unique_hkey key;
+        if (RegOpenKeyExW(root.get(), monitorKey, 0, KEY_READ, &key) != ERROR_SUCCESS)
+        {
+            continue;
+        }
+
+        wchar_t processPath[MAX_PATH + 1]{};
+        DWORD processPathLength = ARRAYSIZE(processPath);
+        DWORD type{};
+        DWORD zoneIndex{};
+        DWORD dataSize = sizeof(zoneIndex);
+        DWORD valueIndex = 0;
+        while (RegEnumValueW(key.get(), valueIndex++, processPath, &processPathLength, nullptr, &type, reinterpret_cast<BYTE*>(&zoneIndex), &dataSize) == ERROR_SUCCESS)
+        {
+            if ((type == REG_DWORD) && (dataSize == sizeof(zoneIndex)))
+            {
+                entries.push_back({ monitorKey, processPath, static_cast<int>(zoneIndex) });
+            }
+            processPathLength = ARRAYSIZE(processPath);
+            dataSize = sizeof(zoneIndex);
+        }
+    }
+    return entries;
+}
+
+void AppZoneHistory::WriteToRegistry(std::vector<Entry> const& changes) noexcept try
+{
+    // Open each monitor key once per batch rather than once per value.
+    std::unordered_map<std::wstring, wil::unique_hkey> keys;
+    for (auto const& change : changes)
+    {
+        auto iter = keys.find(change.MonitorKey);
+        if (iter == keys.end())
+        {
+            wchar_t keyPath[256]{};
+            StringCchPrintf(keyPath, ARRAYSIZE(keyPath), L"%s\\%s\\%s", RegistryHelpers::REG_SETTINGS, RegistryHelpers::APP_ZONE_HISTORY_SUBKEY, change.MonitorKey.c_str());
+
+            wil::unique_hkey key;
+            RegCreateKeyExW(HKEY_CURRENT_USER, keyPath, 0, nullptr, REG_OPTION_NON_VOLATILE, KEY_SET_VALUE, nullptr, &key, nullptr);
+            iter = keys.emplace(change.MonitorKey, std::move(key)).first;
+        }
+
+        if (!iter->second)
+        {
+            continue;
+        }
+
+        if (change.ZoneIndex == -1)
+        {
+            RegDeleteValueW(iter->second.get(), change.ProcessPath.c_str());
+        }
+        else
+        {
+            DWORD const zoneIndex = static_cast<DWORD>(change.ZoneIndex);
+            RegSetValueExW(iter->second.get(), change.ProcessPath.c_str(), 0, REG_DWORD, reinterpret_cast<BYTE const*>(&zoneIndex), sizeof(zoneIndex));
+        }
+    }
+}
+CATCH_LOG();
+
+std::wstring AppZoneHistory::MakeKey(std::wstring const& monitorKey, std::wstring const& processPath)
+{
+    std::wstring key;
+    key.reserve(monitorKey.size() + 1 + processPath.size());
+    key += monitorKey;
+    key += L'|';
+    key += processPath;
+    return key;
+}
+
+void AppZoneHistory::Journal(Entry const& entry)
+{
+    m_pending[MakeKey(entry.MonitorKey, entry.ProcessPath)] = entry;
+}
+
+void AppZoneHistory::EvictIfNeeded()
+{
+    while (m_lru.size() > m_capacity)
+    {
+        Entry& evicted = m_lru.back();
+        m_index.erase(MakeKey(evicted.MonitorKey, evicted.ProcessPath));
+        evicted.ZoneIndex = -1;
+        Journal(evicted);
+        m_lru.pop_back();
+    }
+}
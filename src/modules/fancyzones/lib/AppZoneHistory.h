@@ -0,0 +1,60 @@
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+// In-memory record of the zone each application was last snapped to, per monitor.
+//
+// Lookups and updates only touch the hash map; every update is also recorded in a
+// pending journal that the owner drains with TakePendingChanges and persists in
+// batches. The least recently used entries are evicted (and journaled as deletions)
+// once the capacity is reached. All methods are thread-safe.
+class AppZoneHistory
+{
+public:
+    static constexpr inline size_t DefaultCapacity = 1024;
+
+    struct Entry
+    {
+        std::wstring MonitorKey;
+        std::wstring ProcessPath;
+        int ZoneIndex{ -1 }; // -1 means the entry was removed
+    };
+
+    explicit AppZoneHistory(size_t capacity = DefaultCapacity) noexcept;
+
+    // Replaces the contents without journaling anything. Later entries are treated as more recent.
+    void Load(std::vector<Entry> const& entries);
+
+    std::optional<int> Get(std::wstring const& monitorKey, std::wstring const& processPath);
+
+    // Pass -1 for zoneIndex to remove the entry.
+    void Set(std::wstring const& monitorKey, std::wstring const& processPath, int zoneIndex);
+
+    // Returns the changes made since the last call, coalesced to the latest value per entry.
+    std::vector<Entry> TakePendingChanges();
+
+    size_t Size() const noexcept;
+    bool HasPendingChanges() const noexcept;
+
+    static std::wstring MonitorKey(HMONITOR monitor);
+
+    // Persistence under Software\SuperFancyZones\AppZoneHistory\<monitor key>.
+    static std::vector<Entry> ReadFromRegistry();
+    static void WriteToRegistry(std::vector<Entry> const& changes) noexcept;
+
+private:
+    using LruList = std::list<Entry>;
+
+    static std::wstring MakeKey(std::wstring const& monitorKey, std::wstring const& processPath);
+    void Journal(Entry const& entry);
+    void EvictIfNeeded();
+
+    size_t m_capacity;
+    mutable std::mutex m_lock;
+    LruList m_lru; // Most recently used at the front
+    std::unordered_map<std::wstring, LruList::iterator> m_index;
+    std::unordered_map<std::wstring, Entry> m_pending;
+};
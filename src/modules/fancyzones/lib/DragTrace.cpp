@@ -0,0 +1,406 @@
+#include "pch.h"
+
+#include "DragTrace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <utility>
+
+namespace
+{
+    using namespace DragTrace;
+
+    constexpr char const* Header = "fancyzones-drag-trace 1";
+
+    char const* EventName(EventType type) noexcept
+    {
+        switch (type)
+        {
+        case EventType::MoveSizeStart:
+            return "start";
+        case EventType::LocationChange:
+            return "move";
+        default:
+            return "end";
+        }
+    }
+
+    std::ostream& operator<<(std::ostream& out, Box const& box)
+    {
+        return out << box.Left << ' ' << box.Top << ' ' << box.Right << ' ' << box.Bottom;
+    }
+
+    std::istream& operator>>(std::istream& in, Box& box)
+    {
+        return in >> box.Left >> box.Top >> box.Right >> box.Bottom;
+    }
+
+    bool Fail(std::string* error, size_t line, char const* message)
+    {
+        if (error)
+        {
+            *error = "line " + std::to_string(line) + ": " + message;
+        }
+        return false;
+    }
+
+    double Percentile(std::vector<double> const& sorted, double percentile) noexcept
+    {
+        // Nearest rank
+        size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0 * sorted.size()));
+        return sorted[(std::max)(rank, static_cast<size_t>(1)) - 1];
+    }
+}
+
+namespace DragTrace
+{
+    void Write(std::ostream& out, Trace const& trace)
+    {
+        out << Header << '\n';
+        for (auto const& monitor : trace.Monitors)
+        {
+            out << "monitor " << monitor.Id << ' ' << monitor.Bounds << ' ' << monitor.WorkArea << '\n';
+            for (auto const& zone : monitor.Zones)
+            {
+                out << "zone " << zone << '\n';
+            }
+        }
+        WriteEvents(out, trace.Events);
+    }
+
+    void WriteEvents(std::ostream& out, std::vector<Event> const& events)
+    {
+        for (auto const& event : events)
+        {
+            out << EventName(event.Type) << ' ' << event.TimeMs << ' ' << event.Window << ' '
+                << event.Cursor.X << ' ' << event.Cursor.Y << ' ' << (event.Shift ? 1 : 0);
+            if (event.Type == EventType::MoveSizeStart)
+            {
+                out << ' ' << event.WindowRect;
+            }
+            out << '\n';
+        }
+    }
+
+    bool Read(std::istream& in, Trace& trace, std::string* error)
+    {
+        trace = {};
+
+        std::string text;
+        size_t lineNumber = 1;
+        if (!std::getline(in, text) || (text.rfind(Header, 0) != 0))
+        {
+            return Fail(error, lineNumber, "not a drag trace");
+        }
+
+        while (std::getline(in, text))
+        {
+            lineNumber++;
+            std::istringstream line(text);
+            std::string kind;
+            if (!(line >> kind))
+            {
+                continue; // Blank line
+            }
+
+            if (kind == "monitor")
+            {
+                Monitor monitor;
+                if (!(line >> monitor.Id >> monitor.Bounds >> monitor.WorkArea))
+                {
+                    return Fail(error, lineNumber, "malformed monitor");
+                }
+                trace.Monitors.push_back(std::move(monitor));
+            }
+            else if (kind == "zone")
+            {
+                Box zone;
+                if (trace.Monitors.empty() || !(line >> zone))
+                {
+                    return Fail(error, lineNumber, "malformed zone");
+                }
+                trace.Monitors.back().Zones.push_back(zone);
+            }
+            else if ((kind == "start") || (kind == "move") || (kind == "end"))
+            {
+                Event event;
+                event.Type = (kind == "start") ? EventType::MoveSizeStart : (kind == "move") ? EventType::LocationChange : EventType::MoveSizeEnd;
+                int shift = 0;
+                if (!(line >> event.TimeMs >> event.Window >> event.Cursor.X >> event.Cursor.Y >> shift))
+                {
+                    return Fail(error, lineNumber, "malformed event");
+                }
+                if ((event.Type == EventType::MoveSizeStart) && !(line >> event.WindowRect))
+                {
+                    return Fail(error, lineNumber, "malformed window rect");
+                }
+                event.Shift = (shift != 0);
+                trace.Events.push_back(event);
+            }
+            else
+            {
+                return Fail(error, lineNumber, "unknown record");
+            }
+        }
+        return true;
+    }
+
+    LatencyStats Summarize(std::vector<double> samples)
+    {
+        LatencyStats stats;
+        stats.Count = samples.size();
+        if (!samples.empty())
+        {
+            std::sort(samples.begin(), samples.end());
+            stats.P50 = Percentile(samples, 50);
+            stats.P90 = Percentile(samples, 90);
+            stats.P99 = Percentile(samples, 99);
+            stats.Max = samples.back();
+        }
+        return stats;
+    }
+
+    Report Replay(Trace const& trace, DragHandler& handler)
+    {
+        using clock = std::chrono::steady_clock;
+
+        Report report;
+        std::array<std::vector<double>, 3> samples;
+        std::vector<double> all;
+        all.reserve(trace.Events.size());
+
+        for (auto const& event : trace.Events)
+        {
+            // The hook resolves the monitor under the cursor and drops the event if there is none.
+            auto monitor = std::find_if(trace.Monitors.begin(), trace.Monitors.end(), [&](Monitor const& m) {
+                return m.Bounds.Contains(event.Cursor);
+            });
+            if ((event.Type != EventType::MoveSizeEnd) && (monitor == trace.Monitors.end()))
+            {
+                report.Skipped++;
+                continue;
+            }
+
+            auto const start = clock::now();
+            switch (event.Type)
+            {
+            case EventType::MoveSizeStart:
+                handler.MoveSizeStart(event.Window, monitor->Id, event.Cursor, event.Shift, event.WindowRect);
+                break;
+            case EventType::LocationChange:
+                handler.MoveSizeUpdate(monitor->Id, event.Cursor, event.Shift);
+                break;
+            case EventType::MoveSizeEnd:
+                handler.MoveSizeEnd(event.Window, event.Cursor, event.Shift);
+                break;
+            }
+            double const elapsed = std::chrono::duration<double, std::micro>(clock::now() - start).count();
+
+            samples[static_cast<size_t>(event.Type)].push_back(elapsed);
+            all.push_back(elapsed);
+        }
+
+        for (size_t i = 0; i < samples.size(); i++)
+        {
+            report.ByType[i] = Summarize(std::move(samples[i]));
+        }
+        report.All = Summarize(std::move(all));
+        return report;
+    }
+
+    SimulatedFancyZones::SimulatedFancyZones(std::vector<Monitor> monitors, bool shiftDrag, ZoneLocator* zoneLocator) :
+        m_monitors(std::move(monitors)),
+        m_shiftDrag(shiftDrag),
+        m_zoneLocator(zoneLocator)
+    {
+    }
+
+    void SimulatedFancyZones::MoveSizeStart(uint64_t window, uint64_t monitor, Point cursor, bool shift, Box const& windowRect)
+    {
+        // Only enter move/size if the cursor is inside the window rect by a certain padding.
+        Box const inner{ windowRect.Left + 8, windowRect.Top + 6, windowRect.Right - 8, windowRect.Bottom - 6 };
+        if (!inner.Contains(cursor))
+        {
+            return;
+        }
+
+        m_inMoveSize = true;
+        if (!FindMonitor(monitor))
+        {
+            return;
+        }
+
+        m_window = window;
+        m_dragEnabled = (m_shiftDrag == shift);
+        Start(monitor);
+    }
+
+    void SimulatedFancyZones::MoveSizeUpdate(uint64_t monitor, Point cursor, bool shift)
+    {
+        if (!m_inMoveSize)
+        {
+            return;
+        }
+
+        m_dragEnabled = (m_shiftDrag == shift);
+        if (m_activeMonitor)
+        {
+            if (!m_dragEnabled)
+            {
+                m_activeMonitor = nullptr;
+                m_highlightZone = -1;
+                return;
+            }
+
+            Update(monitor, cursor);
+        }
+        else if (m_dragEnabled && m_window && FindMonitor(monitor))
+        {
+            // The modifier was pressed during the drag.
+            Start(monitor);
+            Update(monitor, cursor);
+        }
+    }
+
+    void SimulatedFancyZones::MoveSizeEnd(uint64_t window, Point cursor, bool)
+    {
+        m_inMoveSize = false;
+        m_dragEnabled = false;
+        m_window = 0;
+        m_highlightZone = -1;
+
+        if (auto monitor = std::exchange(m_activeMonitor, nullptr))
+        {
+            Drop(window, monitor, ZoneFromPoint(*monitor, cursor));
+        }
+        else
+        {
+            Drop(window, nullptr, -1);
+        }
+    }
+
+    Monitor const* SimulatedFancyZones::FindMonitor(uint64_t monitor) const noexcept
+    {
+        auto iter = std::find_if(m_monitors.begin(), m_monitors.end(), [monitor](Monitor const& m) { return m.Id == monitor; });
+        return (iter != m_monitors.end()) ? &*iter : nullptr;
+    }
+
+    int SimulatedFancyZones::ZoneFromPoint(Monitor const& monitor, Point cursor, int64_t* zoneArea) const
+    {
+        Point const client{ cursor.X - monitor.WorkArea.Left, cursor.Y - monitor.WorkArea.Top };
+        if (m_zoneLocator)
+        {
+            int64_t area{};
+            int const zone = m_zoneLocator->ZoneFromPoint(monitor, client, area);
+            if (zoneArea)
+            {
+                *zoneArea = area;
+            }
+            return zone;
+        }
+
+        // Like ZoneSet::ZoneFromPoint: the smallest zone under the cursor, later zones first.
+        int smallest = -1;
+        int64_t smallestArea = 0;
+        for (int i = static_cast<int>(monitor.Zones.size()) - 1; i >= 0; i--)
+        {
+            Box const& zone = monitor.Zones[i];
+            if (zone.Contains(client))
+            {
+                int64_t const area = static_cast<int64_t>(zone.Right - zone.Left) * (zone.Bottom - zone.Top);
+                if ((smallest == -1) || (area < smallestArea))
+                {
+                    smallest = i;
+                    smallestArea = area;
+                }
+            }
+        }
+        if (zoneArea)
+        {
+            *zoneArea = smallestArea;
+        }
+        return smallest;
+    }
+
+    void SimulatedFancyZones::Update(uint64_t monitor, Point cursor)
+    {
+        // Like the ZoneSpace of FancyZones: the smallest zone under the cursor on any monitor.
+        // The drag moves to the monitor of that zone, or else to the monitor under the cursor.
+        Monitor const* hitMonitor = nullptr;
+        int hitZone = -1;
+        int64_t hitArea = 0;
+        for (auto const& monitor : m_monitors)
+        {
+            int64_t area = 0;
+            int const zone = ZoneFromPoint(monitor, cursor, &area);
+            if ((zone >= 0) && (!hitMonitor || (area < hitArea)))
+            {
+                hitMonitor = &monitor;
+                hitZone = zone;
+                hitArea = area;
+            }
+        }
+
+        if (hitMonitor)
+        {
+            m_activeMonitor = hitMonitor;
+        }
+        else if (auto const underCursor = FindMonitor(monitor))
+        {
+            m_activeMonitor = underCursor;
+        }
+        m_highlightZone = hitZone;
+    }
+
+    void SimulatedFancyZones::Start(uint64_t monitor)
+    {
+        m_activeMonitor = m_dragEnabled ? FindMonitor(monitor) : nullptr;
+        m_highlightZone = -1;
+    }
+
+    void SimulatedFancyZones::Drop(uint64_t window, Monitor const* monitor, int zone)
+    {
+        Placement placement{ window, (monitor && (zone >= 0)) ? monitor->Id : 0, monitor ? zone : -1 };
+        auto existing = std::find_if(m_placements.begin(), m_placements.end(), [window](Placement const& p) { return p.Window == window; });
+        if (existing != m_placements.end())
+        {
+            *existing = placement;
+        }
+        else
+        {
+            m_placements.push_back(placement);
+        }
+    }
+
+    void WriteReport(std::ostream& out, Report const& report, std::vector<SimulatedFancyZones::Placement> const& placements)
+    {
+        auto const line = [&out](char const* name, LatencyStats const& stats) {
+            out << name << ": count " << stats.Count << ", p50 " << stats.P50 << "us, p90 " << stats.P90
+                << "us, p99 " << stats.P99 << "us, max " << stats.Max << "us\n";
+        };
+
+        out << "model: latencies are of SimulatedFancyZones, not of FancyZones itself\n";
+        line("start", report.ByType[static_cast<size_t>(EventType::MoveSizeStart)]);
+        line("move", report.ByType[static_cast<size_t>(EventType::LocationChange)]);
+        line("end", report.ByType[static_cast<size_t>(EventType::MoveSizeEnd)]);
+        line("all", report.All);
+        out << "skipped: " << report.Skipped << '\n';
+
+        for (auto const& placement : placements)
+        {
+            out << "window " << placement.Window << ": ";
+            if (placement.Zone >= 0)
+            {
+                out << "monitor " << placement.Monitor << " zone " << placement.Zone << '\n';
+            }
+            else
+            {
+                out << "no zone\n";
+            }
+        }
+    }
+}
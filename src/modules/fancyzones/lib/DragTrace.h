@@ -0,0 +1,173 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// Recorded drag sessions and a headless replayer for them.
+//
+// A trace holds the monitor topology and active layouts at the time of recording,
+// followed by the move/size events FancyZones received with the cursor position
+// and shift state of each. Replaying a trace drives a DragHandler with the same
+// calls FancyZones gets from its WinEvent hook and reports how long each call took.
+//
+// Only the standard library is used here so traces can be replayed anywhere the
+// file compiles, including outside Windows.
+namespace DragTrace
+{
+    struct Point
+    {
+        int32_t X{};
+        int32_t Y{};
+    };
+
+    struct Box
+    {
+        int32_t Left{};
+        int32_t Top{};
+        int32_t Right{};
+        int32_t Bottom{};
+
+        bool Contains(Point pt) const noexcept { return (pt.X >= Left) && (pt.X < Right) && (pt.Y >= Top) && (pt.Y < Bottom); }
+
+        bool operator==(Box const& other) const noexcept
+        {
+            return (Left == other.Left) && (Top == other.Top) && (Right == other.Right) && (Bottom == other.Bottom);
+        }
+    };
+
+    struct Monitor
+    {
+        uint64_t Id{}; // Monitor handle at recording time
+        Box Bounds;
+        Box WorkArea;
+        std::vector<Box> Zones; // Active layout, relative to the work area
+
+        bool operator==(Monitor const& other) const noexcept
+        {
+            return (Id == other.Id) && (Bounds == other.Bounds) && (WorkArea == other.WorkArea) && (Zones == other.Zones);
+        }
+    };
+
+    enum class EventType
+    {
+        MoveSizeStart,
+        LocationChange,
+        MoveSizeEnd
+    };
+
+    struct Event
+    {
+        EventType Type{};
+        uint32_t TimeMs{}; // Since the first event
+        uint64_t Window{};
+        Point Cursor;
+        bool Shift{};
+        Box WindowRect; // MoveSizeStart only
+    };
+
+    struct Trace
+    {
+        std::vector<Monitor> Monitors;
+        std::vector<Event> Events;
+    };
+
+    // Line based text format, one monitor, zone or event per line.
+    void Write(std::ostream& out, Trace const& trace);
+    // Appends events to a trace already written with Write.
+    void WriteEvents(std::ostream& out, std::vector<Event> const& events);
+    bool Read(std::istream& in, Trace& trace, std::string* error = nullptr);
+
+    // The drag calls of IFancyZonesCallback, plus the shift state FancyZones reads itself.
+    class DragHandler
+    {
+    public:
+        virtual ~DragHandler() = default;
+
+        virtual void MoveSizeStart(uint64_t window, uint64_t monitor, Point cursor, bool shift, Box const& windowRect) = 0;
+        virtual void MoveSizeUpdate(uint64_t monitor, Point cursor, bool shift) = 0;
+        virtual void MoveSizeEnd(uint64_t window, Point cursor, bool shift) = 0;
+    };
+
+    struct LatencyStats
+    {
+        size_t Count{};
+        double P50{}; // Microseconds
+        double P90{};
+        double P99{};
+        double Max{};
+    };
+
+    LatencyStats Summarize(std::vector<double> samples);
+
+    struct Report
+    {
+        std::array<LatencyStats, 3> ByType; // Indexed by EventType
+        LatencyStats All;
+        size_t Skipped{}; // Events outside every monitor, which FancyZones never sees
+    };
+
+    // Sends every event to handler in order, as fast as possible.
+    Report Replay(Trace const& trace, DragHandler& handler);
+
+    // Hit-tests a monitor's layout at a point relative to its work area. Returns the index
+    // of the zone, or -1, and sets zoneArea to the zone's area.
+    class ZoneLocator
+    {
+    public:
+        virtual ~ZoneLocator() = default;
+
+        virtual int ZoneFromPoint(Monitor const& monitor, Point client, int64_t& zoneArea) = 0;
+    };
+
+    // A model of the drag state machine of FancyZones and its zone windows, run against
+    // the trace's monitors and layouts; it remembers where each window was dropped. Replay
+    // latencies measure this model, not FancyZones: the zone windows need a desktop. Zones
+    // are hit-tested like ZoneSet::ZoneFromPoint unless a ZoneLocator is given, which lets
+    // a replay go through FancyZones' own ZoneSet.
+    class SimulatedFancyZones : public DragHandler
+    {
+    public:
+        struct Placement
+        {
+            uint64_t Window{};
+            uint64_t Monitor{}; // 0 if the window was dropped outside a zone
+            int Zone{ -1 };
+        };
+
+        explicit SimulatedFancyZones(std::vector<Monitor> monitors, bool shiftDrag = true, ZoneLocator* zoneLocator = nullptr);
+
+        void MoveSizeStart(uint64_t window, uint64_t monitor, Point cursor, bool shift, Box const& windowRect) override;
+        void MoveSizeUpdate(uint64_t monitor, Point cursor, bool shift) override;
+        void MoveSizeEnd(uint64_t window, Point cursor, bool shift) override;
+
+        bool InMoveSize() const noexcept { return m_inMoveSize; }
+        int HighlightZone() const noexcept { return m_highlightZone; }
+        uint64_t ActiveMonitor() const noexcept { return m_activeMonitor ? m_activeMonitor->Id : 0; }
+
+        // Last drop of each window, in the order windows were first dropped.
+        std::vector<Placement> const& Placements() const noexcept { return m_placements; }
+
+    private:
+        Monitor const* FindMonitor(uint64_t monitor) const noexcept;
+        int ZoneFromPoint(Monitor const& monitor, Point cursor, int64_t* zoneArea = nullptr) const;
+        void Update(uint64_t monitor, Point cursor);
+        void Start(uint64_t monitor);
+        void Drop(uint64_t window, Monitor const* monitor, int zone);
+
+        std::vector<Monitor> m_monitors;
+        bool m_shiftDrag{};
+        ZoneLocator* m_zoneLocator{};
+        bool m_inMoveSize{};
+        bool m_dragEnabled{};
+        uint64_t m_window{};
+        Monitor const* m_activeMonitor{};
+        int m_highlightZone{ -1 };
+        std::vector<Placement> m_placements;
+    };
+
+    // The report starts with a line saying that the latencies are of SimulatedFancyZones.
+    void WriteReport(std::ostream& out, Report const& report, std::vector<SimulatedFancyZones::Placement> const& placements);
+}
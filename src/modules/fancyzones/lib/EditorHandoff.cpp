@@ -0,0 +1,311 @@
+#include "pch.h"
+
+#include "EditorHandoff.h"
+#include "RegistryHelpers.h"
+
+namespace
+{
+    PCWSTR const SectionPrefix = L"Local\\FancyZonesEditor-";
+    PCWSTR const ResultSuffix = L"-Result";
+
+    size_t AlignUp(size_t value) noexcept
+    {
+        return (value + 7) & ~static_cast<size_t>(7);
+    }
+
+    bool InRange(ULONGLONG offset, ULONGLONG size, ULONGLONG limit) noexcept
+    {
+        return (offset <= limit) && (size <= limit - offset);
+    }
+}
+
+namespace EditorHandoff
+{
+    void LoadStoredState(Snapshot& snapshot) noexcept try
+    {
+        DWORD showSpacing = 1;
+        RegistryHelpers::GetValue(snapshot.UniqueId.c_str(), L"ZoneCount", &snapshot.ZoneCount, sizeof(snapshot.ZoneCount));
+        RegistryHelpers::GetValue(snapshot.UniqueId.c_str(), L"Spacing", &snapshot.Spacing, sizeof(snapshot.Spacing));
+        RegistryHelpers::GetValue(snapshot.UniqueId.c_str(), L"ShowSpacing", &showSpacing, sizeof(showSpacing));
+        snapshot.ShowSpacing = (showSpacing != 0);
+
+        if (wil::unique_hkey key{ RegistryHelpers::OpenKey(L"Layouts") })
+        {
+            DWORD maxNameLength{};
+            DWORD maxDataSize{};
+            if (RegQueryInfoKeyW(key.get(), nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, &maxNameLength, &maxDataSize, nullptr, nullptr) == ERROR_SUCCESS)
+            {
+                std::vector<wchar_t> name(maxNameLength + 1);
+                std::vector<BYTE> data(maxDataSize);
+                DWORD nameLength = static_cast<DWORD>(name.size());
+                DWORD dataSize = maxDataSize;
+                DWORD type{};
+                DWORD i = 0;
+                while (RegEnumValueW(key.get(), i++, name.data(), &nameLength, nullptr, &type, data.data(), &dataSize) == ERROR_SUCCESS)
+                {
+                    if (type == REG_BINARY)
+                    {
+                        snapshot.CustomLayouts.emplace_back(std::wstring(name.data(), nameLength), std::vector<BYTE>(data.begin(), data.begin() + dataSize));
+                    }
+                    nameLength = static_cast<DWORD>(name.size());
+                    dataSize = maxDataSize;
+                }
+            }
+        }
+
+        std::wstring const path = ZoneSetStore::DefaultPath();
+        ZoneSetStore::EnsureMigrated(path.c_str());
+        ZoneSetStore::MappedView view(path.c_str());
+        for (auto& entry : view.Get().ReadAll())
+        {
+            if (entry.WorkAreaKey == snapshot.WorkAreaKey)
+            {
+                snapshot.ZoneSets.emplace_back(std::move(entry));
+            }
+        }
+    }
+    CATCH_LOG();
+
+    std::vector<BYTE> Serialize(Snapshot const& snapshot)
+    {
+        std::vector<BYTE> const store = ZoneSetStore::Serialize(snapshot.ZoneSets);
+
+        size_t dataSize = 0;
+        for (auto const& [name, data] : snapshot.CustomLayouts)
+        {
+            dataSize += name.size() * sizeof(wchar_t) + data.size();
+        }
+
+        size_t const customLayoutsOffset = sizeof(SnapshotHeader);
+        size_t const dataOffset = customLayoutsOffset + snapshot.CustomLayouts.size() * sizeof(CustomLayout);
+        size_t const storeOffset = AlignUp(dataOffset + dataSize);
+        std::vector<BYTE> image(storeOffset + store.size());
+
+        auto header = reinterpret_cast<SnapshotHeader*>(image.data());
+        header->Magic = Magic;
+        header->Version = Version;
+        header->Size = static_cast<DWORD>(image.size());
+        header->LayoutId = snapshot.LayoutId;
+        header->Monitor = snapshot.Monitor;
+        header->EditorX = snapshot.EditorRect.left;
+        header->EditorY = snapshot.EditorRect.top;
+        header->EditorWidth = snapshot.EditorRect.right;
+        header->EditorHeight = snapshot.EditorRect.bottom;
+        header->Dpi = snapshot.Dpi;
+        header->ZoneCount = snapshot.ZoneCount;
+        header->Spacing = snapshot.Spacing;
+        header->ShowSpacing = snapshot.ShowSpacing ? 1 : 0;
+        header->ActiveZoneSetId = snapshot.ActiveZoneSetId;
+        StringCchCopyW(header->UniqueId, ARRAYSIZE(header->UniqueId), snapshot.UniqueId.c_str());
+        StringCchCopyW(header->WorkAreaKey, ARRAYSIZE(header->WorkAreaKey), snapshot.WorkAreaKey.c_str());
+        header->CustomLayoutCount = static_cast<DWORD>(snapshot.CustomLayouts.size());
+        header->CustomLayoutsOffset = static_cast<DWORD>(customLayoutsOffset);
+        header->DataOffset = static_cast<DWORD>(dataOffset);
+        header->DataSize = static_cast<DWORD>(dataSize);
+        header->StoreOffset = static_cast<DWORD>(storeOffset);
+        header->StoreSize = static_cast<DWORD>(store.size());
+
+        // All the names go first so they stay aligned, then the layout data.
+        auto layouts = reinterpret_cast<CustomLayout*>(image.data() + customLayoutsOffset);
+        BYTE* const data = image.data() + dataOffset;
+        DWORD offset = 0;
+        for (size_t i = 0; i < snapshot.CustomLayouts.size(); i++)
+        {
+            std::wstring const& name = snapshot.CustomLayouts[i].first;
+            layouts[i].NameOffset = offset;
+            layouts[i].NameLength = static_cast<DWORD>(name.size());
+            memcpy(data + offset, name.data(), name.size() * sizeof(wchar_t));
+            offset += static_cast<DWORD>(name.size() * sizeof(wchar_t));
+        }
+
+        for (size_t i = 0; i < snapshot.CustomLayouts.size(); i++)
+        {
+            std::vector<BYTE> const& bytes = snapshot.CustomLayouts[i].second;
+            layouts[i].DataOffset = offset;
+            layouts[i].DataSize = static_cast<DWORD>(bytes.size());
+            std::copy(bytes.begin(), bytes.end(), data + offset);
+            offset += layouts[i].DataSize;
+        }
+
+        std::copy(store.begin(), store.end(), image.begin() + storeOffset);
+        return image;
+    }
+
+    SnapshotView::SnapshotView(void const* data, size_t size) noexcept
+    {
+        if (!data || (size < sizeof(SnapshotHeader)))
+        {
+            return;
+        }
+
+        auto header = static_cast<SnapshotHeader const*>(data);
+        if ((header->Magic != Magic) || (header->Version != Version) || (header->Size != size) ||
+            (wcsnlen(header->UniqueId, ARRAYSIZE(header->UniqueId)) == ARRAYSIZE(header->UniqueId)) ||
+            (wcsnlen(header->WorkAreaKey, ARRAYSIZE(header->WorkAreaKey)) == ARRAYSIZE(header->WorkAreaKey)))
+        {
+            return;
+        }
+
+        if ((header->CustomLayoutsOffset % alignof(CustomLayout) != 0) ||
+            !InRange(header->CustomLayoutsOffset, static_cast<ULONGLONG>(header->CustomLayoutCount) * sizeof(CustomLayout), size) ||
+            !InRange(header->DataOffset, header->DataSize, size) ||
+            (header->StoreOffset % alignof(ZoneSetStore::Record) != 0) ||
+            !InRange(header->StoreOffset, header->StoreSize, size))
+        {
+            return;
+        }
+
+        auto bytes = static_cast<BYTE const*>(data);
+        auto layouts = reinterpret_cast<CustomLayout const*>(bytes + header->CustomLayoutsOffset);
+        for (DWORD i = 0; i < header->CustomLayoutCount; i++)
+        {
+            if ((layouts[i].NameOffset % alignof(wchar_t) != 0) ||
+                !InRange(layouts[i].NameOffset, static_cast<ULONGLONG>(layouts[i].NameLength) * sizeof(wchar_t), header->DataSize) ||
+                !InRange(layouts[i].DataOffset, layouts[i].DataSize, header->DataSize))
+            {
+                return;
+            }
+        }
+
+        ZoneSetStore::Image zoneSets(bytes + header->StoreOffset, header->StoreSize);
+        if (!zoneSets.IsValid())
+        {
+            return;
+        }
+
+        m_header = header;
+        m_customLayouts = layouts;
+        m_data = bytes + header->DataOffset;
+        m_zoneSets = zoneSets;
+    }
+
+    std::wstring SnapshotView::NameOf(CustomLayout const& layout) const
+    {
+        auto name = reinterpret_cast<wchar_t const*>(m_data + layout.NameOffset);
+        return { name, name + layout.NameLength };
+    }
+
+    Snapshot SnapshotView::Read() const
+    {
+        Snapshot snapshot;
+        if (!m_header)
+        {
+            return snapshot;
+        }
+
+        snapshot.UniqueId = m_header->UniqueId;
+        snapshot.WorkAreaKey = m_header->WorkAreaKey;
+        snapshot.LayoutId = static_cast<WORD>(m_header->LayoutId);
+        snapshot.Monitor = m_header->Monitor;
+        snapshot.EditorRect = { m_header->EditorX, m_header->EditorY, m_header->EditorWidth, m_header->EditorHeight };
+        snapshot.Dpi = m_header->Dpi;
+        snapshot.ZoneCount = m_header->ZoneCount;
+        snapshot.Spacing = m_header->Spacing;
+        snapshot.ShowSpacing = (m_header->ShowSpacing != 0);
+        snapshot.ActiveZoneSetId = m_header->ActiveZoneSetId;
+
+        snapshot.CustomLayouts.reserve(m_header->CustomLayoutCount);
+        for (DWORD i = 0; i < m_header->CustomLayoutCount; i++)
+        {
+            CustomLayout const& layout = m_customLayouts[i];
+            BYTE const* data = DataOf(layout);
+            snapshot.CustomLayouts.emplace_back(NameOf(layout), std::vector<BYTE>(data, data + layout.DataSize));
+        }
+
+        snapshot.ZoneSets = m_zoneSets.ReadAll();
+        return snapshot;
+    }
+
+    void WriteResult(void* buffer, Result const& result) noexcept
+    {
+        auto header = static_cast<ResultHeader*>(buffer);
+        auto zones = reinterpret_cast<RECT*>(header + 1);
+
+        DWORD const zoneCount = static_cast<DWORD>((std::min)(result.Zones.size(), static_cast<size_t>(MaxResultZones)));
+        std::copy(result.Zones.begin(), result.Zones.begin() + zoneCount, zones);
+        header->Magic = Magic;
+        header->Version = Version;
+        header->LayoutId = result.LayoutId;
+        header->ZoneCount = zoneCount;
+        header->Applied = 1;
+    }
+
+    bool ReadResult(void const* buffer, Result& result)
+    {
+        auto header = static_cast<ResultHeader const*>(buffer);
+        if ((header->Magic != Magic) || (header->Version != Version) || (header->Applied == 0) ||
+            (header->ZoneCount > MaxResultZones))
+        {
+            return false;
+        }
+
+        auto zones = reinterpret_cast<RECT const*>(header + 1);
+        result.LayoutId = static_cast<WORD>(header->LayoutId);
+        result.Zones.assign(zones, zones + header->ZoneCount);
+        return true;
+    }
+
+    std::unique_ptr<Channel> Channel::Create(Snapshot const& snapshot) noexcept try
+    {
+        static std::atomic<DWORD> s_sequence;
+
+        auto channel = std::make_unique<Channel>();
+        channel->m_name = SectionPrefix + std::to_wstring(GetCurrentProcessId()) + L"-" + std::to_wstring(++s_sequence);
+        channel->m_monitor = snapshot.Monitor;
+
+        std::vector<BYTE> const image = Serialize(snapshot);
+        channel->m_snapshot.reset(CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, static_cast<DWORD>(image.size()), channel->m_name.c_str()));
+        if (!channel->m_snapshot || (GetLastError() == ERROR_ALREADY_EXISTS))
+        {
+            return nullptr;
+        }
+
+        {
+            std::unique_ptr<void, UnmapViewDeleter> view(MapViewOfFile(channel->m_snapshot.get(), FILE_MAP_WRITE, 0, 0, image.size()));
+            if (!view)
+            {
+                return nullptr;
+            }
+            memcpy(view.get(), image.data(), image.size());
+        }
+
+        std::wstring const resultName = channel->m_name + ResultSuffix;
+        channel->m_result.reset(CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, static_cast<DWORD>(ResultSize), resultName.c_str()));
+        if (!channel->m_result || (GetLastError() == ERROR_ALREADY_EXISTS))
+        {
+            return nullptr;
+        }
+
+        channel->m_resultView.reset(MapViewOfFile(channel->m_result.get(), FILE_MAP_WRITE, 0, 0, ResultSize));
+        if (!channel->m_resultView)
+        {
+            return nullptr;
+        }
+
+        // The section starts out zeroed, so there is no result until the editor writes one.
+        auto header = static_cast<ResultHeader*>(channel->m_resultView.get());
+        header->Magic = Magic;
+        header->Version = Version;
+        return channel;
+    }
+    catch (...)
+    {
+        LOG_CAUGHT_EXCEPTION();
+        return nullptr;
+    }
+
+    bool Channel::TakeResult(Result& result) noexcept try
+    {
+        if (!ReadResult(m_resultView.get(), result))
+        {
+            return false;
+        }
+        static_cast<ResultHeader*>(m_resultView.get())->Applied = 0;
+        return true;
+    }
+    catch (...)
+    {
+        LOG_CAUGHT_EXCEPTION();
+        return false;
+    }
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "ZoneSetStore.h"
+
+// Shared-memory handoff between FancyZones and FancyZonesEditor.
+//
+// When the editor is launched FancyZones writes a snapshot of everything the editor
+// needs into a named section: the monitor and where the overlay goes, the picker
+// settings, the custom layouts and the zone sets of the work area. The editor maps it
+// read-only instead of reading the registry. It answers through a second, small
+// section holding the layout it applied, which FancyZones picks up when the editor
+// exits and applies to that monitor directly.
+//
+// The name of the sections is the last argument on the editor command line. Without
+// it the editor falls back to the registry and PersistZoneSet.
+namespace EditorHandoff
+{
+    constexpr inline DWORD Magic = 0x48455A46; // 'FZEH'
+    constexpr inline DWORD Version = 1;
+    constexpr inline size_t MaxUniqueIdLength = 256;
+    constexpr inline DWORD MaxResultZones = 256;
+
+    struct SnapshotHeader
+    {
+        DWORD Magic;
+        DWORD Version;
+        DWORD Size; // Of the whole snapshot
+        DWORD LayoutId; // Of the active zone set, picks the layout selected in the editor
+        UINT64 Monitor;
+        LONG EditorX; // Where the editor overlay shows up, in dpi unaware coordinates
+        LONG EditorY;
+        LONG EditorWidth;
+        LONG EditorHeight;
+        float Dpi;
+        DWORD ZoneCount; // Picker settings of the monitor
+        DWORD Spacing;
+        DWORD ShowSpacing;
+        GUID ActiveZoneSetId;
+        wchar_t UniqueId[MaxUniqueIdLength];
+        wchar_t WorkAreaKey[ZoneSetStore::MaxWorkAreaKeyLength];
+        DWORD CustomLayoutCount;
+        DWORD CustomLayoutsOffset; // CustomLayout records
+        DWORD DataOffset; // Names and data of the custom layouts
+        DWORD DataSize;
+        DWORD StoreOffset; // ZoneSetStore image with the zone sets of the work area
+        DWORD StoreSize;
+    };
+
+    // Offsets are relative to SnapshotHeader::DataOffset. Names are not null terminated and
+    // come before the data of every layout, which keeps them aligned.
+    struct CustomLayout
+    {
+        DWORD NameOffset;
+        DWORD NameLength; // In characters
+        DWORD DataOffset;
+        DWORD DataSize;
+    };
+
+    // Written by the editor. Applied is set last, once the zones are in place.
+    struct ResultHeader
+    {
+        DWORD Magic;
+        DWORD Version;
+        LONG Applied;
+        DWORD LayoutId;
+        DWORD ZoneCount;
+        DWORD Reserved;
+    };
+
+    constexpr inline size_t ResultSize = sizeof(ResultHeader) + MaxResultZones * sizeof(RECT);
+
+    static_assert(sizeof(SnapshotHeader) == 672);
+    static_assert(sizeof(CustomLayout) == 16);
+    static_assert(sizeof(ResultHeader) == 24);
+
+    struct Snapshot
+    {
+        std::wstring UniqueId;
+        std::wstring WorkAreaKey;
+        WORD LayoutId{};
+        UINT64 Monitor{};
+        RECT EditorRect{}; // Left/top and width/height, not right/bottom
+        float Dpi{ 1.0f };
+        DWORD ZoneCount{ 3 };
+        DWORD Spacing{ 16 };
+        bool ShowSpacing{ true };
+        GUID ActiveZoneSetId{};
+        std::vector<std::pair<std::wstring, std::vector<BYTE>>> CustomLayouts;
+        std::vector<ZoneSetStore::Entry> ZoneSets;
+    };
+
+    // Fills in the picker settings of snapshot.UniqueId, the custom layouts and the zone sets
+    // of snapshot.WorkAreaKey from the registry and the zone set store.
+    void LoadStoredState(Snapshot& snapshot) noexcept;
+
+    std::vector<BYTE> Serialize(Snapshot const& snapshot);
+
+    // Validated, read-only view over a serialized snapshot. Does not own the memory.
+    class SnapshotView
+    {
+    public:
+        SnapshotView() = default;
+        SnapshotView(void const* data, size_t size) noexcept;
+
+        bool IsValid() const noexcept { return m_header != nullptr; }
+        SnapshotHeader const& Header() const noexcept { return *m_header; }
+        DWORD CustomLayoutCount() const noexcept { return m_header ? m_header->CustomLayoutCount : 0; }
+        CustomLayout const& CustomLayoutAt(DWORD index) const noexcept { return m_customLayouts[index]; }
+        std::wstring NameOf(CustomLayout const& layout) const;
+        BYTE const* DataOf(CustomLayout const& layout) const noexcept { return m_data + layout.DataOffset; }
+        ZoneSetStore::Image const& ZoneSets() const noexcept { return m_zoneSets; }
+
+        Snapshot Read() const;
+
+    private:
+        SnapshotHeader const* m_header{};
+        CustomLayout const* m_customLayouts{};
+        BYTE const* m_data{};
+        ZoneSetStore::Image m_zoneSets;
+    };
+
+    struct Result
+    {
+        WORD LayoutId{};
+        std::vector<RECT> Zones;
+    };
+
+    // buffer must hold ResultSize bytes. Zones past MaxResultZones are dropped.
+    void WriteResult(void* buffer, Result const& result) noexcept;
+    bool ReadResult(void const* buffer, Result& result);
+
+    // FancyZones' end of the handoff, owns both sections for as long as the editor runs.
+    class Channel
+    {
+    public:
+        // Returns null if the sections could not be created.
+        static std::unique_ptr<Channel> Create(Snapshot const& snapshot) noexcept;
+
+        std::wstring const& Name() const noexcept { return m_name; }
+        UINT64 Monitor() const noexcept { return m_monitor; }
+
+        // The layout the editor applied, if any. Clears it.
+        bool TakeResult(Result& result) noexcept;
+
+    private:
+        struct UnmapViewDeleter
+        {
+            void operator()(void* view) const noexcept { UnmapViewOfFile(view); }
+        };
+
+        std::wstring m_name;
+        UINT64 m_monitor{};
+        wil::unique_handle m_snapshot;
+        wil::unique_handle m_result;
+        std::unique_ptr<void, UnmapViewDeleter> m_resultView;
+    };
+}
@@ -1,26 +1,36 @@
 #include "pch.h"
 #include "common/dpi_aware.h"
 #include "common/on_thread_executor.h"
+#include "interface/lowlevel_keyboard_event_data.h"
 
 #include "FancyZones.h"
 #include "lib/Settings.h"
 #include "lib/ZoneWindow.h"
+#include "lib/ZoneNavigation.h"
+#include "lib/ZoneSpace.h"
+#include "lib/Snapshot.h"
+#include "lib/VirtualDesktopIds.h"
 #include "lib/RegistryHelpers.h"
+#include "lib/AppZoneHistory.h"
+#include "lib/ZoneSetStore.h"
+#include "lib/PlacementModel.h"
+#include "lib/DragTrace.h"
+#include "lib/AnimationScheduler.h"
+#include "lib/EditorHandoff.h"
 #include "trace.h"
 
+#include <chrono>
+#include <fstream>
 #include <functional>
+#include <mutex>
 #include <common/common.h>
 
-namespace std
+namespace
 {
-    template<> struct hash<GUID>
+    DragTrace::Box ToTraceBox(RECT const& rect) noexcept
     {
-        size_t operator()(const GUID& Value) const
-        {
-            RPC_STATUS status = RPC_S_OK;
-            return ::UuidHash(&const_cast<GUID&>(Value), &status);
-        }
-    };
+        return { rect.left, rect.top, rect.right, rect.bottom };
+    }
 }
 
 struct FancyZones : public winrt::implements<FancyZones, IFancyZones, IFancyZonesCallback, IZoneWindowHost>
@@ -38,14 +48,14 @@ public:
     IFACEMETHODIMP_(void) Destroy() noexcept;
 
     // IFancyZonesCallback
-    IFACEMETHODIMP_(bool) InMoveSize() noexcept { std::shared_lock readLock(m_lock); return m_inMoveSize; }
+    IFACEMETHODIMP_(bool) InMoveSize() noexcept { return m_inMoveSize; }
     IFACEMETHODIMP_(void) MoveSizeStart(HWND window, HMONITOR monitor, POINT const& ptScreen) noexcept;
     IFACEMETHODIMP_(void) MoveSizeUpdate(HMONITOR monitor, POINT const& ptScreen) noexcept;
     IFACEMETHODIMP_(void) MoveSizeEnd(HWND window, POINT const& ptScreen) noexcept;
     IFACEMETHODIMP_(void) VirtualDesktopChanged() noexcept;
     IFACEMETHODIMP_(void) VirtualDesktopInitialize() noexcept;
     IFACEMETHODIMP_(void) WindowCreated(HWND window) noexcept;
-    IFACEMETHODIMP_(bool) OnKeyDown(PKBDLLHOOKSTRUCT info) noexcept;
+    IFACEMETHODIMP_(void) OnHotkey(DWORD vkCode, UINT modifiers) noexcept;
     IFACEMETHODIMP_(void) ToggleEditor() noexcept;
     IFACEMETHODIMP_(void) SettingsChanged() noexcept;
 
@@ -63,7 +73,8 @@ public:
     }
     IFACEMETHODIMP_(GUID) GetCurrentMonitorZoneSetId(HMONITOR monitor) noexcept
     {
-        if (auto it = m_zoneWindowMap.find(monitor); it != m_zoneWindowMap.end() && it->second->ActiveZoneSet()) {
+        auto zoneWindows = m_zoneWindows.Load();
+        if (auto it = zoneWindows->find(monitor); it != zoneWindows->end() && it->second->ActiveZoneSet()) {
             return it->second->ActiveZoneSet()->Id();
         }
         return GUID_NULL;
@@ -72,6 +83,9 @@ public:
     {
         return m_settings->GetSettings().zoneHighlightOpacity;
     }
+    IFACEMETHODIMP_(void) SetAppLastZone(HWND window, PCWSTR processPath, int zoneIndex) noexcept;
+    IFACEMETHODIMP_(AnimationScheduler*) Animations() noexcept { return &m_animations; }
+    IFACEMETHODIMP_(void) PersistZoneSets(std::vector<ZoneSetStore::Entry> const& entries) noexcept;
 
     LRESULT WndProc(HWND, UINT, WPARAM, LPARAM) noexcept;
     void OnDisplayChange(DisplayChangeType changeType) noexcept;
@@ -97,40 +111,118 @@ private:
         require_write_lock(const std::unique_lock<T>& lock) { lock; }
     };
 
+    using ZoneWindowMap = std::map<HMONITOR, winrt::com_ptr<IZoneWindow>>;
+
     void UpdateZoneWindows() noexcept;
+    bool SwitchZoneWindowsDesktop() noexcept;
+    GUID CurrentVirtualDesktopId() noexcept;
+    bool ConsumeNewVirtualDesktop() noexcept;
     void MoveWindowsOnDisplayChange() noexcept;
-    void UpdateDragState(require_write_lock) noexcept;
+    void ApplyEditorResult(EditorHandoff::Channel& editorHandoff) noexcept;
+    void MoveWindowIntoZoneByIndex(HWND window, int index, WindowRelayout::Planner& planner) noexcept;
+    static bool IsDragModifierPressed() noexcept;
+    void UpdateDragState() noexcept;
     void CycleActiveZoneSet(DWORD vkCode) noexcept;
     void OnSnapHotkey(DWORD vkCode) noexcept;
-    void MoveSizeStartInternal(HWND window, HMONITOR monitor, POINT const& ptScreen, require_write_lock) noexcept;
-    void MoveSizeEndInternal(HWND window, POINT const& ptScreen, require_write_lock) noexcept;
-    void MoveSizeUpdateInternal(HMONITOR monitor, POINT const& ptScreen, require_write_lock) noexcept;
+    void UpdateZoneGraph(require_write_lock) noexcept;
+    void UpdateZoneSpace(bool checkOrigins) noexcept;
+    void MoveWindowIntoZoneByDirection(HWND window, HMONITOR monitor, ZoneNavigation::Direction direction, require_write_lock) noexcept;
+    void MoveSizeStartInternal(HWND window, HMONITOR monitor, POINT const& ptScreen) noexcept;
+    void MoveSizeEndInternal(HWND window, POINT const& ptScreen) noexcept;
+    void MoveSizeUpdateInternal(HMONITOR monitor, POINT const& ptScreen) noexcept;
     void HandleVirtualDesktopUpdates(HANDLE fancyZonesDestroyedEvent) noexcept;
+    void ScheduleAppZoneHistoryFlush() noexcept;
+    void FlushAppZoneHistory() noexcept;
+    void ScheduleZoneSetWrites(DWORD delay) noexcept;
+    void FlushZoneSetWrites() noexcept;
+    std::optional<PlacementModel::Context> PlacementContext(HMONITOR monitor) noexcept;
+    void RecordDragEvent(DragTrace::EventType type, HWND window, POINT const& ptScreen) noexcept;
+    std::vector<DragTrace::Monitor> SnapshotDragTraceMonitors();
+    void WriteDragTrace(std::vector<DragTrace::Event> events, std::vector<DragTrace::Monitor> const* monitors) noexcept;
 
     const HINSTANCE m_hinstance{};
 
     HKEY m_virtualDesktopsRegKey{ nullptr };
 
-    mutable std::shared_mutex m_lock;
     HWND m_window{};
-    HWND m_windowMoveSize{}; // The window that is being moved/sized
-    bool m_inMoveSize{};  // Whether or not a move/size operation is currently active
+
+    // Map of monitor to ZoneWindow (one per monitor). Republished when a zone window is added, so
+    // looking one up never waits. Zone windows themselves aren't thread safe; calls into them are
+    // serialized by m_zoneWindowsLock, which is recursive because they call back into the host.
+    Snapshot<ZoneWindowMap> m_zoneWindows;
+    std::recursive_mutex m_zoneWindowsLock;
+
+    // Drag state. Move/size events all arrive on the WinEvent thread, which is the only one that
+    // touches these, except for the two atomics that hotkeys and relayouts read.
+    std::atomic<HWND> m_windowMoveSize{}; // The window that is being moved/sized
+    std::atomic_bool m_inMoveSize{};  // Whether or not a move/size operation is currently active
     bool m_dragEnabled{}; // True if we should be showing zone hints while dragging
-    std::map<HMONITOR, winrt::com_ptr<IZoneWindow>> m_zoneWindowMap; // Map of monitor to ZoneWindow (one per monitor)
     winrt::com_ptr<IZoneWindow> m_zoneWindowMoveSize; // "Active" ZoneWindow, where the move/size is happening. Will update as drag moves between monitors.
+
+    // Zones of every monitor's active ZoneSet, laid out for Win+Arrow. Each monitor is one
+    // group of the graph; the graph is rebuilt only when one of these layouts changes.
+    // Guarded by m_zoneWindowsLock.
+    struct ZoneGraphLayout
+    {
+        HMONITOR monitor{};
+        winrt::com_ptr<IZoneSet> zoneSet;
+        POINT origin{}; // Work area origin, zone rects are relative to it
+        size_t firstNode{};
+    };
+    std::vector<ZoneGraphLayout> m_zoneGraphLayouts;
+    std::vector<std::pair<size_t, int>> m_zoneGraphNodes; // Group and zone index of each node
+    ZoneNavigation::Graph m_zoneGraph;
+
+    // Zones of every monitor's active ZoneSet in screen coordinates, hit-tested once per drag
+    // update regardless of the monitor under the cursor. Monitors are re-indexed one at a time
+    // when their active ZoneSet or work area changes. Drag state, like the drag trace below.
+    struct ZoneSpaceLayout
+    {
+        GUID zoneSetId{}; // With the revision, the active ZoneSet the zones were taken from
+        UINT zoneSetRevision{};
+        POINT origin{};
+    };
+    std::map<HMONITOR, ZoneSpaceLayout> m_zoneSpaceLayouts;
+    ZoneSpace m_zoneSpace;
+
     IFancyZonesSettings* m_settings{};
+    std::mutex m_virtualDesktopLock; // Guards the two below
     GUID m_currentVirtualDesktopId{}; // UUID of the current virtual desktop. Is GUID_NULL until first VD switch per session.
-    std::unordered_map<GUID, bool> m_virtualDesktopIds;
+    VirtualDesktopIds m_virtualDesktopIds; // Written by the virtual desktop tracker thread
+    std::mutex m_editorLock; // Guards the two below
     wil::unique_handle m_terminateEditorEvent; // Handle of FancyZonesEditor.exe we launch and wait on
+    std::unique_ptr<EditorHandoff::Channel> m_editorHandoff; // Sections shared with the running editor
     wil::unique_handle m_terminateVirtualDesktopTrackerEvent;
+    std::future<void> m_virtualDesktopTracker; // Reads m_virtualDesktopsRegKey until the event above is set
+    AppZoneHistory m_appZoneHistory;
+    PlacementModel m_placementModel; // Places new windows of apps that have no usable last zone
+    std::atomic_bool m_appZoneHistoryFlushScheduled{};
+    wil::unique_handle m_flushNowEvent; // Signaled on destroy to skip the flush and retry delays
+    ZoneSetStore::PendingWrites m_zoneSetWrites; // Zone sets the zone windows changed, not in the store yet
+    std::atomic_bool m_zoneSetWritesScheduled{};
+    int m_zoneSetWriteRetries{}; // Only touched on m_zoneSetStoreThread
+
+    // Drag sessions are recorded for offline replay when the DragTracePath setting names a file.
+    std::wstring m_dragTracePath;
+    std::vector<DragTrace::Monitor> m_dragTraceMonitors; // Topology the file on disk was started with
+    std::vector<DragTrace::Event> m_dragTraceEvents; // Current session, written when it ends
+    std::chrono::steady_clock::time_point m_dragTraceStart;
+    bool m_dragTraceRestart{}; // The topology changed, rewrite the file instead of appending
 
     OnThreadExecutor m_dpiUnawareThread;
     OnThreadExecutor m_virtualDesktopTrackerThread;
+    OnThreadExecutor m_appZoneHistoryThread;
+    OnThreadExecutor m_zoneSetStoreThread;
+    AnimationScheduler m_animations; // Runs the fades of every zone window
 
     static UINT WM_PRIV_VDCHANGED; // Message to get back on to the UI thread when virtual desktop changes
     static UINT WM_PRIV_VDINIT; // Message to get back to the UI thread when FancyZones are initialized
     static UINT WM_PRIV_EDITOR; // Message to get back on to the UI thread when the editor exits
 
+    static const DWORD m_appZoneHistoryFlushDelay = 2000; // ms
+    static const DWORD m_zoneSetWriteRetryDelay = 1000; // ms
+    static const int m_zoneSetWriteMaxRetries = 10;
+
     // Did we terminate the editor or was it closed cleanly?
     enum class EditorExitKind : byte
     {
@@ -146,8 +238,6 @@ UINT FancyZones::WM_PRIV_EDITOR = RegisterWindowMessage(L"{87543824-7080-4e91-9d
 // IFancyZones
 IFACEMETHODIMP_(void) FancyZones::Run() noexcept
 {
-    std::unique_lock writeLock(m_lock);
-
     WNDCLASSEXW wcex{};
     wcex.cbSize = sizeof(WNDCLASSEX);
     wcex.lpfnWndProc = s_WndProc;
@@ -164,6 +254,18 @@ IFACEMETHODIMP_(void) FancyZones::Run() noexcept
 
     VirtualDesktopInitialize();
 
+    wchar_t dragTracePath[MAX_PATH]{};
+    RegistryHelpers::GetString(nullptr, L"DragTracePath", dragTracePath, sizeof(dragTracePath));
+    m_dragTracePath = dragTracePath;
+
+    m_flushNowEvent.reset(CreateEvent(nullptr, TRUE, FALSE, nullptr));
+    m_appZoneHistory.Load(AppZoneHistory::ReadFromRegistry());
+    m_placementModel.Load(PlacementModel::ReadFromRegistry());
+    if (m_appZoneHistory.HasPendingChanges() || m_placementModel.HasPendingChanges())
+    {
+        ScheduleAppZoneHistoryFlush();
+    }
+
     m_dpiUnawareThread.submit(OnThreadExecutor::task_t{[]{
         SetThreadDpiAwarenessContext(DPI_AWARENESS_CONTEXT_UNAWARE);
         SetThreadDpiHostingBehavior(DPI_HOSTING_BEHAVIOR_MIXED);
@@ -171,7 +273,7 @@ IFACEMETHODIMP_(void) FancyZones::Run() noexcept
 
     if (RegOpenKeyEx(HKEY_CURRENT_USER, L"Software\\Microsoft\\Windows\\CurrentVersion\\Explorer\\VirtualDesktops", 0, KEY_ALL_ACCESS, &m_virtualDesktopsRegKey) == ERROR_SUCCESS) {
         m_terminateVirtualDesktopTrackerEvent.reset(CreateEvent(nullptr, FALSE, FALSE, nullptr));
-        m_virtualDesktopTrackerThread.submit(
+        m_virtualDesktopTracker = m_virtualDesktopTrackerThread.submit(
             OnThreadExecutor::task_t{ std::bind(&FancyZones::HandleVirtualDesktopUpdates, this, m_terminateVirtualDesktopTrackerEvent.get()) });
     }
 }
@@ -179,8 +281,11 @@ IFACEMETHODIMP_(void) FancyZones::Run() noexcept
 // IFancyZones
 IFACEMETHODIMP_(void) FancyZones::Destroy() noexcept
 {
-    std::unique_lock writeLock(m_lock);
-    m_zoneWindowMap.clear();
+    {
+        std::scoped_lock lock(m_zoneWindowsLock);
+        m_zoneWindows.Reset();
+        m_zoneGraphLayouts.clear();
+    }
     BufferedPaintUnInit();
     if (m_window)
     {
@@ -190,31 +295,49 @@ IFACEMETHODIMP_(void) FancyZones::Destroy() noexcept
     if (m_terminateVirtualDesktopTrackerEvent) {
         SetEvent(m_terminateVirtualDesktopTrackerEvent.get());
     }
+    // The tracker may be in the middle of reading the key, let it stop before closing it.
+    if (m_virtualDesktopTracker.valid()) {
+        m_virtualDesktopTracker.wait();
+    }
     if (m_virtualDesktopsRegKey) {
         RegCloseKey(m_virtualDesktopsRegKey);
         m_virtualDesktopsRegKey = nullptr;
     }
+
+    // Persist whatever is still in the journal, and the zone sets not saved yet, before going away.
+    if (m_flushNowEvent) {
+        SetEvent(m_flushNowEvent.get());
+    }
+    m_appZoneHistoryThread.submit(OnThreadExecutor::task_t{ [this] { FlushAppZoneHistory(); } }).wait();
+    m_zoneSetStoreThread.submit(OnThreadExecutor::task_t{ [this] { m_zoneSetWrites.Flush(); } }).wait();
 }
 
 // IFancyZonesCallback
 IFACEMETHODIMP_(void) FancyZones::MoveSizeStart(HWND window, HMONITOR monitor, POINT const& ptScreen) noexcept
 {
-    std::unique_lock writeLock(m_lock);
-    MoveSizeStartInternal(window, monitor, ptScreen, writeLock);
+    RecordDragEvent(DragTrace::EventType::MoveSizeStart, window, ptScreen);
+    MoveSizeStartInternal(window, monitor, ptScreen);
 }
 
 // IFancyZonesCallback
 IFACEMETHODIMP_(void) FancyZones::MoveSizeUpdate(HMONITOR monitor, POINT const& ptScreen) noexcept
 {
-    std::unique_lock writeLock(m_lock);
-    MoveSizeUpdateInternal(monitor, ptScreen, writeLock);
+    RecordDragEvent(DragTrace::EventType::LocationChange, m_windowMoveSize, ptScreen);
+    MoveSizeUpdateInternal(monitor, ptScreen);
 }
 
 // IFancyZonesCallback
 IFACEMETHODIMP_(void) FancyZones::MoveSizeEnd(HWND window, POINT const& ptScreen) noexcept
 {
-    std::unique_lock writeLock(m_lock);
-    MoveSizeEndInternal(window, ptScreen, writeLock);
+    RecordDragEvent(DragTrace::EventType::MoveSizeEnd, window, ptScreen);
+    MoveSizeEndInternal(window, ptScreen);
+
+    auto traceEvents = std::exchange(m_dragTraceEvents, {});
+    const bool restartTrace = std::exchange(m_dragTraceRestart, false);
+    if (!traceEvents.empty())
+    {
+        WriteDragTrace(std::move(traceEvents), restartTrace ? &m_dragTraceMonitors : nullptr);
+    }
 }
 
 // IFancyZonesCallback
@@ -239,70 +362,75 @@ IFACEMETHODIMP_(void) FancyZones::WindowCreated(HWND window) noexcept
         auto processPath = get_process_path(window);
         if (!processPath.empty()) 
         {
-            INT zoneIndex = -1;
-            LRESULT res = RegistryHelpers::GetAppLastZone(window, processPath.data(), &zoneIndex);
-            if ((res == ERROR_SUCCESS) && (zoneIndex != -1))
+            if (const HMONITOR monitor = MonitorFromWindow(window, MONITOR_DEFAULTTONULL))
             {
-                MoveWindowIntoZoneByIndex(window, zoneIndex);
+                const auto context = PlacementContext(monitor);
+
+                // The last zone of the app on this monitor wins while it still exists. Otherwise,
+                // like when the app was never snapped on this monitor or its layout changed, go
+                // with where the app usually ends up.
+                auto zoneIndex = m_appZoneHistory.Get(AppZoneHistory::MonitorKey(monitor), processPath);
+                if (context && (!zoneIndex || (*zoneIndex < 0) || (static_cast<size_t>(*zoneIndex) >= context->ZoneCount)))
+                {
+                    zoneIndex = m_placementModel.Predict(processPath, *context, PlacementModel::Now());
+                }
+
+                if (zoneIndex.has_value() && (*zoneIndex != -1))
+                {
+                    MoveWindowIntoZoneByIndex(window, *zoneIndex);
+                }
             }
         }
     }
 }
 
 // IFancyZonesCallback
-IFACEMETHODIMP_(bool) FancyZones::OnKeyDown(PKBDLLHOOKSTRUCT info) noexcept
+IFACEMETHODIMP_(void) FancyZones::OnHotkey(DWORD vkCode, UINT modifiers) noexcept
 {
-    // Return true to swallow the keyboard event
-    bool const shift = GetAsyncKeyState(VK_SHIFT) & 0x8000;
-    bool const win = GetAsyncKeyState(VK_LWIN) & 0x8000;
+    // Runs after the key press was swallowed or passed on, the modifiers are the ones held at the time
+    bool const number = (vkCode >= '0') && (vkCode <= '9');
+    bool const shift = modifiers & LL_KEYBOARD_MODIFIER_SHIFT;
+    bool const win = modifiers & LL_KEYBOARD_MODIFIER_WIN;
     if (win && !shift)
     {
-        bool const ctrl = GetAsyncKeyState(VK_CONTROL) & 0x8000;
+        bool const ctrl = modifiers & LL_KEYBOARD_MODIFIER_CTRL;
         if (ctrl)
         {
-            if ((info->vkCode >= '0') && (info->vkCode <= '9'))
+            if (number)
             {
                 // Win+Ctrl+Number will cycle through ZoneSets
-                Trace::FancyZones::OnKeyDown(info->vkCode, win, ctrl, false /*inMoveSize*/);
-                CycleActiveZoneSet(info->vkCode);
-                return true;
+                Trace::FancyZones::OnKeyDown(vkCode, win, ctrl, false /*inMoveSize*/);
+                CycleActiveZoneSet(vkCode);
             }
         }
-        else if ((info->vkCode == VK_RIGHT) || (info->vkCode == VK_LEFT))
+        else if (ZoneNavigation::DirectionFromKey(vkCode))
         {
             if (m_settings->GetSettings().overrideSnapHotkeys)
             {
-                // Win+Left, Win+Right will cycle through Zones in the active ZoneSet
-                Trace::FancyZones::OnKeyDown(info->vkCode, win, ctrl, false /*inMoveSize*/);
-                OnSnapHotkey(info->vkCode);
-                return true;
+                // Win+Arrow moves the window to the neighboring zone, across monitors
+                Trace::FancyZones::OnKeyDown(vkCode, win, ctrl, false /*inMoveSize*/);
+                OnSnapHotkey(vkCode);
             }
         }
     }
-    else if (m_inMoveSize && (info->vkCode >= '0') && (info->vkCode <= '9'))
+    else if (m_inMoveSize && number)
     {
         // This allows you to cycle through ZoneSets while dragging a window
-        Trace::FancyZones::OnKeyDown(info->vkCode, win, false /*control*/, true /*inMoveSize*/);
-        CycleActiveZoneSet(info->vkCode);
-        return false;
+        Trace::FancyZones::OnKeyDown(vkCode, win, false /*control*/, true /*inMoveSize*/);
+        CycleActiveZoneSet(vkCode);
     }
-    return false;
 }
 
 // IFancyZonesCallback
 void FancyZones::ToggleEditor() noexcept
 {
     {
-        std::shared_lock readLock(m_lock);
+        std::scoped_lock lock(m_editorLock);
         if (m_terminateEditorEvent)
         {
             SetEvent(m_terminateEditorEvent.get());
             return;
         }
-    }
-
-    {
-        std::unique_lock writeLock(m_lock);
         m_terminateEditorEvent.reset(CreateEvent(nullptr, true, false, nullptr));
     }
 
@@ -330,9 +458,9 @@ void FancyZones::ToggleEditor() noexcept
         return;
     }
 
-    std::shared_lock readLock(m_lock);
-    auto iter = m_zoneWindowMap.find(monitor);
-    if (iter == m_zoneWindowMap.end())
+    auto zoneWindows = m_zoneWindows.Load();
+    auto iter = zoneWindows->find(monitor);
+    if (iter == zoneWindows->end())
     {
         return;
     }
@@ -367,10 +495,11 @@ void FancyZones::ToggleEditor() noexcept
         std::to_wstring(width) + L"_" +
         std::to_wstring(height);
 
+    std::unique_lock zoneWindowsLock(m_zoneWindowsLock);
     const auto activeZoneSet = iter->second->ActiveZoneSet();
     const std::wstring layoutID = activeZoneSet ? std::to_wstring(activeZoneSet->LayoutId()) : L"0";
 
-    const std::wstring params =
+    std::wstring params =
         iter->second->UniqueId() + L" " +
         layoutID + L" " +
         std::to_wstring(reinterpret_cast<UINT_PTR>(monitor)) + L" " +
@@ -378,6 +507,31 @@ void FancyZones::ToggleEditor() noexcept
         iter->second->WorkAreaKey() + L" " +
         std::to_wstring(static_cast<float>(dpi_x) / DPIAware::DEFAULT_DPI);
 
+    // Hand the editor everything it would otherwise read from the registry, and get the
+    // layout it applies back the same way. Without the sections the editor persists through
+    // PersistZoneSet and the zone windows are reloaded when it exits.
+    EditorHandoff::Snapshot snapshot;
+    snapshot.UniqueId = iter->second->UniqueId();
+    snapshot.WorkAreaKey = iter->second->WorkAreaKey();
+    snapshot.LayoutId = activeZoneSet ? activeZoneSet->LayoutId() : 0;
+    snapshot.ActiveZoneSetId = activeZoneSet ? activeZoneSet->Id() : GUID_NULL;
+    snapshot.Monitor = reinterpret_cast<UINT_PTR>(monitor);
+    snapshot.EditorRect = { x, y, width, height };
+    snapshot.Dpi = static_cast<float>(dpi_x) / DPIAware::DEFAULT_DPI;
+    zoneWindowsLock.unlock();
+    EditorHandoff::LoadStoredState(snapshot);
+
+    auto editorHandoff = EditorHandoff::Channel::Create(snapshot);
+    if (editorHandoff)
+    {
+        params += L" " + editorHandoff->Name();
+    }
+
+    {
+        std::scoped_lock lock(m_editorLock);
+        m_editorHandoff = std::move(editorHandoff);
+    }
+
     SHELLEXECUTEINFO sei{ sizeof(sei) };
     sei.fMask = { SEE_MASK_NOCLOSEPROCESS | SEE_MASK_FLAG_NO_UI };
     sei.lpFile = L"modules\\FancyZonesEditor.exe";
@@ -427,6 +581,28 @@ IFACEMETHODIMP_(void) FancyZones::MoveWindowsOnActiveZoneSetChange() noexcept
     }
 }
 
+// IZoneWindowHost
+IFACEMETHODIMP_(void) FancyZones::SetAppLastZone(HWND window, PCWSTR processPath, int zoneIndex) noexcept try
+{
+    if (const HMONITOR monitor = MonitorFromWindow(window, MONITOR_DEFAULTTONULL))
+    {
+        m_appZoneHistory.Set(AppZoneHistory::MonitorKey(monitor), processPath, zoneIndex);
+        if (auto context = PlacementContext(monitor); context && (zoneIndex != -1))
+        {
+            m_placementModel.Observe(processPath, *context, zoneIndex, PlacementModel::Now());
+        }
+        ScheduleAppZoneHistoryFlush();
+    }
+}
+CATCH_LOG();
+
+IFACEMETHODIMP_(void) FancyZones::PersistZoneSets(std::vector<ZoneSetStore::Entry> const& entries) noexcept try
+{
+    m_zoneSetWrites.Add(entries);
+    ScheduleZoneSetWrites(0);
+}
+CATCH_LOG();
+
 LRESULT FancyZones::WndProc(HWND window, UINT message, WPARAM wparam, LPARAM lparam) noexcept
 {
     switch (message)
@@ -467,16 +643,25 @@ LRESULT FancyZones::WndProc(HWND window, UINT message, WPARAM wparam, LPARAM lpa
         }
         else if (message == WM_PRIV_EDITOR)
         {
-            if (lparam == static_cast<LPARAM>(EditorExitKind::Exit))
+            std::unique_ptr<EditorHandoff::Channel> editorHandoff;
             {
-                // Don't reload settings if we terminated the editor
-                OnDisplayChange(DisplayChangeType::Editor);
+                // Clean up the event either way
+                std::scoped_lock lock(m_editorLock);
+                m_terminateEditorEvent.release();
+                editorHandoff = std::move(m_editorHandoff);
             }
 
+            if (lparam == static_cast<LPARAM>(EditorExitKind::Exit))
             {
-                // Clean up the event either way
-                std::unique_lock writeLock(m_lock);
-                m_terminateEditorEvent.release();
+                // Don't reload settings if we terminated the editor
+                if (editorHandoff)
+                {
+                    ApplyEditorResult(*editorHandoff);
+                }
+                else
+                {
+                    OnDisplayChange(DisplayChangeType::Editor);
+                }
             }
         }
         else
@@ -498,10 +683,10 @@ void FancyZones::OnDisplayChange(DisplayChangeType changeType) noexcept
         // the first virtual desktop switch happens. If the user hasn't switched virtual desktops in this session
         // then this value will be empty. This means loading the first virtual desktop's configuration can be
         // funky the first time we load up at boot since the user will not have switched virtual desktops yet.
-        std::shared_lock readLock(m_lock);
         GUID currentVirtualDesktopId{};
         if (SUCCEEDED(RegistryHelpers::GetCurrentVirtualDesktop(&currentVirtualDesktopId)))
         {
+            std::scoped_lock lock(m_virtualDesktopLock);
             m_currentVirtualDesktopId = currentVirtualDesktopId;
         }
         else
@@ -511,7 +696,16 @@ void FancyZones::OnDisplayChange(DisplayChangeType changeType) noexcept
         }
     }
 
-    UpdateZoneWindows();
+    if ((changeType == DisplayChangeType::WorkArea) || (changeType == DisplayChangeType::DisplayChange))
+    {
+        // Monitor handles, work areas and scaling may all have changed.
+        WindowRelayout::DesktopGeometryCache().Clear();
+    }
+
+    if ((changeType != DisplayChangeType::VirtualDesktop) || !SwitchZoneWindowsDesktop())
+    {
+        UpdateZoneWindows();
+    }
 
     if ((changeType == DisplayChangeType::WorkArea) || (changeType == DisplayChangeType::DisplayChange))
     {
@@ -536,37 +730,87 @@ void FancyZones::OnDisplayChange(DisplayChangeType changeType) noexcept
     }
 }
 
-void FancyZones::AddZoneWindow(HMONITOR monitor, PCWSTR deviceId) noexcept
+void FancyZones::AddZoneWindow(HMONITOR monitor, PCWSTR deviceId) noexcept try
 {
-    std::unique_lock writeLock(m_lock);
     wil::unique_cotaskmem_string virtualDesktopId;
-    if (SUCCEEDED_LOG(StringFromCLSID(m_currentVirtualDesktopId, &virtualDesktopId)))
+    if (SUCCEEDED_LOG(StringFromCLSID(CurrentVirtualDesktopId(), &virtualDesktopId)))
     {
-        bool newVirtualDesktop = true;
-        if (auto it = m_virtualDesktopIds.find(m_currentVirtualDesktopId); it != end(m_virtualDesktopIds)) {
-            newVirtualDesktop = it->second;
-        }
-        const bool flash = m_settings->GetSettings().zoneSetChange_flashZones && newVirtualDesktop;
+        const bool flash = m_settings->GetSettings().zoneSetChange_flashZones && ConsumeNewVirtualDesktop();
 
+        // A new zone window asks the others for their active zone set while it is created.
+        std::scoped_lock lock(m_zoneWindowsLock);
         if (auto zoneWindow = MakeZoneWindow(this, m_hinstance, monitor, deviceId, virtualDesktopId.get(), flash))
         {
-            m_zoneWindowMap[monitor] = std::move(zoneWindow);
+            m_zoneWindows.Update([&](ZoneWindowMap& zoneWindows) { zoneWindows[monitor] = std::move(zoneWindow); });
         }
-        m_virtualDesktopIds[m_currentVirtualDesktopId] = false;
     }
 }
+CATCH_LOG();
+
+// Switching virtual desktops doesn't change the monitors, so the existing zone windows
+// swap in the zone sets of the new desktop rather than being created again.
+bool FancyZones::SwitchZoneWindowsDesktop() noexcept
+{
+    auto zoneWindows = m_zoneWindows.Load();
+    if (zoneWindows->empty())
+    {
+        return false;
+    }
+
+    wil::unique_cotaskmem_string virtualDesktopId;
+    if (!SUCCEEDED_LOG(StringFromCLSID(CurrentVirtualDesktopId(), &virtualDesktopId)))
+    {
+        return false;
+    }
+
+    const bool flash = m_settings->GetSettings().zoneSetChange_flashZones && ConsumeNewVirtualDesktop();
+    std::scoped_lock lock(m_zoneWindowsLock);
+    for (auto const& [monitor, zoneWindow] : *zoneWindows)
+    {
+        zoneWindow->SwitchVirtualDesktop(virtualDesktopId.get(), flash);
+    }
+    return true;
+}
+
+GUID FancyZones::CurrentVirtualDesktopId() noexcept
+{
+    std::scoped_lock lock(m_virtualDesktopLock);
+    return m_currentVirtualDesktopId;
+}
+
+// Returns whether the current virtual desktop is shown for the first time, and marks it as shown.
+bool FancyZones::ConsumeNewVirtualDesktop() noexcept try
+{
+    std::scoped_lock lock(m_virtualDesktopLock);
+    const bool newVirtualDesktop = m_virtualDesktopIds.IsNew(m_currentVirtualDesktopId);
+    m_virtualDesktopIds.MarkVisited(m_currentVirtualDesktopId);
+    return newVirtualDesktop;
+}
+catch (...)
+{
+    LOG_CAUGHT_EXCEPTION();
+    return false;
+}
 
 void FancyZones::MoveWindowIntoZoneByIndex(HWND window, int index) noexcept
 {
-    std::shared_lock readLock(m_lock);
+    WindowRelayout::Planner planner;
+    MoveWindowIntoZoneByIndex(window, index, planner);
+    planner.Apply();
+}
+
+void FancyZones::MoveWindowIntoZoneByIndex(HWND window, int index, WindowRelayout::Planner& planner) noexcept
+{
     if (window != m_windowMoveSize)
     {
         if (const HMONITOR monitor = MonitorFromWindow(window, MONITOR_DEFAULTTONULL))
         {
-            auto iter = m_zoneWindowMap.find(monitor);
-            if (iter != m_zoneWindowMap.end())
+            auto zoneWindows = m_zoneWindows.Load();
+            auto iter = zoneWindows->find(monitor);
+            if (iter != zoneWindows->end())
             {
-                iter->second->MoveWindowIntoZoneByIndex(window, index);
+                std::scoped_lock lock(m_zoneWindowsLock);
+                iter->second->MoveWindowIntoZoneByIndexDeferred(window, index, planner);
             }
         }
     }
@@ -629,23 +873,61 @@ void FancyZones::UpdateZoneWindows() noexcept
     EnumDisplayMonitors(nullptr, nullptr, callback, reinterpret_cast<LPARAM>(this));
 }
 
+// Applies the layout the editor handed back to the monitor it was launched on. Only that
+// zone window changes, so nothing is reloaded from the registry.
+void FancyZones::ApplyEditorResult(EditorHandoff::Channel& editorHandoff) noexcept
+{
+    EditorHandoff::Result result;
+    if (!editorHandoff.TakeResult(result))
+    {
+        return;
+    }
+
+    {
+        auto zoneWindows = m_zoneWindows.Load();
+        auto iter = zoneWindows->find(reinterpret_cast<HMONITOR>(static_cast<UINT_PTR>(editorHandoff.Monitor())));
+        if (iter == zoneWindows->end())
+        {
+            return;
+        }
+        std::scoped_lock lock(m_zoneWindowsLock);
+        iter->second->ApplyEditorLayout(result.LayoutId, result.Zones);
+    }
+
+    if (m_settings->GetSettings().zoneSetChange_moveWindows)
+    {
+        MoveWindowsOnDisplayChange();
+    }
+}
+
 void FancyZones::MoveWindowsOnDisplayChange() noexcept
 {
+    struct RelayoutContext
+    {
+        FancyZones* fancyZones;
+        WindowRelayout::Planner* planner;
+    };
+
     auto callback = [](HWND window, LPARAM data) -> BOOL
     {
         int i = static_cast<int>(reinterpret_cast<UINT_PTR>(::GetProp(window, ZONE_STAMP)));
         if (i != 0)
         {
             // i is off by 1 since 0 is special.
-            auto strongThis = reinterpret_cast<FancyZones*>(data);
-            strongThis->MoveWindowIntoZoneByIndex(window, i-1);
+            auto context = reinterpret_cast<RelayoutContext*>(data);
+            context->fancyZones->MoveWindowIntoZoneByIndex(window, i-1, *context->planner);
         }
         return TRUE;
     };
-    EnumWindows(callback, reinterpret_cast<LPARAM>(this));
+
+    // Plan every stamped window first, then move them all in one batch.
+    WindowRelayout::Planner planner;
+    RelayoutContext context{ this, &planner };
+    EnumWindows(callback, reinterpret_cast<LPARAM>(&context));
+    planner.Apply();
 }
 
-void FancyZones::UpdateDragState(require_write_lock) noexcept
+bool FancyZones::IsDragModifierPressed() noexcept
 {
     const bool shift = GetAsyncKeyState(VK_SHIFT) & 0x8000;
     const bool mouseL = GetAsyncKeyState(VK_LBUTTON) & 0x8000;
@@ -665,14 +947,19 @@ void FancyZones::UpdateDragState(require_write_lock) noexcept
     {
         mouse |= mouseR;
     }
+    return shift | mouse;
+}
 
+void FancyZones::UpdateDragState() noexcept
+{
+    const bool modifier = IsDragModifierPressed();
     if (m_settings->GetSettings().shiftDrag)
     {
-        m_dragEnabled = (shift | mouse);
+        m_dragEnabled = modifier;
     }
     else
     {
-        m_dragEnabled = !(shift | mouse);
+        m_dragEnabled = !modifier;
     }
 }
 
@@ -686,10 +973,11 @@ void FancyZones::CycleActiveZoneSet(DWORD vkCode) noexcept
         }
         if (const HMONITOR monitor = MonitorFromWindow(window, MONITOR_DEFAULTTONULL))
         {
-            std::shared_lock readLock(m_lock);
-            auto iter = m_zoneWindowMap.find(monitor);
-            if (iter != m_zoneWindowMap.end())
+            auto zoneWindows = m_zoneWindows.Load();
+            auto iter = zoneWindows->find(monitor);
+            if (iter != zoneWindows->end())
             {
+                std::scoped_lock lock(m_zoneWindowsLock);
                 iter->second->CycleActiveZoneSet(vkCode);
             }
         }
@@ -698,6 +986,12 @@ void FancyZones::CycleActiveZoneSet(DWORD vkCode) noexcept
 
 void FancyZones::OnSnapHotkey(DWORD vkCode) noexcept
 {
+    const auto direction = ZoneNavigation::DirectionFromKey(vkCode);
+    if (!direction)
+    {
+        return;
+    }
+
     if (const HWND window = get_filtered_active_window())
     {
         if (GetWindow(window, GW_OWNER) != nullptr)
@@ -706,17 +1000,160 @@ void FancyZones::OnSnapHotkey(DWORD vkCode) noexcept
         }
         if (const HMONITOR monitor = MonitorFromWindow(window, MONITOR_DEFAULTTONULL))
         {
-            std::shared_lock readLock(m_lock);
-            auto iter = m_zoneWindowMap.find(monitor);
-            if (iter != m_zoneWindowMap.end())
+            std::unique_lock lock(m_zoneWindowsLock);
+            UpdateZoneGraph(lock);
+            MoveWindowIntoZoneByDirection(window, monitor, *direction, lock);
+        }
+    }
+}
+
+void FancyZones::UpdateZoneGraph(require_write_lock) noexcept try
+{
+    auto zoneWindows = m_zoneWindows.Load();
+    std::vector<ZoneGraphLayout> layouts;
+    for (auto const& [monitor, zoneWindow] : *zoneWindows)
+    {
+        MONITORINFO mi{ sizeof(mi) };
+        if (!zoneWindow || !zoneWindow->ActiveZoneSet() || !GetMonitorInfo(monitor, &mi))
+        {
+            continue;
+        }
+
+        ZoneGraphLayout layout;
+        layout.monitor = monitor;
+        layout.zoneSet.copy_from(zoneWindow->ActiveZoneSet());
+        layout.origin = { mi.rcWork.left, mi.rcWork.top };
+        layouts.push_back(std::move(layout));
+    }
+
+    auto const sameLayout = [](ZoneGraphLayout const& a, ZoneGraphLayout const& b) {
+        return (a.monitor == b.monitor) && (a.zoneSet == b.zoneSet) && (a.origin.x == b.origin.x) && (a.origin.y == b.origin.y);
+    };
+    if (std::equal(layouts.begin(), layouts.end(), m_zoneGraphLayouts.begin(), m_zoneGraphLayouts.end(), sameLayout))
+    {
+        return;
+    }
+
+    std::vector<ZoneNavigation::Node> nodes;
+    std::vector<std::pair<size_t, int>> nodeZones;
+    for (size_t group = 0; group < layouts.size(); group++)
+    {
+        auto& layout = layouts[group];
+        layout.firstNode = nodes.size();
+
+        auto const zones = layout.zoneSet->GetZones();
+        for (size_t i = 0; i < zones.size(); i++)
+        {
+            RECT rect = zones[i]->GetZoneRect();
+            OffsetRect(&rect, layout.origin.x, layout.origin.y);
+            nodes.push_back({ rect, group });
+            nodeZones.emplace_back(group, static_cast<int>(i));
+        }
+    }
+
+    m_zoneGraph = ZoneNavigation::Graph(nodes);
+    m_zoneGraphNodes = std::move(nodeZones);
+    m_zoneGraphLayouts = std::move(layouts);
+}
+CATCH_LOG();
+
+// Work areas only move when the display changes, so they are only looked up again when asked
+// to; a changed active ZoneSet is picked up on every call, like one cycled with the keyboard mid-drag.
+void FancyZones::UpdateZoneSpace(bool checkOrigins) noexcept try
+{
+    auto zoneWindows = m_zoneWindows.Load();
+    for (auto iter = m_zoneSpaceLayouts.begin(); iter != m_zoneSpaceLayouts.end();)
+    {
+        if (zoneWindows->find(iter->first) == zoneWindows->end())
+        {
+            m_zoneSpace.Remove(iter->first);
+            iter = m_zoneSpaceLayouts.erase(iter);
+        }
+        else
+        {
+            ++iter;
+        }
+    }
+
+    std::scoped_lock lock(m_zoneWindowsLock);
+    for (auto const& [monitor, zoneWindow] : *zoneWindows)
+    {
+        IZoneSet* zoneSet = zoneWindow ? zoneWindow->ActiveZoneSet() : nullptr;
+        const GUID zoneSetId = zoneSet ? zoneSet->Id() : GUID_NULL;
+        const UINT zoneSetRevision = zoneSet ? zoneSet->Revision() : 0;
+        auto& layout = m_zoneSpaceLayouts[monitor];
+        const bool zoneSetChanged = (layout.zoneSetId != zoneSetId) || (layout.zoneSetRevision != zoneSetRevision);
+        if (!zoneSetChanged && !checkOrigins)
+        {
+            continue;
+        }
+
+        MONITORINFO mi{ sizeof(mi) };
+        if (!GetMonitorInfo(monitor, &mi))
+        {
+            continue;
+        }
+
+        const POINT origin{ mi.rcWork.left, mi.rcWork.top };
+        if (!zoneSetChanged && (origin.x == layout.origin.x) && (origin.y == layout.origin.y))
+        {
+            continue;
+        }
+
+        std::vector<RECT> zones;
+        if (zoneSet)
+        {
+            for (auto const& zone : zoneSet->GetZones())
             {
-                iter->second->MoveWindowIntoZoneByDirection(window, vkCode);
+                RECT rect = zone->GetZoneRect();
+                OffsetRect(&rect, origin.x, origin.y);
+                zones.push_back(rect);
             }
         }
+        m_zoneSpace.SetZones(monitor, zones);
+        layout.zoneSetId = zoneSetId;
+        layout.zoneSetRevision = zoneSetRevision;
+        layout.origin = origin;
     }
 }
+CATCH_LOG();
 
-void FancyZones::MoveSizeStartInternal(HWND window, HMONITOR monitor, POINT const& ptScreen, require_write_lock writeLock) noexcept
+void FancyZones::MoveWindowIntoZoneByDirection(HWND window, HMONITOR monitor, ZoneNavigation::Direction direction, require_write_lock) noexcept
+{
+    auto source = std::find_if(m_zoneGraphLayouts.begin(), m_zoneGraphLayouts.end(), [monitor](ZoneGraphLayout const& layout) {
+        return layout.monitor == monitor;
+    });
+    if (source == m_zoneGraphLayouts.end())
+    {
+        return;
+    }
+
+    const size_t group = std::distance(m_zoneGraphLayouts.begin(), source);
+    const int zoneIndex = source->zoneSet->GetZoneIndexFromWindow(window);
+    const int node = (zoneIndex >= 0) ?
+        m_zoneGraph.Neighbor(source->firstNode + zoneIndex, direction) :
+        m_zoneGraph.Entry(group, direction);
+    if (node == ZoneNavigation::None)
+    {
+        return;
+    }
+
+    auto const [targetGroup, targetIndex] = m_zoneGraphNodes[node];
+    if ((targetGroup != group) && (zoneIndex >= 0))
+    {
+        // Leaving this monitor; the target ZoneSet only knows about its own zones.
+        source->zoneSet->GetZones()[zoneIndex]->RemoveWindowFromZone(window, false);
+    }
+
+    auto zoneWindows = m_zoneWindows.Load();
+    auto iter = zoneWindows->find(m_zoneGraphLayouts[targetGroup].monitor);
+    if (iter != zoneWindows->end())
+    {
+        iter->second->MoveWindowIntoZone(window, targetIndex);
+    }
+}
+
+void FancyZones::MoveSizeStartInternal(HWND window, HMONITOR monitor, POINT const& ptScreen) noexcept
 {
     // Only enter move/size if the cursor is inside the window rect by a certain padding.
     // This prevents resize from triggering zones.
@@ -736,9 +1173,11 @@ void FancyZones::MoveSizeStartInternal(HWND window, HMONITOR monitor, POINT cons
     }
 
     m_inMoveSize = true;
+    UpdateZoneSpace(true);
 
-    auto iter = m_zoneWindowMap.find(monitor);
-    if (iter == end(m_zoneWindowMap))
+    auto zoneWindows = m_zoneWindows.Load();
+    auto iter = zoneWindows->find(monitor);
+    if (iter == zoneWindows->end())
     {
         return;
     }
@@ -746,8 +1185,9 @@ void FancyZones::MoveSizeStartInternal(HWND window, HMONITOR monitor, POINT cons
     m_windowMoveSize = window;
 
     // This updates m_dragEnabled depending on if the shift key is being held down.
-    UpdateDragState(writeLock);
+    UpdateDragState();
 
+    std::scoped_lock lock(m_zoneWindowsLock);
     if (m_dragEnabled)
     {
         m_zoneWindowMoveSize = iter->second;
@@ -760,7 +1200,7 @@ void FancyZones::MoveSizeStartInternal(HWND window, HMONITOR monitor, POINT cons
     }
 }
 
-void FancyZones::MoveSizeEndInternal(HWND window, POINT const& ptScreen, require_write_lock) noexcept
+void FancyZones::MoveSizeEndInternal(HWND window, POINT const& ptScreen) noexcept
 {
     m_inMoveSize = false;
     m_dragEnabled = false;
@@ -768,6 +1208,7 @@ void FancyZones::MoveSizeEndInternal(HWND window, POINT const& ptScreen, require
     if (m_zoneWindowMoveSize)
     {
         auto zoneWindow = std::move(m_zoneWindowMoveSize);
+        std::scoped_lock lock(m_zoneWindowsLock);
         zoneWindow->MoveSizeEnd(window, ptScreen);
     }
     else
@@ -777,17 +1218,17 @@ void FancyZones::MoveSizeEndInternal(HWND window, POINT const& ptScreen, require
         auto processPath = get_process_path(window);
         if (!processPath.empty())
         {
-            RegistryHelpers::SaveAppLastZone(window, processPath.data(), -1);
+            SetAppLastZone(window, processPath.c_str(), -1);
         }
     }
 }
 
-void FancyZones::MoveSizeUpdateInternal(HMONITOR monitor, POINT const& ptScreen, require_write_lock writeLock) noexcept
+void FancyZones::MoveSizeUpdateInternal(HMONITOR monitor, POINT const& ptScreen) noexcept
 {
     if (m_inMoveSize)
     {
         // This updates m_dragEnabled depending on if the shift key is being held down.
-        UpdateDragState(writeLock);
+        UpdateDragState();
 
         if (m_zoneWindowMoveSize)
         {
@@ -796,41 +1237,60 @@ void FancyZones::MoveSizeUpdateInternal(HMONITOR monitor, POINT const& ptScreen,
             {
                 // Drag got disabled, tell it to cancel and clear out m_zoneWindowMoveSize
                 auto zoneWindow = std::move(m_zoneWindowMoveSize);
+                std::scoped_lock lock(m_zoneWindowsLock);
                 zoneWindow->MoveSizeCancel();
             }
             else
             {
-                auto iter = m_zoneWindowMap.find(monitor);
-                if (iter != m_zoneWindowMap.end())
+                // Hit-test every monitor's zones at once. The drag moves to the zone window of
+                // the monitor under the cursor, or of the zone under it, which may reach past
+                // its own monitor.
+                UpdateZoneSpace(false);
+                int zoneIndex = -1;
+                HMONITOR targetMonitor = monitor;
+                if (const auto hit = m_zoneSpace.ZoneFromPoint(ptScreen))
+                {
+                    targetMonitor = hit->Monitor;
+                    zoneIndex = hit->ZoneIndex;
+                }
+
+                winrt::com_ptr<IZoneWindow> targetZoneWindow;
+                auto zoneWindows = m_zoneWindows.Load();
+                if (auto iter = zoneWindows->find(targetMonitor); iter != zoneWindows->end())
                 {
-                    if (iter->second != m_zoneWindowMoveSize)
-                    {
-                        // The drag has moved to a different monitor.
-                        auto const isDragEnabled = m_zoneWindowMoveSize->IsDragEnabled();
-                        m_zoneWindowMoveSize->MoveSizeCancel();
-                        m_zoneWindowMoveSize = iter->second;
-                        m_zoneWindowMoveSize->MoveSizeEnter(m_windowMoveSize, isDragEnabled);
-                    }
-                    m_zoneWindowMoveSize->MoveSizeUpdate(ptScreen, m_dragEnabled);
+                    targetZoneWindow = iter->second;
                 }
+
+                std::scoped_lock lock(m_zoneWindowsLock);
+                if (targetZoneWindow && (targetZoneWindow != m_zoneWindowMoveSize))
+                {
+                    // The drag has moved to a different monitor.
+                    auto const isDragEnabled = m_zoneWindowMoveSize->IsDragEnabled();
+                    m_zoneWindowMoveSize->MoveSizeCancel();
+                    m_zoneWindowMoveSize = std::move(targetZoneWindow);
+                    m_zoneWindowMoveSize->MoveSizeEnter(m_windowMoveSize, isDragEnabled);
+                }
+                m_zoneWindowMoveSize->MoveSizeUpdateZone(zoneIndex, m_dragEnabled);
             }
         }
         else if (m_dragEnabled)
         {
             // We'll get here if the user presses/releases shift while dragging.
             // Restart the drag on the ZoneWindow that m_windowMoveSize is on
-            MoveSizeStartInternal(m_windowMoveSize, monitor, ptScreen, writeLock);
-            MoveSizeUpdateInternal(monitor, ptScreen, writeLock);
+            MoveSizeStartInternal(m_windowMoveSize, monitor, ptScreen);
+            MoveSizeUpdateInternal(monitor, ptScreen);
         }
     }
 }
 
-void FancyZones::HandleVirtualDesktopUpdates(HANDLE fancyZonesDestroyedEvent) noexcept
+void FancyZones::HandleVirtualDesktopUpdates(HANDLE fancyZonesDestroyedEvent) noexcept try
 {
-    HANDLE regKeyEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-    HANDLE events[2] = { regKeyEvent, fancyZonesDestroyedEvent };
+    wil::unique_event regKeyEvent(wil::EventOptions::None);
+    HANDLE events[2] = { regKeyEvent.get(), fancyZonesDestroyedEvent };
+    std::vector<BYTE> buffer;
     while (1) {
-        if (RegNotifyChangeKeyValue(HKEY_CURRENT_USER, TRUE, REG_NOTIFY_CHANGE_LAST_SET, regKeyEvent, TRUE) != ERROR_SUCCESS) {
+        // Only the VirtualDesktops key itself; watching all of HKCU would wake this thread for every registry write.
+        if (RegNotifyChangeKeyValue(m_virtualDesktopsRegKey, FALSE, REG_NOTIFY_CHANGE_LAST_SET, regKeyEvent.get(), TRUE) != ERROR_SUCCESS) {
             return;
         }
         if (WaitForMultipleObjects(2, events, FALSE, INFINITE) != (WAIT_OBJECT_0 + 0)) {
@@ -843,32 +1303,181 @@ void FancyZones::HandleVirtualDesktopUpdates(HANDLE fancyZonesDestroyedEvent) no
         if (RegQueryValueExW(m_virtualDesktopsRegKey, key, 0, nullptr, nullptr, &bufferCapacity) != ERROR_SUCCESS) {
             return;
         }
-        std::unique_ptr<BYTE[]> buffer = std::make_unique<BYTE[]>(bufferCapacity);
+        buffer.resize(bufferCapacity);
         // request regkey binary content
-        if (RegQueryValueExW(m_virtualDesktopsRegKey, key, 0, nullptr, buffer.get(), &bufferCapacity) != ERROR_SUCCESS) {
+        if (RegQueryValueExW(m_virtualDesktopsRegKey, key, 0, nullptr, buffer.data(), &bufferCapacity) != ERROR_SUCCESS) {
             return;
         }
-        const int guidSize = sizeof(GUID);
-        std::unordered_map<GUID, bool> temp;
-        temp.reserve(bufferCapacity / guidSize);
-        for (size_t i = 0; i < bufferCapacity; i += guidSize) {
-            GUID *guid = reinterpret_cast<GUID*>(buffer.get() + i);
-            temp[*guid] = true;
-        }
-        std::unique_lock writeLock(m_lock);
-        for (auto it = begin(m_virtualDesktopIds); it != end(m_virtualDesktopIds);) {
-            if (auto iter = temp.find(it->first); iter == temp.end()) {
-                it = m_virtualDesktopIds.erase(it); // virtual desktop closed, remove it from map
-            }
-            else {
-                temp.erase(it->first); // virtual desktop already in map, skip it
-                ++it;
+        std::scoped_lock lock(m_virtualDesktopLock);
+        m_virtualDesktopIds.Update(buffer.data(), bufferCapacity);
+    }
+}
+CATCH_LOG();
+
+void FancyZones::ScheduleAppZoneHistoryFlush() noexcept try
+{
+    if (!m_appZoneHistoryFlushScheduled.exchange(true))
+    {
+        m_appZoneHistoryThread.submit(OnThreadExecutor::task_t{ [this] {
+            // Give a burst of window moves time to land so they go out in one batch.
+            WaitForSingleObject(m_flushNowEvent.get(), m_appZoneHistoryFlushDelay);
+            m_appZoneHistoryFlushScheduled = false;
+            FlushAppZoneHistory();
+        } });
+    }
+}
+CATCH_LOG();
+
+void FancyZones::FlushAppZoneHistory() noexcept try
+{
+    auto changes = m_appZoneHistory.TakePendingChanges();
+    if (!changes.empty())
+    {
+        AppZoneHistory::WriteToRegistry(changes);
+    }
+
+    auto placements = m_placementModel.TakePendingChanges();
+    if (!placements.empty())
+    {
+        PlacementModel::WriteToRegistry(placements);
+    }
+}
+CATCH_LOG();
+
+void FancyZones::ScheduleZoneSetWrites(DWORD delay) noexcept try
+{
+    if (!m_zoneSetWritesScheduled.exchange(true))
+    {
+        m_zoneSetStoreThread.submit(OnThreadExecutor::task_t{ [this, delay] {
+            WaitForSingleObject(m_flushNowEvent.get(), delay);
+            m_zoneSetWritesScheduled = false;
+            FlushZoneSetWrites();
+        } });
+    }
+}
+CATCH_LOG();
+
+// Runs on the zone set store thread. A failed save, usually because the editor has the store
+// mapped, is retried a few times; after that the changes wait for the next save or Destroy.
+void FancyZones::FlushZoneSetWrites() noexcept
+{
+    if (m_zoneSetWrites.Flush())
+    {
+        m_zoneSetWriteRetries = 0;
+    }
+    else if ((m_zoneSetWriteRetries < m_zoneSetWriteMaxRetries) && (WaitForSingleObject(m_flushNowEvent.get(), 0) == WAIT_TIMEOUT))
+    {
+        m_zoneSetWriteRetries++;
+        ScheduleZoneSetWrites(m_zoneSetWriteRetryDelay);
+    }
+}
+
+// The monitor and layout a window is placed with.
+std::optional<PlacementModel::Context> FancyZones::PlacementContext(HMONITOR monitor) noexcept try
+{
+    auto zoneWindows = m_zoneWindows.Load();
+    auto iter = zoneWindows->find(monitor);
+    if (iter == zoneWindows->end())
+    {
+        return std::nullopt;
+    }
+
+    std::scoped_lock lock(m_zoneWindowsLock);
+    IZoneSet* zoneSet = iter->second->ActiveZoneSet();
+    if (!zoneSet)
+    {
+        return std::nullopt;
+    }
+    return PlacementModel::Context{ AppZoneHistory::MonitorKey(monitor), zoneSet->LayoutId(), zoneSet->GetZones().size() };
+}
+catch (...)
+{
+    LOG_CAUGHT_EXCEPTION();
+    return std::nullopt;
+}
+
+void FancyZones::RecordDragEvent(DragTrace::EventType type, HWND window, POINT const& ptScreen) noexcept try
+{
+    if (m_dragTracePath.empty())
+    {
+        return;
+    }
+
+    DragTrace::Event event;
+    event.Type = type;
+    event.Window = reinterpret_cast<uintptr_t>(window);
+    event.Cursor = { ptScreen.x, ptScreen.y };
+    event.Shift = IsDragModifierPressed();
+
+    if (type == DragTrace::EventType::MoveSizeStart)
+    {
+        // A session that never ended is dropped, as is everything recorded against an old topology.
+        m_dragTraceEvents.clear();
+        auto monitors = SnapshotDragTraceMonitors();
+        if (monitors != m_dragTraceMonitors)
+        {
+            m_dragTraceMonitors = std::move(monitors);
+            m_dragTraceRestart = true;
+            m_dragTraceStart = std::chrono::steady_clock::now();
+        }
+
+        RECT windowRect{};
+        ::GetWindowRect(window, &windowRect);
+        event.WindowRect = ToTraceBox(windowRect);
+    }
+    else if (m_dragTraceEvents.empty())
+    {
+        return;
+    }
+
+    event.TimeMs = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_dragTraceStart).count());
+    m_dragTraceEvents.push_back(event);
+}
+CATCH_LOG();
+
+std::vector<DragTrace::Monitor> FancyZones::SnapshotDragTraceMonitors()
+{
+    auto zoneWindows = m_zoneWindows.Load();
+    std::scoped_lock lock(m_zoneWindowsLock);
+    std::vector<DragTrace::Monitor> monitors;
+    for (auto const& [monitor, zoneWindow] : *zoneWindows)
+    {
+        MONITORINFO mi{ sizeof(mi) };
+        if (!GetMonitorInfoW(monitor, &mi))
+        {
+            continue;
+        }
+
+        DragTrace::Monitor traced;
+        traced.Id = reinterpret_cast<uintptr_t>(monitor);
+        traced.Bounds = ToTraceBox(mi.rcMonitor);
+        traced.WorkArea = ToTraceBox(mi.rcWork);
+        if (auto zoneSet = zoneWindow->ActiveZoneSet())
+        {
+            for (auto const& zone : zoneSet->GetZones())
+            {
+                traced.Zones.push_back(ToTraceBox(zone->GetZoneRect()));
             }
         }
-        // register new virtual desktops, if any
-        m_virtualDesktopIds.insert(begin(temp), end(temp));
+        monitors.push_back(std::move(traced));
+    }
+    return monitors;
+}
+
+void FancyZones::WriteDragTrace(std::vector<DragTrace::Event> events, std::vector<DragTrace::Monitor> const* monitors) noexcept try
+{
+    if (monitors)
+    {
+        std::ofstream out(m_dragTracePath, std::ios::trunc);
+        DragTrace::Write(out, DragTrace::Trace{ *monitors, std::move(events) });
+    }
+    else
+    {
+        std::ofstream out(m_dragTracePath, std::ios::app);
+        DragTrace::WriteEvents(out, events);
     }
 }
+CATCH_LOG();
 
 winrt::com_ptr<IFancyZones> MakeFancyZones(HINSTANCE hinstance, IFancyZonesSettings* settings) noexcept
 {
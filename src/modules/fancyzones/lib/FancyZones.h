@@ -1,7 +1,9 @@
 #pragma once
 
 interface IZoneWindow;
+class AnimationScheduler;
 interface IFancyZonesSettings;
+namespace ZoneSetStore { struct Entry; }
 
 enum class DisplayChangeType
 {
@@ -26,7 +28,7 @@ interface __declspec(uuid("{2CB37E8F-87E6-4AEC-B4B2-E0FDC873343F}")) IFancyZones
     IFACEMETHOD_(void, MoveSizeEnd)(HWND window, POINT const& ptScreen) = 0;
     IFACEMETHOD_(void, VirtualDesktopChanged)() = 0;
     IFACEMETHOD_(void, WindowCreated)(HWND window) = 0;
-    IFACEMETHOD_(bool, OnKeyDown)(PKBDLLHOOKSTRUCT info) = 0;
+    IFACEMETHOD_(void, OnHotkey)(DWORD vkCode, UINT modifiers) = 0;
     IFACEMETHOD_(void, ToggleEditor)() = 0;
     IFACEMETHOD_(void, SettingsChanged)() = 0;
 };
@@ -37,6 +39,11 @@ interface __declspec(uuid("{5C8D99D6-34B2-4F4A-A8E5-7483F6869775}")) IZoneWindow
     IFACEMETHOD_(COLORREF, GetZoneHighlightColor)() = 0;
     IFACEMETHOD_(GUID, GetCurrentMonitorZoneSetId)(HMONITOR monitor) = 0;
     IFACEMETHOD_(int, GetZoneHighlightOpacity)() = 0;
+    IFACEMETHOD_(void, SetAppLastZone)(HWND window, PCWSTR processPath, int zoneIndex) = 0;
+    // Shared by every zone window for its fades. May be null, zone windows then skip them.
+    IFACEMETHOD_(AnimationScheduler*, Animations)() = 0;
+    // Saves the zone sets to the store off the UI thread. Saves that fail are retried later.
+    IFACEMETHOD_(void, PersistZoneSets)(std::vector<ZoneSetStore::Entry> const& entries) = 0;
 };
 
 winrt::com_ptr<IFancyZones> MakeFancyZones(HINSTANCE hinstance, IFancyZonesSettings* settings) noexcept;
@@ -0,0 +1,329 @@
+#include "pch.h"
+
+#include "LayoutGenerator.h"
+
+#include <limits>
+
+namespace
+{
+    // Persisted grid models of the editor's "Priority Grid" for 1 to 11 zones, in the
+    // editor's format: version (2 bytes), id (2), type (1), rows, columns, big-endian
+    // row and column percents, then the cell map.
+    std::vector<std::vector<BYTE>> const PriorityData{
+        { 0, 0, 0, 0, 0, 1, 1, 39, 16, 39, 16, 0 },
+        { 0, 0, 0, 0, 0, 1, 2, 39, 16, 26, 11, 13, 5, 0, 1 },
+        { 0, 0, 0, 0, 0, 1, 3, 39, 16, 9, 196, 19, 136, 9, 196, 0, 1, 2 },
+        { 0, 0, 0, 0, 0, 2, 3, 19, 136, 19, 136, 9, 196, 19, 136, 9, 196, 0, 1, 2, 0, 1, 3 },
+        { 0, 0, 0, 0, 0, 2, 3, 19, 136, 19, 136, 9, 196, 19, 136, 9, 196, 0, 1, 2, 3, 1, 4 },
+        { 0, 0, 0, 0, 0, 3, 3, 13, 5, 13, 6, 13, 5, 9, 196, 19, 136, 9, 196, 0, 1, 2, 0, 1, 3, 4, 1, 5 },
+        { 0, 0, 0, 0, 0, 3, 3, 13, 5, 13, 6, 13, 5, 9, 196, 19, 136, 9, 196, 0, 1, 2, 3, 1, 4, 5, 1, 6 },
+        { 0, 0, 0, 0, 0, 3, 4, 13, 5, 13, 6, 13, 5, 9, 196, 9, 196, 9, 196, 9, 196, 0, 1, 2, 3, 4, 1, 2, 5, 6, 1, 2, 7 },
+        { 0, 0, 0, 0, 0, 3, 4, 13, 5, 13, 6, 13, 5, 9, 196, 9, 196, 9, 196, 9, 196, 0, 1, 2, 3, 4, 1, 2, 5, 6, 1, 7, 8 },
+        { 0, 0, 0, 0, 0, 3, 4, 13, 5, 13, 6, 13, 5, 9, 196, 9, 196, 9, 196, 9, 196, 0, 1, 2, 3, 4, 1, 5, 6, 7, 1, 8, 9 },
+        { 0, 0, 0, 0, 0, 3, 4, 13, 5, 13, 6, 13, 5, 9, 196, 9, 196, 9, 196, 9, 196, 0, 1, 2, 3, 4, 1, 5, 6, 7, 8, 9, 10 },
+    };
+
+    LayoutGenerator::GridSpec ParseGridModel(std::vector<BYTE> const& data)
+    {
+        LayoutGenerator::GridSpec spec;
+        size_t i = 5;
+        spec.Rows = data[i++];
+        spec.Columns = data[i++];
+
+        for (int row = 0; row < spec.Rows; row++, i += 2)
+        {
+            spec.RowPercents.push_back(data[i] * 256 + data[i + 1]);
+        }
+        for (int column = 0; column < spec.Columns; column++, i += 2)
+        {
+            spec.ColumnPercents.push_back(data[i] * 256 + data[i + 1]);
+        }
+        spec.CellChildMap.assign(data.begin() + i, data.end());
+        return spec;
+    }
+
+    // Start and end offsets of each track. The percents are normalized by their sum rather
+    // than by Multiplier: the editor's equal splits (Multiplier / count) do not add up to
+    // Multiplier and would otherwise leave the last track a few pixels short.
+    std::vector<std::pair<LONG, LONG>> Tracks(std::vector<int> const& percents, LONG origin, LONG extent, int spacing)
+    {
+        LONGLONG total = 0;
+        for (int percent : percents)
+        {
+            total += percent;
+        }
+
+        // Never let the gaps alone overflow the work area.
+        LONGLONG const count = static_cast<LONGLONG>(percents.size());
+        LONGLONG const gap = (std::min)(static_cast<LONGLONG>(spacing), (std::max)(0LL, static_cast<LONGLONG>(extent)) / (count + 1));
+        LONGLONG const available = (std::max)(0LL, extent - gap * (count + 1));
+
+        std::vector<std::pair<LONG, LONG>> tracks;
+        tracks.reserve(percents.size());
+        LONGLONG sum = 0;
+        for (LONGLONG i = 0; i < count; i++)
+        {
+            LONGLONG const start = available * sum / total;
+            sum += percents[static_cast<size_t>(i)];
+            LONGLONG const end = available * sum / total;
+
+            LONGLONG const offset = origin + gap * (i + 1);
+            tracks.emplace_back(static_cast<LONG>(offset + start), static_cast<LONG>(offset + end));
+        }
+        return tracks;
+    }
+
+    LayoutGenerator::GridSpec EqualTracks(int rows, int columns)
+    {
+        LayoutGenerator::GridSpec spec;
+        if ((rows <= 0) || (columns <= 0))
+        {
+            return spec;
+        }
+
+        spec.Rows = rows;
+        spec.Columns = columns;
+        spec.RowPercents.assign(rows, LayoutGenerator::Multiplier / rows);
+        spec.ColumnPercents.assign(columns, LayoutGenerator::Multiplier / columns);
+        spec.CellChildMap.resize(static_cast<size_t>(rows) * columns);
+        return spec;
+    }
+}
+
+namespace LayoutGenerator
+{
+    GridSpec Rows(int zoneCount)
+    {
+        GridSpec spec = EqualTracks(zoneCount, 1);
+        for (int i = 0; i < zoneCount; i++)
+        {
+            spec.CellChildMap[i] = i;
+        }
+        return spec;
+    }
+
+    GridSpec Columns(int zoneCount)
+    {
+        GridSpec spec = EqualTracks(1, zoneCount);
+        for (int i = 0; i < zoneCount; i++)
+        {
+            spec.CellChildMap[i] = i;
+        }
+        return spec;
+    }
+
+    GridSpec Grid(int zoneCount)
+    {
+        if (zoneCount <= 0)
+        {
+            return {};
+        }
+
+        int rows = 1;
+        while (zoneCount / rows >= rows)
+        {
+            rows++;
+        }
+        rows--;
+
+        int const columns = (zoneCount / rows) + ((zoneCount % rows == 0) ? 0 : 1);
+        GridSpec spec = EqualTracks(rows, columns);
+
+        // Zones are numbered from the bottom right; the leftover cells at the top left
+        // are merged into the last zone.
+        int index = 0;
+        for (int column = columns - 1; column >= 0; column--)
+        {
+            for (int row = rows - 1; row >= 0; row--)
+            {
+                spec.CellChildMap[row * columns + column] = index++;
+                if (index == zoneCount)
+                {
+                    index--;
+                }
+            }
+        }
+        return spec;
+    }
+
+    GridSpec PriorityGrid(int zoneCount)
+    {
+        if ((zoneCount >= 1) && (zoneCount <= static_cast<int>(PriorityData.size())))
+        {
+            return ParseGridModel(PriorityData[zoneCount - 1]);
+        }
+        return Grid(zoneCount);
+    }
+
+    int ZoneCount(GridSpec const& spec) noexcept
+    {
+        int maxIndex = -1;
+        for (int index : spec.CellChildMap)
+        {
+            maxIndex = (std::max)(maxIndex, index);
+        }
+        return maxIndex + 1;
+    }
+
+    bool IsValid(GridSpec const& spec) noexcept try
+    {
+        if ((spec.Rows <= 0) || (spec.Columns <= 0) ||
+            (spec.RowPercents.size() != static_cast<size_t>(spec.Rows)) ||
+            (spec.ColumnPercents.size() != static_cast<size_t>(spec.Columns)) ||
+            (spec.CellChildMap.size() != static_cast<size_t>(spec.Rows) * spec.Columns))
+        {
+            return false;
+        }
+
+        auto const positive = [](int percent) { return percent > 0; };
+        if (!std::all_of(spec.RowPercents.begin(), spec.RowPercents.end(), positive) ||
+            !std::all_of(spec.ColumnPercents.begin(), spec.ColumnPercents.end(), positive) ||
+            !std::all_of(spec.CellChildMap.begin(), spec.CellChildMap.end(), [](int index) { return index >= 0; }))
+        {
+            return false;
+        }
+
+        struct Bounds
+        {
+            int top, left, bottom, right, cells;
+        };
+        std::vector<Bounds> bounds(ZoneCount(spec), Bounds{ (std::numeric_limits<int>::max)(), (std::numeric_limits<int>::max)(), -1, -1, 0 });
+        for (int row = 0; row < spec.Rows; row++)
+        {
+            for (int column = 0; column < spec.Columns; column++)
+            {
+                Bounds& zone = bounds[spec.CellAt(row, column)];
+                zone.top = (std::min)(zone.top, row);
+                zone.left = (std::min)(zone.left, column);
+                zone.bottom = (std::max)(zone.bottom, row);
+                zone.right = (std::max)(zone.right, column);
+                zone.cells++;
+            }
+        }
+
+        // Every index is used, and a zone's cells exactly fill its bounding box.
+        return std::all_of(bounds.begin(), bounds.end(), [](Bounds const& zone) {
+            return (zone.cells > 0) && (zone.cells == (zone.bottom - zone.top + 1) * (zone.right - zone.left + 1));
+        });
+    }
+    catch (...)
+    {
+        return false;
+    }
+
+    std::vector<RECT> GridZones(GridSpec const& spec, RECT const& workArea, int spacing)
+    {
+        std::vector<RECT> zones;
+        if (!IsValid(spec))
+        {
+            return zones;
+        }
+
+        spacing = (std::max)(spacing, 0);
+        auto const rows = Tracks(spec.RowPercents, workArea.top, workArea.bottom - workArea.top, spacing);
+        auto const columns = Tracks(spec.ColumnPercents, workArea.left, workArea.right - workArea.left, spacing);
+
+        constexpr LONG maxValue = (std::numeric_limits<LONG>::max)();
+        constexpr LONG minValue = (std::numeric_limits<LONG>::min)();
+        zones.resize(ZoneCount(spec), RECT{ maxValue, maxValue, minValue, minValue });
+        for (int row = 0; row < spec.Rows; row++)
+        {
+            for (int column = 0; column < spec.Columns; column++)
+            {
+                RECT& zone = zones[spec.CellAt(row, column)];
+                zone.left = (std::min)(zone.left, columns[column].first);
+                zone.top = (std::min)(zone.top, rows[row].first);
+                zone.right = (std::max)(zone.right, columns[column].second);
+                zone.bottom = (std::max)(zone.bottom, rows[row].second);
+            }
+        }
+        return zones;
+    }
+
+    std::vector<RECT> FocusZones(int zoneCount, RECT const& workArea)
+    {
+        std::vector<RECT> zones;
+        if (zoneCount <= 0)
+        {
+            return zones;
+        }
+
+        // A stack of cascading windows, each 60% of the work area, spread over the middle 80%.
+        LONG const width = workArea.right - workArea.left;
+        LONG const height = workArea.bottom - workArea.top;
+        LONG const xIncrement = (zoneCount <= 1) ? 0 : (width / 5) / (zoneCount - 1);
+        LONG const yIncrement = (zoneCount <= 1) ? 0 : (height / 5) / (zoneCount - 1);
+
+        RECT zone{ workArea.left + width / 10, workArea.top + height / 10 };
+        zone.right = zone.left + width * 6 / 10;
+        zone.bottom = zone.top + height * 6 / 10;
+
+        zones.reserve(zoneCount);
+        for (int i = 0; i < zoneCount; i++)
+        {
+            zones.push_back(zone);
+            zone.left += xIncrement;
+            zone.right += xIncrement;
+            zone.top += yIncrement;
+            zone.bottom += yIncrement;
+        }
+        return zones;
+    }
+
+    std::vector<RECT> ScaleZones(std::vector<RECT> const& zones, RECT const& from, RECT const& to)
+    {
+        LONGLONG const fromWidth = (std::max)(1LL, static_cast<LONGLONG>(from.right) - from.left);
+        LONGLONG const fromHeight = (std::max)(1LL, static_cast<LONGLONG>(from.bottom) - from.top);
+        LONGLONG const toWidth = to.right - to.left;
+        LONGLONG const toHeight = to.bottom - to.top;
+
+        auto const scaleX = [&](LONG x) { return static_cast<LONG>(to.left + (x - from.left) * toWidth / fromWidth); };
+        auto const scaleY = [&](LONG y) { return static_cast<LONG>(to.top + (y - from.top) * toHeight / fromHeight); };
+
+        std::vector<RECT> scaled;
+        scaled.reserve(zones.size());
+        for (auto const& zone : zones)
+        {
+            scaled.push_back({ scaleX(zone.left), scaleY(zone.top), scaleX(zone.right), scaleY(zone.bottom) });
+        }
+        return scaled;
+    }
+
+    bool IsPredefined(WORD layoutId) noexcept
+    {
+        return (layoutId >= PriorityGridLayoutId) && (layoutId <= FocusLayoutId);
+    }
+
+    std::vector<RECT> Generate(LayoutSpec const& spec, RECT const& workArea)
+    {
+        if (spec.ZoneCount <= 0)
+        {
+            return {};
+        }
+
+        switch (spec.LayoutId)
+        {
+        case FocusLayoutId:
+            return FocusZones(spec.ZoneCount, workArea);
+        case RowsLayoutId:
+            return GridZones(Rows(spec.ZoneCount), workArea, spec.Spacing);
+        case ColumnsLayoutId:
+            return GridZones(Columns(spec.ZoneCount), workArea, spec.Spacing);
+        case GridLayoutId:
+            return GridZones(Grid(spec.ZoneCount), workArea, spec.Spacing);
+        case PriorityGridLayoutId:
+            return GridZones(PriorityGrid(spec.ZoneCount), workArea, spec.Spacing);
+        default:
+            return {};
+        }
+    }
+
+    std::vector<RECT> FitZones(LayoutSpec const& spec, std::vector<RECT> const& zones, RECT const& from, RECT const& unscaledTo, RECT const& to)
+    {
+        if (IsPredefined(spec.LayoutId))
+        {
+            return ScaleZones(Generate(spec, unscaledTo), unscaledTo, to);
+        }
+        return ScaleZones(zones, from, to);
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+
+// Computes zone rects for the editor's predefined layouts from a compact description, so
+// zones can be regenerated for any work area instead of replaying rects that were
+// persisted for another resolution or DPI.
+//
+// The algorithms mirror the editor (see Settings.UpdateLayoutModels and
+// GridEditor.ArrangeGridRects) but use integer arithmetic only, so the output is
+// deterministic and adjacent zones never overlap or leave rounding gaps.
+namespace LayoutGenerator
+{
+    // Layout ids the editor assigns to its predefined layouts.
+    constexpr WORD FocusLayoutId = 0xFFFF;
+    constexpr WORD RowsLayoutId = 0xFFFE;
+    constexpr WORD ColumnsLayoutId = 0xFFFD;
+    constexpr WORD GridLayoutId = 0xFFFC;
+    constexpr WORD PriorityGridLayoutId = 0xFFFB;
+
+    // Row and column sizes are expressed in units of 1/Multiplier, as in the editor.
+    constexpr int Multiplier = 10000;
+
+    struct GridSpec
+    {
+        int Rows{};
+        int Columns{};
+        std::vector<int> RowPercents;
+        std::vector<int> ColumnPercents;
+        // Zone index of each cell in row-major order; a zone spanning several cells
+        // repeats its index in all of them.
+        std::vector<int> CellChildMap;
+
+        int CellAt(int row, int column) const noexcept { return CellChildMap[row * Columns + column]; }
+    };
+
+    struct LayoutSpec
+    {
+        WORD LayoutId{};
+        int ZoneCount{};
+        int Spacing{}; // Gap between zones and around the edges, grid layouts only
+    };
+
+    GridSpec Rows(int zoneCount);
+    GridSpec Columns(int zoneCount);
+    GridSpec Grid(int zoneCount);
+    GridSpec PriorityGrid(int zoneCount);
+
+    // A spec is valid if every zone index from 0 to ZoneCount - 1 is used and
+    // each zone covers a rectangular block of cells.
+    bool IsValid(GridSpec const& spec) noexcept;
+    int ZoneCount(GridSpec const& spec) noexcept;
+
+    // Returns one rect per zone, in zone index order. Invalid specs yield no zones.
+    std::vector<RECT> GridZones(GridSpec const& spec, RECT const& workArea, int spacing);
+    std::vector<RECT> FocusZones(int zoneCount, RECT const& workArea);
+
+    // Maps custom zones drawn for a work area of size `from` onto `to`.
+    std::vector<RECT> ScaleZones(std::vector<RECT> const& zones, RECT const& from, RECT const& to);
+
+    bool IsPredefined(WORD layoutId) noexcept;
+
+    // Zones for a predefined layout, or nothing for custom layouts and zero zones.
+    std::vector<RECT> Generate(LayoutSpec const& spec, RECT const& workArea);
+
+    // Fits stored zones, saved for the scaled work area `from`, to the scaled work area `to`.
+    // Predefined layouts are regenerated for `unscaledTo` and scaled by the DPI like the
+    // editor does; custom layouts are scaled from `from`.
+    std::vector<RECT> FitZones(LayoutSpec const& spec, std::vector<RECT> const& zones, RECT const& from, RECT const& unscaledTo, RECT const& to);
+}
@@ -0,0 +1,346 @@
+#include "pch.h"
+
+#include "PlacementModel.h"
+#include "RegistryHelpers.h"
+
+#include <cmath>
+
+namespace
+{
+    constexpr DWORD PersistedVersion = 1;
+    constexpr size_t MaxMonitorKeyLength = 20;
+
+    struct PersistedPlacement
+    {
+        wchar_t MonitorKey[MaxMonitorKeyLength];
+        DWORD LayoutId;
+        DWORD ZoneCount;
+        LONG ZoneIndex;
+        float Score;
+        INT64 Updated;
+    };
+
+    static_assert(sizeof(PersistedPlacement) == 64);
+
+    PCWSTR const PlacementSubkey = L"AppPlacement";
+}
+
+PlacementModel::PlacementModel(size_t capacity, Time halfLife) noexcept :
+    m_capacity(max(capacity, static_cast<size_t>(1))),
+    m_halfLife(static_cast<double>(max(halfLife, Time(1)).count()))
+{
+}
+
+void PlacementModel::Load(std::vector<Entry> const& entries)
+{
+    std::scoped_lock lock(m_lock);
+    m_lru.clear();
+    m_index.clear();
+    m_pending.clear();
+
+    for (auto const& entry : entries)
+    {
+        if (auto iter = m_index.find(entry.ProcessPath); iter != m_index.end())
+        {
+            m_lru.erase(iter->second);
+            m_index.erase(iter);
+        }
+        if (entry.Placements.empty())
+        {
+            continue;
+        }
+
+        App app{ entry.ProcessPath };
+        for (auto const& placement : entry.Placements)
+        {
+            if ((app.SlotCount == MaxSlots) || (placement.ZoneIndex < 0) || (placement.ZoneIndex >= placement.ZoneCount))
+            {
+                continue;
+            }
+            app.Slots[app.SlotCount++] = { MonitorId(placement.MonitorKey), placement.LayoutId, placement.ZoneCount,
+                                           static_cast<WORD>(placement.ZoneIndex), placement.Score, placement.Updated.count() };
+        }
+
+        m_lru.push_front(std::move(app));
+        m_index[entry.ProcessPath] = m_lru.begin();
+    }
+
+    // Anything over capacity was never going to be used; drop it from the store as well.
+    EvictIfNeeded();
+}
+
+void PlacementModel::Observe(std::wstring const& processPath, Context const& context, int zoneIndex, Time now)
+{
+    if ((zoneIndex < 0) || (static_cast<size_t>(zoneIndex) >= context.ZoneCount) || (context.ZoneCount > USHRT_MAX))
+    {
+        return;
+    }
+
+    std::scoped_lock lock(m_lock);
+    uint32_t const monitor = MonitorId(context.MonitorKey);
+    WORD const zoneCount = static_cast<WORD>(context.ZoneCount);
+    App& app = Touch(processPath);
+    m_pending.insert(processPath);
+
+    Slot* weakest = nullptr;
+    float weakestScore{};
+    for (size_t i = 0; i < app.SlotCount; i++)
+    {
+        Slot& slot = app.Slots[i];
+        float const score = Decayed(slot, now);
+        if ((slot.Monitor == monitor) && (slot.LayoutId == context.LayoutId) && (slot.ZoneCount == zoneCount) && (slot.ZoneIndex == zoneIndex))
+        {
+            slot.Score = score + 1.0f;
+            slot.Updated = now.count();
+            return;
+        }
+
+        if (!weakest || (score < weakestScore))
+        {
+            weakest = &slot;
+            weakestScore = score;
+        }
+    }
+
+    Slot& slot = (app.SlotCount < MaxSlots) ? app.Slots[app.SlotCount++] : *weakest;
+    slot = { monitor, context.LayoutId, zoneCount, static_cast<WORD>(zoneIndex), 1.0f, now.count() };
+    EvictIfNeeded();
+}
+
+std::optional<int> PlacementModel::Predict(std::wstring const& processPath, Context const& context, Time now)
+{
+    std::scoped_lock lock(m_lock);
+    auto iter = m_index.find(processPath);
+    if (iter == m_index.end())
+    {
+        return std::nullopt;
+    }
+    m_lru.splice(m_lru.begin(), m_lru, iter->second);
+
+    auto const monitor = m_monitorIds.find(context.MonitorKey);
+    App const& app = *iter->second;
+
+    // Ranked by how closely the slot matches context first, and by score within a match.
+    int bestMatch = -1;
+    float bestScore{};
+    std::optional<int> best;
+    for (size_t i = 0; i < app.SlotCount; i++)
+    {
+        Slot const& slot = app.Slots[i];
+        if (static_cast<size_t>(slot.ZoneIndex) >= context.ZoneCount)
+        {
+            continue; // The zone no longer exists
+        }
+
+        float const score = Decayed(slot, now);
+        if (score < MinScore)
+        {
+            continue;
+        }
+
+        bool const sameMonitor = (monitor != m_monitorIds.end()) && (slot.Monitor == monitor->second);
+        bool const sameLayout = (slot.LayoutId == context.LayoutId) && (slot.ZoneCount == context.ZoneCount);
+        int const match = sameLayout ? (sameMonitor ? 3 : 2) : (sameMonitor ? 1 : 0);
+        if ((match > bestMatch) || ((match == bestMatch) && (score > bestScore)))
+        {
+            bestMatch = match;
+            bestScore = score;
+            best = slot.ZoneIndex;
+        }
+    }
+    return best;
+}
+
+std::vector<PlacementModel::Entry> PlacementModel::TakePendingChanges()
+{
+    std::scoped_lock lock(m_lock);
+    std::vector<Entry> changes;
+    changes.reserve(m_pending.size());
+    for (auto const& processPath : m_pending)
+    {
+        Entry entry{ processPath };
+        if (auto iter = m_index.find(processPath); iter != m_index.end())
+        {
+            App const& app = *iter->second;
+            for (size_t i = 0; i < app.SlotCount; i++)
+            {
+                Slot const& slot = app.Slots[i];
+                entry.Placements.push_back({ m_monitors[slot.Monitor], slot.LayoutId, slot.ZoneCount, slot.ZoneIndex, slot.Score, Time(slot.Updated) });
+            }
+        }
+        changes.emplace_back(std::move(entry));
+    }
+    m_pending.clear();
+    return changes;
+}
+
+size_t PlacementModel::Size() const noexcept
+{
+    std::scoped_lock lock(m_lock);
+    return m_index.size();
+}
+
+bool PlacementModel::HasPendingChanges() const noexcept
+{
+    std::scoped_lock lock(m_lock);
+    return !m_pending.empty();
+}
+
+PlacementModel::Time PlacementModel::Now() noexcept
+{
+    // Scores are persisted, so they are timed with the wall clock rather than since boot.
+    return std::chrono::duration_cast<Time>(std::chrono::system_clock::now().time_since_epoch());
+}
+
+std::vector<BYTE> PlacementModel::Pack(std::vector<Placement> const& placements)
+{
+    std::vector<BYTE> data(sizeof(DWORD) + placements.size() * sizeof(PersistedPlacement));
+    memcpy(data.data(), &PersistedVersion, sizeof(PersistedVersion));
+
+    // The version leaves the records unaligned, so they are copied in and out.
+    BYTE* next = data.data() + sizeof(DWORD);
+    for (auto const& placement : placements)
+    {
+        PersistedPlacement persisted{};
+        StringCchCopy(persisted.MonitorKey, ARRAYSIZE(persisted.MonitorKey), placement.MonitorKey.c_str());
+        persisted.LayoutId = placement.LayoutId;
+        persisted.ZoneCount = placement.ZoneCount;
+        persisted.ZoneIndex = placement.ZoneIndex;
+        persisted.Score = placement.Score;
+        persisted.Updated = placement.Updated.count();
+        memcpy(next, &persisted, sizeof(persisted));
+        next += sizeof(persisted);
+    }
+    return data;
+}
+
+std::optional<std::vector<PlacementModel::Placement>> PlacementModel::Unpack(BYTE const* data, size_t size)
+{
+    DWORD version{};
+    if ((size < sizeof(version)) || ((size - sizeof(version)) % sizeof(PersistedPlacement) != 0))
+    {
+        return std::nullopt;
+    }
+
+    memcpy(&version, data, sizeof(version));
+    if (version != PersistedVersion)
+    {
+        return std::nullopt;
+    }
+
+    std::vector<Placement> placements;
+    size_t const count = (size - sizeof(version)) / sizeof(PersistedPlacement);
+    for (size_t i = 0; i < count; i++)
+    {
+        PersistedPlacement persisted;
+        memcpy(&persisted, data + sizeof(version) + i * sizeof(persisted), sizeof(persisted));
+        if ((wcsnlen(persisted.MonitorKey, ARRAYSIZE(persisted.MonitorKey)) == ARRAYSIZE(persisted.MonitorKey)) ||
+            (persisted.ZoneCount > USHRT_MAX) || (persisted.LayoutId > USHRT_MAX) || !std::isfinite(persisted.Score))
+        {
+            return std::nullopt;
+        }
+        placements.push_back({ persisted.MonitorKey, static_cast<WORD>(persisted.LayoutId), static_cast<WORD>(persisted.ZoneCount),
+                               persisted.ZoneIndex, persisted.Score, Time(persisted.Updated) });
+    }
+    return placements;
+}
+
+std::vector<PlacementModel::Entry> PlacementModel::ReadFromRegistry()
+{
+    std::vector<Entry> entries;
+
+    wchar_t placementKey[256]{};
+    StringCchPrintf(placementKey, ARRAYSIZE(placementKey), L"%s\\%s", RegistryHelpers::REG_SETTINGS, PlacementSubkey);
+
+    wil::unique_hkey key;
+    if (RegOpenKeyExW(HKEY_CURRENT_USER, placementKey, 0, KEY_READ, &key) != ERROR_SUCCESS)
+    {
+        return entries;
+    }
+
+    std::vector<BYTE> data(sizeof(DWORD) + MaxSlots * sizeof(PersistedPlacement));
+    wchar_t processPath[MAX_PATH + 1]{};
+    DWORD processPathLength = ARRAYSIZE(processPath);
+    DWORD type{};
+    DWORD dataSize = static_cast<DWORD>(data.size());
+    DWORD valueIndex = 0;
+    while (RegEnumValueW(key.get(), valueIndex++, processPath, &processPathLength, nullptr, &type, data.data(), &dataSize) == ERROR_SUCCESS)
+    {
+        if (type == REG_BINARY)
+        {
+            if (auto placements = Unpack(data.data(), dataSize))
+            {
+                entries.push_back({ processPath, std::move(*placements) });
+            }
+        }
+        processPathLength = ARRAYSIZE(processPath);
+        dataSize = static_cast<DWORD>(data.size());
+    }
+    return entries;
+}
+
+void PlacementModel::WriteToRegistry(std::vector<Entry> const& changes) noexcept try
+{
+    wchar_t placementKey[256]{};
+    StringCchPrintf(placementKey, ARRAYSIZE(placementKey), L"%s\\%s", RegistryHelpers::REG_SETTINGS, PlacementSubkey);
+
+    wil::unique_hkey key;
+    if (RegCreateKeyExW(HKEY_CURRENT_USER, placementKey, 0, nullptr, REG_OPTION_NON_VOLATILE, KEY_SET_VALUE, nullptr, &key, nullptr) != ERROR_SUCCESS)
+    {
+        return;
+    }
+
+    for (auto const& change : changes)
+    {
+        if (change.Placements.empty())
+        {
+            RegDeleteValueW(key.get(), change.ProcessPath.c_str());
+        }
+        else
+        {
+            std::vector<BYTE> const data = Pack(change.Placements);
+            RegSetValueExW(key.get(), change.ProcessPath.c_str(), 0, REG_BINARY, data.data(), static_cast<DWORD>(data.size()));
+        }
+    }
+}
+CATCH_LOG();
+
+float PlacementModel::Decayed(Slot const& slot, Time now) const noexcept
+{
+    double const age = static_cast<double>(max(now.count() - slot.Updated, static_cast<int64_t>(0)));
+    return static_cast<float>(slot.Score * std::exp2(-age / m_halfLife));
+}
+
+uint32_t PlacementModel::MonitorId(std::wstring const& monitorKey)
+{
+    auto [iter, inserted] = m_monitorIds.emplace(monitorKey, static_cast<uint32_t>(m_monitors.size()));
+    if (inserted)
+    {
+        m_monitors.push_back(monitorKey);
+    }
+    return iter->second;
+}
+
+PlacementModel::App& PlacementModel::Touch(std::wstring const& processPath)
+{
+    if (auto iter = m_index.find(processPath); iter != m_index.end())
+    {
+        m_lru.splice(m_lru.begin(), m_lru, iter->second);
+        return *iter->second;
+    }
+
+    m_lru.push_front(App{ processPath });
+    m_index.emplace(processPath, m_lru.begin());
+    return m_lru.front();
+}
+
+void PlacementModel::EvictIfNeeded()
+{
+    while (m_lru.size() > m_capacity)
+    {
+        App& evicted = m_lru.back();
+        m_index.erase(evicted.ProcessPath);
+        m_pending.insert(evicted.ProcessPath);
+        m_lru.pop_back();
+    }
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+
+// Learns where each application's windows get snapped, to place its new windows.
+//
+// Every snap is counted against the monitor, the layout and the zone it landed in, and
+// counts decay exponentially so recent habits win over old ones. Each application keeps
+// a fixed handful of slots, so a prediction is a hash lookup and a scan of at most
+// MaxSlots entries. When the exact monitor and layout were never seen, the same layout
+// on another monitor and then any zone that still exists on this monitor are used.
+//
+// Like AppZoneHistory, applications are evicted least recently used first and every
+// change is journaled for the owner to persist in batches. All methods are thread-safe.
+class PlacementModel
+{
+public:
+    using Time = std::chrono::seconds;
+
+    static constexpr inline size_t DefaultCapacity = 1024;
+    static constexpr inline size_t MaxSlots = 8;
+    static constexpr inline Time DefaultHalfLife{ 14 * 24 * 60 * 60 };
+    static constexpr inline float MinScore = 0.5f; // A single snap stops counting after one half-life
+
+    // Where a window is being placed.
+    struct Context
+    {
+        std::wstring MonitorKey;
+        WORD LayoutId{};
+        size_t ZoneCount{};
+    };
+
+    struct Placement
+    {
+        std::wstring MonitorKey;
+        WORD LayoutId{};
+        WORD ZoneCount{};
+        int ZoneIndex{};
+        float Score{}; // As of Updated
+        Time Updated{};
+    };
+
+    struct Entry
+    {
+        std::wstring ProcessPath;
+        std::vector<Placement> Placements; // Empty means the application was removed
+    };
+
+    explicit PlacementModel(size_t capacity = DefaultCapacity, Time halfLife = DefaultHalfLife) noexcept;
+
+    // Replaces the contents without journaling anything. Later entries are treated as more recent.
+    void Load(std::vector<Entry> const& entries);
+
+    void Observe(std::wstring const& processPath, Context const& context, int zoneIndex, Time now);
+
+    // The zone to open a new window of the application in, if it has a habit that fits context.
+    std::optional<int> Predict(std::wstring const& processPath, Context const& context, Time now);
+
+    // Returns the applications changed since the last call, with their current placements.
+    std::vector<Entry> TakePendingChanges();
+
+    size_t Size() const noexcept;
+    bool HasPendingChanges() const noexcept;
+
+    static Time Now() noexcept;
+
+    // One binary value per application under Software\SuperFancyZones\AppPlacement.
+    static std::vector<BYTE> Pack(std::vector<Placement> const& placements);
+    static std::optional<std::vector<Placement>> Unpack(BYTE const* data, size_t size);
+    static std::vector<Entry> ReadFromRegistry();
+    static void WriteToRegistry(std::vector<Entry> const& changes) noexcept;
+
+private:
+    struct Slot
+    {
+        uint32_t Monitor; // Index into m_monitors
+        WORD LayoutId;
+        WORD ZoneCount;
+        WORD ZoneIndex;
+        float Score;
+        int64_t Updated;
+    };
+
+    struct App
+    {
+        std::wstring ProcessPath;
+        std::array<Slot, MaxSlots> Slots;
+        size_t SlotCount{};
+    };
+
+    using LruList = std::list<App>;
+
+    float Decayed(Slot const& slot, Time now) const noexcept;
+    uint32_t MonitorId(std::wstring const& monitorKey);
+    App& Touch(std::wstring const& processPath);
+    void EvictIfNeeded();
+
+    size_t m_capacity;
+    double m_halfLife; // In seconds
+    mutable std::mutex m_lock;
+    LruList m_lru; // Most recently used at the front
+    std::unordered_map<std::wstring, LruList::iterator> m_index;
+    std::unordered_set<std::wstring> m_pending;
+    std::vector<std::wstring> m_monitors; // Monitor keys are shared by every slot
+    std::unordered_map<std::wstring, uint32_t> m_monitorIds;
+};
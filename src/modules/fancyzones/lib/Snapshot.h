@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+// A value that is read far more often than it changes, published as an immutable copy.
+//
+// Load never blocks: readers get a reference to the current copy and keep using it while
+// newer ones are published. Update copies the current value, lets the caller edit the copy
+// and publishes it; updates are serialized with each other, so none of them is lost.
+template<typename T>
+class Snapshot
+{
+public:
+    Snapshot() :
+        m_value(std::make_shared<const T>())
+    {
+    }
+
+    std::shared_ptr<const T> Load() const noexcept
+    {
+        return m_value.load();
+    }
+
+    template<typename Edit>
+    void Update(Edit&& edit)
+    {
+        std::scoped_lock lock(m_updateLock);
+        auto value = std::make_shared<T>(*m_value.load());
+        edit(*value);
+        m_value.store(std::move(value));
+    }
+
+    void Reset(T value = {})
+    {
+        std::scoped_lock lock(m_updateLock);
+        m_value.store(std::make_shared<const T>(std::move(value)));
+    }
+
+private:
+    std::atomic<std::shared_ptr<const T>> m_value;
+    std::mutex m_updateLock;
+};
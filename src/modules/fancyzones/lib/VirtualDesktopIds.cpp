@@ -0,0 +1,93 @@
+#include "pch.h"
+
+#include "VirtualDesktopIds.h"
+
+namespace
+{
+    bool Less(GUID const& a, GUID const& b) noexcept
+    {
+        return memcmp(&a, &b, sizeof(GUID)) < 0;
+    }
+}
+
+VirtualDesktopIds::Diff VirtualDesktopIds::Update(BYTE const* blob, size_t size)
+{
+    size -= size % sizeof(GUID);
+    if ((size == m_lastBlob.size()) && ((size == 0) || (memcmp(blob, m_lastBlob.data(), size) == 0)))
+    {
+        return {};
+    }
+    m_lastBlob.assign(blob, blob + size);
+
+    m_ids.resize(size / sizeof(GUID));
+    if (size != 0)
+    {
+        memcpy(m_ids.data(), blob, size);
+    }
+    std::sort(m_ids.begin(), m_ids.end(), Less);
+    m_ids.erase(std::unique(m_ids.begin(), m_ids.end()), m_ids.end());
+
+    // Merge the sorted ids with the sorted entries, keeping the state of known desktops.
+    Diff diff;
+    m_scratch.clear();
+    m_scratch.reserve(m_ids.size());
+    auto entry = m_entries.begin();
+    for (auto const& id : m_ids)
+    {
+        while ((entry != m_entries.end()) && Less(entry->Id, id))
+        {
+            diff.Removed++;
+            ++entry;
+        }
+
+        if ((entry != m_entries.end()) && (entry->Id == id))
+        {
+            m_scratch.push_back(*entry);
+            ++entry;
+        }
+        else
+        {
+            m_scratch.push_back({ id, true });
+            diff.Added++;
+        }
+    }
+    diff.Removed += std::distance(entry, m_entries.end());
+
+    m_entries.swap(m_scratch);
+    return diff;
+}
+
+bool VirtualDesktopIds::IsNew(GUID const& id) const noexcept
+{
+    auto entry = Find(id);
+    return (entry == m_entries.end()) || entry->New;
+}
+
+void VirtualDesktopIds::MarkVisited(GUID const& id)
+{
+    auto entry = std::lower_bound(m_entries.begin(), m_entries.end(), id, [](Entry const& e, GUID const& value) {
+        return Less(e.Id, value);
+    });
+
+    if ((entry != m_entries.end()) && (entry->Id == id))
+    {
+        entry->New = false;
+    }
+    else
+    {
+        m_entries.insert(entry, { id, false });
+    }
+}
+
+bool VirtualDesktopIds::Contains(GUID const& id) const noexcept
+{
+    return Find(id) != m_entries.end();
+}
+
+std::vector<VirtualDesktopIds::Entry>::const_iterator VirtualDesktopIds::Find(GUID const& id) const noexcept
+{
+    auto entry = std::lower_bound(m_entries.begin(), m_entries.end(), id, [](Entry const& e, GUID const& value) {
+        return Less(e.Id, value);
+    });
+    return ((entry != m_entries.end()) && (entry->Id == id)) ? entry : m_entries.end();
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+
+// The set of virtual desktops Explorer knows about, as persisted in its VirtualDesktopIDs
+// registry blob. The blob is kept from the last update so the common case, a notification
+// for some other value in the key, is a single compare; otherwise the sorted ids are
+// merged against the previous ones so desktops keep their state across updates.
+class VirtualDesktopIds
+{
+public:
+    struct Diff
+    {
+        size_t Added{};
+        size_t Removed{};
+
+        bool Empty() const noexcept { return (Added == 0) && (Removed == 0); }
+    };
+
+    // Replaces the set with the GUIDs in blob. A trailing partial GUID is ignored.
+    Diff Update(BYTE const* blob, size_t size);
+
+    // True for desktops that appeared since the last update and have not been visited yet,
+    // and for desktops the set doesn't know about.
+    bool IsNew(GUID const& id) const noexcept;
+    void MarkVisited(GUID const& id);
+
+    bool Contains(GUID const& id) const noexcept;
+    size_t Size() const noexcept { return m_entries.size(); }
+
+private:
+    struct Entry
+    {
+        GUID Id{};
+        bool New{};
+    };
+
+    std::vector<Entry>::const_iterator Find(GUID const& id) const noexcept;
+
+    std::vector<Entry> m_entries; // Sorted by Id
+    std::vector<Entry> m_scratch; // Reused while merging
+    std::vector<GUID> m_ids; // Reused while parsing
+    std::vector<BYTE> m_lastBlob;
+};
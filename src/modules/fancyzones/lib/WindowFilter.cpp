@@ -0,0 +1,135 @@
+#include "pch.h"
+
+#include "WindowFilter.h"
+
+#include <queue>
+
+ExcludedAppsMatcher::ExcludedAppsMatcher(std::vector<std::wstring> const& patterns)
+{
+    m_nodes.emplace_back();
+
+    // Build the trie.
+    for (auto const& pattern : patterns)
+    {
+        if (pattern.empty())
+        {
+            m_matchesEverything = true;
+            continue;
+        }
+
+        int node = 0;
+        for (wchar_t const ch : pattern)
+        {
+            int next = FindNext(m_nodes[node], ch);
+            if (next == 0)
+            {
+                next = static_cast<int>(m_nodes.size());
+                auto& edges = m_nodes[node].Next;
+                auto position = std::lower_bound(edges.begin(), edges.end(), ch, [](auto const& edge, wchar_t value) {
+                    return edge.first < value;
+                });
+                edges.insert(position, { ch, next });
+                m_nodes.emplace_back();
+            }
+            node = next;
+        }
+        m_nodes[node].Output = true;
+    }
+
+    // Breadth-first pass to compute the fail links. A node's fail link is always
+    // shallower than the node itself, so it is complete by the time it is needed.
+    std::queue<int> pending;
+    for (auto const& [ch, child] : m_nodes[0].Next)
+    {
+        pending.push(child);
+    }
+
+    while (!pending.empty())
+    {
+        int const node = pending.front();
+        pending.pop();
+
+        for (auto const& [ch, child] : m_nodes[node].Next)
+        {
+            int const fail = Step(m_nodes[node].Fail, ch);
+            m_nodes[child].Fail = fail;
+            m_nodes[child].Output |= m_nodes[fail].Output;
+            pending.push(child);
+        }
+    }
+}
+
+bool ExcludedAppsMatcher::Matches(std::wstring_view path) const noexcept
+{
+    if (m_matchesEverything)
+    {
+        return true;
+    }
+
+    if (m_nodes.size() <= 1)
+    {
+        return false;
+    }
+
+    int node = 0;
+    for (wchar_t const ch : path)
+    {
+        node = Step(node, ch);
+        if (m_nodes[node].Output)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+int ExcludedAppsMatcher::Step(int node, wchar_t ch) const noexcept
+{
+    while (true)
+    {
+        if (int const next = FindNext(m_nodes[node], ch); next != 0)
+        {
+            return next;
+        }
+
+        if (node == 0)
+        {
+            return 0;
+        }
+        node = m_nodes[node].Fail;
+    }
+}
+
+int ExcludedAppsMatcher::FindNext(Node const& node, wchar_t ch) noexcept
+{
+    auto position = std::lower_bound(node.Next.begin(), node.Next.end(), ch, [](auto const& edge, wchar_t value) {
+        return edge.first < value;
+    });
+    return ((position != node.Next.end()) && (position->first == ch)) ? position->second : 0;
+}
+
+std::optional<bool> WindowVerdictCache::Get(HWND window, DWORD pid) const noexcept
+{
+    auto iter = m_verdicts.find(window);
+    if ((iter == m_verdicts.end()) || (iter->second.Pid != pid))
+    {
+        return std::nullopt;
+    }
+    return iter->second.Interesting;
+}
+
+void WindowVerdictCache::Set(HWND window, DWORD pid, bool interesting)
+{
+    // Destroy notifications can be missed (e.g. while the module is disabled), so keep
+    // the cache bounded rather than trusting invalidation alone.
+    if ((m_verdicts.size() >= m_capacity) && (m_verdicts.find(window) == m_verdicts.end()))
+    {
+        m_verdicts.clear();
+    }
+    m_verdicts[window] = { pid, interesting };
+}
+
+void WindowVerdictCache::Invalidate(HWND window) noexcept
+{
+    m_verdicts.erase(window);
+}
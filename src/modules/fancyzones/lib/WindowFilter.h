@@ -0,0 +1,69 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Matches process paths against the user's excluded apps list.
+//
+// The patterns are compiled into an Aho-Corasick automaton so a path is scanned once
+// regardless of how many apps are excluded. Both the patterns and the paths passed to
+// Matches are expected to be upper-cased already (Settings stores excludedAppsArray
+// that way).
+class ExcludedAppsMatcher
+{
+public:
+    ExcludedAppsMatcher() noexcept = default;
+    explicit ExcludedAppsMatcher(std::vector<std::wstring> const& patterns);
+
+    // True if any pattern occurs as a substring of path.
+    bool Matches(std::wstring_view path) const noexcept;
+    bool Empty() const noexcept { return !m_matchesEverything && (m_nodes.size() <= 1); }
+
+private:
+    struct Node
+    {
+        std::vector<std::pair<wchar_t, int>> Next; // Sorted by character
+        int Fail{};
+        bool Output{}; // A pattern ends here or at any node on the fail chain
+    };
+
+    int Step(int node, wchar_t ch) const noexcept;
+    static int FindNext(Node const& node, wchar_t ch) noexcept;
+
+    std::vector<Node> m_nodes;
+    bool m_matchesEverything{}; // An empty pattern matches any path
+};
+
+// Remembers whether a window passed the excluded apps check, keyed by HWND and owning
+// process id so a recycled handle in another process is never mistaken for a cached one.
+// Entries must be invalidated when the window is destroyed; the whole cache is cleared
+// when the exclusion list changes or it grows past its capacity.
+class WindowVerdictCache
+{
+public:
+    static constexpr inline size_t DefaultCapacity = 4096;
+
+    explicit WindowVerdictCache(size_t capacity = DefaultCapacity) noexcept :
+        m_capacity(capacity)
+    {
+    }
+
+    std::optional<bool> Get(HWND window, DWORD pid) const noexcept;
+    void Set(HWND window, DWORD pid, bool interesting);
+    void Invalidate(HWND window) noexcept;
+    void Clear() noexcept { m_verdicts.clear(); }
+    size_t Size() const noexcept { return m_verdicts.size(); }
+
+private:
+    struct Verdict
+    {
+        DWORD Pid;
+        bool Interesting;
+    };
+
+    size_t m_capacity;
+    std::unordered_map<HWND, Verdict> m_verdicts;
+};
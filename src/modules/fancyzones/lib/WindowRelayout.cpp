@@ -0,0 +1,379 @@
+#include "pch.h"
+
+#include <common/dpi_aware.h>
+#include "WindowRelayout.h"
+
+namespace
+{
+    class DesktopWindows : public WindowRelayout::WindowSystem
+    {
+    public:
+        bool IsWindowVisible(HWND window) override
+        {
+            return ::IsWindowVisible(window);
+        }
+
+        RECT GetWindowRect(HWND window) override
+        {
+            RECT rect{};
+            ::GetWindowRect(window, &rect);
+            return rect;
+        }
+
+        std::optional<RECT> GetFrameBounds(HWND window) override
+        {
+            RECT rect{};
+            if (SUCCEEDED(DwmGetWindowAttribute(window, DWMWA_EXTENDED_FRAME_BOUNDS, &rect, sizeof(rect))))
+            {
+                return rect;
+            }
+            return std::nullopt;
+        }
+
+        bool IsDpiUnaware(HWND window) override
+        {
+            return DPIAware::GetAwarenessLevel(GetWindowDpiAwarenessContext(window)) < DPIAware::PER_MONITOR_AWARE;
+        }
+
+        WINDOWPLACEMENT GetWindowPlacement(HWND window) override
+        {
+            WINDOWPLACEMENT placement{ sizeof(placement) };
+            ::GetWindowPlacement(window, &placement);
+            return placement;
+        }
+
+        RECT MapToScreen(HWND zoneWindow, RECT const& rect) override
+        {
+            RECT mapped = rect;
+            MapWindowRect(zoneWindow, nullptr, &mapped);
+            return mapped;
+        }
+
+        HMONITOR MonitorFromWindow(HWND window) override
+        {
+            return ::MonitorFromWindow(window, MONITOR_DEFAULTTONEAREST);
+        }
+
+        std::optional<MONITORINFO> GetMonitorInfo(HMONITOR monitor) override
+        {
+            MONITORINFO mi{ sizeof(mi) };
+            if (GetMonitorInfoW(monitor, &mi))
+            {
+                return mi;
+            }
+            return std::nullopt;
+        }
+
+        bool CanDeferMove(HWND window) override
+        {
+            if (IsHungAppWindow(window))
+            {
+                return false;
+            }
+
+            // The shell cloaks the windows of other virtual desktops.
+            DWORD cloaked{};
+            if (SUCCEEDED(DwmGetWindowAttribute(window, DWMWA_CLOAKED, &cloaked, sizeof(cloaked))) && cloaked)
+            {
+                return false;
+            }
+
+            DWORD processId{};
+            GetWindowThreadProcessId(window, &processId);
+            if (processId == GetCurrentProcessId())
+            {
+                return true;
+            }
+            wil::unique_handle process{ OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId) };
+            auto const integrityLevel = process ? IntegrityLevelOf(process.get()) : std::nullopt;
+            return integrityLevel && (*integrityLevel <= OwnIntegrityLevel());
+        }
+
+        bool DeferMoves(std::vector<WindowRelayout::Target const*> const& batch) override
+        {
+            // DeferWindowPos frees the batch on failure, in which case nothing has moved yet.
+            HDWP deferred = BeginDeferWindowPos(static_cast<int>(batch.size()));
+            for (auto target : batch)
+            {
+                if (!deferred)
+                {
+                    break;
+                }
+
+                RECT const& rect = target->ScreenRect;
+                deferred = DeferWindowPos(deferred, target->Window, nullptr, rect.left, rect.top, rect.right - rect.left, rect.bottom - rect.top,
+                    SWP_NOZORDER | SWP_NOOWNERZORDER | SWP_NOACTIVATE);
+            }
+            return deferred && EndDeferWindowPos(deferred);
+        }
+
+        bool SetWindowPlacement(HWND window, WINDOWPLACEMENT const& placement) override
+        {
+            return ::SetWindowPlacement(window, &placement);
+        }
+
+        WindowRelayout::GeometryCache* Cache() override
+        {
+            return &WindowRelayout::DesktopGeometryCache();
+        }
+
+    private:
+        static std::optional<DWORD> IntegrityLevelOf(HANDLE process) noexcept
+        {
+            wil::unique_handle token;
+            if (!OpenProcessToken(process, TOKEN_QUERY, &token))
+            {
+                return std::nullopt;
+            }
+
+            DWORD size{};
+            GetTokenInformation(token.get(), TokenIntegrityLevel, nullptr, 0, &size);
+            std::vector<BYTE> buffer(size);
+            if (buffer.empty() || !GetTokenInformation(token.get(), TokenIntegrityLevel, buffer.data(), size, &size))
+            {
+                return std::nullopt;
+            }
+
+            auto const label = reinterpret_cast<TOKEN_MANDATORY_LABEL const*>(buffer.data());
+            return *GetSidSubAuthority(label->Label.Sid, *GetSidSubAuthorityCount(label->Label.Sid) - 1);
+        }
+
+        static DWORD OwnIntegrityLevel() noexcept
+        {
+            static DWORD const level = IntegrityLevelOf(GetCurrentProcess()).value_or(SECURITY_MANDATORY_MEDIUM_RID);
+            return level;
+        }
+    };
+
+    bool IsRestored(WINDOWPLACEMENT const& placement) noexcept
+    {
+        return placement.showCmd == (SW_RESTORE | SW_SHOWNA);
+    }
+}
+
+namespace WindowRelayout
+{
+    WindowSystem& DesktopWindowSystem() noexcept
+    {
+        static DesktopWindows desktop;
+        return desktop;
+    }
+
+    GeometryCache& DesktopGeometryCache() noexcept
+    {
+        static GeometryCache cache;
+        return cache;
+    }
+
+    FrameMargins MarginsOf(RECT const& windowRect, std::optional<RECT> const& frameRect) noexcept
+    {
+        if (!frameRect)
+        {
+            return {};
+        }
+        return { frameRect->left - windowRect.left, windowRect.right - frameRect->right, windowRect.bottom - frameRect->bottom };
+    }
+
+    POINT WorkspaceOffset(std::optional<MONITORINFO> const& monitorInfo) noexcept
+    {
+        if (!monitorInfo)
+        {
+            return {};
+        }
+        return { std::abs(monitorInfo->rcMonitor.left - monitorInfo->rcWork.left), std::abs(monitorInfo->rcMonitor.top - monitorInfo->rcWork.top) };
+    }
+
+    RECT FitToZone(RECT const& zoneRect, FrameMargins const& margins, std::optional<MONITORINFO> const& monitorInfo, bool dpiUnaware) noexcept
+    {
+        POINT const offset = WorkspaceOffset(monitorInfo);
+        RECT normalRect{ zoneRect.left - margins.Left - offset.x, zoneRect.top - offset.y,
+                         zoneRect.right + margins.Right - offset.x, zoneRect.bottom + margins.Bottom - offset.y };
+        if (monitorInfo && dpiUnaware)
+        {
+            normalRect.left = max(monitorInfo->rcMonitor.left, normalRect.left);
+            normalRect.right = min(monitorInfo->rcMonitor.right - offset.x, normalRect.right);
+            normalRect.top = max(monitorInfo->rcMonitor.top, normalRect.top);
+            normalRect.bottom = min(monitorInfo->rcMonitor.bottom - offset.y, normalRect.bottom);
+        }
+        return normalRect;
+    }
+
+    std::optional<GeometryCache::Window> GeometryCache::FindWindow(HWND window, HMONITOR monitor) const
+    {
+        std::scoped_lock lock(m_lock);
+        auto iter = m_windows.find(window);
+        if ((iter == m_windows.end()) || (iter->second.Monitor != monitor))
+        {
+            return std::nullopt;
+        }
+        return iter->second;
+    }
+
+    void GeometryCache::SetWindow(HWND window, Window const& geometry)
+    {
+        std::scoped_lock lock(m_lock);
+        m_windows[window] = geometry;
+    }
+
+    void GeometryCache::InvalidateWindow(HWND window) noexcept
+    {
+        std::scoped_lock lock(m_lock);
+        m_windows.erase(window);
+    }
+
+    std::optional<std::optional<MONITORINFO>> GeometryCache::FindMonitorInfo(HMONITOR monitor) const
+    {
+        std::scoped_lock lock(m_lock);
+        auto iter = m_monitorInfo.find(monitor);
+        if (iter == m_monitorInfo.end())
+        {
+            return std::nullopt;
+        }
+        return iter->second;
+    }
+
+    void GeometryCache::SetMonitorInfo(HMONITOR monitor, std::optional<MONITORINFO> const& monitorInfo)
+    {
+        std::scoped_lock lock(m_lock);
+        m_monitorInfo[monitor] = monitorInfo;
+    }
+
+    void GeometryCache::Clear() noexcept
+    {
+        std::scoped_lock lock(m_lock);
+        m_windows.clear();
+        m_monitorInfo.clear();
+    }
+
+    size_t GeometryCache::WindowCount() const noexcept
+    {
+        std::scoped_lock lock(m_lock);
+        return m_windows.size();
+    }
+
+    Target ComputeTarget(HWND window, RECT const& zoneRect, FrameMargins const& margins,
+        std::optional<MONITORINFO> const& monitorInfo, bool dpiUnaware, WINDOWPLACEMENT placement) noexcept
+    {
+        RECT const normalRect = FitToZone(zoneRect, margins, monitorInfo, dpiUnaware);
+        POINT const offset = WorkspaceOffset(monitorInfo);
+
+        Target target;
+        target.Window = window;
+        target.ScreenRect = { normalRect.left + offset.x, normalRect.top + offset.y, normalRect.right + offset.x, normalRect.bottom + offset.y };
+        target.Placement = placement;
+        target.Placement.rcNormalPosition = normalRect;
+        target.Placement.flags |= WPF_ASYNCWINDOWPLACEMENT;
+        // Do not restore minimized windows. We change their placement though so they restore to the correct zone.
+        if ((placement.showCmd & SW_SHOWMINIMIZED) == 0)
+        {
+            target.Placement.showCmd = SW_RESTORE | SW_SHOWNA;
+        }
+        return target;
+    }
+
+    void Planner::Add(HWND window, HWND zoneWindow, RECT const& zoneRect)
+    {
+        if (!m_system.IsWindowVisible(window))
+        {
+            return;
+        }
+
+        HMONITOR const monitor = MonitorFor(zoneWindow);
+        WINDOWPLACEMENT const placement = m_system.GetWindowPlacement(window);
+        GeometryCache::Window const geometry = GeometryOf(window, monitor, placement);
+        Target target = ComputeTarget(
+            window,
+            m_system.MapToScreen(zoneWindow, zoneRect),
+            geometry.Margins,
+            MonitorInfoFor(monitor),
+            geometry.DpiUnaware,
+            placement);
+
+        auto existing = std::find_if(m_targets.begin(), m_targets.end(), [&](Target const& planned) { return planned.Window == window; });
+        if (existing != m_targets.end())
+        {
+            *existing = target;
+        }
+        else
+        {
+            m_targets.push_back(target);
+        }
+    }
+
+    void Planner::Apply() noexcept try
+    {
+        std::vector<Target const*> batch;
+        for (auto const& target : m_targets)
+        {
+            if ((m_targets.size() > 1) && IsRestored(target.Placement) && m_system.CanDeferMove(target.Window))
+            {
+                batch.push_back(&target);
+            }
+            else
+            {
+                m_system.SetWindowPlacement(target.Window, target.Placement);
+            }
+        }
+
+        if (!batch.empty() && !m_system.DeferMoves(batch))
+        {
+            for (auto target : batch)
+            {
+                m_system.SetWindowPlacement(target->Window, target->Placement);
+            }
+        }
+    }
+    CATCH_LOG();
+
+    HMONITOR Planner::MonitorFor(HWND zoneWindow)
+    {
+        auto monitor = m_zoneWindowMonitors.find(zoneWindow);
+        if (monitor == m_zoneWindowMonitors.end())
+        {
+            monitor = m_zoneWindowMonitors.emplace(zoneWindow, m_system.MonitorFromWindow(zoneWindow)).first;
+        }
+        return monitor->second;
+    }
+
+    std::optional<MONITORINFO> const& Planner::MonitorInfoFor(HMONITOR monitor)
+    {
+        auto info = m_monitorInfo.find(monitor);
+        if (info == m_monitorInfo.end())
+        {
+            auto cached = m_cache ? m_cache->FindMonitorInfo(monitor) : std::nullopt;
+            if (!cached)
+            {
+                cached.emplace(m_system.GetMonitorInfo(monitor));
+                if (m_cache)
+                {
+                    m_cache->SetMonitorInfo(monitor, *cached);
+                }
+            }
+            info = m_monitorInfo.emplace(monitor, std::move(*cached)).first;
+        }
+        return info->second;
+    }
+
+    GeometryCache::Window Planner::GeometryOf(HWND window, HMONITOR monitor, WINDOWPLACEMENT const& placement)
+    {
+        if (m_cache)
+        {
+            if (auto cached = m_cache->FindWindow(window, monitor))
+            {
+                return *cached;
+            }
+        }
+
+        GeometryCache::Window geometry;
+        geometry.Margins = MarginsOf(m_system.GetWindowRect(window), m_system.GetFrameBounds(window));
+        geometry.DpiUnaware = m_system.IsDpiUnaware(window);
+
+        // The frame of a minimized window says nothing about its restored one.
+        if (m_cache && ((placement.showCmd & SW_SHOWMINIMIZED) == 0))
+        {
+            geometry.Monitor = m_system.MonitorFromWindow(window);
+            m_cache->SetWindow(window, geometry);
+        }
+        return geometry;
+    }
+}
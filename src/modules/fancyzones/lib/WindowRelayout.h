@@ -0,0 +1,151 @@
+#pragma once
+
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+// Moving windows into zones is split into planning and applying. The planner computes
+// every target rect up front, querying each monitor only once; Apply then moves all
+// windows in a single deferred batch so a relayout of many windows lands at once
+// instead of rippling across the screen one window at a time.
+namespace WindowRelayout
+{
+    class GeometryCache;
+    struct Target;
+
+    // The window manager calls the planner depends on, so it can be driven by a fake in tests.
+    class WindowSystem
+    {
+    public:
+        virtual ~WindowSystem() = default;
+
+        virtual bool IsWindowVisible(HWND window) = 0;
+        virtual RECT GetWindowRect(HWND window) = 0;
+        virtual std::optional<RECT> GetFrameBounds(HWND window) = 0; // DWM extended frame bounds
+        virtual bool IsDpiUnaware(HWND window) = 0;
+        virtual WINDOWPLACEMENT GetWindowPlacement(HWND window) = 0;
+        virtual RECT MapToScreen(HWND zoneWindow, RECT const& rect) = 0;
+        virtual HMONITOR MonitorFromWindow(HWND window) = 0;
+        virtual std::optional<MONITORINFO> GetMonitorInfo(HMONITOR monitor) = 0;
+
+        // EndDeferWindowPos moves the windows of other threads synchronously, so a batch waits
+        // on every window in it. Only windows that answer messages, are on the current virtual
+        // desktop and are within reach of UIPI may join one.
+        virtual bool CanDeferMove(HWND window) = 0;
+        // Moves every target to its screen rect at once. False if the batch failed, in which
+        // case nothing has moved.
+        virtual bool DeferMoves(std::vector<Target const*> const& batch) = 0;
+        virtual bool SetWindowPlacement(HWND window, WINDOWPLACEMENT const& placement) = 0;
+
+        // Geometry kept across planners, if any.
+        virtual GeometryCache* Cache() { return nullptr; }
+    };
+
+    // The real desktop.
+    WindowSystem& DesktopWindowSystem() noexcept;
+
+    // How far the invisible resize borders reach out of the visible frame. There is none
+    // above the caption.
+    struct FrameMargins
+    {
+        LONG Left{};
+        LONG Right{};
+        LONG Bottom{};
+
+        bool operator==(FrameMargins const& other) const noexcept
+        {
+            return (Left == other.Left) && (Right == other.Right) && (Bottom == other.Bottom);
+        }
+    };
+
+    FrameMargins MarginsOf(RECT const& windowRect, std::optional<RECT> const& frameRect) noexcept;
+
+    // Placements are in workspace coordinates, which exclude a taskbar on the left or top.
+    POINT WorkspaceOffset(std::optional<MONITORINFO> const& monitorInfo) noexcept;
+
+    // The normal rect, in workspace coordinates, of a window filling a zone given in screen
+    // coordinates: the zone grown by the margins, and for windows that are not per-monitor
+    // dpi aware kept within the monitor so Windows doesn't rescale them onto another one.
+    RECT FitToZone(RECT const& zoneRect, FrameMargins const& margins, std::optional<MONITORINFO> const& monitorInfo, bool dpiUnaware) noexcept;
+
+    // Frame margins and dpi awareness of windows, and the monitor info they are snapped on,
+    // kept across relayouts. Margins only change when a window changes dpi, so an entry is
+    // only used while the window is snapped on the monitor it was measured on. Owners drop
+    // windows as they are destroyed or dragged, and everything when the displays change.
+    // All methods are thread-safe.
+    class GeometryCache
+    {
+    public:
+        struct Window
+        {
+            FrameMargins Margins;
+            bool DpiUnaware{};
+            HMONITOR Monitor{}; // Where the margins were measured
+        };
+
+        std::optional<Window> FindWindow(HWND window, HMONITOR monitor) const;
+        void SetWindow(HWND window, Window const& geometry);
+        void InvalidateWindow(HWND window) noexcept;
+
+        std::optional<std::optional<MONITORINFO>> FindMonitorInfo(HMONITOR monitor) const;
+        void SetMonitorInfo(HMONITOR monitor, std::optional<MONITORINFO> const& monitorInfo);
+
+        void Clear() noexcept;
+        size_t WindowCount() const noexcept;
+
+    private:
+        mutable std::mutex m_lock;
+        std::unordered_map<HWND, Window> m_windows;
+        std::unordered_map<HMONITOR, std::optional<MONITORINFO>> m_monitorInfo;
+    };
+
+    // The cache of DesktopWindowSystem.
+    GeometryCache& DesktopGeometryCache() noexcept;
+
+    struct Target
+    {
+        HWND Window{};
+        RECT ScreenRect{}; // Where the window goes, in screen coordinates
+        WINDOWPLACEMENT Placement{}; // Same rect as the normal position, in workspace coordinates
+    };
+
+    // Computes where a window goes for a zone rect that is already in screen coordinates.
+    // The zone is grown by the invisible resize borders so the visible frame lines up
+    // with the zone, then converted to workspace coordinates for the placement.
+    Target ComputeTarget(HWND window, RECT const& zoneRect, FrameMargins const& margins,
+        std::optional<MONITORINFO> const& monitorInfo, bool dpiUnaware, WINDOWPLACEMENT placement) noexcept;
+
+    class Planner
+    {
+    public:
+        explicit Planner(WindowSystem& system = DesktopWindowSystem()) noexcept :
+            m_system(system),
+            m_cache(system.Cache())
+        {
+        }
+
+        // Plans moving window into zoneRect, given in zoneWindow client coordinates.
+        // Invisible windows are skipped; planning the same window again replaces its target.
+        void Add(HWND window, HWND zoneWindow, RECT const& zoneRect);
+
+        std::vector<Target> const& Targets() const noexcept { return m_targets; }
+
+        // Moves every planned window. Restored windows are moved in one DeferWindowPos
+        // batch; minimized and maximized windows, single moves and windows that can't join
+        // a batch go through an asynchronous SetWindowPlacement so they restore into their
+        // zone and a hung window can't stall the rest.
+        void Apply() noexcept;
+
+    private:
+        HMONITOR MonitorFor(HWND zoneWindow);
+        std::optional<MONITORINFO> const& MonitorInfoFor(HMONITOR monitor);
+        GeometryCache::Window GeometryOf(HWND window, HMONITOR monitor, WINDOWPLACEMENT const& placement);
+
+        WindowSystem& m_system;
+        GeometryCache* m_cache;
+        std::unordered_map<HWND, HMONITOR> m_zoneWindowMonitors;
+        std::unordered_map<HMONITOR, std::optional<MONITORINFO>> m_monitorInfo;
+        std::vector<Target> m_targets;
+    };
+}
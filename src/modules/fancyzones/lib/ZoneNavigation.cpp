@@ -0,0 +1,166 @@
+#include "pch.h"
+
+#include "ZoneNavigation.h"
+
+#include <tuple>
+
+namespace
+{
+    using ZoneNavigation::Direction;
+
+    constexpr std::array<Direction, 4> Directions{ Direction::Left, Direction::Up, Direction::Right, Direction::Down };
+
+    // A rect turned so that direction points along the positive axis. Coordinates are
+    // doubled where centers are needed so everything stays in integers.
+    struct Extent
+    {
+        LONGLONG Near{};
+        LONGLONG Far{};
+        LONGLONG Low{}; // Perpendicular extent
+        LONGLONG High{};
+
+        LONGLONG Center() const noexcept { return Near + Far; }
+        LONGLONG CrossCenter() const noexcept { return Low + High; }
+    };
+
+    Extent ExtentOf(RECT const& rect, Direction direction) noexcept
+    {
+        switch (direction)
+        {
+        case Direction::Left:
+            return { -static_cast<LONGLONG>(rect.right), -static_cast<LONGLONG>(rect.left), rect.top, rect.bottom };
+        case Direction::Up:
+            return { -static_cast<LONGLONG>(rect.bottom), -static_cast<LONGLONG>(rect.top), rect.left, rect.right };
+        case Direction::Right:
+            return { rect.left, rect.right, rect.top, rect.bottom };
+        default:
+            return { rect.top, rect.bottom, rect.left, rect.right };
+        }
+    }
+
+    bool Aligned(Extent const& from, Extent const& to) noexcept
+    {
+        return (std::min)(from.High, to.High) > (std::max)(from.Low, to.Low);
+    }
+
+    int FindNeighbor(std::vector<ZoneNavigation::Node> const& nodes, size_t node, Direction direction)
+    {
+        Extent const from = ExtentOf(nodes[node].Rect, direction);
+
+        // Lower is better: lined-up zones first, then the smallest gap, then the
+        // zone closest to the perpendicular center, then the closest center.
+        using Score = std::tuple<bool, LONGLONG, LONGLONG, LONGLONG, size_t>;
+        std::optional<Score> best;
+        for (size_t i = 0; i < nodes.size(); i++)
+        {
+            Extent const to = ExtentOf(nodes[i].Rect, direction);
+            if ((i == node) || (to.Center() <= from.Center()) || (to.Far <= from.Far))
+            {
+                continue;
+            }
+
+            Score const score{
+                !Aligned(from, to),
+                (std::max)(0LL, to.Near - from.Far),
+                std::abs(to.CrossCenter() - from.CrossCenter()),
+                to.Center() - from.Center(),
+                i
+            };
+            if (!best || (score < *best))
+            {
+                best = score;
+            }
+        }
+
+        if (best)
+        {
+            return static_cast<int>(std::get<4>(*best));
+        }
+
+        // Nothing further that way; wrap to the furthest lined-up zone on the same monitor.
+        std::optional<std::tuple<LONGLONG, LONGLONG, size_t>> wrap;
+        for (size_t i = 0; i < nodes.size(); i++)
+        {
+            Extent const to = ExtentOf(nodes[i].Rect, direction);
+            if ((i == node) || (nodes[i].Group != nodes[node].Group) || !Aligned(from, to) || (to.Center() >= from.Center()))
+            {
+                continue;
+            }
+
+            std::tuple<LONGLONG, LONGLONG, size_t> const score{ to.Center(), std::abs(to.CrossCenter() - from.CrossCenter()), i };
+            if (!wrap || (score < *wrap))
+            {
+                wrap = score;
+            }
+        }
+        return wrap ? static_cast<int>(std::get<2>(*wrap)) : ZoneNavigation::None;
+    }
+}
+
+namespace ZoneNavigation
+{
+    std::optional<Direction> DirectionFromKey(DWORD vkCode) noexcept
+    {
+        switch (vkCode)
+        {
+        case VK_LEFT:
+            return Direction::Left;
+        case VK_UP:
+            return Direction::Up;
+        case VK_RIGHT:
+            return Direction::Right;
+        case VK_DOWN:
+            return Direction::Down;
+        default:
+            return std::nullopt;
+        }
+    }
+
+    Graph::Graph(std::vector<Node> const& nodes)
+    {
+        m_neighbors.resize(nodes.size());
+        for (size_t node = 0; node < nodes.size(); node++)
+        {
+            for (auto direction : Directions)
+            {
+                m_neighbors[node][static_cast<size_t>(direction)] = FindNeighbor(nodes, node, direction);
+            }
+
+            size_t const group = nodes[node].Group;
+            if (group >= m_entries.size())
+            {
+                std::array<int, 4> none;
+                none.fill(None);
+                m_entries.resize(group + 1, none);
+            }
+
+            // Enter from the edge the direction points away from, reading order for ties.
+            for (auto direction : Directions)
+            {
+                int& entry = m_entries[group][static_cast<size_t>(direction)];
+                Extent const candidate = ExtentOf(nodes[node].Rect, direction);
+                if (entry == None)
+                {
+                    entry = static_cast<int>(node);
+                    continue;
+                }
+
+                Extent const current = ExtentOf(nodes[entry].Rect, direction);
+                if (std::make_tuple(candidate.Center(), candidate.CrossCenter()) < std::make_tuple(current.Center(), current.CrossCenter()))
+                {
+                    entry = static_cast<int>(node);
+                }
+            }
+        }
+    }
+
+    int Graph::Neighbor(size_t node, Direction direction) const noexcept
+    {
+        return (node < m_neighbors.size()) ? m_neighbors[node][static_cast<size_t>(direction)] : None;
+    }
+
+    int Graph::Entry(size_t group, Direction direction) const noexcept
+    {
+        return (group < m_entries.size()) ? m_entries[group][static_cast<size_t>(direction)] : None;
+    }
+}
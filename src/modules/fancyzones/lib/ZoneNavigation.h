@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <optional>
+#include <vector>
+
+// Moves between zones by geometry rather than by zone index. The graph holds the
+// nearest zone in each direction for every zone on every monitor, so it is built
+// once per layout change and each Win+Arrow press is a single lookup.
+namespace ZoneNavigation
+{
+    enum class Direction
+    {
+        Left,
+        Up,
+        Right,
+        Down
+    };
+
+    constexpr int None = -1;
+
+    std::optional<Direction> DirectionFromKey(DWORD vkCode) noexcept;
+
+    struct Node
+    {
+        RECT Rect{}; // In screen coordinates, so zones on different monitors can be compared
+        size_t Group{}; // Monitor the zone belongs to; groups are numbered from 0
+    };
+
+    class Graph
+    {
+    public:
+        Graph() = default;
+        explicit Graph(std::vector<Node> const& nodes);
+
+        // The closest zone beyond node in direction, preferring zones that line up with it.
+        // When there is none, wraps around to the far side of the node's own monitor.
+        int Neighbor(size_t node, Direction direction) const noexcept;
+
+        // The zone a window that is not in a zone enters first: the leftmost zone for
+        // Right, the topmost zone for Down, and so on.
+        int Entry(size_t group, Direction direction) const noexcept;
+
+        size_t Size() const noexcept { return m_neighbors.size(); }
+
+    private:
+        std::vector<std::array<int, 4>> m_neighbors;
+        std::vector<std::array<int, 4>> m_entries;
+    };
+}
@@ -0,0 +1,123 @@
+#include "pch.h"
+
+#include "ZoneRasterizer.h"
+
+#include <emmintrin.h>
+
+namespace
+{
+    bool ClipToSurface(ArgbSurface const& surface, RECT const& rect, RECT& clipped) noexcept
+    {
+        if (!surface.bits)
+        {
+            return false;
+        }
+
+        clipped.left = max(rect.left, 0L);
+        clipped.top = max(rect.top, 0L);
+        clipped.right = min(rect.right, static_cast<LONG>(surface.width));
+        clipped.bottom = min(rect.bottom, static_cast<LONG>(surface.height));
+        return (clipped.left < clipped.right) && (clipped.top < clipped.bottom);
+    }
+
+    // (value * scale) / 255 rounded to nearest, exact for 8-bit inputs. The SSE2 path below
+    // performs the same arithmetic on 16-bit lanes so both paths produce identical pixels.
+    inline UINT32 ScaleChannel(UINT32 value, UINT32 scale) noexcept
+    {
+        UINT32 const product = value * scale + 128;
+        return (product + (product >> 8)) >> 8;
+    }
+
+    inline UINT32 BlendPixel(UINT32 dst, UINT32 src, UINT32 inverseAlpha) noexcept
+    {
+        UINT32 result = 0;
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            UINT32 const channel = ((src >> shift) & 0xFF) + ScaleChannel((dst >> shift) & 0xFF, inverseAlpha);
+            result |= min(channel, 255u) << shift;
+        }
+        return result;
+    }
+}
+
+namespace ZoneRasterizer
+{
+    UINT32 PremultipliedColor(BYTE alpha, COLORREF color) noexcept
+    {
+        UINT32 const red = GetRValue(color) * alpha / 255;
+        UINT32 const green = GetGValue(color) * alpha / 255;
+        UINT32 const blue = GetBValue(color) * alpha / 255;
+        return (static_cast<UINT32>(alpha) << 24) | (red << 16) | (green << 8) | blue;
+    }
+
+    void FillRect(ArgbSurface const& surface, RECT const& rect, UINT32 pixel) noexcept
+    {
+        RECT clipped;
+        if (!ClipToSurface(surface, rect, clipped))
+        {
+            return;
+        }
+
+        int const width = clipped.right - clipped.left;
+        __m128i const fill = _mm_set1_epi32(static_cast<int>(pixel));
+        for (LONG y = clipped.top; y < clipped.bottom; y++)
+        {
+            UINT32* row = surface.bits + static_cast<size_t>(y) * surface.stride + clipped.left;
+            int x = 0;
+            for (; x + 4 <= width; x += 4)
+            {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(row + x), fill);
+            }
+            for (; x < width; x++)
+            {
+                row[x] = pixel;
+            }
+        }
+    }
+
+    void BlendRect(ArgbSurface const& surface, RECT const& rect, UINT32 pixel) noexcept
+    {
+        UINT32 const alpha = pixel >> 24;
+        if (alpha == 255)
+        {
+            FillRect(surface, rect, pixel);
+            return;
+        }
+
+        RECT clipped;
+        if ((pixel == 0) || !ClipToSurface(surface, rect, clipped))
+        {
+            return;
+        }
+
+        int const width = clipped.right - clipped.left;
+        UINT32 const inverseAlpha = 255 - alpha;
+        __m128i const zero = _mm_setzero_si128();
+        __m128i const source = _mm_set1_epi32(static_cast<int>(pixel));
+        __m128i const scale = _mm_set1_epi16(static_cast<short>(inverseAlpha));
+        __m128i const bias = _mm_set1_epi16(128);
+
+        auto scaleLanes = [&](__m128i lanes) noexcept {
+            __m128i const product = _mm_add_epi16(_mm_mullo_epi16(lanes, scale), bias);
+            return _mm_srli_epi16(_mm_add_epi16(product, _mm_srli_epi16(product, 8)), 8);
+        };
+
+        for (LONG y = clipped.top; y < clipped.bottom; y++)
+        {
+            UINT32* row = surface.bits + static_cast<size_t>(y) * surface.stride + clipped.left;
+            int x = 0;
+            for (; x + 4 <= width; x += 4)
+            {
+                __m128i const dst = _mm_loadu_si128(reinterpret_cast<__m128i const*>(row + x));
+                __m128i const low = scaleLanes(_mm_unpacklo_epi8(dst, zero));
+                __m128i const high = scaleLanes(_mm_unpackhi_epi8(dst, zero));
+                __m128i const result = _mm_adds_epu8(source, _mm_packus_epi16(low, high));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(row + x), result);
+            }
+            for (; x < width; x++)
+            {
+                row[x] = BlendPixel(row[x], pixel, inverseAlpha);
+            }
+        }
+    }
+}
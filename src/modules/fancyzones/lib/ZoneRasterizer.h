@@ -0,0 +1,26 @@
+#pragma once
+
+// Premultiplied 32bpp BGRA pixel buffer, as returned by GetBufferedPaintBits for a
+// BPBF_TOPDOWNDIB paint buffer. stride is expressed in pixels, not bytes.
+struct ArgbSurface
+{
+    UINT32* bits{};
+    int width{};
+    int height{};
+    int stride{};
+};
+
+// Draws the zone overlay directly into the paint buffer instead of issuing one
+// StretchDIBits/GdiAlphaBlend call per rectangle. All rectangles are clipped to
+// the surface bounds.
+namespace ZoneRasterizer
+{
+    // Same rounding as the GDI path it replaces: each channel is scaled by alpha / 255.
+    UINT32 PremultipliedColor(BYTE alpha, COLORREF color) noexcept;
+
+    // Overwrites the pixels inside rect with the premultiplied color.
+    void FillRect(ArgbSurface const& surface, RECT const& rect, UINT32 pixel) noexcept;
+
+    // Composites the premultiplied color over the pixels inside rect (AC_SRC_OVER).
+    void BlendRect(ArgbSurface const& surface, RECT const& rect, UINT32 pixel) noexcept;
+}
@@ -1,7 +1,16 @@
 #include "pch.h"
 
 #include "lib/ZoneSet.h"
-#include "lib/RegistryHelpers.h"
+#include "lib/ZoneSetStore.h"
+
+namespace
+{
+    UINT NextRevision() noexcept
+    {
+        static std::atomic<UINT> revision{};
+        return ++revision;
+    }
+}
 
 struct ZoneSet : winrt::implements<ZoneSet, IZoneSet>
 {
@@ -18,25 +27,30 @@ public:
 
     IFACEMETHODIMP_(GUID) Id() noexcept { return m_config.Id; }
     IFACEMETHODIMP_(WORD) LayoutId() noexcept { return m_config.LayoutId; }
+    IFACEMETHODIMP_(UINT) Revision() noexcept { return m_revision; }
     IFACEMETHODIMP AddZone(winrt::com_ptr<IZone> zone) noexcept;
     IFACEMETHODIMP_(winrt::com_ptr<IZone>) ZoneFromPoint(POINT pt) noexcept;
     IFACEMETHODIMP_(int) GetZoneIndexFromWindow(HWND window) noexcept;
     IFACEMETHODIMP_(std::vector<winrt::com_ptr<IZone>>) GetZones() noexcept { return m_zones; }
-    IFACEMETHODIMP_(void) Save() noexcept;
+    IFACEMETHODIMP_(bool) Save() noexcept;
     IFACEMETHODIMP_(void) MoveWindowIntoZoneByIndex(HWND window, HWND zoneWindow, int index) noexcept;
-    IFACEMETHODIMP_(void) MoveWindowIntoZoneByDirection(HWND window, HWND zoneWindow, DWORD vkCode) noexcept;
+    IFACEMETHODIMP_(void) MoveWindowIntoZoneByIndexDeferred(HWND window, HWND zoneWindow, int index, WindowRelayout::Planner& planner) noexcept;
+    IFACEMETHODIMP_(void) MoveWindowIntoZone(HWND window, HWND zoneWindow, int index) noexcept;
     IFACEMETHODIMP_(void) MoveSizeEnd(HWND window, HWND zoneWindow, POINT ptClient) noexcept;
 
 private:
     winrt::com_ptr<IZone> ZoneFromWindow(HWND window) noexcept;
+    winrt::com_ptr<IZone> ZoneFromIndex(int index) noexcept;
 
     std::vector<winrt::com_ptr<IZone>> m_zones;
     ZoneSetConfig m_config;
+    UINT m_revision{ NextRevision() };
 };
 
 IFACEMETHODIMP ZoneSet::AddZone(winrt::com_ptr<IZone> zone) noexcept
 {
     m_zones.emplace_back(zone);
+    m_revision = NextRevision();
 
     // Important not to set Id 0 since we store it in the HWND using SetProp.
     // SetProp(0) doesn't really work.
@@ -80,35 +94,16 @@ IFACEMETHODIMP_(winrt::com_ptr<IZone>) ZoneSet::ZoneFromPoint(POINT pt) noexcept
     return smallestKnownZone;
 }
 
-IFACEMETHODIMP_(void) ZoneSet::Save() noexcept
+IFACEMETHODIMP_(bool) ZoneSet::Save() noexcept try
 {
-    size_t const zoneCount = m_zones.size();
-    if (zoneCount == 0)
-    {
-        RegistryHelpers::DeleteZoneSet(m_config.ResolutionKey, m_config.Id);
-    }
-    else
-    {
-        ZoneSetPersistedData data{};
-        data.LayoutId = m_config.LayoutId;
-        data.ZoneCount = static_cast<DWORD>(zoneCount);
-
-        int i = 0;
-        for (auto iter = m_zones.begin(); iter != m_zones.end(); iter++)
-        {
-            winrt::com_ptr<IZone> zone = iter->as<IZone>();
-            CopyRect(&data.Zones[i++], &zone->GetZoneRect());
-        }
-
-        wil::unique_cotaskmem_string guid;
-        if (SUCCEEDED_LOG(StringFromCLSID(m_config.Id, &guid)))
-        {
-            if (wil::unique_hkey hkey{ RegistryHelpers::CreateKey(m_config.ResolutionKey) })
-            {
-                RegSetValueExW(hkey.get(), guid.get(), 0, REG_BINARY, reinterpret_cast<BYTE*>(&data), sizeof(data));
-            }
-        }
-    }
+    // Without zones, the zone set is deleted from the store. The work area is left unknown,
+    // the zone window that loads it next records its own.
+    return ZoneSetStore::SaveZoneSets({ ZoneSetStore::EntryOf(this, m_config.ResolutionKey, {}) });
+}
+catch (...)
+{
+    LOG_CAUGHT_EXCEPTION();
+    return false;
 }
 
 IFACEMETHODIMP_(int) ZoneSet::GetZoneIndexFromWindow(HWND window) noexcept
@@ -129,58 +124,32 @@ IFACEMETHODIMP_(int) ZoneSet::GetZoneIndexFromWindow(HWND window) noexcept
 
 IFACEMETHODIMP_(void) ZoneSet::MoveWindowIntoZoneByIndex(HWND window, HWND windowZone, int index) noexcept
 {
-    if (index >= static_cast<int>(m_zones.size()))
+    if (auto zone = ZoneFromIndex(index))
     {
-        index = 0;
+        zone->AddWindowToZone(window, windowZone, false);
     }
+}
 
-    if (index < m_zones.size())
+IFACEMETHODIMP_(void) ZoneSet::MoveWindowIntoZoneByIndexDeferred(HWND window, HWND windowZone, int index, WindowRelayout::Planner& planner) noexcept
+{
+    if (auto zone = ZoneFromIndex(index))
     {
-        if (auto zone = m_zones.at(index))
-        {
-            zone->AddWindowToZone(window, windowZone, false);
-        }
+        zone->AddWindowToZoneDeferred(window, windowZone, planner);
     }
 }
 
-IFACEMETHODIMP_(void) ZoneSet::MoveWindowIntoZoneByDirection(HWND window, HWND windowZone, DWORD vkCode) noexcept
+IFACEMETHODIMP_(void) ZoneSet::MoveWindowIntoZone(HWND window, HWND windowZone, int index) noexcept
 {
-    winrt::com_ptr<IZone> oldZone;
-    winrt::com_ptr<IZone> newZone;
-
-    auto iter = std::find(m_zones.begin(), m_zones.end(), ZoneFromWindow(window));
-    if (iter == m_zones.end())
+    if ((index < 0) || (index >= static_cast<int>(m_zones.size())))
     {
-        iter = (vkCode == VK_RIGHT) ? m_zones.begin() : m_zones.end() - 1;
-    }
-    else if (oldZone = iter->as<IZone>())
-    {
-        if (vkCode == VK_LEFT)
-        {
-            if (iter == m_zones.begin())
-            {
-                iter = m_zones.end();
-            }
-            iter--;
-        }
-        else if (vkCode == VK_RIGHT)
-        {
-            iter++;
-            if (iter == m_zones.end())
-            {
-                iter = m_zones.begin();
-            }
-        }
+        return;
     }
 
-    if (newZone = iter->as<IZone>())
+    if (auto oldZone = ZoneFromWindow(window))
     {
-        if (oldZone)
-        {
-            oldZone->RemoveWindowFromZone(window, false);
-        }
-        newZone->AddWindowToZone(window, windowZone, true);
+        oldZone->RemoveWindowFromZone(window, false);
     }
+    m_zones[index]->AddWindowToZone(window, windowZone, true);
 }
 
 IFACEMETHODIMP_(void) ZoneSet::MoveSizeEnd(HWND window, HWND zoneWindow, POINT ptClient) noexcept
@@ -211,6 +180,20 @@ winrt::com_ptr<IZone> ZoneSet::ZoneFromWindow(HWND window) noexcept
     return nullptr;
 }
 
+winrt::com_ptr<IZone> ZoneSet::ZoneFromIndex(int index) noexcept
+{
+    if (index >= static_cast<int>(m_zones.size()))
+    {
+        index = 0;
+    }
+
+    if (index < m_zones.size())
+    {
+        return m_zones.at(index);
+    }
+    return nullptr;
+}
+
 winrt::com_ptr<IZoneSet> MakeZoneSet(ZoneSetConfig const& config) noexcept
 {
     return winrt::make_self<ZoneSet>(config);
@@ -14,16 +14,21 @@ interface __declspec(uuid("{E4839EB7-669D-49CF-84A9-71A2DFD851A3}")) IZoneSet :
 {
     IFACEMETHOD_(GUID, Id)() = 0;
     IFACEMETHOD_(WORD, LayoutId)() = 0;
+    // Changes whenever the zones do. Unique across zone sets, so a replaced one never looks unchanged.
+    IFACEMETHOD_(UINT, Revision)() = 0;
     IFACEMETHOD(AddZone)(winrt::com_ptr<IZone> zone) = 0;
     IFACEMETHOD_(winrt::com_ptr<IZone>, ZoneFromPoint)(POINT pt) = 0;
     IFACEMETHOD_(int, GetZoneIndexFromWindow)(HWND window) = 0;
     IFACEMETHOD_(std::vector<winrt::com_ptr<IZone>>, GetZones)() = 0;
-    IFACEMETHOD_(void, Save)() = 0;
+    // Writes the zone set to the store right away. Returns false, which is logged, if it wasn't.
+    IFACEMETHOD_(bool, Save)() = 0;
     IFACEMETHOD_(void, MoveWindowIntoZoneByIndex)(HWND window, HWND zoneWindow, int index) = 0;
-    IFACEMETHOD_(void, MoveWindowIntoZoneByDirection)(HWND window, HWND zoneWindow, DWORD vkCode) = 0;
+    IFACEMETHOD_(void, MoveWindowIntoZoneByIndexDeferred)(HWND window, HWND zoneWindow, int index, WindowRelayout::Planner& planner) = 0;
+    IFACEMETHOD_(void, MoveWindowIntoZone)(HWND window, HWND zoneWindow, int index) = 0;
     IFACEMETHOD_(void, MoveSizeEnd)(HWND window, HWND zoneWindow, POINT ptClient) = 0;
 };
 
+// Registry format used before ZoneSetStore; only read to migrate existing zone sets.
 #define VERSION_PERSISTEDDATA 0x0000F00D
 struct ZoneSetPersistedData
 {
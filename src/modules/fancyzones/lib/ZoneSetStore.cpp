@@ -0,0 +1,538 @@
+#include "pch.h"
+
+#include "ZoneSetStore.h"
+#include "RegistryHelpers.h"
+
+#include <common/settings_helpers.h>
+
+namespace
+{
+    PCWSTR const StoreFileName = L"\\zone-sets.bin";
+    PCWSTR const BadStoreSuffix = L".bad";
+    PCWSTR const StoreMutexName = L"Local\\FancyZonesZoneSetStore";
+
+    // Serializes read-modify-write cycles between FancyZones and the editor process,
+    // which both persist zone sets.
+    class StoreLock
+    {
+    public:
+        StoreLock() noexcept :
+            m_mutex(CreateMutexW(nullptr, FALSE, StoreMutexName))
+        {
+            if (m_mutex)
+            {
+                DWORD const result = WaitForSingleObject(m_mutex.get(), INFINITE);
+                m_owned = (result == WAIT_OBJECT_0) || (result == WAIT_ABANDONED);
+            }
+        }
+
+        ~StoreLock()
+        {
+            if (m_owned)
+            {
+                ReleaseMutex(m_mutex.get());
+            }
+        }
+
+    private:
+        wil::unique_handle m_mutex;
+        bool m_owned{};
+    };
+
+    // Version 1 records, from before records held the work area their zones were laid out for.
+    struct RecordV1
+    {
+        wchar_t WorkAreaKey[ZoneSetStore::MaxWorkAreaKeyLength];
+        GUID Id;
+        DWORD LayoutId;
+        DWORD Layout;
+        DWORD PaddingInner;
+        DWORD PaddingOuter;
+        DWORD FirstZone;
+        DWORD ZoneCount;
+    };
+
+    static_assert(sizeof(RecordV1) == 104);
+
+    template<typename RecordT>
+    ZoneSetStore::Entry EntryFromRecord(RecordT const& record, RECT const* zones)
+    {
+        ZoneSetStore::Entry entry;
+        entry.WorkAreaKey = record.WorkAreaKey;
+        entry.Id = record.Id;
+        entry.LayoutId = static_cast<WORD>(record.LayoutId);
+        entry.Layout = static_cast<ZoneSetLayout>(record.Layout);
+        entry.PaddingInner = record.PaddingInner;
+        entry.PaddingOuter = record.PaddingOuter;
+        if constexpr (std::is_same_v<RecordT, ZoneSetStore::Record>)
+        {
+            entry.WorkArea = record.WorkArea;
+        }
+        entry.Zones.assign(zones, zones + record.ZoneCount);
+        return entry;
+    }
+
+    // Checks the header and record bounds shared by every version. Returns the records, or
+    // nullptr if the image isn't a valid store of that version.
+    template<typename RecordT>
+    RecordT const* ValidRecords(void const* data, size_t size, DWORD version) noexcept
+    {
+        if (!data || (size < sizeof(ZoneSetStore::Header)))
+        {
+            return nullptr;
+        }
+
+        auto header = static_cast<ZoneSetStore::Header const*>(data);
+        if ((header->Magic != ZoneSetStore::Magic) || (header->Version != version))
+        {
+            return nullptr;
+        }
+
+        ULONGLONG const expectedSize = sizeof(ZoneSetStore::Header) +
+            static_cast<ULONGLONG>(header->RecordCount) * sizeof(RecordT) +
+            static_cast<ULONGLONG>(header->ZoneCount) * sizeof(RECT);
+        if (expectedSize != size)
+        {
+            return nullptr;
+        }
+
+        auto records = reinterpret_cast<RecordT const*>(header + 1);
+        for (DWORD i = 0; i < header->RecordCount; i++)
+        {
+            RecordT const& record = records[i];
+            if ((wcsnlen(record.WorkAreaKey, ZoneSetStore::MaxWorkAreaKeyLength) == ZoneSetStore::MaxWorkAreaKeyLength) ||
+                (record.FirstZone > header->ZoneCount) ||
+                (record.ZoneCount > header->ZoneCount - record.FirstZone))
+            {
+                return nullptr;
+            }
+        }
+        return records;
+    }
+
+    // The current version image of a version 1 store, or an empty one if it isn't valid.
+    // Its zone sets don't know their work area yet.
+    std::vector<BYTE> UpgradeFromVersion1(void const* data, size_t size)
+    {
+        auto records = ValidRecords<RecordV1>(data, size, 1);
+        if (!records)
+        {
+            return {};
+        }
+
+        auto header = static_cast<ZoneSetStore::Header const*>(data);
+        auto zones = reinterpret_cast<RECT const*>(records + header->RecordCount);
+        std::vector<ZoneSetStore::Entry> entries;
+        for (DWORD i = 0; i < header->RecordCount; i++)
+        {
+            entries.emplace_back(EntryFromRecord(records[i], zones + records[i].FirstZone));
+        }
+        return ZoneSetStore::Serialize(entries);
+    }
+
+    std::vector<ZoneSetStore::Entry> ReadRegistryEntries()
+    {
+        std::vector<ZoneSetStore::Entry> entries;
+        wil::unique_hkey root{ RegistryHelpers::OpenKey(nullptr) };
+        if (!root)
+        {
+            return entries;
+        }
+
+        wchar_t workAreaKey[256]{};
+        DWORD keyIndex = 0;
+        while (RegEnumKeyW(root.get(), keyIndex++, workAreaKey, ARRAYSIZE(workAreaKey)) == ERROR_SUCCESS)
+        {
+            wil::unique_hkey key{ RegistryHelpers::OpenKey(workAreaKey) };
+            if (!key || (wcslen(workAreaKey) >= ZoneSetStore::MaxWorkAreaKeyLength))
+            {
+                continue;
+            }
+
+            // Only work area keys hold zone sets: GUID-named binary values in the persisted format.
+            ZoneSetPersistedData data{};
+            DWORD dataSize = sizeof(data);
+            DWORD type{};
+            wchar_t value[256]{};
+            DWORD valueLength = ARRAYSIZE(value);
+            DWORD i = 0;
+            while (RegEnumValueW(key.get(), i++, value, &valueLength, nullptr, &type, reinterpret_cast<BYTE*>(&data), &dataSize) == ERROR_SUCCESS)
+            {
+                GUID zoneSetId;
+                if ((type == REG_BINARY) &&
+                    (dataSize == sizeof(data)) &&
+                    (data.Version == VERSION_PERSISTEDDATA) &&
+                    (data.ZoneCount <= ZoneSetPersistedData::MAX_ZONES) &&
+                    SUCCEEDED(CLSIDFromString(value, &zoneSetId)))
+                {
+                    ZoneSetStore::Entry entry;
+                    entry.WorkAreaKey = workAreaKey;
+                    entry.Id = zoneSetId;
+                    entry.LayoutId = data.LayoutId;
+                    entry.Layout = data.Layout;
+                    entry.PaddingInner = data.PaddingInner;
+                    entry.PaddingOuter = data.PaddingOuter;
+                    entry.Zones.assign(data.Zones, data.Zones + data.ZoneCount);
+                    entries.emplace_back(std::move(entry));
+                }
+
+                valueLength = ARRAYSIZE(value);
+                dataSize = sizeof(data);
+            }
+        }
+        return entries;
+    }
+}
+
+namespace ZoneSetStore
+{
+    Image::Image(void const* data, size_t size) noexcept
+    {
+        auto records = ValidRecords<Record>(data, size, Version);
+        if (!records)
+        {
+            return;
+        }
+
+        m_header = static_cast<Header const*>(data);
+        m_records = records;
+        m_zones = reinterpret_cast<RECT const*>(records + m_header->RecordCount);
+    }
+
+    Record const* Image::Find(PCWSTR workAreaKey, GUID const& id) const noexcept
+    {
+        for (DWORD i = 0; i < RecordCount(); i++)
+        {
+            if ((m_records[i].Id == id) && (wcscmp(m_records[i].WorkAreaKey, workAreaKey) == 0))
+            {
+                return &m_records[i];
+            }
+        }
+        return nullptr;
+    }
+
+    Record const* Image::Find(GUID const& id) const noexcept
+    {
+        for (DWORD i = 0; i < RecordCount(); i++)
+        {
+            if (m_records[i].Id == id)
+            {
+                return &m_records[i];
+            }
+        }
+        return nullptr;
+    }
+
+    std::vector<Entry> Image::ReadAll() const
+    {
+        std::vector<Entry> entries;
+        entries.reserve(RecordCount());
+        for (DWORD i = 0; i < RecordCount(); i++)
+        {
+            entries.emplace_back(EntryFromRecord(m_records[i], ZonesOf(m_records[i])));
+        }
+        return entries;
+    }
+
+    std::vector<BYTE> Serialize(std::vector<Entry> const& entries)
+    {
+        size_t zoneCount = 0;
+        for (auto const& entry : entries)
+        {
+            zoneCount += entry.Zones.size();
+        }
+
+        std::vector<BYTE> image(sizeof(Header) + entries.size() * sizeof(Record) + zoneCount * sizeof(RECT));
+        auto header = reinterpret_cast<Header*>(image.data());
+        auto records = reinterpret_cast<Record*>(header + 1);
+        auto zones = reinterpret_cast<RECT*>(records + entries.size());
+
+        header->Magic = Magic;
+        header->Version = Version;
+        header->RecordCount = static_cast<DWORD>(entries.size());
+        header->ZoneCount = static_cast<DWORD>(zoneCount);
+
+        DWORD firstZone = 0;
+        for (auto const& entry : entries)
+        {
+            Record& record = *records++;
+            StringCchCopyW(record.WorkAreaKey, ARRAYSIZE(record.WorkAreaKey), entry.WorkAreaKey.c_str());
+            record.Id = entry.Id;
+            record.LayoutId = entry.LayoutId;
+            record.Layout = static_cast<DWORD>(entry.Layout);
+            record.PaddingInner = entry.PaddingInner;
+            record.PaddingOuter = entry.PaddingOuter;
+            record.FirstZone = firstZone;
+            record.ZoneCount = static_cast<DWORD>(entry.Zones.size());
+            record.WorkArea = entry.WorkArea;
+
+            std::copy(entry.Zones.begin(), entry.Zones.end(), zones + firstZone);
+            firstZone += record.ZoneCount;
+        }
+        return image;
+    }
+
+    MappedView::MappedView(PCWSTR path) noexcept
+    {
+        m_file.reset(CreateFileW(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
+        if (!m_file)
+        {
+            return;
+        }
+
+        LARGE_INTEGER size{};
+        if (!GetFileSizeEx(m_file.get(), &size) || (size.QuadPart == 0))
+        {
+            return;
+        }
+
+        m_mapping.reset(CreateFileMappingW(m_file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+        if (m_mapping)
+        {
+            m_view.reset(MapViewOfFile(m_mapping.get(), FILE_MAP_READ, 0, 0, 0));
+            if (m_view)
+            {
+                m_image = Image(m_view.get(), static_cast<size_t>(size.QuadPart));
+                if (!m_image.IsValid())
+                {
+                    try
+                    {
+                        m_upgraded = UpgradeFromVersion1(m_view.get(), static_cast<size_t>(size.QuadPart));
+                        m_image = Image(m_upgraded.data(), m_upgraded.size());
+                    }
+                    CATCH_LOG();
+                }
+            }
+        }
+    }
+
+    bool Write(PCWSTR path, std::vector<Entry> const& entries) noexcept try
+    {
+        std::vector<BYTE> const image = Serialize(entries);
+        std::wstring const tempPath = std::wstring(path) + L".tmp";
+        {
+            wil::unique_hfile file{ CreateFileW(tempPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr) };
+            if (!file)
+            {
+                LOG_LAST_ERROR_MSG("Can't create %ls", tempPath.c_str());
+                return false;
+            }
+
+            DWORD written = 0;
+            if (!LOG_IF_WIN32_BOOL_FALSE(::WriteFile(file.get(), image.data(), static_cast<DWORD>(image.size()), &written, nullptr)) ||
+                (written != image.size()) ||
+                !LOG_IF_WIN32_BOOL_FALSE(FlushFileBuffers(file.get())))
+            {
+                file.reset();
+                DeleteFileW(tempPath.c_str());
+                return false;
+            }
+        }
+
+        // A reader in another process may briefly hold the old file mapped.
+        for (int attempt = 0; attempt < 5; attempt++)
+        {
+            if (MoveFileExW(tempPath.c_str(), path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+            {
+                return true;
+            }
+            Sleep(10);
+        }
+
+        LOG_LAST_ERROR_MSG("Can't replace %ls", path);
+        DeleteFileW(tempPath.c_str());
+        return false;
+    }
+    catch (...)
+    {
+        LOG_CAUGHT_EXCEPTION();
+        return false;
+    }
+
+    std::wstring DefaultPath()
+    {
+        static std::wstring const path = PTSettingsHelper::get_module_save_folder_location(L"FancyZones") + StoreFileName;
+        return path;
+    }
+
+    void EnsureMigrated(PCWSTR path) noexcept
+    {
+        if (GetFileAttributesW(path) != INVALID_FILE_ATTRIBUTES)
+        {
+            return;
+        }
+
+        StoreLock lock;
+        if (GetFileAttributesW(path) == INVALID_FILE_ATTRIBUTES)
+        {
+            Write(path, ReadRegistryEntries());
+        }
+    }
+
+    bool ReadForUpdate(PCWSTR path, std::vector<Entry>& entries) noexcept try
+    {
+        {
+            MappedView view(path);
+            if (view.Get().IsValid())
+            {
+                entries = view.Get().ReadAll();
+                return true;
+            }
+            if (!view.IsOpen())
+            {
+                DWORD const error = GetLastError();
+                if ((error != ERROR_FILE_NOT_FOUND) && (error != ERROR_PATH_NOT_FOUND))
+                {
+                    LOG_WIN32_MSG(error, "Can't open %ls", path);
+                    return false;
+                }
+                entries = ReadRegistryEntries();
+                return true;
+            }
+        }
+
+        // Corrupt, truncated or of another version. Writing the changed zone sets alone would
+        // lose the layouts of every other monitor and desktop, keep it for recovery instead.
+        std::wstring const badPath = std::wstring(path) + BadStoreSuffix;
+        if (!LOG_IF_WIN32_BOOL_FALSE(MoveFileExW(path, badPath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)))
+        {
+            return false;
+        }
+        LOG_HR_MSG(HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT), "%ls isn't a valid zone set store, moved to %ls", path, badPath.c_str());
+        entries = ReadRegistryEntries();
+        return true;
+    }
+    catch (...)
+    {
+        LOG_CAUGHT_EXCEPTION();
+        return false;
+    }
+
+    bool SaveZoneSets(PCWSTR path, std::vector<Entry> const& changes) noexcept try
+    {
+        if (changes.empty())
+        {
+            return true;
+        }
+
+        StoreLock lock;
+        std::vector<Entry> entries;
+        if (!ReadForUpdate(path, entries))
+        {
+            return false;
+        }
+
+        for (auto const& change : changes)
+        {
+            auto iter = std::find_if(entries.begin(), entries.end(), [&](Entry const& existing) {
+                return (existing.Id == change.Id) && (existing.WorkAreaKey == change.WorkAreaKey);
+            });
+
+            if (change.Zones.empty())
+            {
+                if (iter != entries.end())
+                {
+                    entries.erase(iter);
+                }
+            }
+            else if (iter != entries.end())
+            {
+                *iter = change;
+            }
+            else
+            {
+                entries.push_back(change);
+            }
+        }
+        return Write(path, entries);
+    }
+    catch (...)
+    {
+        LOG_CAUGHT_EXCEPTION();
+        return false;
+    }
+
+    bool SaveZoneSets(std::vector<Entry> const& entries) noexcept
+    {
+        return SaveZoneSets(DefaultPath().c_str(), entries);
+    }
+
+    Entry EntryOf(IZoneSet* zoneSet, PCWSTR workAreaKey, RECT const& workArea)
+    {
+        Entry entry;
+        entry.WorkAreaKey = workAreaKey;
+        entry.Id = zoneSet->Id();
+        entry.LayoutId = zoneSet->LayoutId();
+        entry.WorkArea = workArea;
+        for (auto const& zone : zoneSet->GetZones())
+        {
+            entry.Zones.push_back(zone->GetZoneRect());
+        }
+        return entry;
+    }
+
+    void PendingWrites::Add(std::vector<Entry> entries)
+    {
+        std::scoped_lock lock(m_lock);
+        for (auto& entry : entries)
+        {
+            auto iter = std::find_if(m_pending.begin(), m_pending.end(), [&](Entry const& pending) {
+                return (pending.Id == entry.Id) && (pending.WorkAreaKey == entry.WorkAreaKey);
+            });
+
+            if (iter != m_pending.end())
+            {
+                *iter = std::move(entry);
+            }
+            else
+            {
+                m_pending.push_back(std::move(entry));
+            }
+        }
+    }
+
+    bool PendingWrites::HasPending() const noexcept
+    {
+        std::scoped_lock lock(m_lock);
+        return !m_pending.empty();
+    }
+
+    bool PendingWrites::Flush() noexcept try
+    {
+        std::vector<Entry> entries;
+        {
+            std::scoped_lock lock(m_lock);
+            entries.swap(m_pending);
+        }
+
+        if (SaveZoneSets(m_path.c_str(), entries))
+        {
+            return true;
+        }
+
+        // Put back what no newer change replaced meanwhile.
+        std::scoped_lock lock(m_lock);
+        for (auto& pending : m_pending)
+        {
+            auto iter = std::find_if(entries.begin(), entries.end(), [&](Entry const& entry) {
+                return (entry.Id == pending.Id) && (entry.WorkAreaKey == pending.WorkAreaKey);
+            });
+
+            if (iter != entries.end())
+            {
+                *iter = std::move(pending);
+            }
+            else
+            {
+                entries.push_back(std::move(pending));
+            }
+        }
+        m_pending.swap(entries);
+        return false;
+    }
+    catch (...)
+    {
+        LOG_CAUGHT_EXCEPTION();
+        return false;
+    }
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "ZoneSet.h"
+
+#include <mutex>
+
+// Binary layout database holding the zone sets of every work area in a single file.
+//
+// The file is a header followed by a fixed-size record per zone set and one shared
+// array of zone rectangles. Records reference their zones by index into that array,
+// so a zone set can hold any number of zones. Readers map the file and use the
+// records in place; writers build a new image and atomically replace the file.
+// Files of an older version are upgraded in memory when mapped and rewritten in the
+// current version on the next save.
+namespace ZoneSetStore
+{
+    constexpr inline DWORD Magic = 0x534C5A46; // 'FZLS'
+    constexpr inline DWORD Version = 2;
+    constexpr inline size_t MaxWorkAreaKeyLength = 32;
+
+    struct Header
+    {
+        DWORD Magic;
+        DWORD Version;
+        DWORD RecordCount;
+        DWORD ZoneCount;
+    };
+
+    struct Record
+    {
+        wchar_t WorkAreaKey[MaxWorkAreaKeyLength];
+        GUID Id;
+        DWORD LayoutId;
+        DWORD Layout;
+        DWORD PaddingInner;
+        DWORD PaddingOuter;
+        DWORD FirstZone;
+        DWORD ZoneCount;
+        RECT WorkArea; // Scaled work area the zones were laid out for, empty if unknown
+    };
+
+    static_assert(sizeof(Header) == 16);
+    static_assert(sizeof(Record) == 120);
+    static_assert(sizeof(RECT) == 16);
+
+    struct Entry
+    {
+        std::wstring WorkAreaKey;
+        GUID Id{};
+        WORD LayoutId{};
+        ZoneSetLayout Layout{};
+        DWORD PaddingInner{};
+        DWORD PaddingOuter{};
+        RECT WorkArea{};
+        std::vector<RECT> Zones;
+    };
+
+    // Validated, read-only view over a serialized store. Does not own the memory.
+    class Image
+    {
+    public:
+        Image() = default;
+        Image(void const* data, size_t size) noexcept;
+
+        bool IsValid() const noexcept { return m_header != nullptr; }
+        DWORD RecordCount() const noexcept { return m_header ? m_header->RecordCount : 0; }
+        Record const& RecordAt(DWORD index) const noexcept { return m_records[index]; }
+        RECT const* ZonesOf(Record const& record) const noexcept { return m_zones + record.FirstZone; }
+
+        Record const* Find(PCWSTR workAreaKey, GUID const& id) const noexcept;
+        Record const* Find(GUID const& id) const noexcept; // In any work area
+        std::vector<Entry> ReadAll() const;
+
+        template<typename Fn>
+        void ForEach(PCWSTR workAreaKey, Fn&& fn) const
+        {
+            for (DWORD i = 0; i < RecordCount(); i++)
+            {
+                Record const& record = m_records[i];
+                if (wcscmp(record.WorkAreaKey, workAreaKey) == 0)
+                {
+                    fn(record, ZonesOf(record));
+                }
+            }
+        }
+
+    private:
+        Header const* m_header{};
+        Record const* m_records{};
+        RECT const* m_zones{};
+    };
+
+    std::vector<BYTE> Serialize(std::vector<Entry> const& entries);
+
+    // Maps the store file for reading. The mapping is released when the view goes away,
+    // so keep it short-lived; writers cannot replace the file while it is mapped.
+    class MappedView
+    {
+    public:
+        explicit MappedView(PCWSTR path) noexcept;
+
+        Image const& Get() const noexcept { return m_image; }
+        // Whether the file could be opened, even if its contents aren't a valid store.
+        bool IsOpen() const noexcept { return static_cast<bool>(m_file); }
+
+    private:
+        struct UnmapViewDeleter
+        {
+            void operator()(void const* view) const noexcept { UnmapViewOfFile(view); }
+        };
+
+        wil::unique_hfile m_file;
+        wil::unique_handle m_mapping;
+        std::unique_ptr<void const, UnmapViewDeleter> m_view;
+        std::vector<BYTE> m_upgraded; // Current version image of an older file
+        Image m_image;
+    };
+
+    // Writes the entries to a temporary file next to path and moves it into place. Logs why
+    // when it fails, the file is then left as it was.
+    bool Write(PCWSTR path, std::vector<Entry> const& entries) noexcept;
+
+    // Reads the whole store before changing it. A store that doesn't exist yet starts from the
+    // registry zone sets. One that exists but isn't valid is never written over: it is kept as
+    // a .bad file next to it, which is logged, and the registry zone sets are started from
+    // again. Returns false when the store can't be opened or moved aside right now.
+    bool ReadForUpdate(PCWSTR path, std::vector<Entry>& entries) noexcept;
+
+    // Store shared by FancyZones and the editor, under the FancyZones settings folder.
+    // Created from the registry zone sets on first use.
+    std::wstring DefaultPath();
+    void EnsureMigrated(PCWSTR path) noexcept;
+
+    // Saves the zone sets in one read-modify-write of the store, serialized across processes.
+    // Each entry replaces the zone set with the same work area key and id; one without zones
+    // deletes it, like ZoneSet::Save. Returns false, and logs why, if the store is unchanged.
+    bool SaveZoneSets(PCWSTR path, std::vector<Entry> const& entries) noexcept;
+    bool SaveZoneSets(std::vector<Entry> const& entries) noexcept; // To the default store
+
+    // The entry saving the zone set and its current zones under the work area key, laid out
+    // for the scaled work area. Leave that empty when it isn't known.
+    Entry EntryOf(IZoneSet* zoneSet, PCWSTR workAreaKey, RECT const& workArea);
+
+    // Zone set changes waiting to be saved, latest per zone set, so the UI thread doesn't wait
+    // on the store. The owner saves them off the UI thread with Flush. What couldn't be saved
+    // stays pending for the next Flush, unless a newer change to the same zone set replaced it.
+    // All methods are thread-safe.
+    class PendingWrites
+    {
+    public:
+        explicit PendingWrites(std::wstring path = DefaultPath()) :
+            m_path(std::move(path))
+        {
+        }
+
+        void Add(std::vector<Entry> entries);
+        bool HasPending() const noexcept;
+
+        // Saves everything pending in one store update. Returns false if it is still pending.
+        bool Flush() noexcept;
+
+    private:
+        std::wstring const m_path;
+        mutable std::mutex m_lock;
+        std::vector<Entry> m_pending;
+    };
+}
@@ -0,0 +1,134 @@
+#include "pch.h"
+
+#include "ZoneSpace.h"
+
+void ZoneSpace::SetZones(HMONITOR monitor, std::vector<RECT> const& zones)
+{
+    Remove(monitor);
+
+    std::vector<uint32_t> ids;
+    ids.reserve(zones.size());
+    for (size_t i = 0; i < zones.size(); i++)
+    {
+        RECT const& rect = zones[i];
+        if (IsRectEmpty(&rect))
+        {
+            continue; // Never hit
+        }
+
+        uint32_t id;
+        if (m_free.empty())
+        {
+            id = static_cast<uint32_t>(m_zones.size());
+            m_zones.emplace_back();
+        }
+        else
+        {
+            id = m_free.back();
+            m_free.pop_back();
+        }
+
+        LONGLONG const area = static_cast<LONGLONG>(rect.right - rect.left) * (rect.bottom - rect.top);
+        m_zones[id] = { rect, area, monitor, static_cast<int>(i) };
+        ids.push_back(id);
+
+        CellRange const cells = CellsOf(rect);
+        for (LONG y = cells.Top; y <= cells.Bottom; y++)
+        {
+            for (LONG x = cells.Left; x <= cells.Right; x++)
+            {
+                m_cells[CellKey(x, y)].push_back(id);
+            }
+        }
+    }
+
+    if (!ids.empty())
+    {
+        m_monitors[monitor] = std::move(ids);
+    }
+}
+
+void ZoneSpace::Remove(HMONITOR monitor)
+{
+    auto iter = m_monitors.find(monitor);
+    if (iter == m_monitors.end())
+    {
+        return;
+    }
+
+    for (uint32_t const id : iter->second)
+    {
+        CellRange const cells = CellsOf(m_zones[id].Rect);
+        for (LONG y = cells.Top; y <= cells.Bottom; y++)
+        {
+            for (LONG x = cells.Left; x <= cells.Right; x++)
+            {
+                auto cell = m_cells.find(CellKey(x, y));
+                auto& cellZones = cell->second;
+                cellZones.erase(std::find(cellZones.begin(), cellZones.end(), id));
+                if (cellZones.empty())
+                {
+                    m_cells.erase(cell);
+                }
+            }
+        }
+        m_zones[id] = {};
+        m_free.push_back(id);
+    }
+    m_monitors.erase(iter);
+}
+
+void ZoneSpace::Clear() noexcept
+{
+    m_zones.clear();
+    m_free.clear();
+    m_monitors.clear();
+    m_cells.clear();
+}
+
+std::optional<ZoneSpace::Hit> ZoneSpace::ZoneFromPoint(POINT pt) const noexcept
+{
+    auto cell = m_cells.find(CellKey(CellOf(pt.x), CellOf(pt.y)));
+    if (cell == m_cells.end())
+    {
+        return std::nullopt;
+    }
+
+    Zone const* best = nullptr;
+    for (uint32_t const id : cell->second)
+    {
+        Zone const& zone = m_zones[id];
+        if (!PtInRect(&zone.Rect, pt))
+        {
+            continue;
+        }
+
+        if (!best || (zone.Area < best->Area) || ((zone.Area == best->Area) && (zone.Monitor == best->Monitor) && (zone.Index > best->Index)))
+        {
+            best = &zone;
+        }
+    }
+
+    if (!best)
+    {
+        return std::nullopt;
+    }
+    return Hit{ best->Monitor, best->Index };
+}
+
+LONG ZoneSpace::CellOf(LONG coordinate) noexcept
+{
+    // Monitors left of or above the primary one have negative coordinates; round those down too.
+    return (coordinate >= 0) ? (coordinate / CellSize) : static_cast<LONG>(-((-static_cast<LONGLONG>(coordinate) + CellSize - 1) / CellSize));
+}
+
+ZoneSpace::CellRange ZoneSpace::CellsOf(RECT const& rect) noexcept
+{
+    // Right and bottom are exclusive.
+    return { CellOf(rect.left), CellOf(rect.top), CellOf(rect.right - 1), CellOf(rect.bottom - 1) };
+}
+
+uint64_t ZoneSpace::CellKey(LONG x, LONG y) noexcept
+{
+    return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+}
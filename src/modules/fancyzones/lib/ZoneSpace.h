@@ -0,0 +1,62 @@
+#pragma once
+
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+// One spatial index over the zones of every monitor, in virtual screen coordinates.
+//
+// Zones are bucketed into a uniform grid of CellSize squares, so a hit test only looks
+// at the zones overlapping the cell under the point, whichever monitor it is on. The
+// zones of each monitor are replaced on their own and only touch the cells they cover,
+// so a topology or layout change on one monitor leaves the rest of the index alone.
+// Zones are plain rects and may cover several monitors; the monitor a zone is added
+// with only says which zone window it belongs to.
+class ZoneSpace
+{
+public:
+    static constexpr inline LONG CellSize = 256;
+
+    struct Hit
+    {
+        HMONITOR Monitor{};
+        int ZoneIndex{}; // Into the zones the monitor was set with
+    };
+
+    // Replaces the zones of monitor. Rects are in screen coordinates.
+    void SetZones(HMONITOR monitor, std::vector<RECT> const& zones);
+    void Remove(HMONITOR monitor);
+    void Clear() noexcept;
+
+    // Like ZoneSet::ZoneFromPoint: the smallest zone under pt, later zones first on ties.
+    std::optional<Hit> ZoneFromPoint(POINT pt) const noexcept;
+
+    size_t Size() const noexcept { return m_zones.size() - m_free.size(); }
+    size_t CellCount() const noexcept { return m_cells.size(); }
+
+private:
+    struct Zone
+    {
+        RECT Rect{};
+        LONGLONG Area{};
+        HMONITOR Monitor{};
+        int Index{};
+    };
+
+    struct CellRange
+    {
+        LONG Left{};
+        LONG Top{};
+        LONG Right{}; // Inclusive
+        LONG Bottom{};
+    };
+
+    static LONG CellOf(LONG coordinate) noexcept;
+    static CellRange CellsOf(RECT const& rect) noexcept;
+    static uint64_t CellKey(LONG x, LONG y) noexcept;
+
+    std::vector<Zone> m_zones; // Slots of removed zones are reused
+    std::vector<uint32_t> m_free;
+    std::unordered_map<HMONITOR, std::vector<uint32_t>> m_monitors;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> m_cells;
+};
@@ -7,6 +7,10 @@
 #include "trace.h"
 #include "util.h"
 #include "RegistryHelpers.h"
+#include "ZoneRasterizer.h"
+#include "ZoneSetStore.h"
+#include "LayoutGenerator.h"
+#include "AnimationScheduler.h"
 
 #include <ShellScalingApi.h>
 
@@ -14,20 +18,25 @@ struct ZoneWindow : public winrt::implements<ZoneWindow, IZoneWindow>
 {
 public:
     ZoneWindow(IZoneWindowHost* host, HINSTANCE hinstance, HMONITOR monitor, PCWSTR deviceId, PCWSTR virtualDesktopId, bool flashZones);
+    ~ZoneWindow();
 
     IFACEMETHODIMP MoveSizeEnter(HWND window, bool dragEnabled) noexcept;
     IFACEMETHODIMP MoveSizeUpdate(POINT const& ptScreen, bool dragEnabled) noexcept;
+    IFACEMETHODIMP MoveSizeUpdateZone(int zoneIndex, bool dragEnabled) noexcept;
     IFACEMETHODIMP MoveSizeEnd(HWND window, POINT const& ptScreen) noexcept;
     IFACEMETHODIMP MoveSizeCancel() noexcept;
     IFACEMETHODIMP_(bool) IsDragEnabled() noexcept { return m_dragEnabled; }
     IFACEMETHODIMP_(void) MoveWindowIntoZoneByIndex(HWND window, int index) noexcept;
-    IFACEMETHODIMP_(void) MoveWindowIntoZoneByDirection(HWND window, DWORD vkCode) noexcept;
+    IFACEMETHODIMP_(void) MoveWindowIntoZoneByIndexDeferred(HWND window, int index, WindowRelayout::Planner& planner) noexcept;
+    IFACEMETHODIMP_(void) MoveWindowIntoZone(HWND window, int index) noexcept;
     IFACEMETHODIMP_(void) CycleActiveZoneSet(DWORD vkCode) noexcept;
     IFACEMETHODIMP_(std::wstring) DeviceId() noexcept { return { m_deviceId.get() }; }
     IFACEMETHODIMP_(std::wstring) UniqueId() noexcept { return { m_uniqueId }; }
     IFACEMETHODIMP_(std::wstring) WorkAreaKey() noexcept { return { m_workArea }; }
     IFACEMETHODIMP_(void) SaveWindowProcessToZoneIndex(HWND window) noexcept;
     IFACEMETHODIMP_(IZoneSet*) ActiveZoneSet() noexcept { return m_activeZoneSet.get(); }
+    IFACEMETHODIMP_(void) SwitchVirtualDesktop(PCWSTR virtualDesktopId, bool flashZones) noexcept;
+    IFACEMETHODIMP_(void) ApplyEditorLayout(WORD layoutId, std::vector<RECT> const& zones) noexcept;
 
 protected:
     static LRESULT CALLBACK s_WndProc(HWND window, UINT message, WPARAM wparam, LPARAM lparam) noexcept;
@@ -47,20 +56,28 @@ private:
     void InitializeId(PCWSTR deviceId, PCWSTR virtualDesktopId) noexcept;
     void LoadSettings() noexcept;
     void InitializeZoneSets(MONITORINFO const& mi) noexcept;
-    void LoadZoneSetsFromRegistry() noexcept;
+    void LoadZoneSets(MONITORINFO const& mi) noexcept;
+    LayoutGenerator::LayoutSpec LayoutSpecOf(ZoneSetStore::Record const& record) noexcept;
+    RECT ScaledWorkArea(RECT const& workArea) noexcept;
+    void SaveZoneSets(std::vector<winrt::com_ptr<IZoneSet>> const& zoneSets) noexcept;
     void UpdateActiveZoneSet(_In_opt_ IZoneSet* zoneSet) noexcept;
     LRESULT WndProc(UINT message, WPARAM wparam, LPARAM lparam) noexcept;
-    void DrawBackdrop(wil::unique_hdc& hdc, RECT const& clientRect) noexcept;
-    void DrawZone(wil::unique_hdc& hdc, ColorSetting const& colorSetting, winrt::com_ptr<IZone> zone) noexcept;
-    void DrawIndex(wil::unique_hdc& hdc, POINT offset, size_t index, int padding, int size, bool flipX, bool flipY, COLORREF colorFill);
-    void DrawActiveZoneSet(wil::unique_hdc& hdc, RECT const& clientRect) noexcept;
+    void DrawBackdrop(ArgbSurface const& surface) noexcept;
+    void DrawZone(ArgbSurface const& surface, ColorSetting const& colorSetting, winrt::com_ptr<IZone> zone) noexcept;
+    void DrawIndex(ArgbSurface const& surface, POINT offset, size_t index, int padding, int size, bool flipX, bool flipY, COLORREF colorFill);
+    void DrawActiveZoneSet(ArgbSurface const& surface) noexcept;
     void OnPaint(wil::unique_hdc& hdc) noexcept;
     void OnKeyUp(WPARAM wparam) noexcept;
     winrt::com_ptr<IZone> ZoneFromPoint(POINT pt) noexcept;
-    void ChooseDefaultActiveZoneSet() noexcept;
+    void HighlightZone(winrt::com_ptr<IZone> zone, bool dragEnabled) noexcept;
+    void ChooseDefaultActiveZoneSet(MONITORINFO const& mi) noexcept;
+    winrt::com_ptr<IZoneSet> GenerateZoneSet(GUID const& sourceId, MONITORINFO const& mi) noexcept;
     bool IsOccluded(POINT pt, size_t index) noexcept;
     void CycleActiveZoneSetInternal(DWORD wparam, Trace::ZoneWindow::InputMode mode) noexcept;
     void FlashZones() noexcept;
+    void FlashZonesUnlessFullScreen(MONITORINFO const& mi) noexcept;
+    void Animate(UINT duration, bool fadeIn) noexcept;
+    void OnAnimationFrame(BYTE opacity, bool last) noexcept;
     UINT GetDpiForMonitor() noexcept;
 
     winrt::com_ptr<IZoneWindowHost> m_host;
@@ -73,16 +90,35 @@ private:
     bool m_drawHints{};
     bool m_flashMode{};
     bool m_dragEnabled{};
+    BYTE m_opacity{ 255 }; // Scales every zone while the window fades in or out
+    UINT m_animation{}; // Bumped for every animation so frames of superseded ones are dropped
     winrt::com_ptr<IZoneSet> m_activeZoneSet;
     GUID m_activeZoneSetId{};
     std::vector<winrt::com_ptr<IZoneSet>> m_zoneSets;
+    std::wstring m_virtualDesktopId;
+
+    // Zone sets of the other virtual desktops this monitor has shown, so switching back
+    // to a desktop swaps them in instead of loading them again.
+    struct DesktopState
+    {
+        std::wstring uniqueId;
+        GUID activeZoneSetId{};
+        winrt::com_ptr<IZoneSet> activeZoneSet;
+        std::vector<winrt::com_ptr<IZoneSet>> zoneSets;
+    };
+    std::map<std::wstring, DesktopState> m_desktopStates;
+
     winrt::com_ptr<IZone> m_highlightZone;
     WPARAM m_keyLast{};
     size_t m_keyCycle{};
     static const UINT m_showAnimationDuration = 200; // ms
     static const UINT m_flashDuration = 700; // ms
+
+    static UINT WM_PRIV_ANIMATION_FRAME; // Posted by the animation scheduler, wparam holds opacity and whether it is the last frame
 };
 
+UINT ZoneWindow::WM_PRIV_ANIMATION_FRAME = RegisterWindowMessage(L"{2f3a7c61-5d0e-4b8a-9c4f-8e1b6d27a3f5}");
+
 ZoneWindow::ZoneWindow(
     IZoneWindowHost* host,
     HINSTANCE hinstance,
@@ -90,7 +126,8 @@ ZoneWindow::ZoneWindow(
     PCWSTR deviceId,
     PCWSTR virtualDesktopId,
     bool flashZones)
-        : m_monitor(monitor)
+        : m_monitor(monitor),
+          m_virtualDesktopId(virtualDesktopId)
 {
     m_host.copy_from(host);
 
@@ -129,17 +166,18 @@ ZoneWindow::ZoneWindow(
         MakeWindowTransparent(m_window.get());
         if (flashZones)
         {
-            // Don't flash if the foreground window is in full screen mode
-            RECT windowRect;
-            if (GetWindowRect(GetForegroundWindow(), &windowRect) &&
-                windowRect.left == mi.rcMonitor.left &&
-                windowRect.top == mi.rcMonitor.top &&
-                windowRect.right == mi.rcMonitor.right &&
-                windowRect.bottom == mi.rcMonitor.bottom)
-            {
-                return;
-            }
-            FlashZones();
+            FlashZonesUnlessFullScreen(mi);
+        }
+    }
+}
+
+ZoneWindow::~ZoneWindow()
+{
+    if (m_host && m_window)
+    {
+        if (auto animations = m_host->Animations())
+        {
+            animations->Cancel(reinterpret_cast<uintptr_t>(m_window.get()));
         }
     }
 }
@@ -161,30 +199,27 @@ IFACEMETHODIMP ZoneWindow::MoveSizeEnter(HWND window, bool dragEnabled) noexcept
 
 IFACEMETHODIMP ZoneWindow::MoveSizeUpdate(POINT const& ptScreen, bool dragEnabled) noexcept
 {
-    bool redraw = false;
     POINT ptClient = ptScreen;
     MapWindowPoints(nullptr, m_window.get(), &ptClient, 1);
+    HighlightZone(dragEnabled ? ZoneFromPoint(ptClient) : nullptr, dragEnabled);
+    return S_OK;
+}
 
-    m_dragEnabled = dragEnabled;
-
-    if (dragEnabled)
-    {
-        auto highlightZone = ZoneFromPoint(ptClient);
-        redraw = (highlightZone != m_highlightZone);
-        m_highlightZone = std::move(highlightZone);
-    }
-    else if (m_highlightZone)
-    {
-        m_highlightZone = nullptr;
-        redraw = true;
-    }
-
-    if (redraw)
+IFACEMETHODIMP ZoneWindow::MoveSizeUpdateZone(int zoneIndex, bool dragEnabled) noexcept try
+{
+    winrt::com_ptr<IZone> zone;
+    if (dragEnabled && m_activeZoneSet && (zoneIndex >= 0))
     {
-        InvalidateRect(m_window.get(), nullptr, true);
+        auto zones = m_activeZoneSet->GetZones();
+        if (static_cast<size_t>(zoneIndex) < zones.size())
+        {
+            zone = zones[zoneIndex];
+        }
     }
+    HighlightZone(std::move(zone), dragEnabled);
     return S_OK;
 }
+CATCH_RETURN();
 
 IFACEMETHODIMP ZoneWindow::MoveSizeEnd(HWND window, POINT const& ptScreen) noexcept
 {
@@ -222,11 +257,19 @@ IFACEMETHODIMP_(void) ZoneWindow::MoveWindowIntoZoneByIndex(HWND window, int ind
     }
 }
 
-IFACEMETHODIMP_(void) ZoneWindow::MoveWindowIntoZoneByDirection(HWND window, DWORD vkCode) noexcept
+IFACEMETHODIMP_(void) ZoneWindow::MoveWindowIntoZoneByIndexDeferred(HWND window, int index, WindowRelayout::Planner& planner) noexcept
 {
     if (m_activeZoneSet)
     {
-        m_activeZoneSet->MoveWindowIntoZoneByDirection(window, m_window.get(), vkCode);
+        m_activeZoneSet->MoveWindowIntoZoneByIndexDeferred(window, m_window.get(), index, planner);
+    }
+}
+
+IFACEMETHODIMP_(void) ZoneWindow::MoveWindowIntoZone(HWND window, int index) noexcept
+{
+    if (m_activeZoneSet)
+    {
+        m_activeZoneSet->MoveWindowIntoZone(window, m_window.get(), index);
         SaveWindowProcessToZoneIndex(window);
     }
 }
@@ -245,15 +288,108 @@ IFACEMETHODIMP_(void) ZoneWindow::CycleActiveZoneSet(DWORD wparam) noexcept
     }
 }
 
+IFACEMETHODIMP_(void) ZoneWindow::SwitchVirtualDesktop(PCWSTR virtualDesktopId, bool flashZones) noexcept try
+{
+    if (m_virtualDesktopId == virtualDesktopId)
+    {
+        return;
+    }
+
+    MONITORINFO mi{};
+    mi.cbSize = sizeof(mi);
+    if (!GetMonitorInfoW(m_monitor, &mi))
+    {
+        return;
+    }
+
+    auto& parked = m_desktopStates[m_virtualDesktopId];
+    parked.uniqueId = m_uniqueId;
+    parked.activeZoneSetId = m_activeZoneSetId;
+    parked.activeZoneSet = std::move(m_activeZoneSet);
+    parked.zoneSets = std::move(m_zoneSets);
+
+    m_virtualDesktopId = virtualDesktopId;
+    m_activeZoneSet = nullptr;
+    m_activeZoneSetId = {};
+    m_zoneSets.clear();
+    m_highlightZone = nullptr;
+
+    if (auto cached = m_desktopStates.find(m_virtualDesktopId); cached != m_desktopStates.end())
+    {
+        StringCchCopy(m_uniqueId, ARRAYSIZE(m_uniqueId), cached->second.uniqueId.c_str());
+        m_activeZoneSetId = cached->second.activeZoneSetId;
+        m_activeZoneSet = std::move(cached->second.activeZoneSet);
+        m_zoneSets = std::move(cached->second.zoneSets);
+        m_desktopStates.erase(cached);
+    }
+    else
+    {
+        // InitializeId replaces m_deviceId, so pass it a copy.
+        std::wstring const deviceId = DeviceId();
+        InitializeId(deviceId.c_str(), virtualDesktopId);
+        LoadSettings();
+        InitializeZoneSets(mi);
+    }
+
+    if (flashZones)
+    {
+        FlashZonesUnlessFullScreen(mi);
+    }
+}
+CATCH_LOG();
+
+IFACEMETHODIMP_(void) ZoneWindow::ApplyEditorLayout(WORD layoutId, std::vector<RECT> const& zones) noexcept try
+{
+    auto existing = std::find_if(m_zoneSets.begin(), m_zoneSets.end(), [&](winrt::com_ptr<IZoneSet> const& zoneSet) {
+        return (zoneSet->LayoutId() == layoutId) && (zoneSet->GetZones().size() == zones.size());
+    });
+
+    GUID id{};
+    if (existing != m_zoneSets.end())
+    {
+        id = (*existing)->Id();
+    }
+    else if (FAILED(CoCreateGuid(&id)))
+    {
+        return;
+    }
+
+    auto zoneSet = MakeZoneSet(ZoneSetConfig(id, layoutId, m_monitor, m_workArea));
+    if (!zoneSet)
+    {
+        return;
+    }
+
+    for (auto const& zone : zones)
+    {
+        zoneSet->AddZone(MakeZone(zone));
+    }
+    SaveZoneSets({ zoneSet });
+
+    if (existing != m_zoneSets.end())
+    {
+        *existing = zoneSet;
+    }
+    else
+    {
+        m_zoneSets.emplace_back(zoneSet);
+    }
+
+    m_activeZoneSetId = id;
+    m_highlightZone = nullptr;
+    UpdateActiveZoneSet(zoneSet.get());
+}
+CATCH_LOG();
+
 IFACEMETHODIMP_(void) ZoneWindow::SaveWindowProcessToZoneIndex(HWND window) noexcept
 {
     auto processPath = get_process_path(window);
     if (!processPath.empty())
     {
-        DWORD zoneIndex = static_cast<DWORD>(m_activeZoneSet->GetZoneIndexFromWindow(window));
-        if (zoneIndex != -1)
+        const int zoneIndex = m_activeZoneSet->GetZoneIndexFromWindow(window);
+        if ((zoneIndex != -1) && m_host)
         {
-            RegistryHelpers::SaveAppLastZone(window, processPath.data(), zoneIndex);
+            m_host->SetAppLastZone(window, processPath.c_str(), zoneIndex);
         }
     }
 }
@@ -275,8 +411,9 @@ void ZoneWindow::ShowZoneWindow() noexcept
 
         SetWindowPos(m_window.get(), windowInsertAfter, 0, 0, 0, 0, flags);
 
-        AnimateWindow(m_window.get(), m_showAnimationDuration, AW_BLEND);
-        InvalidateRect(m_window.get(), nullptr, true);
+        m_opacity = 0;
+        ShowWindow(m_window.get(), SW_SHOWNA);
+        Animate(m_showAnimationDuration, true);
     }
 }
 
@@ -284,6 +421,13 @@ void ZoneWindow::HideZoneWindow() noexcept
 {
     if (m_window)
     {
+        // Drop whatever fade is still running.
+        m_animation++;
+        if (auto animations = m_host ? m_host->Animations() : nullptr)
+        {
+            animations->Cancel(reinterpret_cast<uintptr_t>(m_window.get()));
+        }
+
         ShowWindow(m_window.get(), SW_HIDE);
         m_keyLast = 0;
         m_windowMoveSize = nullptr;
@@ -318,65 +462,120 @@ void ZoneWindow::LoadSettings() noexcept
 
 void ZoneWindow::InitializeZoneSets(MONITORINFO const& mi) noexcept
 {
-    LoadZoneSetsFromRegistry();
+    LoadZoneSets(mi);
 
     if (!m_activeZoneSet)
     {
-        ChooseDefaultActiveZoneSet();
+        ChooseDefaultActiveZoneSet(mi);
     }
 }
 
-void ZoneWindow::LoadZoneSetsFromRegistry() noexcept
+void ZoneWindow::LoadZoneSets(MONITORINFO const& mi) noexcept try
 {
-    wil::unique_hkey key{RegistryHelpers::OpenKey(m_workArea)};
-    if (!key)
-    {
-        return;
-    }
+    std::wstring const path = ZoneSetStore::DefaultPath();
+    ZoneSetStore::EnsureMigrated(path.c_str());
+
+    // The store key only holds the monitor resolution, so zones saved for this monitor with
+    // another work area or DPI are found under the same key. Refit those to the current one,
+    // and record it for zone sets that don't know their work area yet.
+    RECT const workArea{ 0, 0, mi.rcWork.right - mi.rcWork.left, mi.rcWork.bottom - mi.rcWork.top };
+    RECT const scaledWorkArea = ScaledWorkArea(workArea);
 
-    ZoneSetPersistedData data{};
-    DWORD dataSize = sizeof(data);
-    wchar_t value[256]{};
-    DWORD valueLength = ARRAYSIZE(value);
-    DWORD i = 0;
-    while (RegEnumValueW(key.get(), i++, value, &valueLength, nullptr, nullptr, reinterpret_cast<BYTE*>(&data), &dataSize) == ERROR_SUCCESS)
+    std::vector<winrt::com_ptr<IZoneSet>> changed;
     {
-        if (data.Version == VERSION_PERSISTEDDATA)
-        {
-            GUID zoneSetId;
-            if (SUCCEEDED_LOG(CLSIDFromString(value, &zoneSetId)))
+        ZoneSetStore::MappedView view(path.c_str());
+        view.Get().ForEach(m_workArea, [&](ZoneSetStore::Record const& record, RECT const* zones) {
+            auto zoneSet = MakeZoneSet(ZoneSetConfig(
+                record.Id,
+                static_cast<WORD>(record.LayoutId),
+                m_monitor,
+                m_workArea));
+
+            if (zoneSet)
             {
-                auto zoneSet = MakeZoneSet(ZoneSetConfig(
-                    zoneSetId,
-                    data.LayoutId,
-                    m_monitor,
-                    m_workArea));
-
-                if (zoneSet)
+                std::vector<RECT> fitted(zones, zones + record.ZoneCount);
+                if (!EqualRect(&record.WorkArea, &scaledWorkArea))
                 {
-                    for (UINT j = 0; j < data.ZoneCount; j++)
+                    if (!IsRectEmpty(&record.WorkArea))
                     {
-                        zoneSet->AddZone(MakeZone(data.Zones[j]));
+                        fitted = LayoutGenerator::FitZones(LayoutSpecOf(record), fitted, record.WorkArea, workArea, scaledWorkArea);
                     }
+                    changed.push_back(zoneSet);
+                }
 
-                    if (zoneSetId == m_activeZoneSetId)
-                    {
-                        UpdateActiveZoneSet(zoneSet.get());
-                    }
+                for (auto const& zone : fitted)
+                {
+                    zoneSet->AddZone(MakeZone(zone));
+                }
 
-                    m_zoneSets.emplace_back(std::move(zoneSet));
+                if (record.Id == m_activeZoneSetId)
+                {
+                    UpdateActiveZoneSet(zoneSet.get());
                 }
+
+                m_zoneSets.emplace_back(std::move(zoneSet));
             }
-        }
-        else
-        {
-            // Migrate from older settings format
-        }
+        });
+    }
 
-        valueLength = ARRAYSIZE(value);
-        dataSize = sizeof(data);
+    // Persist after the view is gone, the store can't be replaced while it is mapped.
+    if (!changed.empty())
+    {
+        SaveZoneSets(changed);
     }
 }
+CATCH_LOG();
+
+LayoutGenerator::LayoutSpec ZoneWindow::LayoutSpecOf(ZoneSetStore::Record const& record) noexcept
+{
+    LayoutGenerator::LayoutSpec spec;
+    spec.LayoutId = static_cast<WORD>(record.LayoutId);
+    spec.ZoneCount = static_cast<int>(record.ZoneCount);
+
+    // Use the spacing the editor would show for this monitor, with the editor's defaults.
+    DWORD showSpacing = 1;
+    DWORD spacing = 16;
+    RegistryHelpers::GetValue(m_uniqueId, L"ShowSpacing", &showSpacing, sizeof(showSpacing));
+    RegistryHelpers::GetValue(m_uniqueId, L"Spacing", &spacing, sizeof(spacing));
+    spec.Spacing = showSpacing ? static_cast<int>(spacing) : 0;
+    return spec;
+}
+
+RECT ZoneWindow::ScaledWorkArea(RECT const& workArea) noexcept
+{
+    // Like the editor, zones are laid out in unscaled work area coordinates and then scaled by the DPI.
+    Rect const scaled(workArea, GetDpiForMonitor());
+    return { 0, 0, scaled.width(), scaled.height() };
+}
+
+// Saves them as laid out for the current work area, in one store update. The host saves them off
+// the UI thread. Without one, as in the tests, they are saved right away.
+void ZoneWindow::SaveZoneSets(std::vector<winrt::com_ptr<IZoneSet>> const& zoneSets) noexcept try
+{
+    RECT scaledWorkArea{};
+    MONITORINFO mi{};
+    mi.cbSize = sizeof(mi);
+    if (GetMonitorInfoW(m_monitor, &mi))
+    {
+        scaledWorkArea = ScaledWorkArea({ 0, 0, mi.rcWork.right - mi.rcWork.left, mi.rcWork.bottom - mi.rcWork.top });
+    }
+
+    std::vector<ZoneSetStore::Entry> entries;
+    for (auto const& zoneSet : zoneSets)
+    {
+        entries.push_back(ZoneSetStore::EntryOf(zoneSet.get(), m_workArea, scaledWorkArea));
+    }
+
+    if (m_host)
+    {
+        m_host->PersistZoneSets(entries);
+    }
+    else
+    {
+        ZoneSetStore::SaveZoneSets(entries);
+    }
+}
+CATCH_LOG();
 
 void ZoneWindow::UpdateActiveZoneSet(_In_opt_ IZoneSet* zoneSet) noexcept
 {
@@ -394,6 +593,15 @@ void ZoneWindow::UpdateActiveZoneSet(_In_opt_ IZoneSet* zoneSet) noexcept
 
 LRESULT ZoneWindow::WndProc(UINT message, WPARAM wparam, LPARAM lparam) noexcept
 {
+    if (message == WM_PRIV_ANIMATION_FRAME)
+    {
+        if (static_cast<UINT>(lparam) == m_animation)
+        {
+            OnAnimationFrame(static_cast<BYTE>(LOWORD(wparam)), HIWORD(wparam) != 0);
+        }
+        return 0;
+    }
+
     switch (message)
     {
         case WM_NCDESTROY:
@@ -435,20 +643,21 @@ LRESULT ZoneWindow::WndProc(UINT message, WPARAM wparam, LPARAM lparam) noexcept
     return 0;
 }
 
-void ZoneWindow::DrawBackdrop(wil::unique_hdc& hdc, RECT const& clientRect) noexcept
+void ZoneWindow::DrawBackdrop(ArgbSurface const& surface) noexcept
 {
-    FillRectARGB(hdc, &clientRect, 0, RGB(0, 0, 0), false);
+    ZoneRasterizer::FillRect(surface, { 0, 0, surface.width, surface.height }, 0);
 }
 
-void ZoneWindow::DrawZone(wil::unique_hdc& hdc, ColorSetting const& colorSetting, winrt::com_ptr<IZone> zone) noexcept
+void ZoneWindow::DrawZone(ArgbSurface const& surface, ColorSetting const& colorSetting, winrt::com_ptr<IZone> zone) noexcept
 {
     RECT zoneRect = zone->GetZoneRect();
+    auto const fade = [this](BYTE alpha) { return static_cast<BYTE>(alpha * m_opacity / 255); };
     if (colorSetting.borderAlpha > 0)
     {
-        FillRectARGB(hdc, &zoneRect, colorSetting.borderAlpha, colorSetting.border, false);
+        ZoneRasterizer::FillRect(surface, zoneRect, ZoneRasterizer::PremultipliedColor(fade(colorSetting.borderAlpha), colorSetting.border));
         InflateRect(&zoneRect, colorSetting.thickness, colorSetting.thickness);
     }
-    FillRectARGB(hdc, &zoneRect, colorSetting.fillAlpha, colorSetting.fill, false);
+    ZoneRasterizer::FillRect(surface, zoneRect, ZoneRasterizer::PremultipliedColor(fade(colorSetting.fillAlpha), colorSetting.fill));
 
     if (m_flashMode)
     {
@@ -462,30 +671,33 @@ void ZoneWindow::DrawZone(wil::unique_hdc& hdc, ColorSetting const& colorSetting
     POINT offset = { zoneRect.left + padding, zoneRect.top + padding };
     if (!IsOccluded(offset, index))
     {
-        DrawIndex(hdc, offset, index, padding, size, false, false, colorFill); // top left
+        DrawIndex(surface, offset, index, padding, size, false, false, colorFill); // top left
         return;
     }
 
     offset.x = zoneRect.right - ((padding + size) * 3);
     if (!IsOccluded(offset, index))
     {
-        DrawIndex(hdc, offset, index, padding, size, true, false, colorFill); // top right
+        DrawIndex(surface, offset, index, padding, size, true, false, colorFill); // top right
         return;
     }
 
     offset.y = zoneRect.bottom - ((padding + size) * 3);
     if (!IsOccluded(offset, index))
     {
-        DrawIndex(hdc, offset, index, padding, size, true, true, colorFill); // bottom right
+        DrawIndex(surface, offset, index, padding, size, true, true, colorFill); // bottom right
         return;
     }
 
     offset.x = zoneRect.left + padding;
-    DrawIndex(hdc, offset, index, padding, size, false, true, colorFill); // bottom left
+    DrawIndex(surface, offset, index, padding, size, false, true, colorFill); // bottom left
 }
 
-void ZoneWindow::DrawIndex(wil::unique_hdc& hdc, POINT offset, size_t index, int padding, int size, bool flipX, bool flipY, COLORREF colorFill)
+void ZoneWindow::DrawIndex(ArgbSurface const& surface, POINT offset, size_t index, int padding, int size, bool flipX, bool flipY, COLORREF colorFill)
 {
+    UINT32 const outerColor = ZoneRasterizer::PremultipliedColor(200, RGB(50, 50, 50));
+    UINT32 const innerColor = ZoneRasterizer::PremultipliedColor(100, colorFill);
+
     RECT rect = { offset.x, offset.y, offset.x + size, offset.y + size };
     for (int y = 0; y < 3; y++)
     {
@@ -506,12 +718,12 @@ void ZoneWindow::DrawIndex(wil::unique_hdc& hdc, POINT offset, size_t index, int
                 useRect.bottom = useRect.top + size;
             }
 
-            FillRectARGB(hdc, &useRect, 200, RGB(50, 50, 50), true);
+            ZoneRasterizer::BlendRect(surface, useRect, outerColor);
 
             RECT inside = useRect;
             InflateRect(&inside, -2, -2);
 
-            FillRectARGB(hdc, &inside, 100, colorFill, true);
+            ZoneRasterizer::BlendRect(surface, inside, innerColor);
 
             rect.left += (size + padding);
             rect.right = rect.left + size;
@@ -528,7 +740,7 @@ void ZoneWindow::DrawIndex(wil::unique_hdc& hdc, POINT offset, size_t index, int
     }
 }
 
-void ZoneWindow::DrawActiveZoneSet(wil::unique_hdc& hdc, RECT const& clientRect) noexcept
+void ZoneWindow::DrawActiveZoneSet(ArgbSurface const& surface) noexcept
 {
     if (m_activeZoneSet)
     {
@@ -565,15 +777,15 @@ void ZoneWindow::DrawActiveZoneSet(wil::unique_hdc& hdc, RECT const& clientRect)
             {
                 if (m_flashMode)
                 {
-                    DrawZone(hdc, colorFlash, zone);
+                    DrawZone(surface, colorFlash, zone);
                 }
                 else if (m_drawHints)
                 {
-                    DrawZone(hdc, colorHints, zone);
+                    DrawZone(surface, colorHints, zone);
                 }
                 {
                     colorViewer.fill = colors[colorIndex];
-                    DrawZone(hdc, colorViewer, zone);
+                    DrawZone(surface, colorViewer, zone);
                 }
             }
             colorIndex = colorIndex != 0 ? colorIndex - 1 : maxColorIndex;
@@ -587,7 +799,7 @@ void ZoneWindow::DrawActiveZoneSet(wil::unique_hdc& hdc, RECT const& clientRect)
                 max(0, GetGValue(colorHighlight.fill) - 25),
                 max(0, GetBValue(colorHighlight.fill) - 25)
             );
-            DrawZone(hdc, colorHighlight, m_highlightZone);
+            DrawZone(surface, colorHighlight, m_highlightZone);
         }
     }
 }
@@ -601,8 +813,20 @@ void ZoneWindow::OnPaint(wil::unique_hdc& hdc) noexcept
     HPAINTBUFFER bufferedPaint = BeginBufferedPaint(hdc.get(), &clientRect, BPBF_TOPDOWNDIB, nullptr, &hdcMem);
     if (bufferedPaint)
     {
-        DrawBackdrop(hdcMem, clientRect);
-        DrawActiveZoneSet(hdcMem, clientRect);
+        // Rasterize straight into the paint buffer; EndBufferedPaint is the only GDI blit.
+        RGBQUAD* bits{};
+        int rowWidth{};
+        if (SUCCEEDED(GetBufferedPaintBits(bufferedPaint, &bits, &rowWidth)))
+        {
+            ArgbSurface const surface{
+                reinterpret_cast<UINT32*>(bits),
+                clientRect.right - clientRect.left,
+                clientRect.bottom - clientRect.top,
+                rowWidth
+            };
+            DrawBackdrop(surface);
+            DrawActiveZoneSet(surface);
+        }
         EndBufferedPaint(bufferedPaint, TRUE);
     }
 }
@@ -619,6 +843,16 @@ void ZoneWindow::OnKeyUp(WPARAM wparam) noexcept
     }
 }
 
+void ZoneWindow::HighlightZone(winrt::com_ptr<IZone> zone, bool dragEnabled) noexcept
+{
+    m_dragEnabled = dragEnabled;
+    if (zone != m_highlightZone)
+    {
+        m_highlightZone = std::move(zone);
+        InvalidateRect(m_window.get(), nullptr, true);
+    }
+}
+
 winrt::com_ptr<IZone> ZoneWindow::ZoneFromPoint(POINT pt) noexcept
 {
     if (m_activeZoneSet)
@@ -628,7 +862,7 @@ winrt::com_ptr<IZone> ZoneWindow::ZoneFromPoint(POINT pt) noexcept
     return nullptr;
 }
 
-void ZoneWindow::ChooseDefaultActiveZoneSet() noexcept
+void ZoneWindow::ChooseDefaultActiveZoneSet(MONITORINFO const& mi) noexcept
 {
     // Default zone set can be empty (no fancyzones layout), or it can be layout from virtual
     // desktop from which this virtual desktop is created.
@@ -639,7 +873,74 @@ void ZoneWindow::ChooseDefaultActiveZoneSet() noexcept
                 return;
             }
         }
+
+        // The layout was created for another resolution. Predefined layouts are regenerated
+        // and custom layouts scaled for this work area, rather than leaving the monitor without zones.
+        if (auto zoneSet = GenerateZoneSet(id, mi)) {
+            UpdateActiveZoneSet(zoneSet.get());
+            m_zoneSets.emplace_back(std::move(zoneSet));
+        }
+    }
+}
+
+winrt::com_ptr<IZoneSet> ZoneWindow::GenerateZoneSet(GUID const& sourceId, MONITORINFO const& mi) noexcept try
+{
+    LayoutGenerator::LayoutSpec spec;
+    std::vector<RECT> sourceZones;
+    RECT sourceWorkArea{};
+    {
+        ZoneSetStore::MappedView view(ZoneSetStore::DefaultPath().c_str());
+        auto source = view.Get().Find(sourceId);
+        if (!source)
+        {
+            return nullptr;
+        }
+        spec = LayoutSpecOf(*source);
+        RECT const* zones = view.Get().ZonesOf(*source);
+        sourceZones.assign(zones, zones + source->ZoneCount);
+
+        sourceWorkArea = source->WorkArea;
+        if (IsRectEmpty(&sourceWorkArea))
+        {
+            // Saved before work areas were recorded. Fall back to the monitor resolution
+            // in the key, which only lacks the taskbar and any DPI scaling.
+            int width{}, height{};
+            if (swscanf_s(source->WorkAreaKey, L"%d_%d", &width, &height) != 2)
+            {
+                return nullptr;
+            }
+            sourceWorkArea = { 0, 0, width, height };
+        }
+    }
+
+    RECT const workArea{ 0, 0, mi.rcWork.right - mi.rcWork.left, mi.rcWork.bottom - mi.rcWork.top };
+    auto const zones = LayoutGenerator::FitZones(spec, sourceZones, sourceWorkArea, workArea, ScaledWorkArea(workArea));
+    if (zones.empty())
+    {
+        return nullptr;
     }
+
+    GUID id;
+    if (FAILED(CoCreateGuid(&id)))
+    {
+        return nullptr;
+    }
+
+    auto zoneSet = MakeZoneSet(ZoneSetConfig(id, spec.LayoutId, m_monitor, m_workArea));
+    if (zoneSet)
+    {
+        for (auto const& zone : zones)
+        {
+            zoneSet->AddZone(MakeZone(zone));
+        }
+        SaveZoneSets({ zoneSet });
+    }
+    return zoneSet;
+}
+catch (...)
+{
+    LOG_CAUGHT_EXCEPTION();
+    return nullptr;
 }
 
 bool ZoneWindow::IsOccluded(POINT pt, size_t index) noexcept
@@ -712,12 +1013,63 @@ void ZoneWindow::CycleActiveZoneSetInternal(DWORD wparam, Trace::ZoneWindow::Inp
 void ZoneWindow::FlashZones() noexcept
 {
     m_flashMode = true;
+    m_opacity = 255;
 
     ShowWindow(m_window.get(), SW_SHOWNA);
-    std::thread([window = m_window.get()]()
+    Animate(m_flashDuration, false);
+}
+
+void ZoneWindow::FlashZonesUnlessFullScreen(MONITORINFO const& mi) noexcept
+{
+    // Don't flash if the foreground window is in full screen mode
+    RECT windowRect;
+    if (GetWindowRect(GetForegroundWindow(), &windowRect) &&
+        windowRect.left == mi.rcMonitor.left &&
+        windowRect.top == mi.rcMonitor.top &&
+        windowRect.right == mi.rcMonitor.right &&
+        windowRect.bottom == mi.rcMonitor.bottom)
+    {
+        return;
+    }
+    FlashZones();
+}
+
+void ZoneWindow::Animate(UINT duration, bool fadeIn) noexcept
+{
+    UINT const animation = ++m_animation;
+    try
+    {
+        if (auto animations = m_host ? m_host->Animations() : nullptr)
         {
-            AnimateWindow(window, m_flashDuration, AW_HIDE | AW_BLEND);
-        }).detach();
+            // The scheduler thread only posts frames; they are applied here on the UI thread.
+            animations->Start(reinterpret_cast<uintptr_t>(m_window.get()), std::chrono::milliseconds(duration),
+                [window = m_window.get(), animation, fadeIn](double progress) {
+                    BYTE const opacity = static_cast<BYTE>(255 * (fadeIn ? progress : 1.0 - progress));
+                    PostMessage(window, WM_PRIV_ANIMATION_FRAME, MAKEWPARAM(opacity, progress >= 1.0), animation);
+                });
+            return;
+        }
+    }
+    catch (...)
+    {
+        LOG_CAUGHT_EXCEPTION();
+    }
+
+    // No scheduler, skip straight to the end.
+    OnAnimationFrame(fadeIn ? 255 : 0, true);
+}
+
+void ZoneWindow::OnAnimationFrame(BYTE opacity, bool last) noexcept
+{
+    m_opacity = opacity;
+    if (last && (opacity == 0))
+    {
+        ShowWindow(m_window.get(), SW_HIDE);
+    }
+    else
+    {
+        InvalidateRect(m_window.get(), nullptr, true);
+    }
 }
 
 typedef BOOL(WINAPI *GetDpiForMonitorInternalFunc)(HMONITOR, UINT, UINT*, UINT*);
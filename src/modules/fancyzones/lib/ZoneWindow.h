@@ -6,17 +6,25 @@ interface __declspec(uuid("{7F017528-8110-4FB3-BE41-F472969C2560}")) IZoneWindow
 {
     IFACEMETHOD(MoveSizeEnter)(HWND window, bool dragEnabled) = 0;
     IFACEMETHOD(MoveSizeUpdate)(POINT const& ptScreen, bool dragEnabled) = 0;
+    // Like MoveSizeUpdate, for a host that already hit-tested the cursor; -1 highlights no zone.
+    IFACEMETHOD(MoveSizeUpdateZone)(int zoneIndex, bool dragEnabled) = 0;
     IFACEMETHOD(MoveSizeEnd)(HWND window, POINT const& ptScreen) = 0;
     IFACEMETHOD(MoveSizeCancel)() = 0;
     IFACEMETHOD_(bool, IsDragEnabled)() = 0;
     IFACEMETHOD_(void, MoveWindowIntoZoneByIndex)(HWND window, int index) = 0;
-    IFACEMETHOD_(void, MoveWindowIntoZoneByDirection)(HWND window, DWORD vkCode) = 0;
+    IFACEMETHOD_(void, MoveWindowIntoZoneByIndexDeferred)(HWND window, int index, WindowRelayout::Planner& planner) = 0;
+    IFACEMETHOD_(void, MoveWindowIntoZone)(HWND window, int index) = 0;
     IFACEMETHOD_(void, CycleActiveZoneSet)(DWORD vkCode) = 0;
     IFACEMETHOD_(void, SaveWindowProcessToZoneIndex)(HWND window) = 0;
     IFACEMETHOD_(std::wstring, DeviceId)() = 0;
     IFACEMETHOD_(std::wstring, UniqueId)() = 0;
     IFACEMETHOD_(std::wstring, WorkAreaKey)() = 0;
     IFACEMETHOD_(IZoneSet*, ActiveZoneSet)() = 0;
+    // Swaps in the zone sets of another virtual desktop, loading them on its first visit.
+    IFACEMETHOD_(void, SwitchVirtualDesktop)(PCWSTR virtualDesktopId, bool flashZones) = 0;
+    // Makes the layout applied in the editor the active zone set, reusing a stored zone set
+    // with the same layout and zone count.
+    IFACEMETHOD_(void, ApplyEditorLayout)(WORD layoutId, std::vector<RECT> const& zones) = 0;
 };
 
 winrt::com_ptr<IZoneWindow> MakeZoneWindow(IZoneWindowHost* host, HINSTANCE hinstance, HMONITOR monitor,
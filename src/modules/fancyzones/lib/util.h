@@ -38,80 +38,6 @@ inline void MakeWindowTransparent(HWND window)
     }
 }
 
-inline void InitRGB(_Out_ RGBQUAD *quad, BYTE alpha, COLORREF color)
-{
-    ZeroMemory(quad, sizeof(*quad));
-    quad->rgbReserved = alpha;
-    quad->rgbRed = GetRValue(color) * alpha / 255;
-    quad->rgbGreen = GetGValue(color) * alpha / 255;
-    quad->rgbBlue = GetBValue(color) * alpha / 255;
-}
-
-inline void FillRectARGB(wil::unique_hdc& hdc, RECT const *prcFill, BYTE alpha, COLORREF color, bool blendAlpha)
-{
-    BITMAPINFO bi;
-    ZeroMemory(&bi, sizeof(bi));
-    bi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
-    bi.bmiHeader.biWidth = 1;
-    bi.bmiHeader.biHeight = 1;
-    bi.bmiHeader.biPlanes = 1;
-    bi.bmiHeader.biBitCount = 32;
-    bi.bmiHeader.biCompression = BI_RGB;
-
-    RECT fillRect;
-    CopyRect(&fillRect, prcFill);
-    if ((alpha == 255) || !blendAlpha)
-    {
-        // Opaque or the caller does not want to blend the alpha
-        RGBQUAD bitmapBits;
-        InitRGB(&bitmapBits, alpha, color);
-        StretchDIBits(
-            hdc.get(),
-            fillRect.left,
-            fillRect.top,
-            fillRect.right - fillRect.left,
-            fillRect.bottom - fillRect.top,
-            0, 0, 1, 1, &bitmapBits, &bi, DIB_RGB_COLORS, SRCCOPY);
-    }
-    else
-    {
-        if (wil::unique_hdc hdcSrc{ CreateCompatibleDC(hdc.get()) })
-        {
-            void* pBitmapBits;
-            if (wil::unique_hbitmap bitmapSource{ CreateDIBSection(hdcSrc.get(), &bi, DIB_RGB_COLORS, &pBitmapBits, nullptr, 0) })
-            {
-                InitRGB(reinterpret_cast<RGBQUAD *>(pBitmapBits), alpha, color);
-
-                wil::unique_select_object bitmapOld{ SelectObject(hdcSrc.get(), bitmapSource.get()) };
-                BLENDFUNCTION bf = { AC_SRC_OVER, 0, 255, AC_SRC_ALPHA };
-                GdiAlphaBlend(
-                    hdc.get(),
-                    fillRect.left,
-                    fillRect.top,
-                    fillRect.right - fillRect.left,
-                    fillRect.bottom - fillRect.top,
-                    hdcSrc.get(), 0, 0, 1, 1, bf);
-            }
-
-        }
-    }
-}
-
-inline void FrameRectARGB(wil::unique_hdc& hdc, const RECT &rc, BYTE bAlpha, COLORREF clr, int thickness)
-{
-    RECT sides[] = {
-        { rc.left, rc.top, (rc.left + thickness), rc.bottom },
-        { (rc.right - thickness), rc.top, rc.right, rc.bottom },
-        { (rc.left + thickness), rc.top, (rc.right - thickness), (rc.top + thickness) },
-        { (rc.left + thickness), (rc.bottom - thickness), (rc.right - thickness), rc.bottom }
-    };
-
-    for (UINT i = 0; i < ARRAYSIZE(sides); i++)
-    {
-        FillRectARGB(hdc, &(sides[i]), bAlpha, clr, false);
-    }
-}
-
 inline void ParseDeviceId(PCWSTR deviceId, PWSTR parsedId, size_t size)
 {
     // We're interested in the unique part between the first and last #'s
@@ -0,0 +1,205 @@
+#include "pch.h"
+#include "lib\AnimationScheduler.h"
+
+#include <future>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace FancyZonesUnitTests
+{
+    TEST_CLASS(AnimationQueueUnitTests)
+    {
+        using Time = AnimationQueue::Time;
+
+        // Runs the frames due at now and returns when the next one is due, -1 once idle.
+        static long long Tick(AnimationQueue& queue, long long now)
+        {
+            std::vector<AnimationQueue::Step> steps;
+            auto const next = queue.Advance(Time(now), steps);
+            for (auto const& step : steps)
+            {
+                (*step.Callback)(step.Progress);
+            }
+            return next ? next->count() : -1;
+        }
+
+        TEST_METHOD(FramesUntilDone)
+        {
+            AnimationQueue queue(Time(16));
+            std::vector<double> progress;
+            queue.Start(1, Time(1000), Time(40), [&](double p) { progress.push_back(p); });
+
+            Assert::AreEqual(1016ll, Tick(queue, 1000));
+            Assert::AreEqual(1032ll, Tick(queue, 1016));
+            Assert::AreEqual(1040ll, Tick(queue, 1032)); // The last frame lands on the end
+            Assert::AreEqual(-1ll, Tick(queue, 1040));
+
+            Assert::AreEqual(static_cast<size_t>(4), progress.size());
+            Assert::AreEqual(0.0, progress[0]);
+            Assert::AreEqual(0.4, progress[1]);
+            Assert::AreEqual(0.8, progress[2]);
+            Assert::AreEqual(1.0, progress[3]);
+            Assert::AreEqual(static_cast<size_t>(0), queue.Size());
+        }
+
+        TEST_METHOD(EarlyTickRunsNothing)
+        {
+            AnimationQueue queue(Time(16));
+            int frames = 0;
+            queue.Start(1, Time(0), Time(100), [&](double) { frames++; });
+            Tick(queue, 0);
+            Assert::AreEqual(16ll, Tick(queue, 10));
+            Assert::AreEqual(1, frames);
+        }
+
+        TEST_METHOD(LateTickCoalesces)
+        {
+            AnimationQueue queue(Time(16));
+            std::vector<double> progress;
+            queue.Start(1, Time(0), Time(700), [&](double p) { progress.push_back(p); });
+            Tick(queue, 0);
+            Tick(queue, 350);
+            Tick(queue, 5000);
+
+            Assert::AreEqual(static_cast<size_t>(3), progress.size());
+            Assert::AreEqual(0.5, progress[1]);
+            Assert::AreEqual(1.0, progress[2]);
+        }
+
+        TEST_METHOD(ZeroDuration)
+        {
+            AnimationQueue queue;
+            std::vector<double> progress;
+            queue.Start(1, Time(0), Time(0), [&](double p) { progress.push_back(p); });
+            Assert::AreEqual(-1ll, Tick(queue, 0));
+            Assert::AreEqual(static_cast<size_t>(1), progress.size());
+            Assert::AreEqual(1.0, progress[0]);
+        }
+
+        TEST_METHOD(RestartSupersedes)
+        {
+            AnimationQueue queue(Time(16));
+            int first = 0;
+            int second = 0;
+            queue.Start(1, Time(0), Time(700), [&](double) { first++; });
+            Tick(queue, 0);
+            queue.Start(1, Time(5), Time(700), [&](double) { second++; });
+            Assert::AreEqual(static_cast<size_t>(1), queue.Size());
+
+            for (long long now = 5; now <= 705; now += 16)
+            {
+                Tick(queue, now);
+            }
+            Tick(queue, 705);
+
+            Assert::AreEqual(1, first);
+            Assert::IsTrue(second > 1);
+            Assert::AreEqual(static_cast<size_t>(0), queue.Size());
+        }
+
+        TEST_METHOD(Cancel)
+        {
+            AnimationQueue queue;
+            int frames = 0;
+            queue.Start(1, Time(0), Time(100), [&](double) { frames++; });
+            Assert::IsTrue(queue.Cancel(1));
+            Assert::IsFalse(queue.Cancel(1));
+            Assert::AreEqual(-1ll, Tick(queue, 0));
+            Assert::AreEqual(0, frames);
+        }
+
+        TEST_METHOD(IndependentKeys)
+        {
+            AnimationQueue queue(Time(16));
+            double left = -1;
+            double right = -1;
+            queue.Start(1, Time(0), Time(200), [&](double p) { left = p; });
+            queue.Start(2, Time(8), Time(20), [&](double p) { right = p; });
+
+            Assert::AreEqual(8ll, Tick(queue, 0));
+            Assert::AreEqual(0.0, left);
+            Assert::AreEqual(-1.0, right);
+
+            Assert::AreEqual(16ll, Tick(queue, 8));
+            Assert::AreEqual(0.0, right);
+
+            Assert::AreEqual(24ll, Tick(queue, 16)); // Only the first is due
+            Assert::AreEqual(28ll, Tick(queue, 24));
+            Assert::AreEqual(0.8, right);
+            Assert::AreEqual(32ll, Tick(queue, 28));
+            Assert::AreEqual(1.0, right);
+            Assert::AreEqual(static_cast<size_t>(1), queue.Size());
+        }
+
+        TEST_METHOD(LayoutCyclingBurst)
+        {
+            // Win+Ctrl+digit held down on three monitors: every keystroke restarts the flash
+            // of each zone window, yet only one animation per window is ever alive.
+            AnimationQueue queue(Time(16));
+            std::vector<int> finished(3);
+            for (long long now = 0; now < 2000; now += 4)
+            {
+                if (now < 1000)
+                {
+                    for (uintptr_t window = 0; window < 3; window++)
+                    {
+                        queue.Start(window, Time(now), Time(700), [&finished, window](double p) {
+                            if (p >= 1.0)
+                            {
+                                finished[window]++;
+                            }
+                        });
+                    }
+                    Assert::AreEqual(static_cast<size_t>(3), queue.Size());
+                }
+                Tick(queue, now);
+            }
+
+            for (int count : finished)
+            {
+                Assert::AreEqual(1, count);
+            }
+            Assert::AreEqual(static_cast<size_t>(0), queue.Size());
+        }
+    };
+
+    TEST_CLASS(AnimationSchedulerUnitTests)
+    {
+        TEST_METHOD(RunsToCompletion)
+        {
+            std::promise<void> done;
+            std::vector<double> progress;
+            {
+                AnimationScheduler scheduler;
+                scheduler.Start(1, std::chrono::milliseconds(50), [&](double p) {
+                    progress.push_back(p);
+                    if (p >= 1.0)
+                    {
+                        done.set_value();
+                    }
+                });
+                Assert::IsTrue(done.get_future().wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+            }
+
+            Assert::IsTrue(progress.size() >= 2);
+            Assert::AreEqual(1.0, progress.back());
+            Assert::IsTrue(std::is_sorted(progress.begin(), progress.end()));
+        }
+
+        TEST_METHOD(CancelStopsFrames)
+        {
+            std::atomic<int> frames = 0;
+            AnimationScheduler scheduler;
+            scheduler.Start(1, std::chrono::hours(1), [&](double) { frames++; });
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            scheduler.Cancel(1);
+
+            // A frame collected just before the cancel may still run.
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            int const seen = frames;
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            Assert::AreEqual(seen, frames.load());
+            Assert::IsTrue(seen >= 1);
+        }
+    };
+}
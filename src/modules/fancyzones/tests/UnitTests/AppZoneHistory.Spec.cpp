@@ -0,0 +1,172 @@
+#include "pch.h"
+#include "lib\AppZoneHistory.h"
+
+#include <chrono>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace FancyZonesUnitTests
+{
+    TEST_CLASS(AppZoneHistoryUnitTests)
+    {
+        static std::optional<int> Find(std::vector<AppZoneHistory::Entry> const& changes, PCWSTR monitorKey, PCWSTR processPath)
+        {
+            for (auto const& change : changes)
+            {
+                if ((change.MonitorKey == monitorKey) && (change.ProcessPath == processPath))
+                {
+                    return change.ZoneIndex;
+                }
+            }
+            return std::nullopt;
+        }
+
+        TEST_METHOD(GetMissing)
+        {
+            AppZoneHistory history;
+            Assert::IsFalse(history.Get(L"1", L"C:\\app.exe").has_value());
+        }
+
+        TEST_METHOD(SetAndGet)
+        {
+            AppZoneHistory history;
+            history.Set(L"1", L"C:\\app.exe", 3);
+            history.Set(L"2", L"C:\\app.exe", 5);
+
+            Assert::AreEqual(3, *history.Get(L"1", L"C:\\app.exe"));
+            Assert::AreEqual(5, *history.Get(L"2", L"C:\\app.exe"));
+            Assert::IsFalse(history.Get(L"1", L"C:\\other.exe").has_value());
+            Assert::AreEqual(static_cast<size_t>(2), history.Size());
+        }
+
+        TEST_METHOD(SetMinusOneRemoves)
+        {
+            AppZoneHistory history;
+            history.Set(L"1", L"C:\\app.exe", 3);
+            history.Set(L"1", L"C:\\app.exe", -1);
+
+            Assert::IsFalse(history.Get(L"1", L"C:\\app.exe").has_value());
+            Assert::AreEqual(static_cast<size_t>(0), history.Size());
+        }
+
+        TEST_METHOD(PendingChangesAreCoalesced)
+        {
+            AppZoneHistory history;
+            history.Set(L"1", L"C:\\app.exe", 1);
+            history.Set(L"1", L"C:\\app.exe", 2);
+            history.Set(L"1", L"C:\\other.exe", 4);
+            history.Set(L"1", L"C:\\other.exe", -1);
+
+            auto changes = history.TakePendingChanges();
+            Assert::AreEqual(static_cast<size_t>(2), changes.size());
+            Assert::AreEqual(2, *Find(changes, L"1", L"C:\\app.exe"));
+            Assert::AreEqual(-1, *Find(changes, L"1", L"C:\\other.exe"));
+
+            Assert::IsFalse(history.HasPendingChanges());
+            Assert::IsTrue(history.TakePendingChanges().empty());
+        }
+
+        TEST_METHOD(SettingSameValueIsNotJournaled)
+        {
+            AppZoneHistory history;
+            history.Set(L"1", L"C:\\app.exe", 1);
+            history.TakePendingChanges();
+
+            history.Set(L"1", L"C:\\app.exe", 1);
+            Assert::IsFalse(history.HasPendingChanges());
+        }
+
+        TEST_METHOD(LoadIsNotJournaled)
+        {
+            AppZoneHistory history;
+            history.Load({ { L"1", L"C:\\app.exe", 1 }, { L"2", L"C:\\other.exe", 2 } });
+
+            Assert::IsFalse(history.HasPendingChanges());
+            Assert::AreEqual(1, *history.Get(L"1", L"C:\\app.exe"));
+            Assert::AreEqual(2, *history.Get(L"2", L"C:\\other.exe"));
+        }
+
+        TEST_METHOD(EvictsLeastRecentlyUsed)
+        {
+            AppZoneHistory history(2);
+            history.Set(L"1", L"a.exe", 1);
+            history.Set(L"1", L"b.exe", 2);
+
+            // Touch a so b becomes the least recently used entry.
+            history.Get(L"1", L"a.exe");
+            history.TakePendingChanges();
+
+            history.Set(L"1", L"c.exe", 3);
+            Assert::AreEqual(static_cast<size_t>(2), history.Size());
+            Assert::IsTrue(history.Get(L"1", L"a.exe").has_value());
+            Assert::IsFalse(history.Get(L"1", L"b.exe").has_value());
+            Assert::IsTrue(history.Get(L"1", L"c.exe").has_value());
+
+            // The eviction is journaled so the persisted copy stays bounded too.
+            auto changes = history.TakePendingChanges();
+            Assert::AreEqual(-1, *Find(changes, L"1", L"b.exe"));
+            Assert::AreEqual(3, *Find(changes, L"1", L"c.exe"));
+        }
+
+        TEST_METHOD(LoadOverCapacityJournalsEvictions)
+        {
+            AppZoneHistory history(1);
+            history.Load({ { L"1", L"old.exe", 1 }, { L"1", L"new.exe", 2 } });
+
+            Assert::AreEqual(static_cast<size_t>(1), history.Size());
+            Assert::IsTrue(history.Get(L"1", L"new.exe").has_value());
+
+            auto changes = history.TakePendingChanges();
+            Assert::AreEqual(static_cast<size_t>(1), changes.size());
+            Assert::AreEqual(-1, *Find(changes, L"1", L"old.exe"));
+        }
+
+        // Replays 10k window creations over 250 applications: each one looks up the last zone and
+        // records one when there is none, and the journal is drained in batches the way the
+        // FancyZones flusher does. Logs the time per event.
+        TEST_METHOD(ManyWindowsStayWithinCapacity)
+        {
+            constexpr int events = 10000;
+            constexpr int eventsPerBatch = 100;
+
+            std::vector<std::wstring> processPaths;
+            for (int i = 0; i < 250; i++)
+            {
+                processPaths.push_back(L"C:\\Program Files\\App" + std::to_wstring(i) + L"\\app.exe");
+            }
+
+            AppZoneHistory history(100);
+            size_t hits = 0;
+            size_t persisted = 0;
+            auto const start = std::chrono::steady_clock::now();
+            for (int i = 0; i < events; i++)
+            {
+                // Most windows belong to a few applications that are used all the time.
+                size_t const app = (i % 5 == 0) ? (i / 5 * 7919) % processPaths.size() : (i * 31) % 50;
+                std::wstring const& processPath = processPaths[app];
+                if (history.Get(L"1", processPath).has_value())
+                {
+                    hits++;
+                }
+                else
+                {
+                    history.Set(L"1", processPath, i % 7);
+                }
+
+                if ((i + 1) % eventsPerBatch == 0)
+                {
+                    persisted += history.TakePendingChanges().size();
+                }
+            }
+            auto const elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+            Assert::AreEqual(static_cast<size_t>(100), history.Size());
+            Assert::IsFalse(history.HasPendingChanges());
+
+            std::wstring const message = std::to_wstring(events) + L" window creations: " + std::to_wstring(elapsed.count() / events) +
+                                         L" ns per event, " + std::to_wstring(hits) + L" hits, " + std::to_wstring(persisted) +
+                                         L" changes persisted in " + std::to_wstring(events / eventsPerBatch) + L" batches";
+            Logger::WriteMessage(message.c_str());
+        }
+    };
+}
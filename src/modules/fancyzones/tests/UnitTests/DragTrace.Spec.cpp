@@ -0,0 +1,384 @@
+#include "pch.h"
+#include "lib\DragTrace.h"
+#include "lib\ZoneSet.h"
+
+#include <map>
+#include <sstream>
+
+#include "Util.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace FancyZonesUnitTests
+{
+    TEST_CLASS(DragTraceUnitTests)
+    {
+        using EventType = DragTrace::EventType;
+
+        // Two 1000x800 monitors side by side, taskbar at the bottom. The left one
+        // has two columns, the right one has no layout.
+        static std::vector<DragTrace::Monitor> Monitors()
+        {
+            DragTrace::Monitor left{ 1, { 0, 0, 1000, 800 }, { 0, 0, 1000, 760 }, { { 0, 0, 500, 760 }, { 500, 0, 1000, 760 } } };
+            DragTrace::Monitor right{ 2, { 1000, 0, 2000, 800 }, { 1000, 0, 2000, 760 }, {} };
+            return { left, right };
+        }
+
+        static DragTrace::Event Start(uint32_t time, uint64_t window, int x, int y, bool shift)
+        {
+            return { EventType::MoveSizeStart, time, window, { x, y }, shift, { 100, 100, 600, 500 } };
+        }
+
+        static DragTrace::Event Move(uint32_t time, uint64_t window, int x, int y, bool shift)
+        {
+            return { EventType::LocationChange, time, window, { x, y }, shift, {} };
+        }
+
+        static DragTrace::Event End(uint32_t time, uint64_t window, int x, int y, bool shift)
+        {
+            return { EventType::MoveSizeEnd, time, window, { x, y }, shift, {} };
+        }
+
+        static DragTrace::SimulatedFancyZones::Placement Placement(DragTrace::SimulatedFancyZones const& fancyZones, uint64_t window)
+        {
+            for (auto const& placement : fancyZones.Placements())
+            {
+                if (placement.Window == window)
+                {
+                    return placement;
+                }
+            }
+            Assert::Fail(L"window was never dropped");
+            return {};
+        }
+
+        // Hit-tests through FancyZones' own ZoneSet, built from the trace's layouts.
+        class ZoneSetLocator : public DragTrace::ZoneLocator
+        {
+        public:
+            explicit ZoneSetLocator(std::vector<DragTrace::Monitor> const& monitors)
+            {
+                for (auto const& monitor : monitors)
+                {
+                    auto zoneSet = MakeZoneSet(ZoneSetConfig({}, 0xFFFF, Mocks::Monitor(), L"WorkAreaIn"));
+                    for (auto const& zone : monitor.Zones)
+                    {
+                        zoneSet->AddZone(MakeZone({ zone.Left, zone.Top, zone.Right, zone.Bottom }));
+                    }
+                    m_zoneSets.emplace(monitor.Id, std::move(zoneSet));
+                }
+            }
+
+            int ZoneFromPoint(DragTrace::Monitor const& monitor, DragTrace::Point client, int64_t& zoneArea) override
+            {
+                winrt::com_ptr<IZone> zone = m_zoneSets.at(monitor.Id)->ZoneFromPoint({ client.X, client.Y });
+                if (!zone)
+                {
+                    zoneArea = 0;
+                    return -1;
+                }
+
+                RECT const rect = zone->GetZoneRect();
+                zoneArea = static_cast<int64_t>(rect.right - rect.left) * (rect.bottom - rect.top);
+                return static_cast<int>(zone->Id()) - 1; // Zone ids start at 1
+            }
+
+        private:
+            std::map<uint64_t, winrt::com_ptr<IZoneSet>> m_zoneSets;
+        };
+
+        TEST_METHOD(RoundTrip)
+        {
+            DragTrace::Trace trace{ Monitors(), { Start(0, 7, 300, 110, true), Move(16, 7, 310, 120, true), End(40, 7, 700, 300, false) } };
+            std::stringstream stream;
+            DragTrace::Write(stream, trace);
+
+            DragTrace::Trace read;
+            std::string error;
+            Assert::IsTrue(DragTrace::Read(stream, read, &error));
+            Assert::IsTrue(read.Monitors == trace.Monitors);
+            Assert::AreEqual(trace.Events.size(), read.Events.size());
+            for (size_t i = 0; i < trace.Events.size(); i++)
+            {
+                Assert::IsTrue(read.Events[i].Type == trace.Events[i].Type);
+                Assert::AreEqual(trace.Events[i].TimeMs, read.Events[i].TimeMs);
+                Assert::AreEqual(trace.Events[i].Window, read.Events[i].Window);
+                Assert::AreEqual(trace.Events[i].Cursor.X, read.Events[i].Cursor.X);
+                Assert::AreEqual(trace.Events[i].Cursor.Y, read.Events[i].Cursor.Y);
+                Assert::AreEqual(trace.Events[i].Shift, read.Events[i].Shift);
+            }
+            Assert::IsTrue(read.Events[0].WindowRect == trace.Events[0].WindowRect);
+        }
+
+        TEST_METHOD(AppendedEvents)
+        {
+            std::stringstream stream;
+            DragTrace::Write(stream, { Monitors(), { Start(0, 7, 300, 110, true), End(10, 7, 300, 110, true) } });
+            DragTrace::WriteEvents(stream, { Start(500, 8, 300, 110, true), End(520, 8, 300, 110, true) });
+
+            DragTrace::Trace read;
+            Assert::IsTrue(DragTrace::Read(stream, read));
+            Assert::AreEqual(static_cast<size_t>(4), read.Events.size());
+            Assert::AreEqual(static_cast<uint64_t>(8), read.Events[3].Window);
+        }
+
+        TEST_METHOD(ReadErrors)
+        {
+            auto const fails = [](std::string const& text, std::string const& expected) {
+                std::istringstream stream(text);
+                DragTrace::Trace trace;
+                std::string error;
+                Assert::IsFalse(DragTrace::Read(stream, trace, &error));
+                Assert::AreEqual(expected, error);
+            };
+
+            fails("", "line 1: not a drag trace");
+            fails("fancyzones-drag-trace 1\nzone 0 0 10 10\n", "line 2: malformed zone");
+            fails("fancyzones-drag-trace 1\nmonitor 1 0 0 10\n", "line 2: malformed monitor");
+            fails("fancyzones-drag-trace 1\n\nstart 0 1 5 5 1\n", "line 3: malformed window rect");
+            fails("fancyzones-drag-trace 1\nmove 0 1 5\n", "line 2: malformed event");
+            fails("fancyzones-drag-trace 1\nresize 0 1 5 5 0\n", "line 2: unknown record");
+        }
+
+        TEST_METHOD(Percentiles)
+        {
+            std::vector<double> samples;
+            for (int i = 100; i >= 1; i--)
+            {
+                samples.push_back(i);
+            }
+
+            auto const stats = DragTrace::Summarize(samples);
+            Assert::AreEqual(static_cast<size_t>(100), stats.Count);
+            Assert::AreEqual(50.0, stats.P50);
+            Assert::AreEqual(90.0, stats.P90);
+            Assert::AreEqual(99.0, stats.P99);
+            Assert::AreEqual(100.0, stats.Max);
+
+            auto const single = DragTrace::Summarize({ 3.0 });
+            Assert::AreEqual(3.0, single.P50);
+            Assert::AreEqual(3.0, single.P99);
+
+            Assert::AreEqual(static_cast<size_t>(0), DragTrace::Summarize({}).Count);
+        }
+
+        TEST_METHOD(DropIntoZone)
+        {
+            DragTrace::Trace trace{ Monitors(), { Start(0, 7, 300, 110, true), Move(16, 7, 400, 200, true), Move(32, 7, 700, 300, true), End(48, 7, 700, 300, true) } };
+            DragTrace::SimulatedFancyZones fancyZones(trace.Monitors);
+            auto const report = DragTrace::Replay(trace, fancyZones);
+
+            Assert::AreEqual(static_cast<size_t>(1), report.ByType[static_cast<size_t>(EventType::MoveSizeStart)].Count);
+            Assert::AreEqual(static_cast<size_t>(2), report.ByType[static_cast<size_t>(EventType::LocationChange)].Count);
+            Assert::AreEqual(static_cast<size_t>(1), report.ByType[static_cast<size_t>(EventType::MoveSizeEnd)].Count);
+            Assert::AreEqual(static_cast<size_t>(4), report.All.Count);
+            Assert::AreEqual(static_cast<size_t>(0), report.Skipped);
+
+            auto const placement = Placement(fancyZones, 7);
+            Assert::AreEqual(static_cast<uint64_t>(1), placement.Monitor);
+            Assert::AreEqual(1, placement.Zone);
+            Assert::IsFalse(fancyZones.InMoveSize());
+        }
+
+        TEST_METHOD(HighlightFollowsCursor)
+        {
+            DragTrace::SimulatedFancyZones fancyZones(Monitors());
+            fancyZones.MoveSizeStart(7, 1, { 300, 110 }, true, { 100, 100, 600, 500 });
+            Assert::IsTrue(fancyZones.InMoveSize());
+            Assert::AreEqual(-1, fancyZones.HighlightZone());
+
+            fancyZones.MoveSizeUpdate(1, { 200, 200 }, true);
+            Assert::AreEqual(0, fancyZones.HighlightZone());
+            fancyZones.MoveSizeUpdate(1, { 800, 200 }, true);
+            Assert::AreEqual(1, fancyZones.HighlightZone());
+            fancyZones.MoveSizeUpdate(1, { 800, 790 }, true); // Over the taskbar
+            Assert::AreEqual(-1, fancyZones.HighlightZone());
+        }
+
+        TEST_METHOD(ResizeIsIgnored)
+        {
+            // The cursor is on the window border, so this is a resize.
+            DragTrace::Trace trace{ Monitors(), { Start(0, 7, 102, 300, true), Move(16, 7, 200, 300, true), End(32, 7, 200, 300, true) } };
+            DragTrace::SimulatedFancyZones fancyZones(trace.Monitors);
+            DragTrace::Replay(trace, fancyZones);
+
+            Assert::AreEqual(-1, Placement(fancyZones, 7).Zone);
+        }
+
+        TEST_METHOD(ShiftReleased)
+        {
+            DragTrace::Trace trace{ Monitors(), { Start(0, 7, 300, 110, true), Move(16, 7, 700, 300, true), Move(32, 7, 700, 300, false), End(48, 7, 700, 300, false) } };
+            DragTrace::SimulatedFancyZones fancyZones(trace.Monitors);
+            DragTrace::Replay(trace, fancyZones);
+
+            auto const placement = Placement(fancyZones, 7);
+            Assert::AreEqual(static_cast<uint64_t>(0), placement.Monitor);
+            Assert::AreEqual(-1, placement.Zone);
+        }
+
+        TEST_METHOD(ShiftPressedMidDrag)
+        {
+            DragTrace::Trace trace{ Monitors(), { Start(0, 7, 300, 110, false), Move(16, 7, 250, 300, false), Move(32, 7, 250, 300, true), End(48, 7, 250, 300, true) } };
+            DragTrace::SimulatedFancyZones fancyZones(trace.Monitors);
+            DragTrace::Replay(trace, fancyZones);
+
+            Assert::AreEqual(0, Placement(fancyZones, 7).Zone);
+        }
+
+        TEST_METHOD(WithoutShiftDrag)
+        {
+            // With shiftDrag off, zones show unless shift is held.
+            DragTrace::Trace trace{ Monitors(), { Start(0, 7, 300, 110, false), Move(16, 7, 700, 300, false), End(32, 7, 700, 300, false) } };
+            DragTrace::SimulatedFancyZones fancyZones(trace.Monitors, false);
+            DragTrace::Replay(trace, fancyZones);
+
+            Assert::AreEqual(1, Placement(fancyZones, 7).Zone);
+        }
+
+        TEST_METHOD(DragAcrossMonitors)
+        {
+            // The right monitor has no zones, so the drop there leaves the window unzoned
+            // even though the drag started over a zone.
+            DragTrace::Trace trace{ Monitors(), {
+                Start(0, 7, 300, 110, true), Move(16, 7, 800, 300, true), Move(32, 7, 1500, 300, true), End(48, 7, 1500, 300, true),
+                Start(100, 8, 300, 110, true), Move(116, 8, 1500, 300, true), Move(132, 8, 200, 300, true), End(148, 8, 200, 300, true) } };
+            DragTrace::SimulatedFancyZones fancyZones(trace.Monitors);
+            DragTrace::Replay(trace, fancyZones);
+
+            Assert::AreEqual(-1, Placement(fancyZones, 7).Zone);
+            auto const placement = Placement(fancyZones, 8);
+            Assert::AreEqual(static_cast<uint64_t>(1), placement.Monitor);
+            Assert::AreEqual(0, placement.Zone);
+        }
+
+        TEST_METHOD(DragFollowsMonitorUnderCursor)
+        {
+            // The right monitor gets a zone with spacing around it. Crossing into the spacing
+            // already moves the drag there, without a zone to highlight yet.
+            auto monitors = Monitors();
+            monitors[1].Zones = { { 100, 100, 900, 660 } };
+            DragTrace::SimulatedFancyZones fancyZones(monitors);
+            fancyZones.MoveSizeStart(7, 1, { 300, 110 }, true, { 100, 100, 600, 500 });
+            fancyZones.MoveSizeUpdate(1, { 800, 300 }, true);
+            Assert::AreEqual(static_cast<uint64_t>(1), fancyZones.ActiveMonitor());
+
+            fancyZones.MoveSizeUpdate(2, { 1050, 300 }, true);
+            Assert::AreEqual(static_cast<uint64_t>(2), fancyZones.ActiveMonitor());
+            Assert::AreEqual(-1, fancyZones.HighlightZone());
+
+            fancyZones.MoveSizeUpdate(2, { 1200, 300 }, true);
+            Assert::AreEqual(static_cast<uint64_t>(2), fancyZones.ActiveMonitor());
+            Assert::AreEqual(0, fancyZones.HighlightZone());
+
+            fancyZones.MoveSizeUpdate(1, { 990, 300 }, true);
+            Assert::AreEqual(static_cast<uint64_t>(1), fancyZones.ActiveMonitor());
+            Assert::AreEqual(1, fancyZones.HighlightZone());
+
+            fancyZones.MoveSizeEnd(7, { 990, 300 }, true);
+            auto const placement = Placement(fancyZones, 7);
+            Assert::AreEqual(static_cast<uint64_t>(1), placement.Monitor);
+            Assert::AreEqual(1, placement.Zone);
+        }
+
+        TEST_METHOD(EventsOffscreenAreSkipped)
+        {
+            DragTrace::Trace trace{ Monitors(), { Start(0, 7, 300, 110, true), Move(16, 7, -50, 300, true), Move(32, 7, 2500, 300, true), End(48, 7, 700, 300, true) } };
+            DragTrace::SimulatedFancyZones fancyZones(trace.Monitors);
+            auto const report = DragTrace::Replay(trace, fancyZones);
+
+            Assert::AreEqual(static_cast<size_t>(2), report.Skipped);
+            Assert::AreEqual(static_cast<size_t>(2), report.All.Count);
+            Assert::AreEqual(1, Placement(fancyZones, 7).Zone);
+        }
+
+        TEST_METHOD(LastDropWins)
+        {
+            DragTrace::Trace trace{ Monitors(), {
+                Start(0, 7, 300, 110, true), End(10, 7, 200, 300, true),
+                Start(20, 9, 300, 110, true), End(30, 9, 200, 300, true),
+                Start(40, 7, 300, 110, true), End(50, 7, 800, 300, true) } };
+            DragTrace::SimulatedFancyZones fancyZones(trace.Monitors);
+            DragTrace::Replay(trace, fancyZones);
+
+            Assert::AreEqual(static_cast<size_t>(2), fancyZones.Placements().size());
+            Assert::AreEqual(static_cast<uint64_t>(7), fancyZones.Placements()[0].Window);
+            Assert::AreEqual(1, fancyZones.Placements()[0].Zone);
+        }
+
+        TEST_METHOD(OverlappingZones)
+        {
+            // The smallest zone under the cursor wins, the later one among equals.
+            auto monitors = Monitors();
+            monitors[0].Zones = { { 0, 0, 1000, 760 }, { 100, 100, 400, 400 }, { 100, 100, 400, 400 } };
+            DragTrace::SimulatedFancyZones fancyZones(monitors);
+            fancyZones.MoveSizeStart(7, 1, { 300, 110 }, true, { 100, 100, 600, 500 });
+            fancyZones.MoveSizeUpdate(1, { 200, 200 }, true);
+            Assert::AreEqual(2, fancyZones.HighlightZone());
+            fancyZones.MoveSizeUpdate(1, { 600, 200 }, true);
+            Assert::AreEqual(0, fancyZones.HighlightZone());
+        }
+
+        TEST_METHOD(Report)
+        {
+            DragTrace::Trace trace{ Monitors(), { Start(0, 7, 300, 110, true), End(16, 7, 700, 300, true) } };
+            DragTrace::SimulatedFancyZones fancyZones(trace.Monitors);
+            auto const report = DragTrace::Replay(trace, fancyZones);
+
+            std::ostringstream out;
+            DragTrace::WriteReport(out, report, fancyZones.Placements());
+            auto const text = out.str();
+            Assert::IsTrue(text.find("model: latencies are of SimulatedFancyZones") == 0);
+            Assert::IsTrue(text.find("start: count 1") != std::string::npos);
+            Assert::IsTrue(text.find("move: count 0") != std::string::npos);
+            Assert::IsTrue(text.find("skipped: 0") != std::string::npos);
+            Assert::IsTrue(text.find("window 7: monitor 1 zone 1") != std::string::npos);
+        }
+
+        TEST_METHOD(ReplayThroughZoneSet)
+        {
+            // Four columns on the left monitor and a 2x2 grid on the right one. Every drag
+            // sweeps from the left monitor to the right one and back to a column.
+            auto monitors = Monitors();
+            monitors[0].Zones = { { 0, 0, 250, 760 }, { 250, 0, 500, 760 }, { 500, 0, 750, 760 }, { 750, 0, 1000, 760 } };
+            monitors[1].Zones = { { 0, 0, 500, 380 }, { 500, 0, 1000, 380 }, { 0, 380, 500, 760 }, { 500, 380, 1000, 760 } };
+
+            DragTrace::Trace trace{ monitors, {} };
+            uint32_t time = 0;
+            for (uint64_t window = 1; window <= 200; window++)
+            {
+                trace.Events.push_back(Start(time, window, 300, 110, true));
+                for (int step = 0; step < 50; step++)
+                {
+                    trace.Events.push_back(Move(time += 16, window, 40 * step, 100 + 12 * step, true));
+                }
+                int const x = static_cast<int>(window % 4) * 250 + 100;
+                trace.Events.push_back(Move(time += 16, window, x, 300, true));
+                trace.Events.push_back(End(time += 16, window, x, 300, true));
+            }
+
+            DragTrace::SimulatedFancyZones model(trace.Monitors);
+            auto const modelReport = DragTrace::Replay(trace, model);
+
+            ZoneSetLocator locator(trace.Monitors);
+            DragTrace::SimulatedFancyZones fancyZones(trace.Monitors, true, &locator);
+            auto const report = DragTrace::Replay(trace, fancyZones);
+
+            // Without overlapping zones both hit-test the same way.
+            Assert::AreEqual(model.Placements().size(), fancyZones.Placements().size());
+            for (size_t i = 0; i < model.Placements().size(); i++)
+            {
+                Assert::AreEqual(model.Placements()[i].Window, fancyZones.Placements()[i].Window);
+                Assert::AreEqual(model.Placements()[i].Monitor, fancyZones.Placements()[i].Monitor);
+                Assert::AreEqual(model.Placements()[i].Zone, fancyZones.Placements()[i].Zone);
+            }
+            Assert::AreEqual(static_cast<int>(1 % 4), Placement(fancyZones, 1).Zone);
+
+            // The drag state machine is still the model; only zone hit-testing is FancyZones' own.
+            auto const move = [](DragTrace::Report const& report) { return report.ByType[static_cast<size_t>(EventType::LocationChange)]; };
+            std::wstring const message = std::to_wstring(report.All.Count) + L" drag events through SimulatedFancyZones, a model of the FancyZones drag state machine: move p50 " +
+                                         std::to_wstring(move(modelReport).P50) + L"us, p99 " + std::to_wstring(move(modelReport).P99) + L"us with the model's hit-testing, p50 " +
+                                         std::to_wstring(move(report).P50) + L"us, p99 " + std::to_wstring(move(report).P99) + L"us through ZoneSet::ZoneFromPoint";
+            Logger::WriteMessage(message.c_str());
+        }
+    };
+}
@@ -0,0 +1,256 @@
+#include "pch.h"
+#include "lib\EditorHandoff.h"
+
+#include "Util.h"
+
+#include <chrono>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace FancyZonesUnitTests
+{
+    TEST_CLASS(EditorHandoffUnitTests)
+    {
+        static ZoneSetStore::Entry MakeEntry(PCWSTR workAreaKey, WORD layoutId, size_t zoneCount)
+        {
+            ZoneSetStore::Entry entry;
+            entry.WorkAreaKey = workAreaKey;
+            CoCreateGuid(&entry.Id);
+            entry.LayoutId = layoutId;
+            entry.Layout = ZoneSetLayout::Custom;
+            for (size_t i = 0; i < zoneCount; i++)
+            {
+                LONG const offset = static_cast<LONG>(i) * 10;
+                entry.Zones.push_back({ offset, offset + 1, offset + 100, offset + 200 });
+            }
+            return entry;
+        }
+
+        static EditorHandoff::Snapshot MakeSnapshot()
+        {
+            EditorHandoff::Snapshot snapshot;
+            snapshot.UniqueId = L"DELA026#5&10a58c63&0&UID16777488_1920_1200_{39B25DD2-130D-4B5D-8851-4791D66B1539}";
+            snapshot.WorkAreaKey = L"1920_1200";
+            snapshot.LayoutId = 0xFFFC;
+            snapshot.Monitor = 0x10001;
+            snapshot.EditorRect = { -1920, 40, 1920, 1160 };
+            snapshot.Dpi = 1.5f;
+            snapshot.ZoneCount = 5;
+            snapshot.Spacing = 8;
+            snapshot.ShowSpacing = false;
+            CoCreateGuid(&snapshot.ActiveZoneSetId);
+            snapshot.CustomLayouts = {
+                { L"Coding", { 0, 0, 0, 0, 1, 2, 3 } },
+                { L"Empty", {} },
+                { L"", { 0, 1, 1, 0, 2 } },
+            };
+            snapshot.ZoneSets = { MakeEntry(L"1920_1200", 0xFFFC, 4), MakeEntry(L"1920_1200", 0x0001, 2) };
+            return snapshot;
+        }
+
+        static void AssertSnapshotsEqual(EditorHandoff::Snapshot const& expected, EditorHandoff::Snapshot const& actual)
+        {
+            Assert::IsTrue(expected.UniqueId == actual.UniqueId);
+            Assert::IsTrue(expected.WorkAreaKey == actual.WorkAreaKey);
+            Assert::AreEqual(expected.LayoutId, actual.LayoutId);
+            Assert::AreEqual(expected.Monitor, actual.Monitor);
+            CustomAssert::AreEqual(expected.EditorRect, actual.EditorRect);
+            Assert::AreEqual(expected.Dpi, actual.Dpi);
+            Assert::AreEqual(expected.ZoneCount, actual.ZoneCount);
+            Assert::AreEqual(expected.Spacing, actual.Spacing);
+            Assert::AreEqual(expected.ShowSpacing, actual.ShowSpacing);
+            CustomAssert::AreEqual(expected.ActiveZoneSetId, actual.ActiveZoneSetId);
+
+            Assert::AreEqual(expected.CustomLayouts.size(), actual.CustomLayouts.size());
+            for (size_t i = 0; i < expected.CustomLayouts.size(); i++)
+            {
+                Assert::IsTrue(expected.CustomLayouts[i] == actual.CustomLayouts[i]);
+            }
+
+            Assert::AreEqual(expected.ZoneSets.size(), actual.ZoneSets.size());
+            for (size_t i = 0; i < expected.ZoneSets.size(); i++)
+            {
+                CustomAssert::AreEqual(expected.ZoneSets[i].Id, actual.ZoneSets[i].Id);
+                Assert::AreEqual(expected.ZoneSets[i].LayoutId, actual.ZoneSets[i].LayoutId);
+                Assert::AreEqual(expected.ZoneSets[i].Zones.size(), actual.ZoneSets[i].Zones.size());
+            }
+        }
+
+        TEST_METHOD(RoundTrip)
+        {
+            EditorHandoff::Snapshot const snapshot = MakeSnapshot();
+            std::vector<BYTE> const bytes = EditorHandoff::Serialize(snapshot);
+
+            EditorHandoff::SnapshotView view(bytes.data(), bytes.size());
+            Assert::IsTrue(view.IsValid());
+            AssertSnapshotsEqual(snapshot, view.Read());
+        }
+
+        TEST_METHOD(RoundTripEmpty)
+        {
+            EditorHandoff::Snapshot const snapshot;
+            std::vector<BYTE> const bytes = EditorHandoff::Serialize(snapshot);
+            Assert::AreEqual(sizeof(EditorHandoff::SnapshotHeader) + sizeof(ZoneSetStore::Header), bytes.size());
+
+            EditorHandoff::SnapshotView view(bytes.data(), bytes.size());
+            Assert::IsTrue(view.IsValid());
+            AssertSnapshotsEqual(snapshot, view.Read());
+        }
+
+        TEST_METHOD(CustomLayoutsInPlace)
+        {
+            EditorHandoff::Snapshot const snapshot = MakeSnapshot();
+            std::vector<BYTE> const bytes = EditorHandoff::Serialize(snapshot);
+            EditorHandoff::SnapshotView view(bytes.data(), bytes.size());
+
+            Assert::AreEqual(3ul, view.CustomLayoutCount());
+            auto const& layout = view.CustomLayoutAt(0);
+            Assert::IsTrue(view.NameOf(layout) == L"Coding");
+            Assert::AreEqual(7ul, layout.DataSize);
+            Assert::AreEqual(static_cast<BYTE>(3), view.DataOf(layout)[6]);
+
+            Assert::IsTrue(view.ZoneSets().IsValid());
+            Assert::AreEqual(2ul, view.ZoneSets().RecordCount());
+            Assert::AreEqual(4ul, view.ZoneSets().RecordAt(0).ZoneCount);
+        }
+
+        TEST_METHOD(StoreIsAligned)
+        {
+            EditorHandoff::Snapshot snapshot = MakeSnapshot();
+            snapshot.CustomLayouts = { { L"Odd", { 1, 2, 3 } } };
+            std::vector<BYTE> const bytes = EditorHandoff::Serialize(snapshot);
+
+            EditorHandoff::SnapshotView view(bytes.data(), bytes.size());
+            Assert::IsTrue(view.IsValid());
+            Assert::AreEqual(0ul, view.Header().StoreOffset % 8);
+        }
+
+        TEST_METHOD(RejectsTruncated)
+        {
+            std::vector<BYTE> const bytes = EditorHandoff::Serialize(MakeSnapshot());
+            for (size_t size : { size_t(0), size_t(16), sizeof(EditorHandoff::SnapshotHeader), bytes.size() - 1 })
+            {
+                Assert::IsFalse(EditorHandoff::SnapshotView(bytes.data(), size).IsValid());
+            }
+            Assert::IsFalse(EditorHandoff::SnapshotView(nullptr, bytes.size()).IsValid());
+        }
+
+        TEST_METHOD(RejectsWrongVersion)
+        {
+            std::vector<BYTE> bytes = EditorHandoff::Serialize(MakeSnapshot());
+            reinterpret_cast<EditorHandoff::SnapshotHeader*>(bytes.data())->Version = EditorHandoff::Version + 1;
+            Assert::IsFalse(EditorHandoff::SnapshotView(bytes.data(), bytes.size()).IsValid());
+
+            reinterpret_cast<EditorHandoff::SnapshotHeader*>(bytes.data())->Version = EditorHandoff::Version;
+            reinterpret_cast<EditorHandoff::SnapshotHeader*>(bytes.data())->Magic = ZoneSetStore::Magic;
+            Assert::IsFalse(EditorHandoff::SnapshotView(bytes.data(), bytes.size()).IsValid());
+        }
+
+        TEST_METHOD(RejectsUnterminatedKeys)
+        {
+            std::vector<BYTE> bytes = EditorHandoff::Serialize(MakeSnapshot());
+            auto header = reinterpret_cast<EditorHandoff::SnapshotHeader*>(bytes.data());
+            std::fill(std::begin(header->WorkAreaKey), std::end(header->WorkAreaKey), L'x');
+            Assert::IsFalse(EditorHandoff::SnapshotView(bytes.data(), bytes.size()).IsValid());
+        }
+
+        TEST_METHOD(RejectsCustomLayoutOutOfBounds)
+        {
+            std::vector<BYTE> bytes = EditorHandoff::Serialize(MakeSnapshot());
+            auto header = reinterpret_cast<EditorHandoff::SnapshotHeader*>(bytes.data());
+            auto layouts = reinterpret_cast<EditorHandoff::CustomLayout*>(bytes.data() + header->CustomLayoutsOffset);
+            layouts[1].DataSize = header->DataSize;
+            Assert::IsFalse(EditorHandoff::SnapshotView(bytes.data(), bytes.size()).IsValid());
+
+            layouts[1].DataSize = 0;
+            layouts[2].NameLength = 0xFFFFFFFF;
+            Assert::IsFalse(EditorHandoff::SnapshotView(bytes.data(), bytes.size()).IsValid());
+        }
+
+        TEST_METHOD(RejectsTooManyCustomLayouts)
+        {
+            std::vector<BYTE> bytes = EditorHandoff::Serialize(MakeSnapshot());
+            reinterpret_cast<EditorHandoff::SnapshotHeader*>(bytes.data())->CustomLayoutCount = 0x10000000;
+            Assert::IsFalse(EditorHandoff::SnapshotView(bytes.data(), bytes.size()).IsValid());
+        }
+
+        TEST_METHOD(RejectsCorruptStore)
+        {
+            std::vector<BYTE> bytes = EditorHandoff::Serialize(MakeSnapshot());
+            auto header = reinterpret_cast<EditorHandoff::SnapshotHeader*>(bytes.data());
+            reinterpret_cast<ZoneSetStore::Header*>(bytes.data() + header->StoreOffset)->RecordCount++;
+            Assert::IsFalse(EditorHandoff::SnapshotView(bytes.data(), bytes.size()).IsValid());
+        }
+
+        TEST_METHOD(ResultRoundTrip)
+        {
+            std::vector<BYTE> buffer(EditorHandoff::ResultSize);
+            EditorHandoff::Result result;
+            Assert::IsFalse(EditorHandoff::ReadResult(buffer.data(), result));
+
+            EditorHandoff::Result const expected{ 0xFFFE, { { 0, 0, 960, 1200 }, { 960, 0, 1920, 1200 } } };
+            EditorHandoff::WriteResult(buffer.data(), expected);
+            Assert::IsTrue(EditorHandoff::ReadResult(buffer.data(), result));
+            Assert::AreEqual(expected.LayoutId, result.LayoutId);
+            Assert::AreEqual(expected.Zones.size(), result.Zones.size());
+            CustomAssert::AreEqual(expected.Zones[1], result.Zones[1]);
+        }
+
+        TEST_METHOD(ResultNotApplied)
+        {
+            std::vector<BYTE> buffer(EditorHandoff::ResultSize);
+            EditorHandoff::WriteResult(buffer.data(), { 1, { { 0, 0, 10, 10 } } });
+            reinterpret_cast<EditorHandoff::ResultHeader*>(buffer.data())->Applied = 0;
+
+            EditorHandoff::Result result;
+            Assert::IsFalse(EditorHandoff::ReadResult(buffer.data(), result));
+        }
+
+        TEST_METHOD(ResultDropsExtraZones)
+        {
+            std::vector<BYTE> buffer(EditorHandoff::ResultSize);
+            EditorHandoff::Result expected{ 1, std::vector<RECT>(EditorHandoff::MaxResultZones + 10, RECT{ 1, 2, 3, 4 }) };
+            EditorHandoff::WriteResult(buffer.data(), expected);
+
+            EditorHandoff::Result result;
+            Assert::IsTrue(EditorHandoff::ReadResult(buffer.data(), result));
+            Assert::AreEqual(static_cast<size_t>(EditorHandoff::MaxResultZones), result.Zones.size());
+
+            reinterpret_cast<EditorHandoff::ResultHeader*>(buffer.data())->ZoneCount = EditorHandoff::MaxResultZones + 1;
+            Assert::IsFalse(EditorHandoff::ReadResult(buffer.data(), result));
+        }
+
+        TEST_METHOD(SerializationBenchmark)
+        {
+            // A heavy user: many custom layouts and hundreds of zone sets in the work area.
+            EditorHandoff::Snapshot snapshot = MakeSnapshot();
+            for (int i = 0; i < 100; i++)
+            {
+                snapshot.CustomLayouts.emplace_back(L"Layout " + std::to_wstring(i), std::vector<BYTE>(64 + i, static_cast<BYTE>(i)));
+            }
+            for (WORD i = 0; i < 500; i++)
+            {
+                snapshot.ZoneSets.push_back(MakeEntry(L"1920_1200", i, 1 + i % 16));
+            }
+
+            constexpr int iterations = 100;
+            size_t size = 0;
+            auto const start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; i++)
+            {
+                std::vector<BYTE> const bytes = EditorHandoff::Serialize(snapshot);
+                EditorHandoff::SnapshotView view(bytes.data(), bytes.size());
+                Assert::IsTrue(view.IsValid());
+                size = bytes.size();
+            }
+            auto const elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+            std::wstring const message = L"Snapshot of " + std::to_wstring(size) + L" bytes: " +
+                                         std::to_wstring(elapsed.count() / iterations) + L" us to serialize and validate";
+            Logger::WriteMessage(message.c_str());
+
+            std::vector<BYTE> const bytes = EditorHandoff::Serialize(snapshot);
+            AssertSnapshotsEqual(snapshot, EditorHandoff::SnapshotView(bytes.data(), bytes.size()).Read());
+        }
+    };
+}
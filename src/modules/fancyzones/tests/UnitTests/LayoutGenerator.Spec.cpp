@@ -0,0 +1,275 @@
+#include "pch.h"
+#include "lib\LayoutGenerator.h"
+
+#include "Util.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace FancyZonesUnitTests
+{
+    TEST_CLASS(LayoutGeneratorUnitTests)
+    {
+        using GridFactory = LayoutGenerator::GridSpec (*)(int);
+
+        static std::vector<RECT> WorkAreas()
+        {
+            return {
+                RECT{ 0, 0, 1920, 1040 },
+                RECT{ 0, 0, 1366, 728 },
+                RECT{ -2560, 0, 0, 1400 },
+                RECT{ 1920, -200, 5760, 1920 },
+                RECT{ 100, 100, 107, 113 },
+            };
+        }
+
+        static LONGLONG Area(RECT const& rect)
+        {
+            return static_cast<LONGLONG>(rect.right - rect.left) * (rect.bottom - rect.top);
+        }
+
+        static bool Intersect(RECT const& a, RECT const& b)
+        {
+            return (a.left < b.right) && (b.left < a.right) && (a.top < b.bottom) && (b.top < a.bottom);
+        }
+
+        static bool Contains(RECT const& outer, RECT const& inner)
+        {
+            return (inner.left >= outer.left) && (inner.top >= outer.top) && (inner.right <= outer.right) && (inner.bottom <= outer.bottom) &&
+                   (inner.left <= inner.right) && (inner.top <= inner.bottom);
+        }
+
+        static void AssertTiles(std::vector<RECT> const& zones, RECT const& workArea)
+        {
+            LONGLONG area = 0;
+            for (size_t i = 0; i < zones.size(); i++)
+            {
+                Assert::IsTrue(Contains(workArea, zones[i]));
+                area += Area(zones[i]);
+                for (size_t j = i + 1; j < zones.size(); j++)
+                {
+                    Assert::IsFalse(Intersect(zones[i], zones[j]));
+                }
+            }
+            Assert::AreEqual(Area(workArea), area);
+        }
+
+        static void AssertGridProperties(GridFactory factory)
+        {
+            for (int zoneCount = 1; zoneCount <= 40; zoneCount++)
+            {
+                auto const spec = factory(zoneCount);
+                Assert::IsTrue(LayoutGenerator::IsValid(spec));
+                Assert::AreEqual(zoneCount, LayoutGenerator::ZoneCount(spec));
+
+                for (auto const& workArea : WorkAreas())
+                {
+                    // Without spacing the zones tile the work area exactly.
+                    auto const zones = LayoutGenerator::GridZones(spec, workArea, 0);
+                    Assert::AreEqual(static_cast<size_t>(zoneCount), zones.size());
+                    AssertTiles(zones, workArea);
+
+                    // With spacing they stay inside the work area and never overlap.
+                    for (int spacing : { 1, 16, 5000 })
+                    {
+                        auto const spaced = LayoutGenerator::GridZones(spec, workArea, spacing);
+                        Assert::AreEqual(static_cast<size_t>(zoneCount), spaced.size());
+                        for (size_t i = 0; i < spaced.size(); i++)
+                        {
+                            Assert::IsTrue(Contains(workArea, spaced[i]));
+                            for (size_t j = i + 1; j < spaced.size(); j++)
+                            {
+                                Assert::IsFalse(Intersect(spaced[i], spaced[j]));
+                            }
+                        }
+                    }
+
+                    // Generation is deterministic.
+                    auto const again = LayoutGenerator::GridZones(spec, workArea, 0);
+                    for (size_t i = 0; i < zones.size(); i++)
+                    {
+                        CustomAssert::AreEqual(zones[i], again[i]);
+                    }
+                }
+            }
+        }
+
+        TEST_METHOD(RowsProperties)
+        {
+            AssertGridProperties(LayoutGenerator::Rows);
+        }
+
+        TEST_METHOD(ColumnsProperties)
+        {
+            AssertGridProperties(LayoutGenerator::Columns);
+        }
+
+        TEST_METHOD(GridProperties)
+        {
+            AssertGridProperties(LayoutGenerator::Grid);
+        }
+
+        TEST_METHOD(PriorityGridProperties)
+        {
+            AssertGridProperties(LayoutGenerator::PriorityGrid);
+        }
+
+        TEST_METHOD(ColumnsWithSpacing)
+        {
+            auto const zones = LayoutGenerator::GridZones(LayoutGenerator::Columns(3), RECT{ 0, 0, 1000, 500 }, 10);
+            Assert::AreEqual(static_cast<size_t>(3), zones.size());
+            CustomAssert::AreEqual(RECT{ 10, 10, 330, 490 }, zones[0]);
+            CustomAssert::AreEqual(RECT{ 340, 10, 660, 490 }, zones[1]);
+            CustomAssert::AreEqual(RECT{ 670, 10, 990, 490 }, zones[2]);
+        }
+
+        TEST_METHOD(GridMatchesEditor)
+        {
+            // 5 zones: 2 rows by 3 columns, numbered from the bottom right, with the
+            // last zone spanning the left column.
+            auto const spec = LayoutGenerator::Grid(5);
+            Assert::AreEqual(2, spec.Rows);
+            Assert::AreEqual(3, spec.Columns);
+            std::vector<int> const expected{ 4, 3, 1, 4, 2, 0 };
+            Assert::IsTrue(expected == spec.CellChildMap);
+
+            auto const zones = LayoutGenerator::GridZones(spec, RECT{ 0, 0, 300, 200 }, 0);
+            CustomAssert::AreEqual(RECT{ 200, 100, 300, 200 }, zones[0]);
+            CustomAssert::AreEqual(RECT{ 0, 0, 100, 200 }, zones[4]);
+        }
+
+        TEST_METHOD(PriorityGridMatchesEditor)
+        {
+            // 3 zones: a wide middle column between two quarter-width columns.
+            auto const zones = LayoutGenerator::GridZones(LayoutGenerator::PriorityGrid(3), RECT{ 0, 0, 1000, 100 }, 0);
+            Assert::AreEqual(static_cast<size_t>(3), zones.size());
+            CustomAssert::AreEqual(RECT{ 0, 0, 250, 100 }, zones[0]);
+            CustomAssert::AreEqual(RECT{ 250, 0, 750, 100 }, zones[1]);
+            CustomAssert::AreEqual(RECT{ 750, 0, 1000, 100 }, zones[2]);
+
+            // Larger counts fall back to the plain grid.
+            Assert::IsTrue(LayoutGenerator::Grid(12).CellChildMap == LayoutGenerator::PriorityGrid(12).CellChildMap);
+        }
+
+        TEST_METHOD(InvalidSpecs)
+        {
+            LayoutGenerator::GridSpec spec = LayoutGenerator::Grid(4);
+            Assert::IsTrue(LayoutGenerator::IsValid(spec));
+
+            auto missingIndex = spec;
+            missingIndex.CellChildMap = { 0, 0, 2, 2 };
+            Assert::IsFalse(LayoutGenerator::IsValid(missingIndex));
+
+            auto notRectangular = spec;
+            notRectangular.CellChildMap = { 0, 1, 1, 0 };
+            Assert::IsFalse(LayoutGenerator::IsValid(notRectangular));
+
+            auto zeroPercent = spec;
+            zeroPercent.RowPercents[0] = 0;
+            Assert::IsFalse(LayoutGenerator::IsValid(zeroPercent));
+
+            auto wrongSize = spec;
+            wrongSize.CellChildMap.pop_back();
+            Assert::IsFalse(LayoutGenerator::IsValid(wrongSize));
+
+            Assert::IsFalse(LayoutGenerator::IsValid(LayoutGenerator::Grid(0)));
+            Assert::IsFalse(LayoutGenerator::IsValid(LayoutGenerator::Rows(0)));
+            Assert::IsTrue(LayoutGenerator::GridZones(notRectangular, RECT{ 0, 0, 100, 100 }, 0).empty());
+        }
+
+        TEST_METHOD(FocusProperties)
+        {
+            for (int zoneCount = 1; zoneCount <= 40; zoneCount++)
+            {
+                for (auto const& workArea : WorkAreas())
+                {
+                    auto const zones = LayoutGenerator::FocusZones(zoneCount, workArea);
+                    Assert::AreEqual(static_cast<size_t>(zoneCount), zones.size());
+                    for (auto const& zone : zones)
+                    {
+                        Assert::IsTrue(Contains(workArea, zone));
+                        Assert::AreEqual(zones[0].right - zones[0].left, zone.right - zone.left);
+                        Assert::AreEqual(zones[0].bottom - zones[0].top, zone.bottom - zone.top);
+                    }
+                }
+            }
+
+            auto const zones = LayoutGenerator::FocusZones(3, RECT{ 0, 0, 1000, 500 });
+            CustomAssert::AreEqual(RECT{ 100, 50, 700, 350 }, zones[0]);
+            CustomAssert::AreEqual(RECT{ 200, 100, 800, 400 }, zones[1]);
+            CustomAssert::AreEqual(RECT{ 300, 150, 900, 450 }, zones[2]);
+        }
+
+        TEST_METHOD(ScaleZones)
+        {
+            std::vector<RECT> const zones{ RECT{ 0, 0, 960, 540 }, RECT{ 960, 540, 1920, 1080 } };
+
+            auto const same = LayoutGenerator::ScaleZones(zones, RECT{ 0, 0, 1920, 1080 }, RECT{ 0, 0, 1920, 1080 });
+            CustomAssert::AreEqual(zones[0], same[0]);
+            CustomAssert::AreEqual(zones[1], same[1]);
+
+            auto const scaled = LayoutGenerator::ScaleZones(zones, RECT{ 0, 0, 1920, 1080 }, RECT{ 100, 0, 3940, 2160 });
+            CustomAssert::AreEqual(RECT{ 100, 0, 2020, 1080 }, scaled[0]);
+            CustomAssert::AreEqual(RECT{ 2020, 1080, 3940, 2160 }, scaled[1]);
+        }
+
+        TEST_METHOD(Generate)
+        {
+            RECT const workArea{ 0, 0, 1920, 1080 };
+            for (WORD layoutId : { LayoutGenerator::FocusLayoutId, LayoutGenerator::RowsLayoutId, LayoutGenerator::ColumnsLayoutId,
+                                   LayoutGenerator::GridLayoutId, LayoutGenerator::PriorityGridLayoutId })
+            {
+                Assert::IsTrue(LayoutGenerator::IsPredefined(layoutId));
+                Assert::AreEqual(static_cast<size_t>(7), LayoutGenerator::Generate({ layoutId, 7, 16 }, workArea).size());
+                Assert::IsTrue(LayoutGenerator::Generate({ layoutId, 0, 16 }, workArea).empty());
+            }
+
+            // Custom layouts can't be regenerated.
+            Assert::IsFalse(LayoutGenerator::IsPredefined(0x0001));
+            Assert::IsTrue(LayoutGenerator::Generate({ 0x0001, 3, 0 }, workArea).empty());
+        }
+
+        TEST_METHOD(FitCustomZones)
+        {
+            // A custom layout saved at 100% DPI, fitted to the same work area at 150%.
+            std::vector<RECT> const zones{ RECT{ 0, 0, 600, 1040 }, RECT{ 600, 0, 1920, 1040 } };
+            RECT const from{ 0, 0, 1920, 1040 };
+            RECT const unscaledTo{ 0, 0, 1920, 1040 };
+            RECT const to{ 0, 0, 2880, 1560 };
+
+            auto const fitted = LayoutGenerator::FitZones({ 0x0001, 2, 0 }, zones, from, unscaledTo, to);
+            Assert::AreEqual(zones.size(), fitted.size());
+            CustomAssert::AreEqual(RECT{ 0, 0, 900, 1560 }, fitted[0]);
+            CustomAssert::AreEqual(RECT{ 900, 0, 2880, 1560 }, fitted[1]);
+
+            // Fitting back restores the original rects.
+            auto const restored = LayoutGenerator::FitZones({ 0x0001, 2, 0 }, fitted, to, from, from);
+            CustomAssert::AreEqual(zones[0], restored[0]);
+            CustomAssert::AreEqual(zones[1], restored[1]);
+        }
+
+        TEST_METHOD(FitPredefinedZones)
+        {
+            // Predefined layouts ignore the stored rects and are laid out again, so the
+            // spacing is exact for the new work area rather than stretched.
+            LayoutGenerator::LayoutSpec const spec{ LayoutGenerator::ColumnsLayoutId, 3, 16 };
+            std::vector<RECT> const stale{ RECT{ 0, 0, 1, 1 }, RECT{ 1, 0, 2, 1 }, RECT{ 2, 0, 3, 1 } };
+            RECT const unscaledTo{ 0, 0, 2560, 1400 };
+
+            auto const fitted = LayoutGenerator::FitZones(spec, stale, RECT{ 0, 0, 1920, 1040 }, unscaledTo, unscaledTo);
+            auto const expected = LayoutGenerator::Generate(spec, unscaledTo);
+            Assert::AreEqual(expected.size(), fitted.size());
+            for (size_t i = 0; i < expected.size(); i++)
+            {
+                CustomAssert::AreEqual(expected[i], fitted[i]);
+            }
+
+            RECT const to{ 0, 0, 3840, 2100 };
+            auto const scaled = LayoutGenerator::FitZones(spec, stale, RECT{ 0, 0, 1920, 1040 }, unscaledTo, to);
+            auto const expectedScaled = LayoutGenerator::ScaleZones(expected, unscaledTo, to);
+            for (size_t i = 0; i < expected.size(); i++)
+            {
+                CustomAssert::AreEqual(expectedScaled[i], scaled[i]);
+            }
+        }
+    };
+}
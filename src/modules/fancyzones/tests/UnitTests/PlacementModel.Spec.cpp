@@ -0,0 +1,268 @@
+#include "pch.h"
+#include "lib\PlacementModel.h"
+
+#include <chrono>
+#include <random>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace FancyZonesUnitTests
+{
+    TEST_CLASS(PlacementModelUnitTests)
+    {
+        using Time = PlacementModel::Time;
+
+        static constexpr Time Day{ 24 * 60 * 60 };
+        static constexpr Time Start{ 1'500'000'000 };
+
+        static PlacementModel::Context Context(PCWSTR monitorKey, WORD layoutId, size_t zoneCount)
+        {
+            return { monitorKey, layoutId, zoneCount };
+        }
+
+        TEST_METHOD(PredictUnknownApp)
+        {
+            PlacementModel model;
+            Assert::IsFalse(model.Predict(L"C:\\app.exe", Context(L"1", 0xFFFF, 3), Start).has_value());
+        }
+
+        TEST_METHOD(PredictSameContext)
+        {
+            PlacementModel model;
+            model.Observe(L"C:\\app.exe", Context(L"1", 0xFFFF, 3), 2, Start);
+            Assert::AreEqual(2, *model.Predict(L"C:\\app.exe", Context(L"1", 0xFFFF, 3), Start));
+            Assert::IsFalse(model.Predict(L"C:\\other.exe", Context(L"1", 0xFFFF, 3), Start).has_value());
+        }
+
+        TEST_METHOD(MostFrequentZoneWins)
+        {
+            PlacementModel model;
+            auto const context = Context(L"1", 0xFFFF, 3);
+            model.Observe(L"C:\\app.exe", context, 0, Start);
+            model.Observe(L"C:\\app.exe", context, 1, Start);
+            model.Observe(L"C:\\app.exe", context, 1, Start);
+            model.Observe(L"C:\\app.exe", context, 0, Start);
+            model.Observe(L"C:\\app.exe", context, 1, Start);
+            Assert::AreEqual(1, *model.Predict(L"C:\\app.exe", context, Start));
+        }
+
+        TEST_METHOD(RecentHabitsWin)
+        {
+            PlacementModel model(PlacementModel::DefaultCapacity, Day);
+            auto const context = Context(L"1", 0xFFFF, 3);
+            for (int i = 0; i < 3; i++)
+            {
+                model.Observe(L"C:\\app.exe", context, 0, Start);
+            }
+
+            // Three snaps a half-life ago are worth more than one today, but less than two.
+            model.Observe(L"C:\\app.exe", context, 2, Start + Day);
+            Assert::AreEqual(0, *model.Predict(L"C:\\app.exe", context, Start + Day));
+            model.Observe(L"C:\\app.exe", context, 2, Start + Day);
+            Assert::AreEqual(2, *model.Predict(L"C:\\app.exe", context, Start + Day));
+        }
+
+        TEST_METHOD(HabitsFadeAway)
+        {
+            PlacementModel model(PlacementModel::DefaultCapacity, Day);
+            auto const context = Context(L"1", 0xFFFF, 3);
+            model.Observe(L"C:\\app.exe", context, 1, Start);
+            Assert::IsTrue(model.Predict(L"C:\\app.exe", context, Start + Day / 2).has_value());
+            Assert::IsFalse(model.Predict(L"C:\\app.exe", context, Start + 2 * Day).has_value());
+        }
+
+        TEST_METHOD(OtherMonitorSameLayout)
+        {
+            PlacementModel model;
+            model.Observe(L"C:\\app.exe", Context(L"1", 0xFFFE, 4), 3, Start);
+            model.Observe(L"C:\\app.exe", Context(L"1", 0xFFFD, 4), 1, Start);
+            model.Observe(L"C:\\app.exe", Context(L"1", 0xFFFD, 4), 1, Start);
+
+            // On a new monitor the same layout beats a more frequent zone of another layout.
+            Assert::AreEqual(3, *model.Predict(L"C:\\app.exe", Context(L"2", 0xFFFE, 4), Start));
+        }
+
+        TEST_METHOD(SameMonitorBeatsOtherMonitor)
+        {
+            PlacementModel model;
+            auto const here = Context(L"1", 0xFFFE, 4);
+            auto const there = Context(L"2", 0xFFFE, 4);
+            for (int i = 0; i < 5; i++)
+            {
+                model.Observe(L"C:\\app.exe", there, 0, Start);
+            }
+            model.Observe(L"C:\\app.exe", here, 2, Start);
+            Assert::AreEqual(2, *model.Predict(L"C:\\app.exe", here, Start));
+            Assert::AreEqual(0, *model.Predict(L"C:\\app.exe", there, Start));
+        }
+
+        TEST_METHOD(ZoneNoLongerExists)
+        {
+            PlacementModel model;
+            model.Observe(L"C:\\app.exe", Context(L"1", 0xFFFF, 6), 5, Start);
+            model.Observe(L"C:\\app.exe", Context(L"1", 0xFFFF, 6), 5, Start);
+            model.Observe(L"C:\\app.exe", Context(L"1", 0xFFFF, 6), 1, Start);
+
+            // The layout now has three zones: zone 5 is gone, the next best zone that still exists is used.
+            Assert::AreEqual(1, *model.Predict(L"C:\\app.exe", Context(L"1", 0xFFFF, 3), Start));
+            Assert::IsFalse(model.Predict(L"C:\\app.exe", Context(L"1", 0xFFFF, 1), Start).has_value());
+        }
+
+        TEST_METHOD(IgnoresInvalidZones)
+        {
+            PlacementModel model;
+            model.Observe(L"C:\\app.exe", Context(L"1", 0xFFFF, 3), -1, Start);
+            model.Observe(L"C:\\app.exe", Context(L"1", 0xFFFF, 3), 3, Start);
+            Assert::AreEqual(static_cast<size_t>(0), model.Size());
+            Assert::IsFalse(model.HasPendingChanges());
+        }
+
+        TEST_METHOD(SlotsAreBounded)
+        {
+            PlacementModel model;
+            auto const context = Context(L"1", 0x0001, 32);
+            model.Observe(L"C:\\app.exe", context, 31, Start);
+            model.Observe(L"C:\\app.exe", context, 31, Start);
+            for (int zone = 0; zone < 20; zone++)
+            {
+                model.Observe(L"C:\\app.exe", context, zone, Start + Time(zone));
+            }
+
+            // The weakest slots make room for new zones, the strongest one survives.
+            auto changes = model.TakePendingChanges();
+            Assert::AreEqual(static_cast<size_t>(1), changes.size());
+            Assert::AreEqual(PlacementModel::MaxSlots, changes[0].Placements.size());
+            Assert::AreEqual(31, *model.Predict(L"C:\\app.exe", context, Start + Time(20)));
+        }
+
+        TEST_METHOD(EvictsLeastRecentlyUsed)
+        {
+            PlacementModel model(2);
+            auto const context = Context(L"1", 0xFFFF, 3);
+            model.Observe(L"C:\\a.exe", context, 0, Start);
+            model.Observe(L"C:\\b.exe", context, 1, Start);
+            model.TakePendingChanges();
+
+            model.Predict(L"C:\\a.exe", context, Start);
+            model.Observe(L"C:\\c.exe", context, 2, Start);
+            Assert::AreEqual(static_cast<size_t>(2), model.Size());
+            Assert::IsFalse(model.Predict(L"C:\\b.exe", context, Start).has_value());
+            Assert::IsTrue(model.Predict(L"C:\\a.exe", context, Start).has_value());
+
+            // The eviction is journaled as a removal.
+            auto changes = model.TakePendingChanges();
+            auto evicted = std::find_if(changes.begin(), changes.end(), [](auto const& entry) { return entry.ProcessPath == L"C:\\b.exe"; });
+            Assert::IsTrue(evicted != changes.end());
+            Assert::IsTrue(evicted->Placements.empty());
+        }
+
+        TEST_METHOD(PendingChangesAreCoalesced)
+        {
+            PlacementModel model;
+            auto const context = Context(L"1", 0xFFFF, 3);
+            for (int i = 0; i < 10; i++)
+            {
+                model.Observe(L"C:\\app.exe", context, i % 3, Start);
+            }
+            Assert::IsTrue(model.HasPendingChanges());
+
+            auto changes = model.TakePendingChanges();
+            Assert::AreEqual(static_cast<size_t>(1), changes.size());
+            Assert::AreEqual(static_cast<size_t>(3), changes[0].Placements.size());
+            Assert::IsFalse(model.HasPendingChanges());
+        }
+
+        TEST_METHOD(LoadRestoresPredictions)
+        {
+            PlacementModel model;
+            model.Observe(L"C:\\app.exe", Context(L"1", 0xFFFF, 3), 2, Start);
+            model.Observe(L"C:\\app.exe", Context(L"2", 0xFFFE, 4), 3, Start);
+
+            PlacementModel loaded;
+            loaded.Load(model.TakePendingChanges());
+            Assert::IsFalse(loaded.HasPendingChanges());
+            Assert::AreEqual(2, *loaded.Predict(L"C:\\app.exe", Context(L"1", 0xFFFF, 3), Start));
+            Assert::AreEqual(3, *loaded.Predict(L"C:\\app.exe", Context(L"2", 0xFFFE, 4), Start));
+        }
+
+        TEST_METHOD(PackRoundTrip)
+        {
+            std::vector<PlacementModel::Placement> const placements{
+                { L"1a2b3c", 0xFFFF, 3, 2, 1.5f, Start },
+                { L"4d", 0x0001, 12, 11, 0.75f, Start + Day },
+            };
+
+            std::vector<BYTE> const data = PlacementModel::Pack(placements);
+            auto const unpacked = PlacementModel::Unpack(data.data(), data.size());
+            Assert::IsTrue(unpacked.has_value());
+            Assert::AreEqual(placements.size(), unpacked->size());
+            for (size_t i = 0; i < placements.size(); i++)
+            {
+                Assert::IsTrue(placements[i].MonitorKey == (*unpacked)[i].MonitorKey);
+                Assert::AreEqual(placements[i].LayoutId, (*unpacked)[i].LayoutId);
+                Assert::AreEqual(placements[i].ZoneCount, (*unpacked)[i].ZoneCount);
+                Assert::AreEqual(placements[i].ZoneIndex, (*unpacked)[i].ZoneIndex);
+                Assert::AreEqual(placements[i].Score, (*unpacked)[i].Score);
+                Assert::IsTrue(placements[i].Updated == (*unpacked)[i].Updated);
+            }
+        }
+
+        TEST_METHOD(UnpackRejectsCorruptData)
+        {
+            std::vector<BYTE> data = PlacementModel::Pack({ { L"1", 0xFFFF, 3, 2, 1.0f, Start } });
+            Assert::IsFalse(PlacementModel::Unpack(data.data(), data.size() - 1).has_value());
+            Assert::IsFalse(PlacementModel::Unpack(data.data(), 2).has_value());
+
+            data[0]++;
+            Assert::IsFalse(PlacementModel::Unpack(data.data(), data.size()).has_value());
+        }
+
+        TEST_METHOD(SyntheticTraceBenchmark)
+        {
+            // A week of window creation: every app has a favourite zone per layout, which the
+            // user picks most of the time, and three monitors cycle between a few layouts.
+            std::mt19937 random(42);
+            std::vector<std::wstring> apps;
+            for (int i = 0; i < 200; i++)
+            {
+                apps.push_back(L"C:\\Program Files\\App" + std::to_wstring(i) + L"\\app.exe");
+            }
+            std::vector<PlacementModel::Context> const contexts{
+                Context(L"1", 0xFFFF, 3), Context(L"1", 0xFFFC, 4), Context(L"2", 0xFFFE, 2), Context(L"3", 0xFFFD, 5)
+            };
+            auto favourite = [&](size_t app, PlacementModel::Context const& context) {
+                return static_cast<int>((app * 7 + context.LayoutId) % context.ZoneCount);
+            };
+
+            PlacementModel model;
+            constexpr int events = 200000;
+            int predictions = 0;
+            int hits = 0;
+            Time now = Start;
+            auto const start = std::chrono::steady_clock::now();
+            for (int i = 0; i < events; i++)
+            {
+                size_t const app = std::min<size_t>(static_cast<size_t>(std::exponential_distribution<>(0.05)(random)), apps.size() - 1);
+                auto const& context = contexts[random() % contexts.size()];
+                int const zone = (random() % 10 < 8) ? favourite(app, context) : static_cast<int>(random() % context.ZoneCount);
+                now += Time(3);
+
+                if (auto const predicted = model.Predict(apps[app], context, now))
+                {
+                    predictions++;
+                    hits += (*predicted == zone) ? 1 : 0;
+                }
+                model.Observe(apps[app], context, zone, now);
+            }
+            auto const elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+            std::wstring const message = std::to_wstring(elapsed.count() / events) + L" ns per created window, " +
+                                         std::to_wstring(hits * 100 / predictions) + L"% of " + std::to_wstring(predictions) + L" predictions right";
+            Logger::WriteMessage(message.c_str());
+
+            // 80% of the windows go to the favourite zone, and the model should learn that.
+            Assert::IsTrue(hits * 100 / predictions >= 75);
+            Assert::IsTrue(model.Size() <= apps.size());
+        }
+    };
+}
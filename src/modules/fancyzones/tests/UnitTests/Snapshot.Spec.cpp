@@ -0,0 +1,239 @@
+#include "pch.h"
+#include "lib\Snapshot.h"
+#include "lib\DragTrace.h"
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <thread>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace FancyZonesUnitTests
+{
+    TEST_CLASS(SnapshotUnitTests)
+    {
+        // Active layout of each monitor, published the way FancyZones publishes its zone windows.
+        // The zones are always the candidate layout the index names; a reader seeing anything else
+        // got a copy that was still being edited.
+        struct MonitorLayouts
+        {
+            std::map<uint64_t, size_t> Active;
+            std::map<uint64_t, std::vector<DragTrace::Box>> Zones;
+            uint64_t Cycles{};
+        };
+
+        static std::vector<std::vector<DragTrace::Box>> Candidates()
+        {
+            return {
+                { { 0, 0, 500, 760 }, { 500, 0, 1000, 760 } },
+                { { 0, 0, 333, 760 }, { 333, 0, 666, 760 }, { 666, 0, 1000, 760 } },
+                { { 0, 0, 1000, 380 }, { 0, 380, 1000, 760 } },
+            };
+        }
+
+        static std::vector<DragTrace::Monitor> Monitors()
+        {
+            DragTrace::Monitor left{ 1, { 0, 0, 1000, 800 }, { 0, 0, 1000, 760 }, Candidates()[0] };
+            DragTrace::Monitor right{ 2, { 1000, 0, 2000, 800 }, { 1000, 0, 2000, 760 }, Candidates()[0] };
+            return { left, right };
+        }
+
+        // Drags that sweep back and forth over both monitors.
+        static DragTrace::Trace SweepTrace(int drags, int movesPerDrag)
+        {
+            DragTrace::Trace trace{ Monitors(), {} };
+            uint32_t time = 0;
+            for (int drag = 0; drag < drags; drag++)
+            {
+                const uint64_t window = 100 + drag;
+                trace.Events.push_back({ DragTrace::EventType::MoveSizeStart, time++, window, { 300, 100 }, true, { 100, 50, 600, 500 } });
+                for (int move = 0; move < movesPerDrag; move++)
+                {
+                    const int32_t x = (move * 37 + drag * 11) % 2000;
+                    const int32_t y = (move * 13 + drag * 7) % 760;
+                    trace.Events.push_back({ DragTrace::EventType::LocationChange, time++, window, { x, y }, true, {} });
+                }
+                trace.Events.push_back({ DragTrace::EventType::MoveSizeEnd, time++, window, { 1500, 300 }, true, {} });
+            }
+            return trace;
+        }
+
+        // Looks up the layouts on every drag call, like the drag handling of FancyZones does.
+        class SnapshotDragHandler : public DragTrace::DragHandler
+        {
+        public:
+            explicit SnapshotDragHandler(Snapshot<MonitorLayouts> const& layouts) :
+                m_layouts(layouts), m_candidates(Candidates()) {}
+
+            void MoveSizeStart(uint64_t, uint64_t monitor, DragTrace::Point cursor, bool, DragTrace::Box const&) override { Check(monitor, cursor); }
+            void MoveSizeUpdate(uint64_t monitor, DragTrace::Point cursor, bool) override { Check(monitor, cursor); }
+            void MoveSizeEnd(uint64_t, DragTrace::Point, bool) override {}
+
+            size_t Checked{};
+            size_t Torn{};
+            size_t Hits{};
+
+        private:
+            void Check(uint64_t monitor, DragTrace::Point cursor)
+            {
+                auto layouts = m_layouts.Load();
+                Checked++;
+                for (auto const& [id, active] : layouts->Active)
+                {
+                    auto zones = layouts->Zones.find(id);
+                    if ((zones == layouts->Zones.end()) || (zones->second != m_candidates[active]))
+                    {
+                        Torn++;
+                    }
+                }
+
+                auto zones = layouts->Zones.find(monitor);
+                if (zones != layouts->Zones.end())
+                {
+                    const DragTrace::Point relative{ cursor.X - ((monitor == 2) ? 1000 : 0), cursor.Y };
+                    for (auto const& zone : zones->second)
+                    {
+                        if (zone.Contains(relative))
+                        {
+                            Hits++;
+                            break;
+                        }
+                    }
+                }
+            }
+
+            Snapshot<MonitorLayouts> const& m_layouts;
+            std::vector<std::vector<DragTrace::Box>> m_candidates;
+        };
+
+        static void InitializeLayouts(Snapshot<MonitorLayouts>& layouts)
+        {
+            layouts.Update([](MonitorLayouts& value) {
+                for (uint64_t monitor : { 1, 2 })
+                {
+                    value.Active[monitor] = 0;
+                    value.Zones[monitor] = Candidates()[0];
+                }
+            });
+        }
+
+        // Win+Ctrl+Number on one monitor: the next candidate becomes its active layout.
+        static void CycleLayout(Snapshot<MonitorLayouts>& layouts, uint64_t monitor)
+        {
+            layouts.Update([monitor](MonitorLayouts& value) {
+                const size_t next = (value.Active[monitor] + 1) % Candidates().size();
+                value.Active[monitor] = next;
+                value.Zones[monitor] = Candidates()[next];
+                value.Cycles++;
+            });
+        }
+
+        TEST_METHOD(LoadDefault)
+        {
+            Snapshot<std::vector<int>> snapshot;
+            auto value = snapshot.Load();
+            Assert::IsNotNull(value.get());
+            Assert::IsTrue(value->empty());
+        }
+
+        TEST_METHOD(UpdatePublishesCopy)
+        {
+            Snapshot<std::vector<int>> snapshot;
+            snapshot.Update([](std::vector<int>& value) { value.push_back(1); });
+            auto before = snapshot.Load();
+
+            snapshot.Update([](std::vector<int>& value) { value.push_back(2); });
+            auto after = snapshot.Load();
+
+            // Readers keep the copy they loaded.
+            Assert::AreEqual(size_t{ 1 }, before->size());
+            Assert::AreEqual(size_t{ 2 }, after->size());
+            Assert::AreEqual(2, after->back());
+        }
+
+        TEST_METHOD(Reset)
+        {
+            Snapshot<std::vector<int>> snapshot;
+            snapshot.Update([](std::vector<int>& value) { value.assign(3, 7); });
+            snapshot.Reset();
+            Assert::IsTrue(snapshot.Load()->empty());
+
+            snapshot.Reset({ 4, 5 });
+            Assert::AreEqual(size_t{ 2 }, snapshot.Load()->size());
+        }
+
+        TEST_METHOD(ConcurrentUpdatesAreNotLost)
+        {
+            Snapshot<uint64_t> snapshot;
+            constexpr int threads = 4;
+            constexpr int updates = 2000;
+
+            std::vector<std::thread> workers;
+            for (int i = 0; i < threads; i++)
+            {
+                workers.emplace_back([&snapshot] {
+                    for (int j = 0; j < updates; j++)
+                    {
+                        snapshot.Update([](uint64_t& value) { value++; });
+                    }
+                });
+            }
+            for (auto& worker : workers)
+            {
+                worker.join();
+            }
+
+            Assert::AreEqual(uint64_t{ threads * updates }, *snapshot.Load());
+        }
+
+        // Replays drags on one thread while two others keep cycling layouts, the way hotkeys and
+        // the WinEvent thread run against each other. No drag call may see a half-edited layout
+        // and no cycle may be lost; the drag latency under contention is logged.
+        TEST_METHOD(HotkeysDuringDragReplay)
+        {
+            Snapshot<MonitorLayouts> layouts;
+            InitializeLayouts(layouts);
+
+            const DragTrace::Trace trace = SweepTrace(50, 200);
+            SnapshotDragHandler handler(layouts);
+
+            std::atomic_bool dragging{ true };
+            std::atomic<uint64_t> cycles{ 0 };
+            std::vector<std::thread> hotkeys;
+            for (uint64_t monitor : { 1, 2 })
+            {
+                hotkeys.emplace_back([&layouts, &dragging, &cycles, monitor] {
+                    do
+                    {
+                        CycleLayout(layouts, monitor);
+                        cycles++;
+                    } while (dragging);
+                });
+            }
+
+            DragTrace::Report report;
+            constexpr int replays = 5;
+            for (int i = 0; i < replays; i++)
+            {
+                report = DragTrace::Replay(trace, handler);
+            }
+            dragging = false;
+            for (auto& hotkey : hotkeys)
+            {
+                hotkey.join();
+            }
+
+            Assert::AreEqual(size_t{ 0 }, report.Skipped);
+            Assert::AreEqual(replays * (trace.Events.size() - 50), handler.Checked);
+            Assert::AreEqual(size_t{ 0 }, handler.Torn);
+            Assert::IsTrue(handler.Hits > 0);
+            Assert::AreEqual(cycles.load(), layouts.Load()->Cycles);
+
+            std::wstring const message = L"Drag update while cycling layouts: p50 " + std::to_wstring(report.ByType[1].P50) +
+                                         L" us, p99 " + std::to_wstring(report.ByType[1].P99) + L" us, " +
+                                         std::to_wstring(cycles.load()) + L" layouts cycled";
+            Logger::WriteMessage(message.c_str());
+        }
+    };
+}
@@ -0,0 +1,251 @@
+#include "pch.h"
+#include "lib\VirtualDesktopIds.h"
+
+#include <chrono>
+#include <unordered_map>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace FancyZonesUnitTests
+{
+    TEST_CLASS(VirtualDesktopIdsUnitTests)
+    {
+        static GUID Desktop(unsigned long id)
+        {
+            GUID guid{};
+            guid.Data1 = id;
+            guid.Data4[7] = static_cast<unsigned char>(id * 31);
+            return guid;
+        }
+
+        static std::vector<BYTE> Blob(std::vector<unsigned long> const& ids)
+        {
+            std::vector<BYTE> blob(ids.size() * sizeof(GUID));
+            for (size_t i = 0; i < ids.size(); i++)
+            {
+                GUID const guid = Desktop(ids[i]);
+                memcpy(blob.data() + i * sizeof(GUID), &guid, sizeof(GUID));
+            }
+            return blob;
+        }
+
+        static VirtualDesktopIds::Diff Update(VirtualDesktopIds& ids, std::vector<unsigned long> const& desktops)
+        {
+            auto const blob = Blob(desktops);
+            return ids.Update(blob.data(), blob.size());
+        }
+
+        TEST_METHOD(InitialUpdate)
+        {
+            VirtualDesktopIds ids;
+            auto const diff = Update(ids, { 3, 1, 2 });
+            Assert::AreEqual(static_cast<size_t>(3), diff.Added);
+            Assert::AreEqual(static_cast<size_t>(0), diff.Removed);
+            Assert::AreEqual(static_cast<size_t>(3), ids.Size());
+            Assert::IsTrue(ids.Contains(Desktop(1)));
+            Assert::IsTrue(ids.IsNew(Desktop(2)));
+            Assert::IsFalse(ids.Contains(Desktop(4)));
+        }
+
+        TEST_METHOD(UnchangedBlob)
+        {
+            VirtualDesktopIds ids;
+            Update(ids, { 1, 2 });
+            ids.MarkVisited(Desktop(1));
+
+            Assert::IsTrue(Update(ids, { 1, 2 }).Empty());
+            Assert::IsFalse(ids.IsNew(Desktop(1)));
+            Assert::IsTrue(ids.IsNew(Desktop(2)));
+        }
+
+        TEST_METHOD(AddAndRemove)
+        {
+            VirtualDesktopIds ids;
+            Update(ids, { 1, 2, 3 });
+            ids.MarkVisited(Desktop(1));
+            ids.MarkVisited(Desktop(3));
+
+            // Explorer reorders the blob when desktops move; only 2 went away and 4 is new.
+            auto const diff = Update(ids, { 4, 3, 1 });
+            Assert::AreEqual(static_cast<size_t>(1), diff.Added);
+            Assert::AreEqual(static_cast<size_t>(1), diff.Removed);
+            Assert::IsFalse(ids.Contains(Desktop(2)));
+            Assert::IsFalse(ids.IsNew(Desktop(1)));
+            Assert::IsFalse(ids.IsNew(Desktop(3)));
+            Assert::IsTrue(ids.IsNew(Desktop(4)));
+        }
+
+        TEST_METHOD(RemoveAll)
+        {
+            VirtualDesktopIds ids;
+            Update(ids, { 1, 2 });
+            auto const diff = Update(ids, {});
+            Assert::AreEqual(static_cast<size_t>(2), diff.Removed);
+            Assert::AreEqual(static_cast<size_t>(0), ids.Size());
+        }
+
+        TEST_METHOD(PartialGuidIgnored)
+        {
+            VirtualDesktopIds ids;
+            auto blob = Blob({ 1, 2 });
+            blob.resize(blob.size() + 5, 0xAB);
+            Assert::AreEqual(static_cast<size_t>(2), ids.Update(blob.data(), blob.size()).Added);
+            Assert::AreEqual(static_cast<size_t>(2), ids.Size());
+        }
+
+        TEST_METHOD(DuplicateIds)
+        {
+            VirtualDesktopIds ids;
+            Assert::AreEqual(static_cast<size_t>(2), Update(ids, { 1, 2, 1 }).Added);
+            Assert::AreEqual(static_cast<size_t>(2), ids.Size());
+        }
+
+        TEST_METHOD(UnknownDesktops)
+        {
+            // The current desktop can be shown before Explorer has written the blob.
+            VirtualDesktopIds ids;
+            Assert::IsTrue(ids.IsNew(Desktop(7)));
+            ids.MarkVisited(Desktop(7));
+            Assert::IsFalse(ids.IsNew(Desktop(7)));
+
+            Update(ids, { 7, 8 });
+            Assert::IsFalse(ids.IsNew(Desktop(7)));
+            Assert::IsTrue(ids.IsNew(Desktop(8)));
+        }
+
+        struct GuidHash
+        {
+            size_t operator()(GUID const& id) const noexcept
+            {
+                size_t hash = id.Data1;
+                for (auto byte : id.Data4)
+                {
+                    hash = hash * 31 + byte;
+                }
+                return hash;
+            }
+        };
+
+        // How FancyZones tracked desktops before VirtualDesktopIds: parse every blob into a
+        // hash map and diff it against the previous map, changed or not.
+        static void MapUpdate(std::unordered_map<GUID, bool, GuidHash>& desktops, std::vector<BYTE> const& blob)
+        {
+            std::unordered_map<GUID, bool, GuidHash> temp;
+            temp.reserve(blob.size() / sizeof(GUID));
+            for (size_t i = 0; i + sizeof(GUID) <= blob.size(); i += sizeof(GUID))
+            {
+                temp[*reinterpret_cast<GUID const*>(blob.data() + i)] = true;
+            }
+            for (auto it = desktops.begin(); it != desktops.end();)
+            {
+                if (temp.find(it->first) == temp.end())
+                {
+                    it = desktops.erase(it);
+                }
+                else
+                {
+                    temp.erase(it->first);
+                    ++it;
+                }
+            }
+            desktops.insert(temp.begin(), temp.end());
+        }
+
+        // Runs the same notifications through VirtualDesktopIds and the old hash map diff, and
+        // logs the time per notification of both. changeEvery is how many notifications pass
+        // between desktops being closed and opened; the others leave the id blob alone.
+        static void TimeNotifications(wchar_t const* name, int notifications, int changeEvery)
+        {
+            std::vector<std::vector<BYTE>> blobs;
+            std::vector<unsigned long> desktops;
+            for (unsigned long i = 1; i <= 20; i++)
+            {
+                desktops.push_back(i);
+            }
+            for (int i = 0; i < notifications; i++)
+            {
+                if ((i % changeEvery) == changeEvery - 1)
+                {
+                    // Close the oldest desktop and open a new one.
+                    desktops.erase(desktops.begin());
+                    desktops.push_back(desktops.back() + 1);
+                }
+                blobs.push_back(Blob(desktops));
+            }
+
+            VirtualDesktopIds ids;
+            auto const sortedStart = std::chrono::steady_clock::now();
+            for (auto const& blob : blobs)
+            {
+                ids.Update(blob.data(), blob.size());
+            }
+            auto const sortedElapsed = std::chrono::steady_clock::now() - sortedStart;
+
+            std::unordered_map<GUID, bool, GuidHash> map;
+            auto const mapStart = std::chrono::steady_clock::now();
+            for (auto const& blob : blobs)
+            {
+                MapUpdate(map, blob);
+            }
+            auto const mapElapsed = std::chrono::steady_clock::now() - mapStart;
+
+            Assert::AreEqual(map.size(), ids.Size());
+            for (auto const& [id, isNew] : map)
+            {
+                Assert::IsTrue(ids.Contains(id));
+            }
+
+            auto const perNotification = [&](auto elapsed) {
+                return std::to_wstring(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / notifications) + L" ns";
+            };
+            std::wstring const message = std::wstring(name) + L": " + std::to_wstring(notifications) + L" notifications over 20 desktops, sorted merge " +
+                                         perNotification(sortedElapsed) + L", hash map diff " + perNotification(mapElapsed) + L" per notification";
+            Logger::WriteMessage(message.c_str());
+        }
+
+        TEST_METHOD(NotificationStorm)
+        {
+            // Most notifications for the key are desktop switches, which rewrite
+            // CurrentVirtualDesktop but leave the id blob alone.
+            VirtualDesktopIds ids;
+            std::vector<unsigned long> desktops;
+            for (unsigned long i = 1; i <= 20; i++)
+            {
+                desktops.push_back(i);
+            }
+            Update(ids, desktops);
+
+            size_t changes = 0;
+            for (int i = 0; i < 100000; i++)
+            {
+                if ((i % 1000) == 999)
+                {
+                    // Occasionally close the oldest desktop and open a new one.
+                    desktops.erase(desktops.begin());
+                    desktops.push_back(desktops.back() + 1);
+                }
+
+                auto const diff = Update(ids, desktops);
+                if (!diff.Empty())
+                {
+                    changes++;
+                    Assert::AreEqual(static_cast<size_t>(1), diff.Added);
+                    Assert::AreEqual(static_cast<size_t>(1), diff.Removed);
+                }
+            }
+
+            Assert::AreEqual(static_cast<size_t>(100), changes);
+            Assert::AreEqual(static_cast<size_t>(20), ids.Size());
+            Assert::IsTrue(ids.Contains(Desktop(desktops.back())));
+            Assert::IsFalse(ids.Contains(Desktop(1)));
+
+            TimeNotifications(L"Desktop switches", 100000, 1000);
+        }
+
+        TEST_METHOD(ChangingBlobTime)
+        {
+            // Every notification closes and opens a desktop, so each one takes the merge.
+            TimeNotifications(L"Changing blob", 100000, 1);
+        }
+    };
+}
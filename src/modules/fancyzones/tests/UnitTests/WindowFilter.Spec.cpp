@@ -0,0 +1,234 @@
+#include "pch.h"
+#include "lib\WindowFilter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cwctype>
+#include <random>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace FancyZonesUnitTests
+{
+    TEST_CLASS(ExcludedAppsMatcherUnitTests)
+    {
+        static bool NaiveMatches(std::vector<std::wstring> const& patterns, std::wstring const& path)
+        {
+            for (auto const& pattern : patterns)
+            {
+                if (path.find(pattern) != std::wstring::npos)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        TEST_METHOD(EmptyMatchesNothing)
+        {
+            ExcludedAppsMatcher matcher;
+            Assert::IsTrue(matcher.Empty());
+            Assert::IsFalse(matcher.Matches(L"C:\\WINDOWS\\NOTEPAD.EXE"));
+
+            ExcludedAppsMatcher fromEmptyList(std::vector<std::wstring>{});
+            Assert::IsTrue(fromEmptyList.Empty());
+            Assert::IsFalse(fromEmptyList.Matches(L"C:\\WINDOWS\\NOTEPAD.EXE"));
+        }
+
+        TEST_METHOD(EmptyPatternMatchesEverything)
+        {
+            ExcludedAppsMatcher matcher({ L"" });
+            Assert::IsFalse(matcher.Empty());
+            Assert::IsTrue(matcher.Matches(L"C:\\WINDOWS\\NOTEPAD.EXE"));
+            Assert::IsTrue(matcher.Matches(L""));
+        }
+
+        TEST_METHOD(MatchesSubstrings)
+        {
+            ExcludedAppsMatcher matcher({ L"NOTEPAD", L"\\STEAM\\", L"CALC.EXE" });
+            Assert::IsTrue(matcher.Matches(L"C:\\WINDOWS\\NOTEPAD.EXE"));
+            Assert::IsTrue(matcher.Matches(L"D:\\GAMES\\STEAM\\STEAM.EXE"));
+            Assert::IsTrue(matcher.Matches(L"C:\\WINDOWS\\SYSTEM32\\CALC.EXE"));
+            Assert::IsFalse(matcher.Matches(L"C:\\WINDOWS\\EXPLORER.EXE"));
+            Assert::IsFalse(matcher.Matches(L"C:\\WINDOWS\\NOTEPA"));
+        }
+
+        TEST_METHOD(FollowsFailLinks)
+        {
+            // "ABCE" diverges from "ABCD" after "ABC"; the suffix "BCE" must still be found.
+            ExcludedAppsMatcher matcher({ L"ABCD", L"BCE", L"CX" });
+            Assert::IsTrue(matcher.Matches(L"ABCE"));
+            Assert::IsTrue(matcher.Matches(L"ABCX"));
+            Assert::IsFalse(matcher.Matches(L"ABCBCD"));
+        }
+
+        TEST_METHOD(PatternInsidePattern)
+        {
+            ExcludedAppsMatcher matcher({ L"LONGAPPNAME", L"APP" });
+            Assert::IsTrue(matcher.Matches(L"\\LONGAPX\\APP"));
+            Assert::IsTrue(matcher.Matches(L"LONGAPPNAX"));
+        }
+
+        TEST_METHOD(AgreesWithNaiveSearch)
+        {
+            // Small alphabet so patterns overlap heavily and exercise the fail links.
+            std::mt19937 random(0x2019);
+            auto randomString = [&](size_t maxLength) {
+                std::wstring value(random() % (maxLength + 1), L'A');
+                for (auto& ch : value)
+                {
+                    ch = L"AB\\."[random() % 4];
+                }
+                return value;
+            };
+
+            for (int round = 0; round < 200; round++)
+            {
+                std::vector<std::wstring> patterns;
+                for (size_t i = random() % 6; i > 0; i--)
+                {
+                    std::wstring pattern = randomString(5);
+                    if (!pattern.empty())
+                    {
+                        patterns.push_back(pattern);
+                    }
+                }
+
+                ExcludedAppsMatcher matcher(patterns);
+                for (int i = 0; i < 50; i++)
+                {
+                    std::wstring const path = randomString(20);
+                    Assert::AreEqual(NaiveMatches(patterns, path), matcher.Matches(path));
+                }
+            }
+        }
+    };
+
+    TEST_CLASS(WindowVerdictCacheUnitTests)
+    {
+        static HWND Window(uintptr_t value)
+        {
+            return reinterpret_cast<HWND>(value);
+        }
+
+        TEST_METHOD(GetMissing)
+        {
+            WindowVerdictCache cache;
+            Assert::IsFalse(cache.Get(Window(1), 100).has_value());
+        }
+
+        TEST_METHOD(SetAndGet)
+        {
+            WindowVerdictCache cache;
+            cache.Set(Window(1), 100, true);
+            cache.Set(Window(2), 100, false);
+
+            Assert::IsTrue(*cache.Get(Window(1), 100));
+            Assert::IsFalse(*cache.Get(Window(2), 100));
+        }
+
+        TEST_METHOD(RecycledHandleInOtherProcessMisses)
+        {
+            WindowVerdictCache cache;
+            cache.Set(Window(1), 100, false);
+            Assert::IsFalse(cache.Get(Window(1), 200).has_value());
+
+            cache.Set(Window(1), 200, true);
+            Assert::IsTrue(*cache.Get(Window(1), 200));
+            Assert::IsFalse(cache.Get(Window(1), 100).has_value());
+        }
+
+        TEST_METHOD(Invalidate)
+        {
+            WindowVerdictCache cache;
+            cache.Set(Window(1), 100, true);
+            cache.Set(Window(2), 100, true);
+            cache.Invalidate(Window(1));
+
+            Assert::IsFalse(cache.Get(Window(1), 100).has_value());
+            Assert::IsTrue(cache.Get(Window(2), 100).has_value());
+        }
+
+        TEST_METHOD(StaysWithinCapacity)
+        {
+            WindowVerdictCache cache(16);
+            for (uintptr_t i = 1; i <= 1000; i++)
+            {
+                cache.Set(Window(i), 100, true);
+                Assert::IsTrue(cache.Size() <= 16);
+            }
+
+            // Updating an existing entry at capacity must not drop the others.
+            size_t const size = cache.Size();
+            cache.Set(Window(1000), 100, false);
+            Assert::AreEqual(size, cache.Size());
+        }
+
+        // Simulates the CREATE/SHOW/UNCLOAKED/DESTROY sequence the hook sees for short-lived
+        // windows: each window is probed several times and then destroyed. Runs the storm through
+        // the cache and the matcher, and the way IsInterestingWindow used to check every event
+        // (upper-case a copy of the path, then search it for each excluded app), and logs the
+        // throughput and time per event of both.
+        TEST_METHOD(EventStorm)
+        {
+            constexpr uintptr_t windows = 10000;
+            constexpr int eventsPerWindow = 3;
+
+            std::vector<std::wstring> excluded{ L"\\STEAM\\", L"NOTEPAD.EXE" };
+            for (int i = 0; i < 30; i++)
+            {
+                excluded.push_back(L"\\VENDOR" + std::to_wstring(i) + L"\\TOOL.EXE");
+            }
+            std::wstring const paths[] = { L"C:\\Windows\\System32\\notepad.exe", L"C:\\Program Files\\WindowsApps\\Microsoft.WindowsTerminal\\WindowsTerminal.exe" };
+            std::wstring const upperPaths[] = { L"C:\\WINDOWS\\SYSTEM32\\NOTEPAD.EXE", L"C:\\PROGRAM FILES\\WINDOWSAPPS\\MICROSOFT.WINDOWSTERMINAL\\WINDOWSTERMINAL.EXE" };
+
+            WindowVerdictCache cache;
+            ExcludedAppsMatcher matcher(excluded);
+            size_t misses = 0;
+            auto const cachedStart = std::chrono::steady_clock::now();
+            for (uintptr_t i = 1; i <= windows; i++)
+            {
+                DWORD const pid = static_cast<DWORD>(i % 2);
+                for (int event = 0; event < eventsPerWindow; event++)
+                {
+                    auto verdict = cache.Get(Window(i), pid);
+                    if (!verdict)
+                    {
+                        misses++;
+                        verdict = !matcher.Matches(upperPaths[pid]);
+                        cache.Set(Window(i), pid, *verdict);
+                    }
+                    Assert::AreEqual(pid == 1, *verdict);
+                }
+                cache.Invalidate(Window(i));
+            }
+            auto const cachedElapsed = std::chrono::steady_clock::now() - cachedStart;
+
+            Assert::AreEqual(static_cast<size_t>(windows), misses);
+            Assert::AreEqual(static_cast<size_t>(0), cache.Size());
+
+            auto const uncachedStart = std::chrono::steady_clock::now();
+            for (uintptr_t i = 1; i <= windows; i++)
+            {
+                DWORD const pid = static_cast<DWORD>(i % 2);
+                for (int event = 0; event < eventsPerWindow; event++)
+                {
+                    std::wstring path = paths[pid];
+                    std::transform(path.begin(), path.end(), path.begin(), towupper);
+                    bool const matches = std::any_of(excluded.begin(), excluded.end(), [&](auto const& app) { return path.find(app) != std::wstring::npos; });
+                    Assert::AreEqual(pid == 1, !matches);
+                }
+            }
+            auto const uncachedElapsed = std::chrono::steady_clock::now() - uncachedStart;
+
+            auto const report = [](auto elapsed) {
+                auto const nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+                auto const perEvent = nanoseconds / (windows * eventsPerWindow);
+                return std::to_wstring(perEvent) + L" ns per event (" + std::to_wstring(perEvent ? 1000000000 / perEvent : 0) + L" events/s)";
+            };
+            std::wstring const message = std::to_wstring(windows * eventsPerWindow) + L" events against " + std::to_wstring(excluded.size()) +
+                                         L" excluded apps: cached " + report(cachedElapsed) + L", checked every time " + report(uncachedElapsed);
+            Logger::WriteMessage(message.c_str());
+        }
+    };
+}
@@ -0,0 +1,457 @@
+#include "pch.h"
+#include "lib\WindowRelayout.h"
+
+#include <algorithm>
+#include <map>
+
+#include "Util.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace FancyZonesUnitTests
+{
+    TEST_CLASS(WindowRelayoutUnitTests)
+    {
+        // Zone windows cover their monitor's work area, so mapping to the screen offsets by its origin.
+        class FakeWindowSystem : public WindowRelayout::WindowSystem
+        {
+        public:
+            struct Window
+            {
+                bool Visible = true;
+                RECT Rect{};
+                std::optional<RECT> Frame;
+                bool DpiUnaware = false;
+                UINT ShowCmd = SW_SHOWNORMAL;
+                bool Hung = false;
+                bool Unmovable = false; // Like a window of an elevated process
+                std::optional<RECT> MovedTo; // Screen rect from a batch, or the normal position from a placement
+            };
+
+            std::map<HWND, Window> Windows;
+            std::map<HWND, HMONITOR> ZoneWindowMonitors;
+            std::map<HMONITOR, MONITORINFO> Monitors;
+            int MonitorInfoQueries = 0;
+            int WindowQueries = 0; // Window rect, frame bounds and dpi awareness
+            WindowRelayout::GeometryCache* GeometryCache = nullptr;
+            std::vector<HWND> Batched; // Windows of every batch, including failed ones
+            int Placements = 0;
+
+            bool IsWindowVisible(HWND window) override { return Windows[window].Visible; }
+            RECT GetWindowRect(HWND window) override { WindowQueries++; return Windows[window].Rect; }
+            std::optional<RECT> GetFrameBounds(HWND window) override { WindowQueries++; return Windows[window].Frame; }
+            bool IsDpiUnaware(HWND window) override { WindowQueries++; return Windows[window].DpiUnaware; }
+
+            WINDOWPLACEMENT GetWindowPlacement(HWND window) override
+            {
+                WINDOWPLACEMENT placement{ sizeof(placement) };
+                placement.showCmd = Windows[window].ShowCmd;
+                placement.rcNormalPosition = Windows[window].Rect;
+                return placement;
+            }
+
+            RECT MapToScreen(HWND zoneWindow, RECT const& rect) override
+            {
+                auto iter = Monitors.find(ZoneWindowMonitors[zoneWindow]);
+                RECT const work = (iter != Monitors.end()) ? iter->second.rcWork : RECT{};
+                return { rect.left + work.left, rect.top + work.top, rect.right + work.left, rect.bottom + work.top };
+            }
+
+            HMONITOR MonitorFromWindow(HWND window) override { return ZoneWindowMonitors[window]; }
+            bool CanDeferMove(HWND window) override { return !Windows[window].Hung; }
+
+            bool DeferMoves(std::vector<WindowRelayout::Target const*> const& batch) override
+            {
+                bool const movable = std::none_of(batch.begin(), batch.end(), [&](auto target) { return Windows[target->Window].Unmovable; });
+                for (auto target : batch)
+                {
+                    Batched.push_back(target->Window);
+                    if (movable)
+                    {
+                        Windows[target->Window].MovedTo = target->ScreenRect;
+                    }
+                }
+                return movable;
+            }
+
+            bool SetWindowPlacement(HWND window, WINDOWPLACEMENT const& placement) override
+            {
+                Placements++;
+                if (Windows[window].Unmovable)
+                {
+                    return false;
+                }
+                Windows[window].MovedTo = placement.rcNormalPosition;
+                return true;
+            }
+
+            WindowRelayout::GeometryCache* Cache() override { return GeometryCache; }
+
+            std::optional<MONITORINFO> GetMonitorInfo(HMONITOR monitor) override
+            {
+                MonitorInfoQueries++;
+                auto iter = Monitors.find(monitor);
+                if (iter == Monitors.end())
+                {
+                    return std::nullopt;
+                }
+                return iter->second;
+            }
+        };
+
+        static HWND Handle(UINT_PTR value) { return reinterpret_cast<HWND>(value); }
+        static HMONITOR Monitor(UINT_PTR value) { return reinterpret_cast<HMONITOR>(value); }
+
+        static MONITORINFO MakeMonitorInfo(RECT const& monitor, RECT const& work)
+        {
+            MONITORINFO mi{ sizeof(mi) };
+            mi.rcMonitor = monitor;
+            mi.rcWork = work;
+            return mi;
+        }
+
+        // Two side-by-side monitors; the left one has its taskbar on the left edge.
+        static FakeWindowSystem MakeDesktop()
+        {
+            FakeWindowSystem system;
+            system.Monitors[Monitor(1)] = MakeMonitorInfo(RECT{ 0, 0, 1920, 1080 }, RECT{ 40, 0, 1920, 1080 });
+            system.Monitors[Monitor(2)] = MakeMonitorInfo(RECT{ 1920, 0, 3840, 1080 }, RECT{ 1920, 0, 3840, 1040 });
+            system.ZoneWindowMonitors[Handle(101)] = Monitor(1);
+            system.ZoneWindowMonitors[Handle(102)] = Monitor(2);
+            return system;
+        }
+
+        static RECT Shrink(RECT rect, WindowRelayout::FrameMargins const& margins)
+        {
+            return { rect.left + margins.Left, rect.top, rect.right - margins.Right, rect.bottom - margins.Bottom };
+        }
+
+        TEST_METHOD(MarginsOfFrame)
+        {
+            auto const margins = WindowRelayout::MarginsOf(RECT{ 93, 100, 507, 407 }, RECT{ 100, 100, 500, 400 });
+            Assert::IsTrue(margins == WindowRelayout::FrameMargins{ 7, 7, 7 });
+            Assert::IsTrue(WindowRelayout::MarginsOf(RECT{ 93, 100, 507, 407 }, std::nullopt) == WindowRelayout::FrameMargins{});
+        }
+
+        TEST_METHOD(FitToZoneExhaustive)
+        {
+            // Every taskbar edge, margin, awareness and zone overhanging each monitor edge.
+            RECT const monitor{ 1920, -200, 3840, 880 };
+            std::vector<std::optional<MONITORINFO>> monitors{ std::nullopt, MakeMonitorInfo(monitor, monitor) };
+            monitors.push_back(MakeMonitorInfo(monitor, RECT{ 1960, -200, 3840, 880 })); // Left
+            monitors.push_back(MakeMonitorInfo(monitor, RECT{ 1920, -160, 3840, 880 })); // Top
+            monitors.push_back(MakeMonitorInfo(monitor, RECT{ 1920, -200, 3800, 880 })); // Right
+            monitors.push_back(MakeMonitorInfo(monitor, RECT{ 1920, -200, 3840, 840 })); // Bottom
+
+            std::vector<RECT> zones;
+            for (LONG dx : { -30, 0, 30 })
+            {
+                for (LONG dy : { -30, 0, 30 })
+                {
+                    zones.push_back({ 1920 + dx, -200 + dy, 2880 + dx, 340 + dy });
+                    zones.push_back({ 2880 + dx, 340 + dy, 3840 + dx, 880 + dy });
+                }
+            }
+
+            size_t cases = 0;
+            for (auto const& monitorInfo : monitors)
+            {
+                POINT const offset = WindowRelayout::WorkspaceOffset(monitorInfo);
+                if (monitorInfo)
+                {
+                    Assert::AreEqual(monitorInfo->rcWork.left - monitorInfo->rcMonitor.left, offset.x);
+                    Assert::AreEqual(monitorInfo->rcWork.top - monitorInfo->rcMonitor.top, offset.y);
+                }
+
+                for (auto const& zone : zones)
+                {
+                    for (LONG left = 0; left <= 12; left += 4)
+                    {
+                        for (LONG right = 0; right <= 12; right += 4)
+                        {
+                            for (LONG bottom = 0; bottom <= 12; bottom += 4)
+                            {
+                                for (bool dpiUnaware : { false, true })
+                                {
+                                    WindowRelayout::FrameMargins const margins{ left, right, bottom };
+                                    RECT const normal = WindowRelayout::FitToZone(zone, margins, monitorInfo, dpiUnaware);
+                                    RECT screen{ normal.left + offset.x, normal.top + offset.y, normal.right + offset.x, normal.bottom + offset.y };
+
+                                    RECT expected{ zone.left - left, zone.top, zone.right + right, zone.bottom + bottom };
+                                    if (monitorInfo && dpiUnaware)
+                                    {
+                                        expected.left = (std::max)(expected.left, monitor.left + offset.x);
+                                        expected.top = (std::max)(expected.top, monitor.top + offset.y);
+                                        expected.right = (std::min)(expected.right, monitor.right);
+                                        expected.bottom = (std::min)(expected.bottom, monitor.bottom);
+                                    }
+                                    CustomAssert::AreEqual(expected, screen);
+
+                                    // Unless clamped, the visible frame covers exactly the zone.
+                                    if (!monitorInfo || !dpiUnaware)
+                                    {
+                                        CustomAssert::AreEqual(zone, Shrink(screen, margins));
+                                    }
+
+                                    WINDOWPLACEMENT placement{ sizeof(placement) };
+                                    auto const target = WindowRelayout::ComputeTarget(Handle(1), zone, margins, monitorInfo, dpiUnaware, placement);
+                                    CustomAssert::AreEqual(expected, target.ScreenRect);
+                                    CustomAssert::AreEqual(normal, target.Placement.rcNormalPosition);
+                                    cases++;
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+            Assert::AreEqual(static_cast<size_t>(6 * 18 * 4 * 4 * 4 * 2), cases);
+        }
+
+        TEST_METHOD(CacheSkipsWindowQueries)
+        {
+            auto system = MakeDesktop();
+            WindowRelayout::GeometryCache cache;
+            system.GeometryCache = &cache;
+            system.ZoneWindowMonitors[Handle(1)] = Monitor(2);
+            system.Windows[Handle(1)].Rect = RECT{ 93, 100, 507, 407 };
+            system.Windows[Handle(1)].Frame = RECT{ 100, 100, 500, 400 };
+            {
+                WindowRelayout::Planner planner(system);
+                planner.Add(Handle(1), Handle(102), RECT{ 0, 0, 960, 1040 });
+            }
+            Assert::AreEqual(3, system.WindowQueries);
+            Assert::AreEqual(1, system.MonitorInfoQueries);
+
+            // The frame has moved on since, but the margins are the same.
+            system.Windows[Handle(1)].Rect = RECT{ 1913, 0, 2887, 1047 };
+            system.Windows[Handle(1)].Frame = RECT{ 1920, 0, 2880, 1040 };
+            WindowRelayout::Planner planner(system);
+            planner.Add(Handle(1), Handle(102), RECT{ 960, 0, 1920, 1040 });
+            Assert::AreEqual(3, system.WindowQueries);
+            Assert::AreEqual(1, system.MonitorInfoQueries);
+            CustomAssert::AreEqual(RECT{ 2873, 0, 3847, 1047 }, planner.Targets().front().ScreenRect);
+        }
+
+        TEST_METHOD(CacheMissesOnOtherMonitor)
+        {
+            auto system = MakeDesktop();
+            WindowRelayout::GeometryCache cache;
+            system.GeometryCache = &cache;
+            system.ZoneWindowMonitors[Handle(1)] = Monitor(2);
+            WindowRelayout::Planner(system).Add(Handle(1), Handle(102), RECT{ 0, 0, 960, 1040 });
+            Assert::AreEqual(3, system.WindowQueries);
+
+            // Moving to the other monitor may change the window's dpi, so it is measured again.
+            WindowRelayout::Planner(system).Add(Handle(1), Handle(101), RECT{ 0, 0, 960, 1040 });
+            Assert::AreEqual(6, system.WindowQueries);
+
+            system.ZoneWindowMonitors[Handle(1)] = Monitor(1);
+            WindowRelayout::Planner(system).Add(Handle(1), Handle(101), RECT{ 0, 0, 960, 1040 });
+            Assert::AreEqual(9, system.WindowQueries);
+            WindowRelayout::Planner(system).Add(Handle(1), Handle(101), RECT{ 0, 0, 960, 1040 });
+            Assert::AreEqual(9, system.WindowQueries);
+        }
+
+        TEST_METHOD(CacheInvalidation)
+        {
+            auto system = MakeDesktop();
+            WindowRelayout::GeometryCache cache;
+            system.GeometryCache = &cache;
+            system.ZoneWindowMonitors[Handle(1)] = Monitor(2);
+            system.ZoneWindowMonitors[Handle(2)] = Monitor(2);
+            {
+                WindowRelayout::Planner planner(system);
+                planner.Add(Handle(1), Handle(102), RECT{ 0, 0, 960, 1040 });
+                planner.Add(Handle(2), Handle(102), RECT{ 960, 0, 1920, 1040 });
+            }
+            Assert::AreEqual(static_cast<size_t>(2), cache.WindowCount());
+
+            cache.InvalidateWindow(Handle(1));
+            {
+                WindowRelayout::Planner planner(system);
+                planner.Add(Handle(1), Handle(102), RECT{ 0, 0, 960, 1040 });
+                planner.Add(Handle(2), Handle(102), RECT{ 960, 0, 1920, 1040 });
+            }
+            Assert::AreEqual(9, system.WindowQueries);
+            Assert::AreEqual(1, system.MonitorInfoQueries);
+
+            cache.Clear();
+            Assert::AreEqual(static_cast<size_t>(0), cache.WindowCount());
+            WindowRelayout::Planner(system).Add(Handle(1), Handle(102), RECT{ 0, 0, 960, 1040 });
+            Assert::AreEqual(12, system.WindowQueries);
+            Assert::AreEqual(2, system.MonitorInfoQueries);
+        }
+
+        TEST_METHOD(MinimizedWindowsNotCached)
+        {
+            auto system = MakeDesktop();
+            WindowRelayout::GeometryCache cache;
+            system.GeometryCache = &cache;
+            system.ZoneWindowMonitors[Handle(1)] = Monitor(2);
+            system.Windows[Handle(1)].ShowCmd = SW_SHOWMINIMIZED;
+            WindowRelayout::Planner(system).Add(Handle(1), Handle(102), RECT{ 0, 0, 960, 1040 });
+
+            Assert::AreEqual(static_cast<size_t>(0), cache.WindowCount());
+        }
+
+        TEST_METHOD(MonitorQueriedOncePerMonitor)
+        {
+            auto system = MakeDesktop();
+            WindowRelayout::Planner planner(system);
+            for (UINT_PTR i = 1; i <= 50; i++)
+            {
+                planner.Add(Handle(i), Handle(100 + (i % 2) + 1), RECT{ 0, 0, 100, 100 });
+            }
+
+            Assert::AreEqual(static_cast<size_t>(50), planner.Targets().size());
+            Assert::AreEqual(2, system.MonitorInfoQueries);
+        }
+
+        TEST_METHOD(ZoneOnSecondaryMonitor)
+        {
+            auto system = MakeDesktop();
+            WindowRelayout::Planner planner(system);
+            planner.Add(Handle(1), Handle(102), RECT{ 0, 0, 960, 1040 });
+
+            auto const& target = planner.Targets().front();
+            Assert::IsTrue(target.Window == Handle(1));
+            CustomAssert::AreEqual(RECT{ 1920, 0, 2880, 1040 }, target.ScreenRect);
+            CustomAssert::AreEqual(RECT{ 1920, 0, 2880, 1040 }, target.Placement.rcNormalPosition);
+            Assert::IsTrue((target.Placement.flags & WPF_ASYNCWINDOWPLACEMENT) != 0);
+            Assert::AreEqual(static_cast<UINT>(SW_RESTORE | SW_SHOWNA), target.Placement.showCmd);
+        }
+
+        TEST_METHOD(TaskbarOffset)
+        {
+            auto system = MakeDesktop();
+            WindowRelayout::Planner planner(system);
+            planner.Add(Handle(1), Handle(101), RECT{ 0, 0, 940, 1080 });
+
+            // The placement is in workspace coordinates, which start right of the taskbar.
+            auto const& target = planner.Targets().front();
+            CustomAssert::AreEqual(RECT{ 40, 0, 980, 1080 }, target.ScreenRect);
+            CustomAssert::AreEqual(RECT{ 0, 0, 940, 1080 }, target.Placement.rcNormalPosition);
+        }
+
+        TEST_METHOD(FrameMargins)
+        {
+            auto system = MakeDesktop();
+            system.Windows[Handle(1)].Rect = RECT{ 93, 100, 507, 407 };
+            system.Windows[Handle(1)].Frame = RECT{ 100, 100, 500, 400 };
+            WindowRelayout::Planner planner(system);
+            planner.Add(Handle(1), Handle(102), RECT{ 0, 0, 960, 1040 });
+
+            // The invisible resize borders hang outside the zone; the top has none.
+            CustomAssert::AreEqual(RECT{ 1913, 0, 2887, 1047 }, planner.Targets().front().ScreenRect);
+        }
+
+        TEST_METHOD(DpiUnawareWindowsStayOnMonitor)
+        {
+            auto system = MakeDesktop();
+            system.Windows[Handle(1)].Rect = RECT{ 93, 100, 507, 407 };
+            system.Windows[Handle(1)].Frame = RECT{ 100, 100, 500, 400 };
+            system.Windows[Handle(1)].DpiUnaware = true;
+            WindowRelayout::Planner planner(system);
+            planner.Add(Handle(1), Handle(102), RECT{ 960, 0, 1920, 1040 });
+
+            CustomAssert::AreEqual(RECT{ 2873, 0, 3840, 1047 }, planner.Targets().front().ScreenRect);
+        }
+
+        TEST_METHOD(MinimizedWindowsStayMinimized)
+        {
+            auto system = MakeDesktop();
+            system.Windows[Handle(1)].ShowCmd = SW_SHOWMINIMIZED;
+            WindowRelayout::Planner planner(system);
+            planner.Add(Handle(1), Handle(102), RECT{ 0, 0, 960, 1040 });
+
+            auto const& target = planner.Targets().front();
+            Assert::AreEqual(static_cast<UINT>(SW_SHOWMINIMIZED), target.Placement.showCmd);
+            CustomAssert::AreEqual(RECT{ 1920, 0, 2880, 1040 }, target.Placement.rcNormalPosition);
+        }
+
+        TEST_METHOD(InvisibleWindowsSkipped)
+        {
+            auto system = MakeDesktop();
+            system.Windows[Handle(1)].Visible = false;
+            WindowRelayout::Planner planner(system);
+            planner.Add(Handle(1), Handle(101), RECT{ 0, 0, 100, 100 });
+
+            Assert::IsTrue(planner.Targets().empty());
+            Assert::AreEqual(0, system.MonitorInfoQueries);
+        }
+
+        TEST_METHOD(DuplicateWindowReplaced)
+        {
+            auto system = MakeDesktop();
+            WindowRelayout::Planner planner(system);
+            planner.Add(Handle(1), Handle(102), RECT{ 0, 0, 960, 1040 });
+            planner.Add(Handle(2), Handle(102), RECT{ 0, 0, 960, 1040 });
+            planner.Add(Handle(1), Handle(102), RECT{ 960, 0, 1920, 1040 });
+
+            auto const& targets = planner.Targets();
+            Assert::AreEqual(static_cast<size_t>(2), targets.size());
+            Assert::IsTrue(targets[0].Window == Handle(1));
+            CustomAssert::AreEqual(RECT{ 2880, 0, 3840, 1040 }, targets[0].ScreenRect);
+        }
+
+        TEST_METHOD(WindowFailingToMove)
+        {
+            // The right monitor has no taskbar on the left or top, so placements are in screen coordinates.
+            auto system = MakeDesktop();
+            system.Windows[Handle(2)].Unmovable = true;
+            WindowRelayout::Planner planner(system);
+            planner.Add(Handle(1), Handle(102), RECT{ 0, 0, 640, 1040 });
+            planner.Add(Handle(2), Handle(102), RECT{ 640, 0, 1280, 1040 });
+            planner.Add(Handle(3), Handle(102), RECT{ 1280, 0, 1920, 1040 });
+            planner.Apply();
+
+            // The batch fails as a whole; every window is then placed on its own, so only the
+            // one that can't move stays where it was.
+            Assert::AreEqual(static_cast<size_t>(3), system.Batched.size());
+            Assert::AreEqual(3, system.Placements);
+            CustomAssert::AreEqual(RECT{ 1920, 0, 2560, 1040 }, *system.Windows[Handle(1)].MovedTo);
+            Assert::IsFalse(system.Windows[Handle(2)].MovedTo.has_value());
+            CustomAssert::AreEqual(RECT{ 3200, 0, 3840, 1040 }, *system.Windows[Handle(3)].MovedTo);
+        }
+
+        TEST_METHOD(HungWindowLeftOutOfBatch)
+        {
+            auto system = MakeDesktop();
+            system.Windows[Handle(2)].Hung = true;
+            WindowRelayout::Planner planner(system);
+            planner.Add(Handle(1), Handle(102), RECT{ 0, 0, 640, 1040 });
+            planner.Add(Handle(2), Handle(102), RECT{ 640, 0, 1280, 1040 });
+            planner.Add(Handle(3), Handle(102), RECT{ 1280, 0, 1920, 1040 });
+            planner.Apply();
+
+            // The batch would wait on the hung window, so it gets an asynchronous placement instead.
+            Assert::IsTrue(system.Batched == std::vector<HWND>{ Handle(1), Handle(3) });
+            Assert::AreEqual(1, system.Placements);
+            Assert::IsTrue((planner.Targets()[1].Placement.flags & WPF_ASYNCWINDOWPLACEMENT) != 0);
+            CustomAssert::AreEqual(RECT{ 2560, 0, 3200, 1040 }, *system.Windows[Handle(2)].MovedTo);
+            CustomAssert::AreEqual(RECT{ 1920, 0, 2560, 1040 }, *system.Windows[Handle(1)].MovedTo);
+        }
+
+        TEST_METHOD(SingleWindowPlaced)
+        {
+            auto system = MakeDesktop();
+            WindowRelayout::Planner planner(system);
+            planner.Add(Handle(1), Handle(102), RECT{ 0, 0, 640, 1040 });
+            planner.Apply();
+
+            Assert::IsTrue(system.Batched.empty());
+            Assert::AreEqual(1, system.Placements);
+        }
+
+        TEST_METHOD(MissingMonitorInfo)
+        {
+            auto system = MakeDesktop();
+            system.ZoneWindowMonitors[Handle(103)] = Monitor(3);
+            WindowRelayout::Planner planner(system);
+            planner.Add(Handle(1), Handle(103), RECT{ 10, 20, 30, 40 });
+
+            // Without monitor info the zone rect is used as is.
+            CustomAssert::AreEqual(RECT{ 10, 20, 30, 40 }, planner.Targets().front().ScreenRect);
+        }
+    };
+}
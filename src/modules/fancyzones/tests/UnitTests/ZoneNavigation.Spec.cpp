@@ -0,0 +1,189 @@
+#include "pch.h"
+#include "lib\ZoneNavigation.h"
+#include "lib\LayoutGenerator.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using ZoneNavigation::Direction;
+
+namespace FancyZonesUnitTests
+{
+    TEST_CLASS(ZoneNavigationUnitTests)
+    {
+        using GridFactory = LayoutGenerator::GridSpec (*)(int);
+
+        static std::vector<ZoneNavigation::Node> Nodes(std::vector<RECT> const& zones, size_t group = 0)
+        {
+            std::vector<ZoneNavigation::Node> nodes;
+            for (auto const& zone : zones)
+            {
+                nodes.push_back({ zone, group });
+            }
+            return nodes;
+        }
+
+        // Edge of rect facing direction, and the opposite edge of a zone lying beyond it.
+        static bool Touches(RECT const& from, RECT const& to, Direction direction)
+        {
+            switch (direction)
+            {
+            case Direction::Left:
+                return (to.right == from.left) && ((std::min)(from.bottom, to.bottom) > (std::max)(from.top, to.top));
+            case Direction::Right:
+                return (to.left == from.right) && ((std::min)(from.bottom, to.bottom) > (std::max)(from.top, to.top));
+            case Direction::Up:
+                return (to.bottom == from.top) && ((std::min)(from.right, to.right) > (std::max)(from.left, to.left));
+            default:
+                return (to.top == from.bottom) && ((std::min)(from.right, to.right) > (std::max)(from.left, to.left));
+            }
+        }
+
+        // Without spacing, each zone's neighbor is a zone sharing the edge it moves across.
+        // Only zones with no such zone wrap around, and then stay in the same row or column.
+        static void AssertGridNavigation(GridFactory factory)
+        {
+            RECT const workArea{ 0, 0, 1920, 1080 };
+            for (int zoneCount = 1; zoneCount <= 40; zoneCount++)
+            {
+                auto const zones = LayoutGenerator::GridZones(factory(zoneCount), workArea, 0);
+                ZoneNavigation::Graph const graph(Nodes(zones));
+                Assert::AreEqual(zones.size(), graph.Size());
+
+                for (size_t i = 0; i < zones.size(); i++)
+                {
+                    for (auto direction : { Direction::Left, Direction::Up, Direction::Right, Direction::Down })
+                    {
+                        bool const hasTouching = std::any_of(zones.begin(), zones.end(), [&](RECT const& zone) {
+                            return Touches(zones[i], zone, direction);
+                        });
+
+                        int const neighbor = graph.Neighbor(i, direction);
+                        if (hasTouching)
+                        {
+                            Assert::IsTrue(neighbor != ZoneNavigation::None);
+                            Assert::IsTrue(Touches(zones[i], zones[neighbor], direction));
+                        }
+                        else if (neighbor != ZoneNavigation::None)
+                        {
+                            Assert::IsTrue(neighbor != static_cast<int>(i));
+                            Assert::IsFalse(Touches(zones[i], zones[neighbor], direction));
+                        }
+                    }
+                }
+            }
+        }
+
+        TEST_METHOD(DirectionFromKey)
+        {
+            Assert::IsTrue(ZoneNavigation::DirectionFromKey(VK_LEFT) == Direction::Left);
+            Assert::IsTrue(ZoneNavigation::DirectionFromKey(VK_UP) == Direction::Up);
+            Assert::IsTrue(ZoneNavigation::DirectionFromKey(VK_RIGHT) == Direction::Right);
+            Assert::IsTrue(ZoneNavigation::DirectionFromKey(VK_DOWN) == Direction::Down);
+            Assert::IsFalse(ZoneNavigation::DirectionFromKey('A').has_value());
+        }
+
+        TEST_METHOD(GridNavigation)
+        {
+            AssertGridNavigation(LayoutGenerator::Grid);
+        }
+
+        TEST_METHOD(PriorityGridNavigation)
+        {
+            AssertGridNavigation(LayoutGenerator::PriorityGrid);
+        }
+
+        TEST_METHOD(ColumnsWrapAround)
+        {
+            auto const zones = LayoutGenerator::GridZones(LayoutGenerator::Columns(3), RECT{ 0, 0, 900, 600 }, 16);
+            ZoneNavigation::Graph const graph(Nodes(zones));
+
+            Assert::AreEqual(1, graph.Neighbor(0, Direction::Right));
+            Assert::AreEqual(2, graph.Neighbor(1, Direction::Right));
+            Assert::AreEqual(0, graph.Neighbor(2, Direction::Right));
+            Assert::AreEqual(2, graph.Neighbor(0, Direction::Left));
+            Assert::AreEqual(ZoneNavigation::None, graph.Neighbor(1, Direction::Up));
+            Assert::AreEqual(ZoneNavigation::None, graph.Neighbor(1, Direction::Down));
+        }
+
+        TEST_METHOD(GridUpDown)
+        {
+            // 4 zones: 2 by 2, numbered from the bottom right.
+            auto const zones = LayoutGenerator::GridZones(LayoutGenerator::Grid(4), RECT{ 0, 0, 1000, 1000 }, 0);
+            ZoneNavigation::Graph const graph(Nodes(zones));
+
+            int const topLeft = LayoutGenerator::Grid(4).CellAt(0, 0);
+            int const bottomLeft = LayoutGenerator::Grid(4).CellAt(1, 0);
+            int const topRight = LayoutGenerator::Grid(4).CellAt(0, 1);
+            Assert::AreEqual(bottomLeft, graph.Neighbor(topLeft, Direction::Down));
+            Assert::AreEqual(topLeft, graph.Neighbor(bottomLeft, Direction::Up));
+            Assert::AreEqual(topRight, graph.Neighbor(topLeft, Direction::Right));
+            Assert::AreEqual(topLeft, graph.Neighbor(topRight, Direction::Right));
+        }
+
+        TEST_METHOD(PriorityGridSpanningZones)
+        {
+            // 5 zones: a tall middle column between two columns split in half.
+            auto const spec = LayoutGenerator::PriorityGrid(5);
+            auto const zones = LayoutGenerator::GridZones(spec, RECT{ 0, 0, 1200, 800 }, 0);
+            ZoneNavigation::Graph const graph(Nodes(zones));
+
+            int const middle = spec.CellAt(0, 1);
+            Assert::AreEqual(middle, spec.CellAt(1, 1));
+            Assert::AreEqual(spec.CellAt(0, 2), graph.Neighbor(middle, Direction::Right));
+            Assert::AreEqual(spec.CellAt(0, 0), graph.Neighbor(middle, Direction::Left));
+            Assert::AreEqual(middle, graph.Neighbor(spec.CellAt(1, 0), Direction::Right));
+            Assert::AreEqual(ZoneNavigation::None, graph.Neighbor(middle, Direction::Down));
+        }
+
+        TEST_METHOD(AcrossMonitors)
+        {
+            // Two columns on each of two side-by-side monitors.
+            auto const left = LayoutGenerator::GridZones(LayoutGenerator::Columns(2), RECT{ 0, 0, 1920, 1040 }, 0);
+            auto const right = LayoutGenerator::GridZones(LayoutGenerator::Columns(2), RECT{ 1920, 0, 3840, 1040 }, 0);
+            auto nodes = Nodes(left, 0);
+            auto const rightNodes = Nodes(right, 1);
+            nodes.insert(nodes.end(), rightNodes.begin(), rightNodes.end());
+            ZoneNavigation::Graph const graph(nodes);
+
+            Assert::AreEqual(1, graph.Neighbor(0, Direction::Right));
+            Assert::AreEqual(2, graph.Neighbor(1, Direction::Right));
+            Assert::AreEqual(3, graph.Neighbor(2, Direction::Right));
+            Assert::AreEqual(1, graph.Neighbor(2, Direction::Left));
+
+            // Wrapping stays on the monitor the window is on.
+            Assert::AreEqual(2, graph.Neighbor(3, Direction::Right));
+            Assert::AreEqual(1, graph.Neighbor(0, Direction::Left));
+        }
+
+        TEST_METHOD(Entry)
+        {
+            auto const spec = LayoutGenerator::Grid(4);
+            auto const zones = LayoutGenerator::GridZones(spec, RECT{ 0, 0, 1000, 1000 }, 0);
+            ZoneNavigation::Graph const graph(Nodes(zones));
+
+            Assert::AreEqual(spec.CellAt(0, 0), graph.Entry(0, Direction::Right));
+            Assert::AreEqual(spec.CellAt(0, 0), graph.Entry(0, Direction::Down));
+            Assert::AreEqual(spec.CellAt(0, 1), graph.Entry(0, Direction::Left));
+            Assert::AreEqual(spec.CellAt(1, 0), graph.Entry(0, Direction::Up));
+            Assert::AreEqual(ZoneNavigation::None, graph.Entry(1, Direction::Right));
+        }
+
+        TEST_METHOD(OverlappingZones)
+        {
+            // Focus zones cascade; each one is further right and down than the last.
+            auto const zones = LayoutGenerator::FocusZones(3, RECT{ 0, 0, 1000, 500 });
+            ZoneNavigation::Graph const graph(Nodes(zones));
+
+            Assert::AreEqual(1, graph.Neighbor(0, Direction::Right));
+            Assert::AreEqual(2, graph.Neighbor(1, Direction::Down));
+            Assert::AreEqual(1, graph.Neighbor(2, Direction::Left));
+        }
+
+        TEST_METHOD(Empty)
+        {
+            ZoneNavigation::Graph const graph;
+            Assert::AreEqual(static_cast<size_t>(0), graph.Size());
+            Assert::AreEqual(ZoneNavigation::None, graph.Neighbor(0, Direction::Right));
+            Assert::AreEqual(ZoneNavigation::None, graph.Entry(0, Direction::Right));
+        }
+    };
+}
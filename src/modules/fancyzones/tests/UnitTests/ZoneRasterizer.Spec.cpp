@@ -0,0 +1,262 @@
+#include "pch.h"
+#include "lib\ZoneRasterizer.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace FancyZonesUnitTests
+{
+    TEST_CLASS(ZoneRasterizerUnitTests)
+    {
+        static constexpr int Width = 13;
+        static constexpr int Height = 6;
+        static constexpr int Stride = 16;
+
+        std::vector<UINT32> pixels;
+        ArgbSurface surface;
+
+        TEST_METHOD_INITIALIZE(Initialize)
+        {
+            // Wider stride than width, so writes past the row end show up in the padding.
+            pixels.assign(Stride * Height, 0xDEADBEEF);
+            surface = { pixels.data(), Width, Height, Stride };
+        }
+
+        UINT32 Pixel(int x, int y) const
+        {
+            return pixels[y * Stride + x];
+        }
+
+        void AssertPadding()
+        {
+            for (int y = 0; y < Height; y++)
+            {
+                for (int x = Width; x < Stride; x++)
+                {
+                    Assert::AreEqual(0xDEADBEEFu, Pixel(x, y));
+                }
+            }
+        }
+
+        // Draws what ZoneWindow::OnPaint draws: the backdrop, then a grid of zones with a border
+        // and a fill, the last one highlighted, each with a 3x3 index glyph in its top left corner.
+        static void DrawOverlay(ArgbSurface const& target, int columns, int rows, int thickness, int glyphSize)
+        {
+            UINT32 const border = ZoneRasterizer::PremultipliedColor(255, RGB(0x10, 0x20, 0x30));
+            UINT32 const fill = ZoneRasterizer::PremultipliedColor(128, RGB(0xF0, 0xF0, 0xF0));
+            UINT32 const highlight = ZoneRasterizer::PremultipliedColor(128, RGB(0x00, 0x78, 0xD7));
+            UINT32 const glyphOuter = ZoneRasterizer::PremultipliedColor(200, RGB(50, 50, 50));
+            UINT32 const glyphInner = ZoneRasterizer::PremultipliedColor(100, RGB(0xFF, 0xFF, 0xFF));
+
+            ZoneRasterizer::FillRect(target, { 0, 0, target.width, target.height }, 0);
+            int const zoneWidth = target.width / columns;
+            int const zoneHeight = target.height / rows;
+            for (int row = 0; row < rows; row++)
+            {
+                for (int column = 0; column < columns; column++)
+                {
+                    RECT zone{ column * zoneWidth, row * zoneHeight, (column + 1) * zoneWidth, (row + 1) * zoneHeight };
+                    ZoneRasterizer::FillRect(target, zone, border);
+                    InflateRect(&zone, -thickness, -thickness);
+                    bool const highlighted = (row == rows - 1) && (column == columns - 1);
+                    ZoneRasterizer::FillRect(target, zone, highlighted ? highlight : fill);
+
+                    for (int y = 0; y < 3; y++)
+                    {
+                        for (int x = 0; x < 3; x++)
+                        {
+                            RECT square{ zone.left + thickness + x * glyphSize, zone.top + thickness + y * glyphSize };
+                            square.right = square.left + glyphSize;
+                            square.bottom = square.top + glyphSize;
+                            ZoneRasterizer::BlendRect(target, square, glyphOuter);
+                            InflateRect(&square, -1, -1);
+                            ZoneRasterizer::BlendRect(target, square, glyphInner);
+                        }
+                    }
+                }
+            }
+        }
+
+        // Draws the overlay at the given resolution for a number of frames and logs the time per frame.
+        static void BenchmarkOverlay(int width, int height, int frames)
+        {
+            std::vector<UINT32> buffer(static_cast<size_t>(width) * height);
+            ArgbSurface const target{ buffer.data(), width, height, width };
+            int const scale = height / 540;
+
+            auto const start = std::chrono::steady_clock::now();
+            for (int frame = 0; frame < frames; frame++)
+            {
+                DrawOverlay(target, 4, 3, 5 * scale, 8 * scale);
+            }
+            auto const elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+            // A highlighted zone is the last one drawn, so its fill has to show in the last pixel.
+            Assert::AreEqual(ZoneRasterizer::PremultipliedColor(128, RGB(0x00, 0x78, 0xD7)), buffer[buffer.size() - 1 - 5 * scale * (width + 1)]);
+
+            auto const perFrame = elapsed.count() / frames;
+            std::wstring const message = std::to_wstring(width) + L"x" + std::to_wstring(height) + L" overlay: " + std::to_wstring(perFrame) +
+                                         L" us per frame, " + std::to_wstring(static_cast<long long>(width) * height / (perFrame ? perFrame : 1)) +
+                                         L" Mpixels/s";
+            Logger::WriteMessage(message.c_str());
+        }
+
+        void AssertImage(RECT const& rect, UINT32 inside, UINT32 outside)
+        {
+            for (int y = 0; y < Height; y++)
+            {
+                for (int x = 0; x < Width; x++)
+                {
+                    POINT const pt{ x, y };
+                    Assert::AreEqual(PtInRect(&rect, pt) ? inside : outside, Pixel(x, y));
+                }
+            }
+            AssertPadding();
+        }
+
+        TEST_METHOD(PremultipliedColorMatchesGdiPath)
+        {
+            Assert::AreEqual(0x00000000u, ZoneRasterizer::PremultipliedColor(0, RGB(255, 255, 255)));
+            Assert::AreEqual(0xFF0A141Eu, ZoneRasterizer::PremultipliedColor(255, RGB(10, 20, 30)));
+            Assert::AreEqual(0xC8272727u, ZoneRasterizer::PremultipliedColor(200, RGB(50, 50, 50)));
+            Assert::AreEqual(0x64646464u, ZoneRasterizer::PremultipliedColor(100, RGB(255, 255, 255)));
+        }
+
+        TEST_METHOD(FillRectInsideSurface)
+        {
+            RECT const rect{ 1, 1, 12, 5 };
+            ZoneRasterizer::FillRect(surface, rect, 0xFF102030);
+            AssertImage(rect, 0xFF102030, 0xDEADBEEF);
+        }
+
+        TEST_METHOD(FillRectIsClipped)
+        {
+            ZoneRasterizer::FillRect(surface, { -10, -10, 100, 100 }, 0x80402010);
+            AssertImage({ 0, 0, Width, Height }, 0x80402010, 0xDEADBEEF);
+        }
+
+        TEST_METHOD(FillRectOutsideSurfaceIsNoop)
+        {
+            ZoneRasterizer::FillRect(surface, { Width, 0, Width + 5, Height }, 0);
+            ZoneRasterizer::FillRect(surface, { 0, -5, Width, 0 }, 0);
+            ZoneRasterizer::FillRect(surface, { 5, 5, 2, 2 }, 0);
+            AssertImage({}, 0, 0xDEADBEEF);
+        }
+
+        TEST_METHOD(BlendRectOverOpaque)
+        {
+            // Index glyph colors drawn by ZoneWindow: white at 100 over dark grey at 200.
+            RECT const all{ 0, 0, Width, Height };
+            ZoneRasterizer::FillRect(surface, all, ZoneRasterizer::PremultipliedColor(200, RGB(50, 50, 50)));
+            ZoneRasterizer::BlendRect(surface, all, ZoneRasterizer::PremultipliedColor(100, RGB(255, 255, 255)));
+            AssertImage(all, 0xDE7C7C7C, 0);
+        }
+
+        TEST_METHOD(BlendRectOverTransparent)
+        {
+            RECT const rect{ 2, 1, 11, 4 };
+            ZoneRasterizer::FillRect(surface, { 0, 0, Width, Height }, 0);
+            ZoneRasterizer::BlendRect(surface, rect, 0x64646464);
+            AssertImage(rect, 0x64646464, 0);
+        }
+
+        TEST_METHOD(BlendRectVectorAndScalarPathsAgree)
+        {
+            // Every row covers both the four-pixel SIMD loop and the scalar tail.
+            for (UINT32 alpha = 1; alpha < 255; alpha += 7)
+            {
+                UINT32 const src = (alpha << 24) | ((alpha / 2) << 16) | ((alpha / 3) << 8) | (alpha / 4);
+                for (int x = 0; x < Width; x++)
+                {
+                    pixels[x] = 0xFF000000 | (x * 0x00131F29);
+                }
+
+                std::vector<UINT32> expected(pixels.begin(), pixels.begin() + Width);
+                for (int x = 0; x < Width; x++)
+                {
+                    ArgbSurface single{ &expected[x], 1, 1, 1 };
+                    ZoneRasterizer::BlendRect(single, { 0, 0, 1, 1 }, src);
+                }
+
+                ZoneRasterizer::BlendRect(surface, { 0, 0, Width, 1 }, src);
+                for (int x = 0; x < Width; x++)
+                {
+                    Assert::AreEqual(expected[x], Pixel(x, 0));
+                }
+            }
+            AssertPadding();
+        }
+
+        TEST_METHOD(BlendRectOpaqueReplaces)
+        {
+            RECT const rect{ 0, 0, 7, 3 };
+            ZoneRasterizer::BlendRect(surface, rect, 0xFF112233);
+            AssertImage(rect, 0xFF112233, 0xDEADBEEF);
+        }
+
+        // Two zones, the second one highlighted, with their glyphs, compared pixel by pixel
+        // with an image checked by hand. Each letter stands for one pixel value.
+        TEST_METHOD(OverlayMatchesGoldenImage)
+        {
+            constexpr int OverlayWidth = 24;
+            constexpr int OverlayHeight = 12;
+            char const* const golden[OverlayHeight] = {
+                "BBBBBBBBBBBBBBBBBBBBBBBB",
+                "BFFFFFFFFFFBBHHHHHHHHHHB",
+                "BFOOOOOOOOOBBHIIIIIIIIIB",
+                "BFOPOOPOOPOBBHIJIIJIIJIB",
+                "BFOOOOOOOOOBBHIIIIIIIIIB",
+                "BFOOOOOOOOOBBHIIIIIIIIIB",
+                "BFOPOOPOOPOBBHIJIIJIIJIB",
+                "BFOOOOOOOOOBBHIIIIIIIIIB",
+                "BFOOOOOOOOOBBHIIIIIIIIIB",
+                "BFOPOOPOOPOBBHIJIIJIIJIB",
+                "BFOOOOOOOOOBBHIIIIIIIIIB",
+                "BBBBBBBBBBBBBBBBBBBBBBBB",
+            };
+            auto const color = [](char letter) {
+                switch (letter)
+                {
+                case 'B': return 0xFF102030u; // Border
+                case 'F': return 0x80787878u; // Zone fill
+                case 'H': return 0x80003C6Bu; // Highlighted zone fill
+                case 'O': return 0xE4414141u; // Glyph square over the fill
+                case 'P': return 0xEF8C8C8Cu; // Glyph center over that
+                case 'I': return 0xE427343Eu; // Glyph square over the highlight
+                case 'J': return 0xEF7C848Au; // Glyph center over that
+                }
+                return 0u;
+            };
+
+            std::vector<UINT32> buffer(OverlayWidth * OverlayHeight, 0xDEADBEEF);
+            DrawOverlay({ buffer.data(), OverlayWidth, OverlayHeight, OverlayWidth }, 2, 1, 1, 3);
+            for (int y = 0; y < OverlayHeight; y++)
+            {
+                for (int x = 0; x < OverlayWidth; x++)
+                {
+                    Assert::AreEqual(color(golden[y][x]), buffer[y * OverlayWidth + x]);
+                }
+            }
+        }
+
+        TEST_METHOD(OverlayFrameTimeAt4K)
+        {
+            BenchmarkOverlay(3840, 2160, 20);
+        }
+
+        TEST_METHOD(OverlayFrameTimeAt8K)
+        {
+            BenchmarkOverlay(7680, 4320, 5);
+        }
+
+        TEST_METHOD(NullSurfaceIsNoop)
+        {
+            ArgbSurface empty{};
+            ZoneRasterizer::FillRect(empty, { 0, 0, 10, 10 }, 0xFFFFFFFF);
+            ZoneRasterizer::BlendRect(empty, { 0, 0, 10, 10 }, 0x80808080);
+        }
+    };
+}
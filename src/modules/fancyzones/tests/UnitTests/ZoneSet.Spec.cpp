@@ -47,6 +47,21 @@ TEST_METHOD(TestAddZone)
     }
 }
 
+TEST_METHOD(TestRevision)
+{
+    ZoneSetConfig config({}, 0xFFFF, Mocks::Monitor(), L"WorkAreaIn");
+    winrt::com_ptr<IZoneSet> set = MakeZoneSet(config);
+    winrt::com_ptr<IZoneSet> same = MakeZoneSet(config);
+
+    // Zone sets with the same id and zones still tell apart, so a replaced one is noticed.
+    Assert::AreNotEqual(set->Revision(), same->Revision());
+
+    const UINT revision = set->Revision();
+    Assert::AreEqual(revision, set->Revision());
+    set->AddZone(MakeZone({ 0, 0, 100, 100 }));
+    Assert::AreNotEqual(revision, set->Revision());
+}
+
 TEST_METHOD(TestMoveWindowIntoZoneByIndex)
 {
     ZoneSetConfig config({}, 0xFFFF, Mocks::Monitor(), L"WorkAreaIn");
@@ -99,8 +114,8 @@ TEST_METHOD(TestMoveWindowIntoZoneByIndexWithInvalidIndex)
 }
 ;
 
-// MoveWindowIntoZoneByDirection is complicated enough to warrant it's own test class
-TEST_CLASS(MoveWindowIntoZoneByDirectionUnitTests)
+// Moving by direction is resolved by ZoneNavigation; the ZoneSet only moves the window into the chosen zone.
+TEST_CLASS(MoveWindowIntoZoneUnitTests)
 {
     winrt::com_ptr<IZoneSet> set;
     winrt::com_ptr<IZone> zone1;
@@ -121,72 +136,39 @@ TEST_CLASS(MoveWindowIntoZoneByDirectionUnitTests)
         set->AddZone(zone3);
     }
 
-    TEST_METHOD(MoveWindowIntoZoneByDirectionRightNoZones)
+    TEST_METHOD(MoveWindowIntoZoneFromNoZone)
     {
         HWND window = Mocks::Window();
-        set->MoveWindowIntoZoneByDirection(window, Mocks::Window(), VK_RIGHT);
-        Assert::IsTrue(zone1->ContainsWindow(window));
-        Assert::IsFalse(zone2->ContainsWindow(window));
-        Assert::IsFalse(zone3->ContainsWindow(window));
-    }
-
-    TEST_METHOD(MoveWindowIntoZoneByDirectionLeftNoZones)
-    {
-        HWND window = Mocks::Window();
-        set->MoveWindowIntoZoneByDirection(window, Mocks::Window(), VK_LEFT);
+        set->MoveWindowIntoZone(window, Mocks::Window(), 2);
         Assert::IsFalse(zone1->ContainsWindow(window));
         Assert::IsFalse(zone2->ContainsWindow(window));
         Assert::IsTrue(zone3->ContainsWindow(window));
     }
 
-    TEST_METHOD(MoveWindowIntoZoneByDirectionRight)
+    TEST_METHOD(MoveWindowIntoZoneLeavesOldZone)
     {
         HWND window = Mocks::Window();
         zone1->AddWindowToZone(window, Mocks::Window(), false /*stampZone*/);
-        set->MoveWindowIntoZoneByDirection(window, Mocks::Window(), VK_RIGHT);
+        set->MoveWindowIntoZone(window, Mocks::Window(), 1);
         Assert::IsFalse(zone1->ContainsWindow(window));
         Assert::IsTrue(zone2->ContainsWindow(window));
         Assert::IsFalse(zone3->ContainsWindow(window));
 
-        set->MoveWindowIntoZoneByDirection(window, Mocks::Window(), VK_RIGHT);
-        Assert::IsFalse(zone1->ContainsWindow(window));
-        Assert::IsFalse(zone2->ContainsWindow(window));
-        Assert::IsTrue(zone3->ContainsWindow(window));
-    }
-
-    TEST_METHOD(MoveWindowIntoZoneByDirectionLeft)
-    {
-        HWND window = Mocks::Window();
-        zone3->AddWindowToZone(window, Mocks::Window(), false /*stampZone*/);
-        set->MoveWindowIntoZoneByDirection(window, Mocks::Window(), VK_LEFT);
-        Assert::IsFalse(zone1->ContainsWindow(window));
-        Assert::IsTrue(zone2->ContainsWindow(window));
-        Assert::IsFalse(zone3->ContainsWindow(window));
-
-        set->MoveWindowIntoZoneByDirection(window, Mocks::Window(), VK_LEFT);
-        Assert::IsTrue(zone1->ContainsWindow(window));
-        Assert::IsFalse(zone2->ContainsWindow(window));
-        Assert::IsFalse(zone3->ContainsWindow(window));
-    }
-
-    TEST_METHOD(MoveWindowIntoZoneByDirectionWrapAroundRight)
-    {
-        HWND window = Mocks::Window();
-        zone3->AddWindowToZone(window, Mocks::Window(), false /*stampZone*/);
-        set->MoveWindowIntoZoneByDirection(window, Mocks::Window(), VK_RIGHT);
+        set->MoveWindowIntoZone(window, Mocks::Window(), 0);
         Assert::IsTrue(zone1->ContainsWindow(window));
         Assert::IsFalse(zone2->ContainsWindow(window));
         Assert::IsFalse(zone3->ContainsWindow(window));
     }
 
-    TEST_METHOD(MoveWindowIntoZoneByDirectionWrapAroundLeft)
+    TEST_METHOD(MoveWindowIntoZoneInvalidIndex)
     {
         HWND window = Mocks::Window();
-        zone1->AddWindowToZone(window, Mocks::Window(), false /*stampZone*/);
-        set->MoveWindowIntoZoneByDirection(window, Mocks::Window(), VK_LEFT);
+        zone2->AddWindowToZone(window, Mocks::Window(), false /*stampZone*/);
+        set->MoveWindowIntoZone(window, Mocks::Window(), 3);
+        set->MoveWindowIntoZone(window, Mocks::Window(), -1);
         Assert::IsFalse(zone1->ContainsWindow(window));
-        Assert::IsFalse(zone2->ContainsWindow(window));
-        Assert::IsTrue(zone3->ContainsWindow(window));
+        Assert::IsTrue(zone2->ContainsWindow(window));
+        Assert::IsFalse(zone3->ContainsWindow(window));
     }
 };
 }
@@ -0,0 +1,320 @@
+#include "pch.h"
+#include "lib\ZoneSetStore.h"
+
+#include "Util.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace FancyZonesUnitTests
+{
+    TEST_CLASS(ZoneSetStoreUnitTests)
+    {
+        static ZoneSetStore::Entry MakeEntry(PCWSTR workAreaKey, WORD layoutId, size_t zoneCount)
+        {
+            ZoneSetStore::Entry entry;
+            entry.WorkAreaKey = workAreaKey;
+            CoCreateGuid(&entry.Id);
+            entry.LayoutId = layoutId;
+            entry.Layout = ZoneSetLayout::Custom;
+            entry.PaddingInner = 4;
+            entry.PaddingOuter = 8;
+            entry.WorkArea = { 0, 0, 1920, 1040 };
+            for (size_t i = 0; i < zoneCount; i++)
+            {
+                LONG const offset = static_cast<LONG>(i) * 10;
+                entry.Zones.push_back({ offset, offset + 1, offset + 100, offset + 200 });
+            }
+            return entry;
+        }
+
+        static void AssertEntriesEqual(ZoneSetStore::Entry const& expected, ZoneSetStore::Entry const& actual)
+        {
+            Assert::IsTrue(expected.WorkAreaKey == actual.WorkAreaKey);
+            CustomAssert::AreEqual(expected.Id, actual.Id);
+            CustomAssert::AreEqual(expected.LayoutId, actual.LayoutId);
+            Assert::IsTrue(expected.Layout == actual.Layout);
+            Assert::AreEqual(expected.PaddingInner, actual.PaddingInner);
+            Assert::AreEqual(expected.PaddingOuter, actual.PaddingOuter);
+            CustomAssert::AreEqual(expected.WorkArea, actual.WorkArea);
+            Assert::AreEqual(expected.Zones.size(), actual.Zones.size());
+            for (size_t i = 0; i < expected.Zones.size(); i++)
+            {
+                CustomAssert::AreEqual(expected.Zones[i], actual.Zones[i]);
+            }
+        }
+
+        static std::wstring TempStorePath()
+        {
+            wchar_t tempPath[MAX_PATH]{};
+            wchar_t path[MAX_PATH]{};
+            GetTempPathW(ARRAYSIZE(tempPath), tempPath);
+            GetTempFileNameW(tempPath, L"fz", 0, path);
+            return path;
+        }
+
+        TEST_METHOD(SerializeEmpty)
+        {
+            std::vector<BYTE> bytes = ZoneSetStore::Serialize({});
+            Assert::AreEqual(sizeof(ZoneSetStore::Header), bytes.size());
+
+            ZoneSetStore::Image image(bytes.data(), bytes.size());
+            Assert::IsTrue(image.IsValid());
+            Assert::AreEqual(0ul, image.RecordCount());
+        }
+
+        TEST_METHOD(RoundTrip)
+        {
+            std::vector<ZoneSetStore::Entry> entries{
+                MakeEntry(L"1920_1080", 0xFFFF, 3),
+                MakeEntry(L"1920_1080", 0xFFFC, 0),
+                MakeEntry(L"3840_2160", 0x0001, 5),
+            };
+
+            std::vector<BYTE> bytes = ZoneSetStore::Serialize(entries);
+            ZoneSetStore::Image image(bytes.data(), bytes.size());
+            Assert::IsTrue(image.IsValid());
+            Assert::AreEqual(3ul, image.RecordCount());
+
+            auto actual = image.ReadAll();
+            Assert::AreEqual(entries.size(), actual.size());
+            for (size_t i = 0; i < entries.size(); i++)
+            {
+                AssertEntriesEqual(entries[i], actual[i]);
+            }
+        }
+
+        TEST_METHOD(MoreThanFortyZones)
+        {
+            std::vector<ZoneSetStore::Entry> entries{ MakeEntry(L"2560_1440", 0x0002, 128) };
+            std::vector<BYTE> bytes = ZoneSetStore::Serialize(entries);
+            ZoneSetStore::Image image(bytes.data(), bytes.size());
+            Assert::IsTrue(image.IsValid());
+            AssertEntriesEqual(entries[0], image.ReadAll()[0]);
+        }
+
+        TEST_METHOD(ForEachFiltersByWorkArea)
+        {
+            std::vector<ZoneSetStore::Entry> entries{
+                MakeEntry(L"1920_1080", 0xFFFF, 3),
+                MakeEntry(L"3840_2160", 0xFFFE, 2),
+                MakeEntry(L"1920_1080", 0xFFFD, 4),
+            };
+            std::vector<BYTE> bytes = ZoneSetStore::Serialize(entries);
+            ZoneSetStore::Image image(bytes.data(), bytes.size());
+
+            std::vector<GUID> visited;
+            image.ForEach(L"1920_1080", [&](ZoneSetStore::Record const& record, RECT const* zones) {
+                visited.push_back(record.Id);
+                CustomAssert::AreEqual(zones[0], RECT{ 0, 1, 100, 200 });
+            });
+
+            Assert::AreEqual(static_cast<size_t>(2), visited.size());
+            CustomAssert::AreEqual(entries[0].Id, visited[0]);
+            CustomAssert::AreEqual(entries[2].Id, visited[1]);
+        }
+
+        TEST_METHOD(Find)
+        {
+            std::vector<ZoneSetStore::Entry> entries{
+                MakeEntry(L"1920_1080", 0xFFFF, 3),
+                MakeEntry(L"3840_2160", 0xFFFE, 2),
+            };
+            std::vector<BYTE> bytes = ZoneSetStore::Serialize(entries);
+            ZoneSetStore::Image image(bytes.data(), bytes.size());
+
+            auto record = image.Find(L"3840_2160", entries[1].Id);
+            Assert::IsNotNull(record);
+            Assert::AreEqual(2ul, record->ZoneCount);
+
+            Assert::IsNull(image.Find(L"1920_1080", entries[1].Id));
+
+            auto anyWorkArea = image.Find(entries[1].Id);
+            Assert::IsNotNull(anyWorkArea);
+            Assert::IsTrue(anyWorkArea == record);
+
+            GUID unknown;
+            CoCreateGuid(&unknown);
+            Assert::IsNull(image.Find(unknown));
+        }
+
+        TEST_METHOD(RejectsCorruptImages)
+        {
+            std::vector<BYTE> bytes = ZoneSetStore::Serialize({ MakeEntry(L"1920_1080", 0xFFFF, 3) });
+
+            Assert::IsFalse(ZoneSetStore::Image(nullptr, 0).IsValid());
+            Assert::IsFalse(ZoneSetStore::Image(bytes.data(), sizeof(ZoneSetStore::Header) - 1).IsValid());
+            Assert::IsFalse(ZoneSetStore::Image(bytes.data(), bytes.size() - 1).IsValid());
+
+            auto badMagic = bytes;
+            reinterpret_cast<ZoneSetStore::Header*>(badMagic.data())->Magic = 0;
+            Assert::IsFalse(ZoneSetStore::Image(badMagic.data(), badMagic.size()).IsValid());
+
+            auto badVersion = bytes;
+            reinterpret_cast<ZoneSetStore::Header*>(badVersion.data())->Version = ZoneSetStore::Version + 1;
+            Assert::IsFalse(ZoneSetStore::Image(badVersion.data(), badVersion.size()).IsValid());
+
+            auto badZones = bytes;
+            reinterpret_cast<ZoneSetStore::Record*>(badZones.data() + sizeof(ZoneSetStore::Header))->ZoneCount = 4;
+            Assert::IsFalse(ZoneSetStore::Image(badZones.data(), badZones.size()).IsValid());
+
+            auto unterminatedKey = bytes;
+            auto record = reinterpret_cast<ZoneSetStore::Record*>(unterminatedKey.data() + sizeof(ZoneSetStore::Header));
+            std::fill(std::begin(record->WorkAreaKey), std::end(record->WorkAreaKey), L'A');
+            Assert::IsFalse(ZoneSetStore::Image(unterminatedKey.data(), unterminatedKey.size()).IsValid());
+        }
+
+        TEST_METHOD(WriteAndMap)
+        {
+            wchar_t tempPath[MAX_PATH]{};
+            wchar_t path[MAX_PATH]{};
+            GetTempPathW(ARRAYSIZE(tempPath), tempPath);
+            GetTempFileNameW(tempPath, L"fz", 0, path);
+
+            std::vector<ZoneSetStore::Entry> entries{ MakeEntry(L"1920_1080", 0xFFFF, 3) };
+            Assert::IsTrue(ZoneSetStore::Write(path, entries));
+            {
+                ZoneSetStore::MappedView view(path);
+                Assert::IsTrue(view.Get().IsValid());
+                AssertEntriesEqual(entries[0], view.Get().ReadAll()[0]);
+            }
+
+            // Replacing the file must not leave the temporary file behind.
+            entries.push_back(MakeEntry(L"3840_2160", 0xFFFE, 50));
+            Assert::IsTrue(ZoneSetStore::Write(path, entries));
+            {
+                ZoneSetStore::MappedView view(path);
+                Assert::AreEqual(2ul, view.Get().RecordCount());
+            }
+            Assert::AreEqual(INVALID_FILE_ATTRIBUTES, GetFileAttributesW((std::wstring(path) + L".tmp").c_str()));
+
+            DeleteFileW(path);
+            Assert::IsFalse(ZoneSetStore::MappedView(path).Get().IsValid());
+        }
+
+        // Version 1 records lack the work area. Such stores are read with it unknown and written
+        // in the current version by the next save.
+        TEST_METHOD(UpgradesVersion1Store)
+        {
+            auto entry = MakeEntry(L"1920_1080", 0xFFFF, 3);
+            std::vector<BYTE> const current = ZoneSetStore::Serialize({ entry });
+            size_t const recordSize = sizeof(ZoneSetStore::Record) - sizeof(RECT);
+            std::vector<BYTE> version1(current.begin(), current.begin() + sizeof(ZoneSetStore::Header) + recordSize);
+            version1.insert(version1.end(), current.end() - entry.Zones.size() * sizeof(RECT), current.end());
+            reinterpret_cast<ZoneSetStore::Header*>(version1.data())->Version = 1;
+            Assert::IsFalse(ZoneSetStore::Image(version1.data(), version1.size()).IsValid());
+
+            std::wstring const path = TempStorePath();
+            {
+                wil::unique_hfile file{ CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr) };
+                DWORD written = 0;
+                Assert::IsTrue(!!WriteFile(file.get(), version1.data(), static_cast<DWORD>(version1.size()), &written, nullptr));
+            }
+
+            entry.WorkArea = {};
+            {
+                ZoneSetStore::MappedView view(path.c_str());
+                Assert::IsTrue(view.Get().IsValid());
+                AssertEntriesEqual(entry, view.Get().ReadAll()[0]);
+            }
+
+            auto other = MakeEntry(L"3840_2160", 0xFFFE, 4);
+            Assert::IsTrue(ZoneSetStore::SaveZoneSets(path.c_str(), { other }));
+            Assert::AreEqual(INVALID_FILE_ATTRIBUTES, GetFileAttributesW((path + L".bad").c_str()));
+            {
+                ZoneSetStore::MappedView view(path.c_str());
+                auto entries = view.Get().ReadAll();
+                Assert::AreEqual(size_t{ 2 }, entries.size());
+                AssertEntriesEqual(entry, entries[0]);
+                AssertEntriesEqual(other, entries[1]);
+            }
+
+            DeleteFileW(path.c_str());
+        }
+
+        TEST_METHOD(SaveZoneSetsReplacesAndDeletes)
+        {
+            std::wstring const path = TempStorePath();
+            auto kept = MakeEntry(L"1920_1080", 0xFFFF, 3);
+            auto replaced = MakeEntry(L"1920_1080", 0xFFFE, 4);
+            auto deleted = MakeEntry(L"3840_2160", 0xFFFD, 5);
+            Assert::IsTrue(ZoneSetStore::Write(path.c_str(), { kept, replaced, deleted }));
+
+            replaced.Zones.pop_back();
+            deleted.Zones.clear();
+            auto added = MakeEntry(L"3840_2160", 0xFFFC, 6);
+            Assert::IsTrue(ZoneSetStore::SaveZoneSets(path.c_str(), { replaced, deleted, added }));
+            {
+                ZoneSetStore::MappedView view(path.c_str());
+                Assert::AreEqual(3ul, view.Get().RecordCount());
+                Assert::IsNull(view.Get().Find(deleted.WorkAreaKey.c_str(), deleted.Id));
+                for (auto const& entry : { kept, replaced, added })
+                {
+                    auto record = view.Get().Find(entry.WorkAreaKey.c_str(), entry.Id);
+                    Assert::IsNotNull(record);
+                    Assert::AreEqual(static_cast<DWORD>(entry.Zones.size()), record->ZoneCount);
+                }
+            }
+
+            DeleteFileW(path.c_str());
+        }
+
+        // A store that can't be read must not be replaced by one holding only the saved zone
+        // sets, which would drop every other layout.
+        TEST_METHOD(SaveZoneSetsKeepsInvalidStoreAside)
+        {
+            std::wstring const path = TempStorePath();
+            std::wstring const badPath = path + L".bad";
+            {
+                wil::unique_hfile file{ CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr) };
+                char const garbage[] = "not a zone set store";
+                DWORD written = 0;
+                Assert::IsTrue(!!WriteFile(file.get(), garbage, sizeof(garbage), &written, nullptr));
+            }
+
+            auto entry = MakeEntry(L"1920_1080", 0xFFFF, 3);
+            Assert::IsTrue(ZoneSetStore::SaveZoneSets(path.c_str(), { entry }));
+            Assert::AreNotEqual(INVALID_FILE_ATTRIBUTES, GetFileAttributesW(badPath.c_str()));
+            {
+                ZoneSetStore::MappedView view(path.c_str());
+                Assert::IsTrue(view.Get().IsValid());
+                Assert::IsNotNull(view.Get().Find(entry.WorkAreaKey.c_str(), entry.Id));
+            }
+
+            DeleteFileW(path.c_str());
+            DeleteFileW(badPath.c_str());
+        }
+
+        TEST_METHOD(PendingWritesKeepLatestUntilSaved)
+        {
+            // The store's folder doesn't exist yet, so the first flush fails.
+            std::wstring const folder = TempStorePath();
+            DeleteFileW(folder.c_str());
+            std::wstring const path = folder + L"\\zones.bin";
+            ZoneSetStore::PendingWrites writes(path);
+
+            auto first = MakeEntry(L"1920_1080", 0xFFFF, 3);
+            auto other = MakeEntry(L"3840_2160", 0xFFFE, 4);
+            writes.Add({ first, other });
+            Assert::IsFalse(writes.Flush());
+            Assert::IsTrue(writes.HasPending());
+
+            // A change made while the store was unavailable replaces the one that failed.
+            auto latest = first;
+            latest.Zones.pop_back();
+            writes.Add({ latest });
+
+            Assert::IsTrue(!!CreateDirectoryW(folder.c_str(), nullptr));
+            Assert::IsTrue(writes.Flush());
+            Assert::IsFalse(writes.HasPending());
+            {
+                ZoneSetStore::MappedView view(path.c_str());
+                Assert::AreEqual(2ul, view.Get().RecordCount());
+                Assert::AreEqual(2ul, view.Get().Find(latest.WorkAreaKey.c_str(), latest.Id)->ZoneCount);
+                Assert::IsNotNull(view.Get().Find(other.WorkAreaKey.c_str(), other.Id));
+            }
+
+            DeleteFileW(path.c_str());
+            RemoveDirectoryW(folder.c_str());
+        }
+    };
+}
@@ -0,0 +1,321 @@
+#include "pch.h"
+#include "lib\ZoneSpace.h"
+
+#include <chrono>
+#include <cmath>
+#include <random>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace FancyZonesUnitTests
+{
+    TEST_CLASS(ZoneSpaceUnitTests)
+    {
+        static HMONITOR Monitor(uintptr_t id)
+        {
+            return reinterpret_cast<HMONITOR>(id);
+        }
+
+        // A columns x rows grid filling rect, in reading order.
+        static std::vector<RECT> Grid(RECT const& rect, int columns, int rows)
+        {
+            std::vector<RECT> zones;
+            const LONG width = rect.right - rect.left;
+            const LONG height = rect.bottom - rect.top;
+            for (int row = 0; row < rows; row++)
+            {
+                for (int column = 0; column < columns; column++)
+                {
+                    zones.push_back({ rect.left + width * column / columns, rect.top + height * row / rows,
+                                      rect.left + width * (column + 1) / columns, rect.top + height * (row + 1) / rows });
+                }
+            }
+            return zones;
+        }
+
+        // What the zone windows do today: find the monitor, then scan its zones.
+        struct MonitorLayout
+        {
+            HMONITOR Monitor{};
+            RECT Bounds{};
+            std::vector<RECT> Zones;
+        };
+
+        static std::optional<ZoneSpace::Hit> ScanZones(std::vector<MonitorLayout> const& layouts, POINT pt)
+        {
+            for (auto const& layout : layouts)
+            {
+                if (!PtInRect(&layout.Bounds, pt))
+                {
+                    continue;
+                }
+
+                std::optional<ZoneSpace::Hit> best;
+                LONGLONG bestArea{};
+                for (int i = static_cast<int>(layout.Zones.size()) - 1; i >= 0; i--)
+                {
+                    RECT const& zone = layout.Zones[i];
+                    LONGLONG const area = static_cast<LONGLONG>(zone.right - zone.left) * (zone.bottom - zone.top);
+                    if (PtInRect(&zone, pt) && (!best || (area < bestArea)))
+                    {
+                        best = ZoneSpace::Hit{ layout.Monitor, i };
+                        bestArea = area;
+                    }
+                }
+                return best;
+            }
+            return std::nullopt;
+        }
+
+        // Four 2560x1440 monitors in a 2x2 block around the primary one, 3x2 grids with spacing.
+        static std::vector<MonitorLayout> FourMonitors()
+        {
+            std::vector<MonitorLayout> layouts;
+            POINT const origins[] = { { 0, 0 }, { -2560, 0 }, { 0, -1440 }, { -2560, -1440 } };
+            for (uintptr_t i = 0; i < 4; i++)
+            {
+                MonitorLayout layout;
+                layout.Monitor = Monitor(i + 1);
+                layout.Bounds = { origins[i].x, origins[i].y, origins[i].x + 2560, origins[i].y + 1440 };
+                for (RECT zone : Grid(layout.Bounds, 3, 2))
+                {
+                    InflateRect(&zone, -8, -8);
+                    layout.Zones.push_back(zone);
+                }
+                layouts.push_back(std::move(layout));
+            }
+            return layouts;
+        }
+
+        static void AreEqual(std::optional<ZoneSpace::Hit> const& expected, std::optional<ZoneSpace::Hit> const& actual)
+        {
+            Assert::AreEqual(expected.has_value(), actual.has_value());
+            if (expected)
+            {
+                Assert::IsTrue(expected->Monitor == actual->Monitor);
+                Assert::AreEqual(expected->ZoneIndex, actual->ZoneIndex);
+            }
+        }
+
+        TEST_METHOD(Empty)
+        {
+            ZoneSpace space;
+            Assert::IsFalse(space.ZoneFromPoint({ 10, 10 }).has_value());
+            Assert::AreEqual<size_t>(0, space.Size());
+        }
+
+        TEST_METHOD(HitsZoneOfEachMonitor)
+        {
+            ZoneSpace space;
+            space.SetZones(Monitor(1), Grid({ 0, 0, 1920, 1080 }, 2, 1));
+            space.SetZones(Monitor(2), Grid({ 1920, 0, 3840, 1080 }, 3, 1));
+
+            AreEqual(ZoneSpace::Hit{ Monitor(1), 0 }, space.ZoneFromPoint({ 100, 100 }));
+            AreEqual(ZoneSpace::Hit{ Monitor(1), 1 }, space.ZoneFromPoint({ 1919, 1079 }));
+            AreEqual(ZoneSpace::Hit{ Monitor(2), 0 }, space.ZoneFromPoint({ 1920, 0 }));
+            AreEqual(ZoneSpace::Hit{ Monitor(2), 2 }, space.ZoneFromPoint({ 3839, 500 }));
+            Assert::IsFalse(space.ZoneFromPoint({ 3840, 500 }).has_value());
+            Assert::IsFalse(space.ZoneFromPoint({ 100, 1080 }).has_value());
+            Assert::AreEqual<size_t>(5, space.Size());
+        }
+
+        TEST_METHOD(MissesSpacingBetweenZones)
+        {
+            ZoneSpace space;
+            space.SetZones(Monitor(1), { { 16, 16, 952, 1064 }, { 968, 16, 1904, 1064 } });
+
+            Assert::IsFalse(space.ZoneFromPoint({ 960, 500 }).has_value());
+            Assert::IsFalse(space.ZoneFromPoint({ 8, 8 }).has_value());
+            AreEqual(ZoneSpace::Hit{ Monitor(1), 1 }, space.ZoneFromPoint({ 968, 500 }));
+        }
+
+        TEST_METHOD(SmallestZoneWins)
+        {
+            ZoneSpace space;
+            space.SetZones(Monitor(1), { { 0, 0, 1000, 1000 }, { 400, 400, 600, 600 }, { 0, 0, 1000, 1000 } });
+
+            AreEqual(ZoneSpace::Hit{ Monitor(1), 1 }, space.ZoneFromPoint({ 500, 500 }));
+            // Same size; the later one is on top.
+            AreEqual(ZoneSpace::Hit{ Monitor(1), 2 }, space.ZoneFromPoint({ 100, 100 }));
+        }
+
+        TEST_METHOD(NegativeCoordinates)
+        {
+            ZoneSpace space;
+            space.SetZones(Monitor(1), Grid({ -1920, -1080, 0, 0 }, 2, 2));
+
+            AreEqual(ZoneSpace::Hit{ Monitor(1), 0 }, space.ZoneFromPoint({ -1920, -1080 }));
+            AreEqual(ZoneSpace::Hit{ Monitor(1), 3 }, space.ZoneFromPoint({ -1, -1 }));
+            AreEqual(ZoneSpace::Hit{ Monitor(1), 1 }, space.ZoneFromPoint({ -ZoneSpace::CellSize, -ZoneSpace::CellSize - 541 }));
+            AreEqual(ZoneSpace::Hit{ Monitor(1), 2 }, space.ZoneFromPoint({ -ZoneSpace::CellSize - 961, -ZoneSpace::CellSize }));
+            Assert::IsFalse(space.ZoneFromPoint({ 0, -1 }).has_value());
+            Assert::IsFalse(space.ZoneFromPoint({ -1, 0 }).has_value());
+        }
+
+        TEST_METHOD(ZoneSpanningMonitors)
+        {
+            ZoneSpace space;
+            space.SetZones(Monitor(1), { { 960, 0, 2880, 1080 } });
+
+            AreEqual(ZoneSpace::Hit{ Monitor(1), 0 }, space.ZoneFromPoint({ 1000, 500 }));
+            AreEqual(ZoneSpace::Hit{ Monitor(1), 0 }, space.ZoneFromPoint({ 2800, 500 }));
+        }
+
+        TEST_METHOD(EmptyZonesKeepIndices)
+        {
+            ZoneSpace space;
+            space.SetZones(Monitor(1), { { 0, 0, 0, 0 }, { 0, 0, 100, 100 } });
+
+            AreEqual(ZoneSpace::Hit{ Monitor(1), 1 }, space.ZoneFromPoint({ 50, 50 }));
+            Assert::AreEqual<size_t>(1, space.Size());
+        }
+
+        TEST_METHOD(SetZonesReplacesOnlyThatMonitor)
+        {
+            ZoneSpace space;
+            space.SetZones(Monitor(1), Grid({ 0, 0, 1920, 1080 }, 2, 1));
+            space.SetZones(Monitor(2), Grid({ 1920, 0, 3840, 1080 }, 2, 1));
+            const size_t cells = space.CellCount();
+
+            space.SetZones(Monitor(1), Grid({ 0, 0, 1920, 1080 }, 1, 3));
+            AreEqual(ZoneSpace::Hit{ Monitor(1), 2 }, space.ZoneFromPoint({ 1500, 1000 }));
+            AreEqual(ZoneSpace::Hit{ Monitor(2), 1 }, space.ZoneFromPoint({ 3000, 1000 }));
+            Assert::AreEqual<size_t>(5, space.Size());
+            Assert::AreEqual(cells, space.CellCount());
+        }
+
+        TEST_METHOD(RemoveReleasesCells)
+        {
+            ZoneSpace space;
+            space.SetZones(Monitor(1), Grid({ 0, 0, 1920, 1080 }, 2, 1));
+            space.SetZones(Monitor(2), Grid({ 1920, 0, 3840, 1080 }, 2, 1));
+
+            space.Remove(Monitor(1));
+            Assert::IsFalse(space.ZoneFromPoint({ 100, 100 }).has_value());
+            AreEqual(ZoneSpace::Hit{ Monitor(2), 0 }, space.ZoneFromPoint({ 2000, 100 }));
+
+            space.Remove(Monitor(2));
+            space.Remove(Monitor(3));
+            Assert::AreEqual<size_t>(0, space.Size());
+            Assert::AreEqual<size_t>(0, space.CellCount());
+
+            // Freed slots are reused.
+            space.SetZones(Monitor(1), Grid({ 0, 0, 1920, 1080 }, 2, 2));
+            Assert::AreEqual<size_t>(4, space.Size());
+            AreEqual(ZoneSpace::Hit{ Monitor(1), 3 }, space.ZoneFromPoint({ 1900, 1000 }));
+        }
+
+        TEST_METHOD(MatchesScanningEachMonitor)
+        {
+            std::mt19937 random(7);
+            for (int round = 0; round < 20; round++)
+            {
+                std::vector<MonitorLayout> layouts;
+                ZoneSpace space;
+                LONG left = -3000;
+                for (uintptr_t i = 1; i <= 3; i++)
+                {
+                    MonitorLayout layout;
+                    layout.Monitor = Monitor(i);
+                    LONG const width = 800 + static_cast<LONG>(random() % 2000);
+                    LONG const top = static_cast<LONG>(random() % 400) - 200;
+                    layout.Bounds = { left, top, left + width, top + 600 + static_cast<LONG>(random() % 1000) };
+                    left += width;
+
+                    // Overlapping zones of random sizes, like a custom canvas layout.
+                    for (int zone = 0; zone < 8; zone++)
+                    {
+                        LONG const x = layout.Bounds.left + static_cast<LONG>(random() % (layout.Bounds.right - layout.Bounds.left));
+                        LONG const y = layout.Bounds.top + static_cast<LONG>(random() % (layout.Bounds.bottom - layout.Bounds.top));
+                        layout.Zones.push_back({ x, y, (std::min)(x + 1 + static_cast<LONG>(random() % 900), layout.Bounds.right),
+                                                 (std::min)(y + 1 + static_cast<LONG>(random() % 900), layout.Bounds.bottom) });
+                    }
+                    space.SetZones(layout.Monitor, layout.Zones);
+                    layouts.push_back(std::move(layout));
+                }
+
+                for (int i = 0; i < 2000; i++)
+                {
+                    POINT const pt{ -3000 + static_cast<LONG>(random() % 9000), -300 + static_cast<LONG>(random() % 2000) };
+                    AreEqual(ScanZones(layouts, pt), space.ZoneFromPoint(pt));
+                }
+            }
+        }
+
+        TEST_METHOD(FourMonitorDragBenchmark)
+        {
+            auto layouts = FourMonitors();
+            ZoneSpace space;
+            for (auto const& layout : layouts)
+            {
+                space.SetZones(layout.Monitor, layout.Zones);
+            }
+
+            // A drag circling through all four monitors, crossing every bezel many times.
+            std::vector<POINT> path;
+            constexpr int steps = 200000;
+            for (int i = 0; i < steps; i++)
+            {
+                double const angle = i * 0.001;
+                double const radius = 200 + (i % 1000) * 1.2;
+                path.push_back({ static_cast<LONG>(radius * std::cos(angle)), static_cast<LONG>(radius * std::sin(angle)) });
+            }
+
+            auto time = [](auto&& body) {
+                auto const start = std::chrono::steady_clock::now();
+                body();
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            };
+
+            size_t spaceHits = 0;
+            size_t scanHits = 0;
+            size_t transitions = 0;
+            HMONITOR current{};
+            auto const spaceTime = time([&] {
+                for (auto const& pt : path)
+                {
+                    if (auto hit = space.ZoneFromPoint(pt))
+                    {
+                        spaceHits++;
+                        transitions += (current && (hit->Monitor != current)) ? 1 : 0;
+                        current = hit->Monitor;
+                    }
+                }
+            });
+            auto const scanTime = time([&] {
+                for (auto const& pt : path)
+                {
+                    scanHits += ScanZones(layouts, pt) ? 1 : 0;
+                }
+            });
+            Assert::AreEqual(scanHits, spaceHits);
+
+            // A layout change on one monitor against rebuilding the whole space.
+            constexpr int changes = 2000;
+            auto const incrementalTime = time([&] {
+                for (int i = 0; i < changes; i++)
+                {
+                    space.SetZones(layouts[i % 4].Monitor, layouts[i % 4].Zones);
+                }
+            });
+            auto const rebuildTime = time([&] {
+                for (int i = 0; i < changes; i++)
+                {
+                    space.Clear();
+                    for (auto const& layout : layouts)
+                    {
+                        space.SetZones(layout.Monitor, layout.Zones);
+                    }
+                }
+            });
+            Assert::AreEqual<size_t>(24, space.Size());
+
+            std::wstring const message = std::to_wstring(spaceTime / steps) + L" ns per hit test in the zone space, " +
+                                         std::to_wstring(scanTime / steps) + L" ns scanning monitors, " +
+                                         std::to_wstring(transitions) + L" monitor transitions; " +
+                                         std::to_wstring(incrementalTime / changes) + L" ns per monitor layout change, " +
+                                         std::to_wstring(rebuildTime / changes) + L" ns per full rebuild";
+            Logger::WriteMessage(message.c_str());
+        }
+    };
+}
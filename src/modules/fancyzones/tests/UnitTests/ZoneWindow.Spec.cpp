@@ -2,6 +2,7 @@
 
 #include <lib/util.h>
 #include <lib/ZoneSet.h>
+#include <lib/ZoneSetStore.h>
 #include <lib/ZoneWindow.h>
 #include "Util.h"
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
@@ -27,8 +28,21 @@ namespace FancyZonesUnitTests
         {
             return 100;
         }
+        IFACEMETHODIMP_(void)
+        SetAppLastZone(HWND window, PCWSTR processPath, int zoneIndex) noexcept {};
+        IFACEMETHODIMP_(AnimationScheduler*)
+        Animations() noexcept
+        {
+            return nullptr;
+        }
+        IFACEMETHODIMP_(void)
+        PersistZoneSets(std::vector<ZoneSetStore::Entry> const& entries) noexcept
+        {
+            m_persisted.insert(m_persisted.end(), entries.begin(), entries.end());
+        }
 
         GUID m_guid;
+        std::vector<ZoneSetStore::Entry> m_persisted;
     };
 
     TEST_CLASS(ZoneWindowUnitTests){
@@ -37,9 +37,70 @@
 
 namespace {
   const wchar_t* ll_keyboard = L"ll_keyboard";
+  const wchar_t* ll_keyboard_hotkey = L"ll_keyboard_hotkey";
 }
 
 struct LowlevelKeyboardEvent {
   KBDLLHOOKSTRUCT* lParam;
   WPARAM wParam;
 };
+
+/*
+  The keyboard hook runs for every keystroke in the system, and Windows removes it if it
+  doesn't return in time. PowerToys that only handle a few keys should fill a filter in
+  the zeroed filter passed to get_keyboard_filter(), so the runner only signals them for
+  those keys:
+    - keys: bit (vkCode % 64) of keys[vkCode / 64] is set for every key of interest,
+    - modifiers: LowlevelKeyboardModifier flags of which at least one must be held down,
+      0 to be signaled regardless of the modifiers,
+    - key_up: whether to also be signaled for WM_KEYUP and WM_SYSKEYUP.
+
+  The modifier keys themselves are only signaled if they are in keys, too. The filter is
+  read once when the PowerToy subscribes and the PowerToy still has to check the event,
+  a PowerToy signaled for a key can't tell which other PowerToys were signaled too.
+
+  Example filter for Win+Ctrl+L:
+
+  virtual bool get_keyboard_filter(LowlevelKeyboardFilter* filter) override {
+    filter->keys[0x4C / 64] |= 1ull << (0x4C % 64);
+    filter->modifiers = LL_KEYBOARD_MODIFIER_WIN;
+    return true;
+  }
+*/
+
+enum LowlevelKeyboardModifier : unsigned {
+  LL_KEYBOARD_MODIFIER_WIN = 1,
+  LL_KEYBOARD_MODIFIER_CTRL = 2,
+  LL_KEYBOARD_MODIFIER_SHIFT = 4,
+  LL_KEYBOARD_MODIFIER_ALT = 8,
+};
+
+struct LowlevelKeyboardFilter {
+  unsigned long long keys[4];
+  unsigned modifiers;
+  bool key_up;
+};
+
+/*
+  ll_keyboard_hotkey - Hotkeys handled off the keyboard hook
+
+  PowerToys that only act on a few hotkeys should subscribe to ll_keyboard_hotkey instead
+  of ll_keyboard and list the hotkeys in get_hotkeys(). A hotkey is a vkCode pressed with
+  exactly the given LowlevelKeyboardModifier flags held, and whether the key press is
+  swallowed is decided from the hotkey table alone, on the hook thread. The PowerToy is
+  then signaled on a runner worker thread, after the key press was swallowed or passed on,
+  so the work it does can't hold up input system-wide.
+
+  The intptr_t data event argument is a pointer to a LowlevelKeyboardHotkey with the key
+  and modifiers that were pressed, and whether any PowerToy swallowed the key press. The
+  return value is ignored.
+
+  The runner asks for the hotkeys again after calling enable(), disable() or set_config()
+  and stops signaling a PowerToy once it's disabled, so the list can follow the settings.
+*/
+
+struct LowlevelKeyboardHotkey {
+  unsigned vk;
+  unsigned modifiers;
+  bool swallow;
+};
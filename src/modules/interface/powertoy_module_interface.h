@@ -23,12 +23,19 @@
     - call_custom_action() when the user selects clicks a custom action in settings,
     - signal_event() to send an event the PowerToy registered to.
 
+  When subscribing to ll_keyboard, the runner also calls get_keyboard_filter() once, to
+  find out which keys the PowerToy wants to be signaled for. Likewise for win_hook_event
+  and get_win_hook_event_ranges().
+
   When terminating, the runner will:
     - call destroy() which should free all the memory and delete the PowerToy object,
     - unload the DLL.
  */
 
 class PowertoySystemMenuIface;
+struct LowlevelKeyboardFilter;
+struct LowlevelKeyboardHotkey;
+struct WinHookEventRange;
 
 class PowertoyModuleIface {
 public:
@@ -37,6 +44,7 @@ public:
   /* Returns a null-terminated table of the names of the events the PowerToy wants to 
      subscribe to. Available events:
        * ll_keyboard
+       * ll_keyboard_hotkey
        * win_hook_event
 
      A nullptr can be returned to signal that the PowerToy does not want to subscribe
@@ -62,9 +70,24 @@ public:
   /* Handle event. Only the events the PowerToy subscribed to will be signaled.
      The data argument and return value meaning are event-specific:
        * ll_keyboard: see lowlevel_keyboard_event_data.h.
+       * ll_keyboard_hotkey: see lowlevel_keyboard_event_data.h.
        * win_hook_event: see win_hook_event_data.h
   */
   virtual intptr_t signal_event(const wchar_t* name, intptr_t data) = 0;
+  /* Narrows down the ll_keyboard events the PowerToy is signaled for, see
+     lowlevel_keyboard_event_data.h. Return false to get every keyboard event.
+  */
+  virtual bool get_keyboard_filter(LowlevelKeyboardFilter* filter) { return false; }
+  /* Fills hotkeys with the ll_keyboard_hotkey hotkeys of the PowerToy, see
+     lowlevel_keyboard_event_data.h. Returns the number of hotkeys, and only fills the
+     buffer if buffer_size is large enough to hold them all.
+  */
+  virtual size_t get_hotkeys(LowlevelKeyboardHotkey* hotkeys, size_t buffer_size) { return 0; }
+  /* Fills ranges with the win_hook_event events the PowerToy wants, see
+     win_hook_event_data.h. Returns the number of ranges, and only fills the buffer
+     if buffer_size is large enough to hold them all. Return 0 to get every event.
+  */
+  virtual size_t get_win_hook_event_ranges(WinHookEventRange* ranges, size_t buffer_size) { return 0; }
 
   /* Register helper class to handle system menu items related actions. */
   virtual void register_system_menu_helper(PowertoySystemMenuIface* helper) = 0;
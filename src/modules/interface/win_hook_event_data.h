@@ -34,12 +34,32 @@
   Taking to long to process the events has negative impact on the whole system
   performance. To address this, the events are signaled from a different
   thread, not from the event hook callback itself.
+
+  By default a PowerToy is signaled for every event in the system. PowerToys that only
+  handle a few events should list them in get_win_hook_event_ranges(), so the runner
+  only hooks those and signals the PowerToy for nothing else. Each WinHookEventRange
+  covers the events from event_min to event_max, either for any object or for the
+  object_id alone, e.g. OBJID_WINDOW to leave out carets and cursors:
+
+  virtual size_t get_win_hook_event_ranges(WinHookEventRange* ranges, size_t buffer_size) override {
+    if (buffer_size >= 1) {
+      ranges[0] = { EVENT_SYSTEM_MOVESIZESTART, EVENT_SYSTEM_MOVESIZEEND, true, 0 };
+    }
+    return 1;
+  }
 */
 
 namespace {
   const wchar_t* win_hook_event = L"win_hook_event";
 }
 
+struct WinHookEventRange {
+  DWORD event_min;
+  DWORD event_max;
+  bool any_object;
+  LONG object_id;
+};
+
 struct WinHookEvent {
   DWORD event;
   HWND hwnd;
@@ -5,6 +5,8 @@
 #include <common/common.h>
 #include <common/settings_helpers.h>
 #include "powertoy_module.h"
+#include "startup_timeline.h"
+#include "tray_icon.h"
 #include <common/windows_colors.h>
 #include <common/winstore.h>
 
@@ -147,16 +149,12 @@ void apply_general_settings(const json::JsonObject& general_configs)
     PTSettingsHelper::save_general_settings(save_settings);
 }
 
-void start_initial_powertoys()
+std::optional<std::unordered_set<std::wstring>> initially_enabled_powertoys()
 {
-    bool only_enable_some_powertoys = false;
-
     std::unordered_set<std::wstring> powertoys_to_enable;
-
-    json::JsonObject general_settings;
     try
     {
-        general_settings = load_general_settings();
+        json::JsonObject general_settings = load_general_settings();
         json::JsonObject enabled = general_settings.GetNamedObject(L"enabled");
         for (const auto& enabled_element : enabled)
         {
@@ -166,28 +164,62 @@ void start_initial_powertoys()
                 powertoys_to_enable.emplace(enabled_element.Key());
             }
         }
-        only_enable_some_powertoys = true;
     }
     catch (...)
     {
         // Couldn't read the general settings correctly.
         // Load all powertoys.
         // TODO: notify user about invalid json config
-        only_enable_some_powertoys = false;
+        return std::nullopt;
     }
+    return powertoys_to_enable;
+}
 
-    for (auto& [name, powertoy] : modules())
+namespace
+{
+    // The modules still to enable at startup. The modules don't depend on each other, so they are
+    // enabled in any order, one per message so the message loop keeps running in between.
+    std::vector<std::wstring> powertoys_to_start;
+    size_t started_powertoys = 0;
+    startup_timeline::clock::time_point enabling_started;
+
+    void start_next_powertoy(PVOID)
     {
-        if (only_enable_some_powertoys)
+        // Without the tray icon window to post to, the rest are enabled right away.
+        do
         {
-            if (powertoys_to_enable.find(name) != powertoys_to_enable.end())
+            if (started_powertoys == powertoys_to_start.size())
             {
-                powertoy.enable();
+                startup_timeline::record(L"Enable", enabling_started, startup_timeline::clock::now());
+                startup_timeline::write();
+                return;
             }
-        }
-        else
+            const auto& name = powertoys_to_start[started_powertoys++];
+            if (modules().find(name) != modules().end())
+            {
+                startup_timeline::Phase phase(L"Enable " + name);
+                modules().at(name).enable();
+            }
+        } while (!dispatch_run_on_main_ui_thread(start_next_powertoy, nullptr));
+    }
+}
+
+void start_initial_powertoys()
+{
+    const auto powertoys_to_enable = initially_enabled_powertoys();
+    powertoys_to_start.clear();
+    started_powertoys = 0;
+    for (auto& [name, powertoy] : modules())
+    {
+        if (!powertoys_to_enable || powertoys_to_enable->find(name) != powertoys_to_enable->end())
         {
-            powertoy.enable();
+            powertoys_to_start.push_back(name);
         }
     }
+
+    enabling_started = startup_timeline::clock::now();
+    if (!dispatch_run_on_main_ui_thread(start_next_powertoy, nullptr))
+    {
+        start_next_powertoy(nullptr);
+    }
 }
@@ -1,8 +1,15 @@
 #pragma once
 
 #include <common/json.h>
+#include <optional>
+#include <string>
+#include <unordered_set>
 
 json::JsonObject load_general_settings();
 json::JsonObject get_general_settings();
 void apply_general_settings(const json::JsonObject& general_configs);
+// The names of the modules enabled in the general settings, nothing if they can't be read and
+// every module starts enabled.
+std::optional<std::unordered_set<std::wstring>> initially_enabled_powertoys();
+// Enables the modules that start enabled from the message loop, one at a time.
 void start_initial_powertoys();
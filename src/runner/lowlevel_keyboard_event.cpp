@@ -1,25 +1,115 @@
 #include "pch.h"
 #include "lowlevel_keyboard_event.h"
 #include "powertoys_events.h"
+#include "trace.h"
+#include <common/spsc_ring.h>
+#include <common/dispatch_sequence.h>
 
 namespace
 {
     HHOOK hook_handle = nullptr;
     HHOOK hook_handle_copy = nullptr; // make sure we do use nullptr in CallNextHookEx call
+    int hook_users = 0; // ll_keyboard and ll_keyboard_hotkey both need the hook
+    DWORD hook_thread = 0; // The hook runs on the thread that installed it
+    DispatchSequence hook_dispatches;
+
+    // Keystrokes are held back from every application while the hook runs, and Windows removes
+    // hooks that don't return in time. Invocations that take longer than this are counted.
+    constexpr auto hook_latency_budget = std::chrono::milliseconds(1);
+    std::atomic<uint64_t> hook_invocations = 0;
+    std::atomic<uint64_t> hook_over_budget = 0;
+    std::atomic<std::chrono::microseconds::rep> hook_slowest = 0;
+
+    struct HotkeyAction
+    {
+        PowertoyModuleIface* module;
+        LowlevelKeyboardHotkey hotkey;
+    };
+
+    // Filled by the hook, drained by the hotkey worker.
+    SpscRing<HotkeyAction, 64> hotkey_actions;
+    std::atomic<uint64_t> queued_actions = 0;
+    std::atomic<uint64_t> completed_actions = 0;
+    std::atomic<uint64_t> dropped_actions = 0;
+    // Created the first time the hook starts and kept for the lifetime of the process.
+    HANDLE actions_queued = nullptr;
+    HANDLE action_completed = nullptr;
+    std::atomic_bool worker_running = false;
+    std::thread worker;
+
+    void record_hook_latency(std::chrono::steady_clock::duration elapsed)
+    {
+        const auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+        hook_invocations.fetch_add(1, std::memory_order_relaxed);
+        if (elapsed > hook_latency_budget)
+        {
+            hook_over_budget.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (microseconds > hook_slowest.load(std::memory_order_relaxed))
+        {
+            hook_slowest.store(microseconds, std::memory_order_relaxed);
+        }
+    }
+
     LRESULT CALLBACK hook_proc(int nCode, WPARAM wParam, LPARAM lParam)
     {
         LowlevelKeyboardEvent event;
         if (nCode == HC_ACTION)
         {
+            const auto start = std::chrono::steady_clock::now();
             event.lParam = reinterpret_cast<KBDLLHOOKSTRUCT*>(lParam);
             event.wParam = wParam;
-            if (powertoys_events().signal_event(ll_keyboard, reinterpret_cast<intptr_t>(&event)) != 0)
+            bool swallow;
+            {
+                DispatchSequence::Scope dispatching(hook_dispatches);
+                swallow = powertoys_events().signal_keyboard_event(event) != 0;
+            }
+            record_hook_latency(std::chrono::steady_clock::now() - start);
+            if (swallow)
             {
                 return 1;
             }
         }
         return CallNextHookEx(hook_handle_copy, nCode, wParam, lParam);
     }
+
+    void hotkey_worker_proc()
+    {
+        HotkeyAction action;
+        for (;;)
+        {
+            WaitForSingleObject(actions_queued, INFINITE);
+            while (hotkey_actions.try_pop(action))
+            {
+                action.module->signal_event(ll_keyboard_hotkey, reinterpret_cast<intptr_t>(&action.hotkey));
+                completed_actions.fetch_add(1);
+                SetEvent(action_completed);
+            }
+            if (!worker_running)
+            {
+                return;
+            }
+        }
+    }
+
+    void start_hotkey_worker()
+    {
+        if (!actions_queued)
+        {
+            actions_queued = CreateEvent(nullptr, false, false, nullptr);
+            action_completed = CreateEvent(nullptr, false, false, nullptr);
+        }
+        worker_running = true;
+        worker = std::thread(hotkey_worker_proc);
+    }
+
+    void stop_hotkey_worker()
+    {
+        // The hook is gone, so the worker only has to drain what was queued before.
+        worker_running = false;
+        SetEvent(actions_queued);
+        worker.join();
+    }
 }
 
 // Prevent system-wide input lagging while paused in the debugger
@@ -27,6 +117,11 @@ namespace
 
 void start_lowlevel_keyboard_hook()
 {
+    if (hook_users++)
+    {
+        return;
+    }
+
 #if defined(_DEBUG) && defined(DISABLE_LOWLEVEL_KBHOOK_WHEN_DEBUGGED)
     if (IsDebuggerPresent())
     {
@@ -36,10 +131,14 @@ void start_lowlevel_keyboard_hook()
 
     if (!hook_handle)
     {
+        start_hotkey_worker();
+        hook_thread = GetCurrentThreadId();
         hook_handle = SetWindowsHookEx(WH_KEYBOARD_LL, hook_proc, GetModuleHandle(NULL), NULL);
         hook_handle_copy = hook_handle;
         if (!hook_handle)
         {
+            stop_hotkey_worker();
+            hook_users--;
             throw std::runtime_error("Cannot install keyboard listener");
         }
     }
@@ -47,9 +146,65 @@ void start_lowlevel_keyboard_hook()
 
 void stop_lowlevel_keyboard_hook()
 {
+    if (--hook_users)
+    {
+        return;
+    }
+
     if (hook_handle)
     {
         UnhookWindowsHookEx(hook_handle);
         hook_handle = nullptr;
+        stop_hotkey_worker();
+
+        const auto stats = keyboard_hook_stats();
+        Trace::EventKeyboardHookStats(stats.invocations, stats.over_budget, stats.slowest.count(), stats.dropped_hotkey_actions);
+        hook_invocations = 0;
+        hook_over_budget = 0;
+        hook_slowest = 0;
+        dropped_actions = 0;
     }
 }
+
+void queue_hotkey_action(PowertoyModuleIface* module, const LowlevelKeyboardHotkey& hotkey)
+{
+    if (hotkey_actions.try_push({ module, hotkey }))
+    {
+        queued_actions.fetch_add(1);
+        SetEvent(actions_queued);
+    }
+    else
+    {
+        dropped_actions.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void wait_for_keyboard_dispatch()
+{
+    // On the hook thread the hook can only be dispatching if this is called from a receiver,
+    // and then the wait would never end.
+    if (GetCurrentThreadId() != hook_thread)
+    {
+        wait_for_dispatch(hook_dispatches);
+    }
+}
+
+void flush_hotkey_actions()
+{
+    const auto queued = queued_actions.load();
+    while (completed_actions.load() < queued)
+    {
+        // Actions may send messages to windows of this thread, so keep handling those while waiting.
+        MSG msg;
+        PeekMessage(&msg, nullptr, 0, 0, PM_NOREMOVE | PM_QS_SENDMESSAGE);
+        MsgWaitForMultipleObjects(1, &action_completed, false, INFINITE, QS_SENDMESSAGE);
+    }
+}
+
+KeyboardHookStats keyboard_hook_stats()
+{
+    return { hook_invocations.load(std::memory_order_relaxed),
+             hook_over_budget.load(std::memory_order_relaxed),
+             std::chrono::microseconds(hook_slowest.load(std::memory_order_relaxed)),
+             dropped_actions.load(std::memory_order_relaxed) };
+}
\ No newline at end of file
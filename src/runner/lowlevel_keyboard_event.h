@@ -1,5 +1,25 @@
-#pragma once
-#include <interface/lowlevel_keyboard_event_data.h>
-
-void start_lowlevel_keyboard_hook();
-void stop_lowlevel_keyboard_hook();
+#pragma once
+#include <interface/lowlevel_keyboard_event_data.h>
+#include <interface/powertoy_module_interface.h>
+
+void start_lowlevel_keyboard_hook();
+void stop_lowlevel_keyboard_hook();
+
+// Runs the ll_keyboard_hotkey action of the module on the hotkey worker thread.
+// Only called from the keyboard hook.
+void queue_hotkey_action(PowertoyModuleIface* module, const LowlevelKeyboardHotkey& hotkey);
+// Waits until the keyboard hook is done with the keystroke it may be dispatching, so receivers
+// removed from the keyboard tables before the call are no longer used by it.
+void wait_for_keyboard_dispatch();
+// Waits until every hotkey action queued so far has run.
+void flush_hotkey_actions();
+
+struct KeyboardHookStats
+{
+    uint64_t invocations;
+    uint64_t over_budget; // Invocations that held the keystroke back longer than the budget
+    std::chrono::microseconds slowest;
+    uint64_t dropped_hotkey_actions; // Hotkeys pressed while the worker was too far behind
+};
+
+KeyboardHookStats keyboard_hook_stats();
@@ -1,9 +1,10 @@
 #include "pch.h"
 #include <ShellScalingApi.h>
 #include <lmcons.h>
-#include <filesystem>
 #include "tray_icon.h"
 #include "powertoy_module.h"
+#include "module_loader.h"
+#include "startup_timeline.h"
 #include "lowlevel_keyboard_event.h"
 #include "trace.h"
 #include "general_settings.h"
@@ -33,6 +34,7 @@ void chdir_current_executable()
 
 int runner()
 {
+    startup_timeline::start();
     DPIAware::EnableDPIAwarenessForThisProcess();
 
 #if _DEBUG && _WIN64
@@ -42,7 +44,10 @@ int runner()
 #endif
     Trace::RegisterProvider();
     winrt::init_apartment();
-    start_tray_icon();
+    {
+        startup_timeline::Phase phase(L"Tray icon");
+        start_tray_icon();
+    }
     int result;
     try
     {
@@ -54,22 +59,8 @@ int runner()
             L"fancyzones.dll",
             L"PowerRenameExt.dll"
         };
-        for (auto& file : std::filesystem::directory_iterator(L"modules/"))
-        {
-            if (file.path().extension() != L".dll")
-                continue;
-            if (known_dlls.find(file.path().filename()) == known_dlls.end())
-                continue;
-            try
-            {
-                auto module = load_powertoy(file.path().wstring());
-                modules().emplace(module.get_name(), std::move(module));
-            }
-            catch (...)
-            {
-            }
-        }
-        // Start initial powertoys
+        load_powertoys(L"modules/", known_dlls);
+        // Start initial powertoys once the message loop runs
         start_initial_powertoys();
 
         Trace::EventLaunch(get_product_version());
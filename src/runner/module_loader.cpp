@@ -0,0 +1,138 @@
+#include "pch.h"
+#include "module_loader.h"
+#include "general_settings.h"
+#include "powertoy_module.h"
+#include "startup_timeline.h"
+
+#include <common/settings_helpers.h>
+#include <filesystem>
+#include <optional>
+
+namespace
+{
+    // The module names by DLL file name, as of when the modules were last loaded. The names are
+    // localized resource strings, so this is how a module can be found disabled without loading it.
+    std::wstring module_names_location()
+    {
+        return PTSettingsHelper::get_root_save_folder_location() + L"\\module_names.json";
+    }
+
+    struct DiscoveredModule
+    {
+        std::wstring path;
+        std::wstring file_name;
+        std::wstring name; // Empty if the module was never loaded
+        bool deferred = false;
+        std::optional<CreatedPowertoy> created;
+    };
+
+    std::vector<DiscoveredModule> discover(const std::wstring& modules_folder, const std::unordered_set<std::wstring>& known_dlls, const json::JsonObject& module_names)
+    {
+        const auto enabled = initially_enabled_powertoys();
+        std::vector<DiscoveredModule> discovered;
+        for (auto& file : std::filesystem::directory_iterator(modules_folder))
+        {
+            if (file.path().extension() != L".dll")
+                continue;
+            auto file_name = file.path().filename().wstring();
+            if (known_dlls.find(file_name) == known_dlls.end())
+                continue;
+            DiscoveredModule module{ file.path().wstring(), file_name };
+            if (json::has(module_names, file_name, json::JsonValueType::String))
+            {
+                module.name = module_names.GetNamedString(file_name).c_str();
+                module.deferred = enabled && enabled->find(module.name) == enabled->end();
+            }
+            discovered.push_back(std::move(module));
+        }
+        return discovered;
+    }
+
+    // Loading the DLLs and creating the powertoys doesn't touch any runner state, so every module
+    // gets its own thread for it.
+    void create_in_parallel(std::vector<DiscoveredModule>& discovered)
+    {
+        std::vector<std::thread> loaders;
+        for (auto& module : discovered)
+        {
+            if (module.deferred)
+                continue;
+            loaders.emplace_back([&module] {
+                winrt::init_apartment();
+                try
+                {
+                    startup_timeline::Phase loading(L"Load " + module.file_name);
+                    module.created = create_powertoy(module.path);
+                }
+                catch (...)
+                {
+                }
+                winrt::uninit_apartment();
+            });
+        }
+        for (auto& loader : loaders)
+        {
+            loader.join();
+        }
+    }
+}
+
+void load_powertoys(const std::wstring& modules_folder, const std::unordered_set<std::wstring>& known_dlls)
+{
+    json::JsonObject module_names;
+    std::vector<DiscoveredModule> discovered;
+    {
+        startup_timeline::Phase phase(L"Discovery");
+        try
+        {
+            module_names = json::from_file(module_names_location()).value_or(json::JsonObject{});
+        }
+        catch (...)
+        {
+        }
+        discovered = discover(modules_folder, known_dlls, module_names);
+    }
+
+    {
+        startup_timeline::Phase phase(L"Load");
+        create_in_parallel(discovered);
+    }
+
+    startup_timeline::Phase phase(L"Register");
+    bool names_changed = false;
+    for (auto& module : discovered)
+    {
+        if (module.deferred)
+        {
+            modules().emplace(module.name, PowertoyModule(module.name, module.path));
+            continue;
+        }
+        if (!module.created)
+        {
+            continue;
+        }
+        try
+        {
+            PowertoyModule powertoy(module.created->module, module.created->handle);
+            if (powertoy.get_name() != module.name)
+            {
+                module_names.SetNamedValue(module.file_name, json::value(powertoy.get_name()));
+                names_changed = true;
+            }
+            modules().emplace(powertoy.get_name(), std::move(powertoy));
+        }
+        catch (...)
+        {
+        }
+    }
+    if (names_changed)
+    {
+        try
+        {
+            json::to_file(module_names_location(), module_names);
+        }
+        catch (...)
+        {
+        }
+    }
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <string>
+#include <unordered_set>
+
+// Adds the known module DLLs found in modules_folder to modules(). The modules that start enabled
+// are loaded and created in parallel; the ones disabled in the general settings aren't loaded
+// until they are first used.
+void load_powertoys(const std::wstring& modules_folder, const std::unordered_set<std::wstring>& known_dlls);
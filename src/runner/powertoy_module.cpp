@@ -9,7 +9,7 @@ std::unordered_map<std::wstring, PowertoyModule>& modules()
     return modules;
 }
 
-PowertoyModule load_powertoy(const std::wstring& filename)
+CreatedPowertoy create_powertoy(const std::wstring& filename)
 {
     auto handle = winrt::check_pointer(LoadLibraryW(filename.c_str()));
     auto create = reinterpret_cast<powertoy_create_func>(GetProcAddress(handle, "powertoy_create"));
@@ -24,16 +24,68 @@ PowertoyModule load_powertoy(const std::wstring& filename)
         FreeLibrary(handle);
         winrt::throw_last_error();
     }
-    module->register_system_menu_helper(&SystemMenuHelperInstace());
+    return { handle, module };
+}
+
+PowertoyModule load_powertoy(const std::wstring& filename)
+{
+    auto [handle, module] = create_powertoy(filename);
     return PowertoyModule(module, handle);
 }
 
+bool PowertoyModule::load() const
+{
+    if (module)
+    {
+        return true;
+    }
+    try
+    {
+        auto [loaded_handle, loaded_module] = create_powertoy(dll_path);
+        handle.reset(loaded_handle);
+        module.reset(loaded_module);
+    }
+    catch (...)
+    {
+        return false;
+    }
+    register_module();
+    return true;
+}
+
+void PowertoyModule::register_module() const
+{
+    module->register_system_menu_helper(&SystemMenuHelperInstace());
+    auto want_signals = module->get_events();
+    if (want_signals)
+    {
+        for (; *want_signals; ++want_signals)
+        {
+            powertoys_events().register_receiver(*want_signals, module.get());
+        }
+    }
+    if (SystemMenuHelperInstace().HasCustomConfig(module.get()))
+    {
+        powertoys_events().register_system_menu_action(module.get());
+    }
+}
+
 json::JsonObject PowertoyModule::json_config() const
 {
+    if (!load())
+    {
+        throw std::runtime_error("Module not loaded");
+    }
+    if (cached_config && cached_revision == revision)
+    {
+        return *cached_config;
+    }
     int size = 0;
     module->get_config(nullptr, &size);
     std::wstring result;
     result.resize(size - 1);
     module->get_config(result.data(), &size);
-    return json::JsonObject::Parse(result);
+    cached_config = json::JsonObject::Parse(result);
+    cached_revision = revision;
+    return *cached_config;
 }
@@ -7,6 +7,7 @@
 #include <mutex>
 #include <vector>
 #include <functional>
+#include <optional>
 
 class PowertoyModule;
 #include <common/json.h>
@@ -33,6 +34,13 @@ struct PowertoyModuleDLLDeleter
     }
 };
 
+// A module DLL loaded and its powertoy created, but not yet registered with the runner.
+struct CreatedPowertoy
+{
+    HMODULE handle;
+    PowertoyModuleIface* module;
+};
+
 class PowertoyModule
 {
 public:
@@ -44,18 +52,14 @@ public:
             throw std::runtime_error("Module not initialized");
         }
         name = module->get_name();
-        auto want_signals = module->get_events();
-        if (want_signals)
-        {
-            for (; *want_signals; ++want_signals)
-            {
-                powertoys_events().register_receiver(*want_signals, module);
-            }
-        }
-        if (SystemMenuHelperInstace().HasCustomConfig(module))
-        {
-            powertoys_events().register_system_menu_action(module);
-        }
+        register_module();
+    }
+
+    // A module that is only loaded from dll_path when it is first used, name is what it was
+    // called when it was last loaded.
+    PowertoyModule(std::wstring name, std::wstring dll_path) :
+        name(std::move(name)), dll_path(std::move(dll_path))
+    {
     }
 
     const std::wstring& get_name() const
@@ -63,11 +67,31 @@ public:
         return name;
     }
 
+    // Loads a module created as not loaded yet, false if that fails.
+    bool load() const;
+
+    // The parsed config is cached until the revision changes, it must not be modified.
     json::JsonObject json_config() const;
 
+    // Changes whenever the module's settings may have changed.
+    uint64_t config_revision() const
+    {
+        return revision;
+    }
+
+    // For settings the module may have changed on its own.
+    void invalidate_config()
+    {
+        ++revision;
+    }
+
     const std::wstring get_config() const
     {
         std::wstring result;
+        if (!load())
+        {
+            return result;
+        }
         int size = 0;
         module->get_config(nullptr, &size);
         wchar_t* buffer = new wchar_t[size];
@@ -81,39 +105,77 @@ public:
 
     void set_config(const std::wstring& config)
     {
+        if (!load())
+        {
+            return;
+        }
         module->set_config(config.c_str());
+        ++revision;
+        powertoys_events().update_hotkeys(module.get());
     }
 
     void call_custom_action(const std::wstring& action)
     {
+        if (!load())
+        {
+            return;
+        }
         module->call_custom_action(action.c_str());
+        ++revision;
     }
 
     intptr_t signal_event(const std::wstring& signal_event, intptr_t data)
     {
+        if (!module)
+        {
+            return 0;
+        }
         return module->signal_event(signal_event.c_str(), data);
     }
 
+    // Modules that aren't loaded yet are disabled.
     bool is_enabled()
     {
-        return module->is_enabled();
+        return module && module->is_enabled();
     }
 
     void enable()
     {
+        if (!load())
+        {
+            return;
+        }
         module->enable();
+        ++revision;
+        powertoys_events().update_hotkeys(module.get());
     }
 
     void disable()
     {
+        if (!module)
+        {
+            return;
+        }
         module->disable();
+        ++revision;
+        powertoys_events().update_hotkeys(module.get());
     }
 
 private:
-    std::unique_ptr<HMODULE, PowertoyModuleDLLDeleter> handle;
-    std::unique_ptr<PowertoyModuleIface, PowertoyModuleDeleter> module;
+    void register_module() const;
+
+    // Set when the module is loaded, which can happen in const accessors.
+    mutable std::unique_ptr<HMODULE, PowertoyModuleDLLDeleter> handle;
+    mutable std::unique_ptr<PowertoyModuleIface, PowertoyModuleDeleter> module;
     std::wstring name;
+    std::wstring dll_path;
+    uint64_t revision = 0;
+    mutable std::optional<json::JsonObject> cached_config;
+    mutable uint64_t cached_revision = 0;
 };
 
+// Loads the DLL and creates its powertoy. Doesn't touch the runner state, so modules can be
+// created on several threads at once; throws if the DLL can't be loaded or has no powertoy.
+CreatedPowertoy create_powertoy(const std::wstring& filename);
 PowertoyModule load_powertoy(const std::wstring& filename);
 std::unordered_map<std::wstring, PowertoyModule>& modules();
@@ -4,9 +4,72 @@
 #include "win_hook_event.h"
 #include "system_menu_helper.h"
 
+static_assert(LL_KEYBOARD_MODIFIER_WIN == keyboard_modifiers::win);
+static_assert(LL_KEYBOARD_MODIFIER_CTRL == keyboard_modifiers::ctrl);
+static_assert(LL_KEYBOARD_MODIFIER_SHIFT == keyboard_modifiers::shift);
+static_assert(LL_KEYBOARD_MODIFIER_ALT == keyboard_modifiers::alt);
+
+static KeyInterest keyboard_interest(PowertoyModuleIface* module)
+{
+    LowlevelKeyboardFilter filter{};
+    if (!module->get_keyboard_filter(&filter))
+    {
+        return KeyInterest::all_keys();
+    }
+
+    KeyInterest interest;
+    std::copy(std::begin(filter.keys), std::end(filter.keys), interest.keys.begin());
+    interest.modifiers = filter.modifiers;
+    interest.key_up = filter.key_up;
+    return interest;
+}
+
+static std::vector<Hotkey> module_hotkeys(PowertoyModuleIface* module)
+{
+    std::vector<LowlevelKeyboardHotkey> buffer(module->get_hotkeys(nullptr, 0));
+    if (buffer.empty() || (module->get_hotkeys(buffer.data(), buffer.size()) != buffer.size()))
+    {
+        return {};
+    }
+
+    std::vector<Hotkey> hotkeys;
+    for (const auto& hotkey : buffer)
+    {
+        hotkeys.push_back({ hotkey.vk, hotkey.modifiers, hotkey.swallow });
+    }
+    return hotkeys;
+}
+
+static std::vector<WinEventRange> module_win_hook_event_ranges(PowertoyModuleIface* module)
+{
+    std::vector<WinHookEventRange> buffer(module->get_win_hook_event_ranges(nullptr, 0));
+    if (buffer.empty() || (module->get_win_hook_event_ranges(buffer.data(), buffer.size()) != buffer.size()))
+    {
+        return {};
+    }
+
+    std::vector<WinEventRange> ranges;
+    for (const auto& range : buffer)
+    {
+        ranges.push_back({ range.event_min, range.event_max, range.any_object, range.object_id });
+    }
+    return ranges;
+}
+
+void wait_for_dispatch(const DispatchSequence& sequence)
+{
+    const auto position = sequence.position();
+    while (!sequence.passed(position))
+    {
+        MSG msg;
+        PeekMessage(&msg, nullptr, 0, 0, PM_NOREMOVE | PM_QS_SENDMESSAGE);
+        MsgWaitForMultipleObjects(0, nullptr, false, 1, QS_SENDMESSAGE);
+    }
+}
+
 void first_subscribed(const std::wstring& event)
 {
-    if (event == ll_keyboard)
+    if (event == ll_keyboard || event == ll_keyboard_hotkey)
         start_lowlevel_keyboard_hook();
     else if (event == win_hook_event)
         start_win_hook_event();
@@ -14,7 +77,7 @@ void first_subscribed(const std::wstring& event)
 
 void last_unsubscribed(const std::wstring& event)
 {
-    if (event == ll_keyboard)
+    if (event == ll_keyboard || event == ll_keyboard_hotkey)
         stop_lowlevel_keyboard_hook();
     else if (event == win_hook_event)
         stop_win_hook_event();
@@ -26,27 +89,75 @@ PowertoysEvents& powertoys_events()
     return powertoys_events;
 }
 
+PowertoysEvents::PowertoysEvents()
+{
+    receivers.intern(ll_keyboard);
+    receivers.intern(win_hook_event);
+    receivers.intern(ll_keyboard_hotkey);
+
+    // The events intercepted for the system menu, registered without a module.
+    win_hook_event_receivers.add_receiver(nullptr, { { EVENT_SYSTEM_MENUSTART, EVENT_SYSTEM_MENUSTART }, { EVENT_OBJECT_INVOKED, EVENT_OBJECT_INVOKED } });
+}
+
 void PowertoysEvents::register_receiver(const std::wstring& event, PowertoyModuleIface* module)
 {
     std::unique_lock lock(mutex);
-    auto& subscribers = receivers[event];
-    if (subscribers.empty())
+    if (event == ll_keyboard)
+    {
+        keyboard_receivers.add_receiver(module, keyboard_interest(module));
+    }
+    else if (event == ll_keyboard_hotkey)
+    {
+        hotkeys.set_hotkeys(module, module_hotkeys(module));
+    }
+    else if (event == win_hook_event)
+    {
+        win_hook_event_receivers.add_receiver(module, module_win_hook_event_ranges(module));
+    }
+    if (receivers.add_receiver(event, module))
     {
         first_subscribed(event);
     }
-    subscribers.push_back(module);
+    else if (event == win_hook_event)
+    {
+        update_win_hook_event();
+    }
 }
 
 void PowertoysEvents::unregister_receiver(PowertoyModuleIface* module)
 {
     std::unique_lock lock(mutex);
-    for (auto& [event, subscribers] : receivers)
+    const auto& win_hook_event_modules = receivers.receivers(win_hook_event_id);
+    const bool win_hook_event_module = std::find(begin(win_hook_event_modules), end(win_hook_event_modules), module) != end(win_hook_event_modules);
+    keyboard_receivers.remove_receiver(module);
+    hotkeys.remove_receiver(module);
+    win_hook_event_receivers.remove_receiver(module);
+    // The module is destroyed next. The hooks dispatch without locking, so wait for the event
+    // each of them may be dispatching from the tables it was just removed from, then for the
+    // hotkey actions that could have queued. Events queued before the WinEvent filter was
+    // swapped are dispatched with the new one, and the hooks are only narrowed afterwards.
+    wait_for_keyboard_dispatch();
+    wait_for_win_hook_dispatch();
+    flush_hotkey_actions();
+    const auto emptied = receivers.remove_receiver(module);
+    for (auto event : emptied)
     {
-        subscribers.erase(remove(begin(subscribers), end(subscribers), module), end(subscribers));
-        if (subscribers.empty())
-        {
-            last_unsubscribed(event);
-        }
+        last_unsubscribed(receivers.name(event));
+    }
+    if (win_hook_event_module && (std::find(begin(emptied), end(emptied), win_hook_event_id) == end(emptied)))
+    {
+        update_win_hook_event();
+    }
+}
+
+void PowertoysEvents::update_hotkeys(PowertoyModuleIface* module)
+{
+    std::unique_lock lock(mutex);
+    const auto& subscribed = receivers.receivers(ll_keyboard_hotkey_id);
+    if (std::find(begin(subscribed), end(subscribed), module) != end(subscribed))
+    {
+        hotkeys.set_hotkeys(module, module_hotkeys(module));
+        flush_hotkey_actions();
     }
 }
 
@@ -89,17 +200,55 @@ void PowertoysEvents::handle_system_menu_action(const WinHookEvent& data)
     }
 }
 
-intptr_t PowertoysEvents::signal_event(const std::wstring& event, intptr_t data)
+intptr_t PowertoysEvents::signal_event(event_id event, intptr_t data)
 {
     intptr_t rvalue = 0;
-    std::shared_lock lock(mutex);
-    if (auto it = receivers.find(event); it != end(receivers))
+    for (auto module : receivers.receivers(event))
     {
-        for (auto& module : it->second)
+        if (module)
+            rvalue |= module->signal_event(receivers.name(event), data);
+    }
+    return rvalue;
+}
+
+std::vector<std::pair<uint32_t, uint32_t>> PowertoysEvents::win_hook_event_ranges() const
+{
+    return win_hook_event_receivers.hook_ranges();
+}
+
+bool PowertoysEvents::wants_win_hook_event(DWORD event, LONG object) const
+{
+    return win_hook_event_receivers.wanted(event, object);
+}
+
+size_t PowertoysEvents::signal_win_hook_event(WinHookEvent& event)
+{
+    size_t signaled = 0;
+    win_hook_event_receivers.dispatch(event.event, event.idObject, [&event, &signaled](PowertoyModuleIface* module) {
+        if (module)
         {
-            if (module)
-                rvalue |= module->signal_event(event.c_str(), data);
+            module->signal_event(win_hook_event, reinterpret_cast<intptr_t>(&event));
+            signaled++;
         }
+    });
+    return signaled;
+}
+
+intptr_t PowertoysEvents::signal_keyboard_event(LowlevelKeyboardEvent& event)
+{
+    const DWORD vk = event.lParam->vkCode;
+    const bool key_down = (event.wParam == WM_KEYDOWN) || (event.wParam == WM_SYSKEYDOWN);
+    intptr_t rvalue = keyboard_receivers.dispatch(vk, key_down, [&event](PowertoyModuleIface* module) {
+        return module->signal_event(ll_keyboard, reinterpret_cast<intptr_t>(&event));
+    });
+
+    // The modifiers are tracked by the dispatcher, which has seen this key already.
+    const auto queue_action = [](PowertoyModuleIface* module, const Hotkey& hotkey) {
+        queue_hotkey_action(module, { hotkey.vk, hotkey.modifiers, hotkey.swallow });
+    };
+    if (key_down && hotkeys.dispatch(vk, keyboard_receivers.held_modifiers(), queue_action))
+    {
+        rvalue |= 1;
     }
     return rvalue;
 }
\ No newline at end of file
@@ -2,27 +2,63 @@
 
 #include <interface/powertoy_module_interface.h>
 #include <interface/win_hook_event_data.h>
+#include <interface/lowlevel_keyboard_event_data.h>
+#include <common/event_dispatch_table.h>
+#include <common/keyboard_dispatch.h>
+#include <common/win_event_filter.h>
+#include <common/dispatch_sequence.h>
 #include <string>
 
 class PowertoysEvents
 {
 public:
+    using event_id = EventDispatchTable<PowertoyModuleIface>::event_id;
+
+    // The events the runner raises itself are interned first, so the hooks know their ids up front.
+    static constexpr event_id ll_keyboard_id = 0;
+    static constexpr event_id win_hook_event_id = 1;
+    static constexpr event_id ll_keyboard_hotkey_id = 2;
+
+    PowertoysEvents();
+
     void register_receiver(const std::wstring& event, PowertoyModuleIface* module);
+    // Returns once no hook thread can call the module any more, so it can be destroyed.
     void unregister_receiver(PowertoyModuleIface* module);
+    // Asks an ll_keyboard_hotkey receiver for its hotkeys again.
+    void update_hotkeys(PowertoyModuleIface* module);
 
     void register_system_menu_action(PowertoyModuleIface* module);
     void unregister_system_menu_action(PowertoyModuleIface* module);
     void handle_system_menu_action(const WinHookEvent& data);
 
-    intptr_t signal_event(const std::wstring& event, intptr_t data);
+    intptr_t signal_event(event_id event, intptr_t data);
+
+    // The fewest event ranges to hook, and whether any module wants an event; the WinEvent
+    // hook callback drops the events that no module wants before queueing them.
+    std::vector<std::pair<uint32_t, uint32_t>> win_hook_event_ranges() const;
+    bool wants_win_hook_event(DWORD event, LONG object) const;
+    // Called from the WinEvent dispatch thread, returns the number of modules signaled.
+    size_t signal_win_hook_event(WinHookEvent& event);
+
+    // Called from the keyboard hook on every keystroke: takes no lock, doesn't allocate and
+    // only signals the modules whose keyboard filter the key passes. Hotkey actions are
+    // queued for the hotkey worker instead.
+    intptr_t signal_keyboard_event(LowlevelKeyboardEvent& event);
 
 private:
-    std::shared_mutex mutex;
-    std::unordered_map<std::wstring, std::vector<PowertoyModuleIface*>> receivers;
+    std::mutex mutex;
+    EventDispatchTable<PowertoyModuleIface> receivers;
+    KeyboardDispatcher<PowertoyModuleIface> keyboard_receivers;
+    HotkeyTable<PowertoyModuleIface> hotkeys;
+    WinEventFilter<PowertoyModuleIface> win_hook_event_receivers;
     std::unordered_set<PowertoyModuleIface*> system_menu_receivers;
 };
 
 PowertoysEvents& powertoys_events();
 
+// Waits until the dispatch running on another thread when it was called, if any, has finished.
+// Sent messages are handled meanwhile, as a receiver may be waiting on this thread.
+void wait_for_dispatch(const DispatchSequence& sequence);
+
 void first_subscribed(const std::wstring& event);
 void last_unsubscribed(const std::wstring& event);
@@ -14,35 +14,110 @@
 #include "restart_elevated.h"
 
 #include <common/json.h>
+#include <common/json_merge_patch.h>
 
 #define BUFSIZE 1024
 
 TwoWayPipeMessageIPC* current_settings_ipc = NULL;
 
-json::JsonObject get_power_toys_settings()
+// The settings the settings window was last sent. The window gets all of them when it asks to
+// refresh, and from then on only what changed, as a JSON merge patch against the version before.
+struct SentSettings
 {
-    json::JsonObject result;
-    for (const auto& [name, powertoy] : modules())
+    uint64_t version = 0;
+    // Not set until all the settings are sent for the first time
+    json::JsonObject general{ nullptr };
+    // The revision and config of every module
+    std::unordered_map<std::wstring, std::pair<uint64_t, json::JsonObject>> powertoys;
+};
+
+SentSettings sent_settings;
+
+void send_settings_message(const json::JsonObject& message)
+{
+    std::wstring settings_string{ message.Stringify().c_str() };
+    current_settings_ipc->send(std::move(settings_string));
+}
+
+void send_all_settings()
+{
+    sent_settings.general = get_general_settings();
+    sent_settings.powertoys.clear();
+    json::JsonObject powertoys;
+    for (auto& [name, powertoy] : modules())
     {
+        // Modules may have changed their settings on their own since the window last asked.
+        powertoy.invalidate_config();
         try
         {
-            result.SetNamedValue(name, powertoy.json_config());
+            const auto config = powertoy.json_config();
+            powertoys.SetNamedValue(name, config);
+            sent_settings.powertoys[name] = { powertoy.config_revision(), config };
         }
         catch (...)
         {
             // TODO: handle malformed JSON.
         }
     }
-    return result;
+
+    json::JsonObject result;
+    result.SetNamedValue(L"version", json::value(++sent_settings.version));
+    result.SetNamedValue(L"general", sent_settings.general);
+    result.SetNamedValue(L"powertoys", powertoys);
+    send_settings_message(result);
 }
 
-json::JsonObject get_all_settings()
+// Only the configs of modules whose revision changed since they were sent are read and compared.
+// A patch is sent even if nothing changed, the window waits for it after saving.
+void send_settings_changes()
 {
-    json::JsonObject result;
+    if (!sent_settings.general)
+    {
+        send_all_settings();
+        return;
+    }
 
-    result.SetNamedValue(L"general", get_general_settings());
-    result.SetNamedValue(L"powertoys", get_power_toys_settings());
-    return result;
+    json::JsonObject patch;
+    const auto general = get_general_settings();
+    const auto general_patch = json::merge_diff(sent_settings.general, general);
+    if (general_patch.Size() > 0)
+    {
+        patch.SetNamedValue(L"general", general_patch);
+    }
+    sent_settings.general = general;
+
+    json::JsonObject powertoys_patch;
+    for (const auto& [name, powertoy] : modules())
+    {
+        const auto sent = sent_settings.powertoys.find(name);
+        if (sent != sent_settings.powertoys.end() && sent->second.first == powertoy.config_revision())
+        {
+            continue;
+        }
+        try
+        {
+            const auto config = powertoy.json_config();
+            const auto module_patch = sent != sent_settings.powertoys.end() ? json::merge_diff(sent->second.second, config) : config;
+            if (module_patch.Size() > 0)
+            {
+                powertoys_patch.SetNamedValue(name, module_patch);
+            }
+            sent_settings.powertoys[name] = { powertoy.config_revision(), config };
+        }
+        catch (...)
+        {
+            // TODO: handle malformed JSON.
+        }
+    }
+    if (powertoys_patch.Size() > 0)
+    {
+        patch.SetNamedValue(L"powertoys", powertoys_patch);
+    }
+
+    json::JsonObject result;
+    result.SetNamedValue(L"version", json::value(++sent_settings.version));
+    result.SetNamedValue(L"patch", patch);
+    send_settings_message(result);
 }
 
 void dispatch_json_action_to_module(const json::JsonObject& powertoys_configs)
@@ -103,8 +178,7 @@ void dispatch_received_json(const std::wstring& json_to_parse)
             apply_general_settings(value.GetObjectW());
             if (current_settings_ipc != nullptr)
             {
-                const std::wstring settings_string{ get_all_settings().Stringify().c_str() };
-                current_settings_ipc->send(settings_string);
+                send_settings_changes();
             }
         }
         else if (name == L"powertoys")
@@ -112,16 +186,14 @@ void dispatch_received_json(const std::wstring& json_to_parse)
             dispatch_json_config_to_modules(value.GetObjectW());
             if (current_settings_ipc != nullptr)
             {
-                const std::wstring settings_string{ get_all_settings().Stringify().c_str() };
-                current_settings_ipc->send(settings_string);
+                send_settings_changes();
             }
         }
         else if (name == L"refresh")
         {
             if (current_settings_ipc != nullptr)
             {
-                const std::wstring settings_string{ get_all_settings().Stringify().c_str() };
-                current_settings_ipc->send(settings_string);
+                send_all_settings();
             }
         }
         else if (name == L"action")
@@ -134,15 +206,16 @@ void dispatch_received_json(const std::wstring& json_to_parse)
 
 void dispatch_received_json_callback(PVOID data)
 {
-    std::wstring* msg = (std::wstring*)data;
-    dispatch_received_json(*msg);
+    SharedMessage* msg = (SharedMessage*)data;
+    dispatch_received_json(msg->str());
     delete msg;
 }
 
-void receive_json_send_to_main_thread(const std::wstring& msg)
+void receive_json_send_to_main_thread(SharedMessage msg)
 {
-    std::wstring* copy = new std::wstring(msg);
-    dispatch_run_on_main_ui_thread(dispatch_received_json_callback, copy);
+    // Only the reference to the text is posted, not a copy of it.
+    SharedMessage* posted = new SharedMessage(std::move(msg));
+    dispatch_run_on_main_ui_thread(dispatch_received_json_callback, posted);
 }
 
 // Try to run the Settings process with non-elevated privileges.
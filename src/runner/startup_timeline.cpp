@@ -0,0 +1,76 @@
+#include "pch.h"
+#include "startup_timeline.h"
+
+#include <common/json.h>
+#include <common/settings_helpers.h>
+
+namespace
+{
+    struct Entry
+    {
+        std::wstring phase;
+        DWORD thread;
+        startup_timeline::clock::time_point begin;
+        startup_timeline::clock::time_point end;
+    };
+
+    std::mutex mutex;
+    startup_timeline::clock::time_point started;
+    std::vector<Entry> entries;
+    bool written = false;
+
+    int64_t microseconds(startup_timeline::clock::duration duration)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    }
+}
+
+void startup_timeline::start()
+{
+    std::lock_guard lock(mutex);
+    started = clock::now();
+    entries.clear();
+    written = false;
+}
+
+void startup_timeline::record(const std::wstring& phase, clock::time_point begin, clock::time_point end)
+{
+    std::lock_guard lock(mutex);
+    if (!written)
+    {
+        entries.push_back({ phase, GetCurrentThreadId(), begin, end });
+    }
+}
+
+void startup_timeline::write()
+{
+    // Complete events of the trace event format, with times in microseconds.
+    json::JsonArray events;
+    {
+        std::lock_guard lock(mutex);
+        written = true;
+        for (const auto& entry : entries)
+        {
+            json::JsonObject event;
+            event.SetNamedValue(L"name", json::value(entry.phase));
+            event.SetNamedValue(L"ph", json::value(L"X"));
+            event.SetNamedValue(L"ts", json::value(microseconds(entry.begin - started)));
+            event.SetNamedValue(L"dur", json::value(microseconds(entry.end - entry.begin)));
+            event.SetNamedValue(L"pid", json::value(GetCurrentProcessId()));
+            event.SetNamedValue(L"tid", json::value(entry.thread));
+            events.Append(event);
+        }
+    }
+
+    json::JsonObject timeline;
+    timeline.SetNamedValue(L"traceEvents", events);
+    timeline.SetNamedValue(L"displayTimeUnit", json::value(L"ms"));
+    try
+    {
+        json::to_file(PTSettingsHelper::get_root_save_folder_location() + L"\\startup_timeline.json", timeline);
+    }
+    catch (...)
+    {
+        // The timeline is only a diagnostic, startup goes on without it.
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+// Records how long the runner spends in each startup phase and on which thread, and writes it as
+// trace events to startup_timeline.json in the PowerToys settings folder, where chrome://tracing
+// or edge://tracing show it as a timeline.
+namespace startup_timeline
+{
+    using clock = std::chrono::steady_clock;
+
+    // Starts the timeline over, the phases are recorded relative to it.
+    void start();
+    // Can be called from any thread.
+    void record(const std::wstring& phase, clock::time_point begin, clock::time_point end);
+    // Writes the phases recorded so far, later ones are ignored.
+    void write();
+
+    // Records the phase from construction to destruction.
+    class Phase
+    {
+    public:
+        explicit Phase(std::wstring name) :
+            name(std::move(name)), begin(clock::now())
+        {
+        }
+
+        ~Phase()
+        {
+            record(name, begin, clock::now());
+        }
+
+        Phase(const Phase&) = delete;
+        Phase& operator=(const Phase&) = delete;
+
+    private:
+        std::wstring name;
+        clock::time_point begin;
+    };
+}
@@ -28,3 +28,36 @@ void Trace::EventLaunch(const std::wstring& versionNumber)
         TraceLoggingBoolean(TRUE, "UTCReplace_AppSessionGuid"),
         TraceLoggingKeyword(PROJECT_KEYWORD_MEASURE));
 }
+
+void Trace::EventKeyboardHookStats(uint64_t invocations, uint64_t overBudget, int64_t slowestMicroseconds, uint64_t droppedHotkeyActions)
+{
+    TraceLoggingWrite(
+        g_hProvider,
+        "Runner_KeyboardHookStats",
+        TraceLoggingUInt64(invocations, "Invocations"),
+        TraceLoggingUInt64(overBudget, "OverBudget"),
+        TraceLoggingInt64(slowestMicroseconds, "SlowestMicroseconds"),
+        TraceLoggingUInt64(droppedHotkeyActions, "DroppedHotkeyActions"),
+        ProjectTelemetryPrivacyDataTag(ProjectTelemetryTag_ProductAndServicePerformance),
+        TraceLoggingBoolean(TRUE, "UTCReplace_AppSessionGuid"),
+        TraceLoggingKeyword(PROJECT_KEYWORD_MEASURE));
+}
+
+void Trace::EventWinHookEventStats(uint64_t received, uint64_t filtered, uint64_t merged, uint64_t dropped, uint64_t delivered, uint64_t peakReceivedPerSecond, uint64_t peakFilteredPerSecond, uint64_t peakDeliveredPerSecond, int64_t seconds)
+{
+    TraceLoggingWrite(
+        g_hProvider,
+        "Runner_WinHookEventStats",
+        TraceLoggingUInt64(received, "Received"),
+        TraceLoggingUInt64(filtered, "Filtered"),
+        TraceLoggingUInt64(merged, "Merged"),
+        TraceLoggingUInt64(dropped, "Dropped"),
+        TraceLoggingUInt64(delivered, "Delivered"),
+        TraceLoggingUInt64(peakReceivedPerSecond, "PeakReceivedPerSecond"),
+        TraceLoggingUInt64(peakFilteredPerSecond, "PeakFilteredPerSecond"),
+        TraceLoggingUInt64(peakDeliveredPerSecond, "PeakDeliveredPerSecond"),
+        TraceLoggingInt64(seconds, "Seconds"),
+        ProjectTelemetryPrivacyDataTag(ProjectTelemetryTag_ProductAndServicePerformance),
+        TraceLoggingBoolean(TRUE, "UTCReplace_AppSessionGuid"),
+        TraceLoggingKeyword(PROJECT_KEYWORD_MEASURE));
+}
@@ -6,4 +6,6 @@ public:
     static void RegisterProvider();
     static void UnregisterProvider();
     static void EventLaunch(const std::wstring& versionNumber);
+    static void EventKeyboardHookStats(uint64_t invocations, uint64_t overBudget, int64_t slowestMicroseconds, uint64_t droppedHotkeyActions);
+    static void EventWinHookEventStats(uint64_t received, uint64_t filtered, uint64_t merged, uint64_t dropped, uint64_t delivered, uint64_t peakReceivedPerSecond, uint64_t peakFilteredPerSecond, uint64_t peakDeliveredPerSecond, int64_t seconds);
 };
@@ -1,16 +1,91 @@
 #include "pch.h"
 #include "win_hook_event.h"
 #include "powertoy_module.h"
+#include "trace.h"
+#include <common/mpsc_ring.h>
+#include <common/dispatch_sequence.h>
 #include <mutex>
-#include <deque>
 #include <thread>
 
+// Guards starting, updating and stopping the hooks; the events themselves go through hook_events.
 static std::mutex mutex;
-static std::deque<WinHookEvent> hook_events;
-static std::condition_variable dispatch_cv;
 
 void intercept_system_menu_action(intptr_t);
 
+namespace
+{
+    // Counts events in the current second and remembers the busiest second.
+    struct EventRate
+    {
+        std::atomic<uint64_t> total = 0;
+        std::atomic<uint64_t> this_second = 0;
+        std::atomic<uint64_t> peak = 0;
+
+        void add(uint64_t count = 1)
+        {
+            total.fetch_add(count, std::memory_order_relaxed);
+            this_second.fetch_add(count, std::memory_order_relaxed);
+        }
+
+        void roll()
+        {
+            const auto count = this_second.exchange(0, std::memory_order_relaxed);
+            if (count > peak.load(std::memory_order_relaxed))
+            {
+                peak.store(count, std::memory_order_relaxed);
+            }
+        }
+
+        void reset()
+        {
+            total = 0;
+            this_second = 0;
+            peak = 0;
+        }
+    };
+
+    EventRate received;
+    EventRate filtered;
+    EventRate merged;
+    EventRate dropped;
+    EventRate delivered;
+    std::chrono::steady_clock::time_point started;
+    std::chrono::steady_clock::time_point second_started; // Only touched by the hook callback
+
+    // The hook callback hands events to the dispatch thread without locking. A drag or a window
+    // animation can send thousands of events a second; if the dispatch thread falls behind, the
+    // ring fills up and further events are dropped and counted instead of piling up.
+    MpscRing<WinHookEvent, 1024> hook_events;
+    constexpr size_t dispatch_batch_size = 64;
+
+    // Set while the dispatch thread waits for events, so the callback only signals when it has to.
+    std::atomic<bool> dispatch_waiting = false;
+    HANDLE dispatch_wakeup = nullptr;
+
+    // The last event queued by the hook callback, which always runs on the thread that installed
+    // the hooks, so this needs no synchronization.
+    struct QueuedEvent
+    {
+        DWORD event = 0;
+        HWND window = nullptr;
+        LONG object = 0;
+        size_t position = 0;
+    };
+    QueuedEvent last_queued;
+
+    // A LOCATIONCHANGE of the window whose LOCATIONCHANGE was queued last and hasn't been taken off
+    // the ring yet is merged into it: the modules read the window and cursor positions when they
+    // handle the event, so signaling them once covers both moves.
+    bool merges_with_last_queued(DWORD event, HWND window, LONG object)
+    {
+        return event == EVENT_OBJECT_LOCATIONCHANGE &&
+               last_queued.event == event &&
+               last_queued.window == window &&
+               last_queued.object == object &&
+               hook_events.popped() <= last_queued.position;
+    }
+}
+
 static void CALLBACK win_hook_event_proc(HWINEVENTHOOK winEventHook,
                                          DWORD event,
                                          HWND window,
@@ -19,41 +94,99 @@ static void CALLBACK win_hook_event_proc(HWINEVENTHOOK winEventHook,
                                          DWORD eventThread,
                                          DWORD eventTime)
 {
-    std::unique_lock lock(mutex);
-    hook_events.push_back({ event,
-                            window,
-                            object,
-                            child,
-                            eventThread,
-                            eventTime });
-    lock.unlock();
-    dispatch_cv.notify_one();
+    const auto now = std::chrono::steady_clock::now();
+    if (now - second_started >= std::chrono::seconds(1))
+    {
+        received.roll();
+        filtered.roll();
+        merged.roll();
+        dropped.roll();
+        delivered.roll();
+        second_started = now;
+    }
+
+    received.add();
+    // The hooks cover whole event ranges, the object ids are only checked here.
+    if (!powertoys_events().wants_win_hook_event(event, object))
+    {
+        filtered.add();
+        return;
+    }
+
+    if (merges_with_last_queued(event, window, object))
+    {
+        merged.add();
+        return;
+    }
+
+    size_t position;
+    if (!hook_events.try_push({ event, window, object, child, eventThread, eventTime }, &position))
+    {
+        dropped.add();
+        return;
+    }
+    last_queued = { event, window, object, position };
+
+    // Pairs with the fence in dispatch_thread_proc: either the dispatch thread sees the event
+    // before it goes to sleep, or it is seen waiting here and woken up.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (dispatch_waiting.load(std::memory_order_relaxed))
+    {
+        SetEvent(dispatch_wakeup);
+    }
 }
 
-static bool running = false;
+static std::atomic<bool> running = false;
 static std::thread dispatch_thread;
+static std::atomic<DWORD> dispatch_thread_id = 0;
+static DispatchSequence dispatches;
 static void dispatch_thread_proc()
 {
-    std::unique_lock lock(mutex);
+    dispatch_thread_id = GetCurrentThreadId();
+    WinHookEvent batch[dispatch_batch_size];
     while (running)
     {
-        dispatch_cv.wait(lock, [] { return !running || !hook_events.empty(); });
-        if (!running)
-            return;
-        while (!hook_events.empty())
+        const size_t count = hook_events.pop_batch(batch, dispatch_batch_size);
+        for (size_t i = 0; i < count; ++i)
         {
-            auto event = hook_events.front();
-            hook_events.pop_front();
-            lock.unlock();
-            intptr_t data = reinterpret_cast<intptr_t>(&event);
+            DispatchSequence::Scope dispatching(dispatches);
+            intptr_t data = reinterpret_cast<intptr_t>(&batch[i]);
             intercept_system_menu_action(data);
-            powertoys_events().signal_event(win_hook_event, data);
-            lock.lock();
+            delivered.add(powertoys_events().signal_win_hook_event(batch[i]));
+        }
+        if (count)
+        {
+            continue;
         }
+
+        dispatch_waiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (running && hook_events.empty())
+        {
+            WaitForSingleObject(dispatch_wakeup, INFINITE);
+        }
+        dispatch_waiting.store(false, std::memory_order_relaxed);
+    }
+}
+
+static std::vector<HWINEVENTHOOK> hook_handles;
+
+static void install_hooks()
+{
+    for (const auto& [event_min, event_max] : powertoys_events().win_hook_event_ranges())
+    {
+        hook_handles.push_back(SetWinEventHook(event_min, event_max, nullptr, win_hook_event_proc, 0, 0, WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS));
     }
 }
 
-static HWINEVENTHOOK hook_handle;
+static void uninstall_hooks()
+{
+    for (auto hook_handle : hook_handles)
+    {
+        UnhookWinEvent(hook_handle);
+    }
+    hook_handles.clear();
+}
 
 void start_win_hook_event()
 {
@@ -61,8 +194,19 @@ void start_win_hook_event()
     if (running)
         return;
     running = true;
+    started = second_started = std::chrono::steady_clock::now();
+    dispatch_wakeup = CreateEventW(nullptr, FALSE, FALSE, nullptr);
     dispatch_thread = std::thread(dispatch_thread_proc);
-    hook_handle = SetWinEventHook(EVENT_MIN, EVENT_MAX, nullptr, win_hook_event_proc, 0, 0, WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS);
+    install_hooks();
+}
+
+void update_win_hook_event()
+{
+    std::lock_guard lock(mutex);
+    if (!running)
+        return;
+    uninstall_hooks();
+    install_hooks();
 }
 
 void stop_win_hook_event()
@@ -71,13 +215,43 @@ void stop_win_hook_event()
     if (!running)
         return;
     running = false;
-    UnhookWinEvent(hook_handle);
-    lock.unlock();
-    dispatch_cv.notify_one();
+    uninstall_hooks();
+    SetEvent(dispatch_wakeup);
     dispatch_thread.join();
-    lock.lock();
-    hook_events.clear();
-    hook_events.shrink_to_fit();
+    dispatch_thread_id = 0;
+    CloseHandle(dispatch_wakeup);
+    dispatch_wakeup = nullptr;
+
+    // Events still queued are dropped, as no hook can push any more.
+    WinHookEvent batch[dispatch_batch_size];
+    while (const size_t count = hook_events.pop_batch(batch, dispatch_batch_size))
+    {
+        dropped.add(count);
+    }
+    last_queued = {};
+
+    const auto stats = win_hook_event_stats();
+    Trace::EventWinHookEventStats(stats.received, stats.filtered, stats.merged, stats.dropped, stats.delivered, stats.peak_received_per_second, stats.peak_filtered_per_second, stats.peak_delivered_per_second, stats.seconds);
+    received.reset();
+    filtered.reset();
+    merged.reset();
+    dropped.reset();
+    delivered.reset();
+}
+
+void wait_for_win_hook_dispatch()
+{
+    // A receiver removing itself while handling an event would wait for itself.
+    if (GetCurrentThreadId() != dispatch_thread_id)
+    {
+        wait_for_dispatch(dispatches);
+    }
+}
+
+WinHookEventStats win_hook_event_stats()
+{
+    const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - started).count();
+    return { received.total, filtered.total, merged.total, dropped.total, delivered.total, received.peak, filtered.peak, delivered.peak, seconds };
 }
 
 void intercept_system_menu_action(intptr_t data)
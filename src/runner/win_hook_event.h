@@ -3,4 +3,24 @@
 #include <interface/win_hook_event_data.h>
 
 void start_win_hook_event();
+// Reinstalls the hooks after the events the modules want changed.
+void update_win_hook_event();
 void stop_win_hook_event();
+// Waits until the dispatch thread is done with the event it may be dispatching, so receivers
+// removed from the WinEvent filter before the call are no longer used by it.
+void wait_for_win_hook_dispatch();
+
+struct WinHookEventStats
+{
+    uint64_t received; // By the hooks
+    uint64_t filtered; // Dropped in the hook callback, no module wanted them
+    uint64_t merged; // LOCATIONCHANGE events merged into the same one of the window still queued
+    uint64_t dropped; // Not queued because the dispatch thread fell behind, or still queued when stopped
+    uint64_t delivered; // Module signal_event calls
+    uint64_t peak_received_per_second;
+    uint64_t peak_filtered_per_second;
+    uint64_t peak_delivered_per_second;
+    int64_t seconds; // Since the hooks were started
+};
+
+WinHookEventStats win_hook_event_stats();
@@ -8,11 +8,32 @@ import {setup_powertoys_icons} from '../setup_icons';
 // Register fabric UI icons and powertoys logos as icons.
 setup_powertoys_icons();
 
+// Returns target with a JSON merge patch (RFC 7396) applied, leaving both unchanged.
+function apply_merge_patch(target: any, patch: any): any {
+  if (typeof patch !== 'object' || patch === null || Array.isArray(patch)) {
+    return patch;
+  }
+  let result: any = (typeof target === 'object' && target !== null && !Array.isArray(target)) ? {...target} : {};
+  for (const key of Object.keys(patch)) {
+    if (patch[key] === null) {
+      delete result[key];
+    } else {
+      result[key] = apply_merge_patch(result[key], patch[key]);
+    }
+  }
+  return result;
+}
+
 export class App extends React.Component <any, any> {
   settings_screen_ref:any;
+  // Kept outside of the state, so patches received before the state is updated apply on top of each other.
+  received_settings:any;
+  settings_version:number;
   constructor(props: any) {
     super(props);
     this.settings_screen_ref = null;
+    this.received_settings = {};
+    this.settings_version = 0;
     this.state = {
       data_changed : false,
       saving : false,
@@ -32,7 +53,20 @@ export class App extends React.Component <any, any> {
     (window as any).output_from_webview(msg);
   }
 
-  public receive_config_msg(config: any):void {
+  public receive_config_msg(msg: any):void {
+    let config:any;
+    if(msg.hasOwnProperty('patch')) {
+      // Only what changed since the previous version. Ask for all the settings if one was missed.
+      if(msg.version !== this.settings_version + 1) {
+        this.send_message_to_application(JSON.stringify({'refresh':true}));
+        return;
+      }
+      config = apply_merge_patch(this.received_settings, msg.patch);
+    } else {
+      config = {general: msg.general, powertoys: msg.powertoys};
+    }
+    this.received_settings = config;
+    this.settings_version = msg.version;
     let current_selected_menu = this.state.selected_menu;
     if(!config.hasOwnProperty('powertoys') || !config.powertoys.hasOwnProperty(current_selected_menu)) {
       current_selected_menu='general';
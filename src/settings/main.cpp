@@ -102,7 +102,7 @@ void resize_web_view()
 
 #define SEND_TO_WEBVIEW_MSG 1
 
-void send_message_to_webview(const std::wstring& msg)
+void send_message_to_webview(SharedMessage msg)
 {
     if (g_main_wnd != nullptr && wm_data_for_webview != 0)
     {
@@ -111,15 +111,14 @@ void send_message_to_webview(const std::wstring& msg)
         // g_webview.InvokeScriptAsync can't be made from other threads.
 
         PCOPYDATASTRUCT message = new COPYDATASTRUCT();
-        DWORD buff_size = (DWORD)(msg.length() + 1);
 
-        // 'wnd_static_proc()' will free the buffer allocated here.
-        wchar_t* buffer = new wchar_t[buff_size];
+        // 'wnd_static_proc()' will free the message allocated here. It shares the text
+        // rather than copying it.
+        SharedMessage* shared = new SharedMessage(std::move(msg));
 
-        wcscpy_s(buffer, buff_size, msg.c_str());
         message->dwData = SEND_TO_WEBVIEW_MSG;
-        message->cbData = buff_size * sizeof(wchar_t);
-        message->lpData = (PVOID)buffer;
+        message->cbData = sizeof(SharedMessage);
+        message->lpData = (PVOID)shared;
         WINRT_VERIFY(PostMessage(g_main_wnd, wm_data_for_webview, (WPARAM)g_main_wnd, (LPARAM)message));
     }
 }
@@ -195,7 +194,7 @@ void send_message_to_powertoys_runner(const std::wstring& msg)
               }
             }
           })json");
-        send_message_to_webview(debug_settings_info);
+        send_message_to_webview(SharedMessage(std::move(debug_settings_info)));
 #endif
     }
 }
@@ -362,12 +361,12 @@ LRESULT CALLBACK wnd_proc_static(HWND hWnd, UINT message, WPARAM wParam, LPARAM
             PCOPYDATASTRUCT msg = (PCOPYDATASTRUCT)lParam;
             if (msg->dwData == SEND_TO_WEBVIEW_MSG)
             {
-                wchar_t* json_message = (wchar_t*)(msg->lpData);
+                SharedMessage* json_message = (SharedMessage*)(msg->lpData);
                 if (g_webview != nullptr)
                 {
-                    const auto _ = g_webview.InvokeScriptAsync(hstring(L"receive_from_settings_app"), { hstring(json_message) });
+                    const auto _ = g_webview.InvokeScriptAsync(hstring(L"receive_from_settings_app"), { hstring(json_message->view()) });
                 }
-                delete[] json_message;
+                delete json_message;
             }
             // wnd_proc_static is responsible for freeing memory.
             delete msg;